@@ -0,0 +1,728 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vgl/VulkanCore.h"
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+
+/*
+Benchmark suite for the library, run headless so it works on CI with lavapipe.
+Every benchmark runs a fixed amount of work with fixed seeds rather than for a fixed time, and reports the median of its repetitions,
+so runs on the same machine and driver can be compared. The first repetition of each is a warm up and isn't counted.
+
+Usage: vgl_bench [--out report.json] [--filter name] [--quick]
+*/
+
+struct Options {
+	std::string outputPath = "vgl_bench.json";
+	std::string filter;
+	//Less work per benchmark, for smoke testing on slow software drivers
+	bool quick = false;
+};
+
+struct Measurement {
+	std::string name;
+	std::string unit;
+	//Median of the samples
+	double value = 0.0;
+	double p99 = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	uint32_t samples = 0;
+	//Which direction is a regression
+	bool higherIsBetter = false;
+};
+
+class Report {
+
+public:
+
+	void add(const std::string& _name, const std::string& _unit, std::vector<double> _samples, bool _higherIsBetter) {
+		if (_samples.empty()) { return; }
+		std::sort(_samples.begin(), _samples.end());
+
+		Measurement measurement;
+		measurement.name = _name;
+		measurement.unit = _unit;
+		measurement.value = percentile(_samples, 0.5);
+		measurement.p99 = percentile(_samples, 0.99);
+		measurement.min = _samples.front();
+		measurement.max = _samples.back();
+		measurement.samples = static_cast<uint32_t>(_samples.size());
+		measurement.higherIsBetter = _higherIsBetter;
+
+		std::printf("%-44s %14.3f %-8s (p99 %.3f, min %.3f, max %.3f, %u samples)\n", measurement.name.c_str(), measurement.value, measurement.unit.c_str(),
+			measurement.p99, measurement.min, measurement.max, measurement.samples);
+		this->measurements.push_back(measurement);
+	}
+
+	bool writeJson(const std::string& _path, const vgl::DeviceCapabilities& _capabilities, const Options& _options) const {
+		std::ofstream file(_path, std::ios::trunc);
+		if (!file.is_open()) { return false; }
+
+		uint32_t apiVersion = _capabilities.properties.apiVersion;
+		file << "{\n";
+		file << "  \"schemaVersion\": 1,\n";
+		file << "  \"quick\": " << (_options.quick ? "true" : "false") << ",\n";
+		file << "  \"device\": {\n";
+		file << "    \"name\": \"" << escape(_capabilities.properties.deviceName) << "\",\n";
+		file << "    \"driver\": \"" << escape(_capabilities.properties12.driverName) << "\",\n";
+		file << "    \"driverVersion\": " << _capabilities.properties.driverVersion << ",\n";
+		file << "    \"apiVersion\": \"" << VK_API_VERSION_MAJOR(apiVersion) << "." << VK_API_VERSION_MINOR(apiVersion) << "." << VK_API_VERSION_PATCH(apiVersion) << "\",\n";
+		file << "    \"vendorId\": " << _capabilities.properties.vendorID << ",\n";
+		file << "    \"deviceId\": " << _capabilities.properties.deviceID << "\n";
+		file << "  },\n";
+		file << "  \"benchmarks\": [";
+
+		for (size_t i = 0; i < this->measurements.size(); i++) {
+			const Measurement& measurement = this->measurements[i];
+			file << (i == 0 ? "\n" : ",\n");
+			file << "    { \"name\": \"" << escape(measurement.name) << "\", \"unit\": \"" << escape(measurement.unit) << "\", \"value\": " << measurement.value
+				<< ", \"p99\": " << measurement.p99 << ", \"min\": " << measurement.min << ", \"max\": " << measurement.max
+				<< ", \"samples\": " << measurement.samples << ", \"higherIsBetter\": " << (measurement.higherIsBetter ? "true" : "false") << " }";
+		}
+		file << "\n  ]\n}\n";
+
+		file.flush();
+		return file.good();
+	}
+
+private:
+
+	std::vector<Measurement> measurements;
+
+	static double percentile(const std::vector<double>& _sorted, double _fraction) {
+		size_t rank = static_cast<size_t>(_fraction * static_cast<double>(_sorted.size() - 1) + 0.5);
+		return _sorted[std::min(rank, _sorted.size() - 1)];
+	}
+
+	static std::string escape(const std::string& _value) {
+		std::string escaped;
+		for (char c : _value) {
+			if (c == '"' || c == '\\') { escaped += '\\'; }
+			if (static_cast<unsigned char>(c) >= 0x20) { escaped += c; }
+		}
+		return escaped;
+	}
+
+};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point _start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+}
+
+//Headless core for the benchmarks, nothing is read from or written to disk so every run starts cold
+vgl::HeadlessSettings makeSettings() {
+	vgl::HeadlessSettings settings;
+	settings.width = 1920;
+	settings.height = 1080;
+	settings.applicationName = "vgl_bench";
+	settings.pipelineCacheDirectory = "";
+	return settings;
+}
+
+//Creating and destroying the whole core, then the startup stages from the CPU profiler
+void benchmarkInit(Report& _report, const Options& _options) {
+	const uint32_t repetitions = _options.quick ? 3 : 8;
+
+	std::vector<double> createMs;
+	std::vector<double> destroyMs;
+	vgl::CpuProfiler::get().reset();
+	for (uint32_t i = 0; i <= repetitions; i++) {
+		auto start = Clock::now();
+		auto core = std::make_unique<vgl::VulkanCore>(makeSettings());
+		double created = elapsedMs(start);
+
+		start = Clock::now();
+		core.reset();
+		double destroyed = elapsedMs(start);
+
+		//The first creation loads the driver
+		if (i > 0) {
+			createMs.push_back(created);
+			destroyMs.push_back(destroyed);
+		}
+	}
+	_report.add("init/core_create", "ms", createMs, false);
+	_report.add("init/core_destroy", "ms", destroyMs, false);
+
+#ifdef VGL_PROFILING
+	//Stages include the warm up, so the medians are what matter here
+	const char* stages[] = { "VulkanCore::createInstance", "PhysicalDevice::PhysicalDevice", "LogicalDevice::LogicalDevice", "vkCreateDevice" };
+	for (const vgl::CpuScopeStats& stats : vgl::CpuProfiler::get().getReport()) {
+		for (const char* stage : stages) {
+			if (stats.name == stage) {
+				_report.add(std::string("init/") + stage, "ms", { stats.p50Ms }, false);
+			}
+		}
+	}
+#endif
+}
+
+//Sub-allocating and freeing memory of mixed sizes and alignments in a random order
+void benchmarkAllocation(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	vgl::MemoryAllocator* allocator = _vk.getLogicalDevice()->getAllocator();
+	const uint32_t repetitions = _options.quick ? 3 : 10;
+	const uint32_t allocationCount = _options.quick ? 4096 : 20000;
+
+	//Same requests every repetition and every run
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<uint32_t> sizeExponent(8, 18);
+	const VkDeviceSize alignments[] = { 256, 4096, 65536 };
+	std::vector<VkMemoryRequirements> requests(allocationCount);
+	for (VkMemoryRequirements& request : requests) {
+		request.size = (1ull << sizeExponent(rng)) + rng() % 1024;
+		request.alignment = alignments[rng() % 3];
+		request.memoryTypeBits = ~0u;
+	}
+	std::vector<uint32_t> freeOrder(allocationCount);
+	for (uint32_t i = 0; i < allocationCount; i++) {
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), rng);
+
+	std::vector<double> allocateNs;
+	std::vector<double> freeNs;
+	std::vector<vgl::MemoryAllocation> allocations(allocationCount);
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		auto start = Clock::now();
+		for (uint32_t i = 0; i < allocationCount; i++) {
+			allocations[i] = allocator->allocate(requests[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, true);
+		}
+		double allocated = elapsedMs(start);
+
+		start = Clock::now();
+		for (uint32_t index : freeOrder) {
+			allocator->free(allocations[index]);
+		}
+		double freed = elapsedMs(start);
+
+		if (repetition > 0) {
+			allocateNs.push_back(allocated * 1e6 / allocationCount);
+			freeNs.push_back(freed * 1e6 / allocationCount);
+		}
+	}
+	_report.add("memory/allocate", "ns/op", allocateNs, false);
+	_report.add("memory/free", "ns/op", freeNs, false);
+
+	//Whole buffer lifetime, including the Vulkan calls around the sub-allocation
+	const uint32_t bufferCount = _options.quick ? 256 : 2048;
+	std::vector<double> bufferUs;
+	std::vector<VkBuffer> buffers(bufferCount);
+	std::vector<vgl::MemoryAllocation> bufferMemory(bufferCount);
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		auto start = Clock::now();
+		for (uint32_t i = 0; i < bufferCount; i++) {
+			allocator->createBuffer(64 * 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffers[i], bufferMemory[i]);
+		}
+		for (uint32_t i = 0; i < bufferCount; i++) {
+			allocator->destroyBuffer(buffers[i], bufferMemory[i]);
+		}
+		if (repetition > 0) {
+			bufferUs.push_back(elapsedMs(start) * 1000.0 / bufferCount);
+		}
+	}
+	_report.add("memory/buffer_create_destroy", "us/op", bufferUs, false);
+}
+
+//Streaming data into a device local buffer through the staging ring, in small and large pieces
+void benchmarkUpload(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	vgl::MemoryAllocator* allocator = _vk.getLogicalDevice()->getAllocator();
+	vgl::UploadEngine* uploadEngine = _vk.getUploadEngine();
+	const uint32_t repetitions = _options.quick ? 2 : 5;
+	const VkDeviceSize totalSize = (_options.quick ? 64ull : 256ull) * 1024 * 1024;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	vgl::MemoryAllocation memory;
+	allocator->createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+
+	std::vector<uint32_t> data(totalSize / sizeof(uint32_t));
+	std::mt19937 rng(5678);
+	for (uint32_t& value : data) {
+		value = rng();
+	}
+
+	const VkDeviceSize pieceSizes[] = { 64ull * 1024, 4ull * 1024 * 1024 };
+	for (VkDeviceSize pieceSize : pieceSizes) {
+		std::vector<double> bandwidth;
+		for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+			auto start = Clock::now();
+			vgl::UploadTicket ticket = 0;
+			for (VkDeviceSize offset = 0; offset < totalSize; offset += pieceSize) {
+				ticket = uploadEngine->uploadBuffer(buffer, offset, reinterpret_cast<const char*>(data.data()) + offset, pieceSize);
+			}
+			uploadEngine->wait(ticket);
+			double ms = elapsedMs(start);
+
+			if (repetition > 0) {
+				bandwidth.push_back(static_cast<double>(totalSize) / (1024.0 * 1024.0) / (ms / 1000.0));
+			}
+		}
+		_report.add("upload/buffer_" + std::to_string(pieceSize / 1024) + "KiB", "MiB/s", bandwidth, true);
+	}
+
+	_vk.waitIdle();
+	allocator->destroyBuffer(buffer, memory);
+}
+
+//Recording secondaries on one thread and across the job system, outside any rendering so no pipeline or shaders are needed
+void benchmarkRecording(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	vgl::MemoryAllocator* allocator = _vk.getLogicalDevice()->getAllocator();
+	vgl::CommandRecorder* recorder = _vk.getCommandRecorder();
+	const uint32_t frames = _options.quick ? 10 : 40;
+	const uint32_t itemCount = _options.quick ? 5000 : 20000;
+	//Viewport, scissor and a 4 byte fill per item
+	const uint32_t commandsPerItem = 3;
+
+	const VkDeviceSize targetSize = 4096;
+	VkBuffer target = VK_NULL_HANDLE;
+	vgl::MemoryAllocation targetMemory;
+	allocator->createBuffer(targetSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target, targetMemory);
+
+	vgl::SecondaryInheritance inheritance;
+	auto recordItems = [&](VkCommandBuffer _commandBuffer, uint32_t _begin, uint32_t _end) {
+		for (uint32_t i = _begin; i < _end; i++) {
+			VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(i % 1920), 1080.0f, 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, { 1920, 1080 } };
+			vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+			vkCmdFillBuffer(_commandBuffer, target, (i * 4) % targetSize, 4, i);
+		}
+	};
+
+	struct Mode {
+		const char* name;
+		uint32_t batchSize;
+	};
+	const Mode modes[] = { { "single_thread", itemCount }, { "parallel", 512 } };
+	for (const Mode& mode : modes) {
+		std::vector<double> commandsPerMs;
+		for (uint32_t frame = 0; frame <= frames; frame++) {
+			double ms = 0.0;
+			_vk.drawFrame([&](const vgl::FrameContext& context) {
+				auto start = Clock::now();
+				recorder->recordParallel(context.commandBuffer, itemCount, mode.batchSize, inheritance, recordItems);
+				ms = elapsedMs(start);
+			});
+			if (frame > 0 && ms > 0.0) {
+				commandsPerMs.push_back(static_cast<double>(itemCount * commandsPerItem) / ms / 1000.0);
+			}
+		}
+		_report.add(std::string("recording/") + mode.name, "Mcmd/s", commandsPerMs, true);
+	}
+
+	_vk.waitIdle();
+	allocator->destroyBuffer(target, targetMemory);
+}
+
+//The whole frame loop with nothing recorded, what every frame pays before any rendering
+void benchmarkFrame(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	const uint32_t frames = _options.quick ? 60 : 500;
+
+	std::vector<double> frameMs;
+	//A few frames to fill the frames in flight
+	for (uint32_t i = 0; i < 8; i++) {
+		_vk.drawFrame();
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		auto start = Clock::now();
+		_vk.drawFrame();
+		frameMs.push_back(elapsedMs(start));
+	}
+	_vk.waitIdle();
+	_report.add("frame/offscreen_empty", "ms", frameMs, false);
+}
+
+//Loading a mesh from a text OBJ against mapping the processed binary file, both ending with the mesh uploaded to device local memory
+//The OBJ path parses every line and uploads full precision vertices, the binary path hands the mapped sections to the upload engine
+void benchmarkMesh(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	vgl::LogicalDevice* logicalDevice = _vk.getLogicalDevice();
+	vgl::MemoryAllocator* allocator = logicalDevice->getAllocator();
+	vgl::UploadEngine* uploadEngine = _vk.getUploadEngine();
+	const uint32_t repetitions = _options.quick ? 2 : 5;
+	const uint32_t gridSize = _options.quick ? 128 : 384;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::string objPath = (directory / "vgl_bench_mesh.obj").string();
+	std::string meshPath = (directory / "vgl_bench_mesh.vgm").string();
+
+	//Rolling terrain with its triangles shuffled, exported meshes rarely come in a cache friendly order
+	{
+		std::vector<uint32_t> triangles;
+		for (uint32_t y = 0; y < gridSize; y++) {
+			for (uint32_t x = 0; x < gridSize; x++) {
+				uint32_t corner = y * (gridSize + 1) + x;
+				triangles.insert(triangles.end(), { corner, corner + 1, corner + gridSize + 1, corner + 1, corner + gridSize + 2, corner + gridSize + 1 });
+			}
+		}
+		std::mt19937 rng(9012);
+		for (size_t i = triangles.size() / 3 - 1; i > 0; i--) {
+			size_t j = std::uniform_int_distribution<size_t>(0, i)(rng);
+			std::swap_ranges(triangles.begin() + i * 3, triangles.begin() + i * 3 + 3, triangles.begin() + j * 3);
+		}
+
+		std::ofstream file(objPath);
+		for (uint32_t y = 0; y <= gridSize; y++) {
+			for (uint32_t x = 0; x <= gridSize; x++) {
+				float u = static_cast<float>(x) / gridSize;
+				float v = static_cast<float>(y) / gridSize;
+				float height = 0.05f * std::sin(u * 25.0f) * std::cos(v * 17.0f);
+				file << "v " << u << " " << height << " " << v << "\n";
+				file << "vt " << u << " " << v << "\n";
+				file << "vn " << -1.25f * std::cos(u * 25.0f) * std::cos(v * 17.0f) << " 1 " << 0.85f * std::sin(u * 25.0f) * std::sin(v * 17.0f) << "\n";
+			}
+		}
+		for (size_t i = 0; i < triangles.size(); i += 3) {
+			file << "f";
+			for (size_t k = 0; k < 3; k++) {
+				uint32_t index = triangles[i + k] + 1;
+				file << " " << index << "/" << index << "/" << index;
+			}
+			file << "\n";
+		}
+	}
+
+	std::vector<vgl::MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	vgl::MeshProcessor::loadObj(objPath, vertices, indices);
+
+	std::vector<double> buildMs;
+	vgl::MeshBuildStats buildStats;
+	vgl::MeshData mesh;
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		mesh = vgl::MeshProcessor::build(vertices, indices, {}, &buildStats);
+		if (repetition > 0) {
+			buildMs.push_back(buildStats.buildMs);
+		}
+	}
+	_report.add("mesh/build", "ms", buildMs, false);
+	_report.add("mesh/acmr_input", "misses/tri", { buildStats.acmrBefore }, false);
+	_report.add("mesh/acmr_optimized", "misses/tri", { buildStats.acmrAfter }, false);
+
+	if (!vgl::MeshFile::save(meshPath, mesh)) {
+		std::cout << "Failed to write " << meshPath << "\n";
+		return;
+	}
+
+	//CPU side only, what a loading thread spends before any upload
+	std::vector<double> parseMs;
+	std::vector<double> mapMs;
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		std::vector<vgl::MeshVertex> parsedVertices;
+		std::vector<uint32_t> parsedIndices;
+		auto start = Clock::now();
+		vgl::MeshProcessor::loadObj(objPath, parsedVertices, parsedIndices);
+		double objMs = elapsedMs(start);
+
+		start = Clock::now();
+		vgl::MeshFile file(meshPath);
+		double binaryMs = elapsedMs(start);
+
+		if (repetition > 0) {
+			parseMs.push_back(objMs);
+			mapMs.push_back(binaryMs);
+		}
+	}
+	_report.add("mesh/parse_obj", "ms", parseMs, false);
+	_report.add("mesh/map_binary", "ms", mapMs, false);
+
+	//Until the data is in device local memory
+	std::vector<double> objLoadMs;
+	std::vector<double> binaryLoadMs;
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		auto start = Clock::now();
+		{
+			std::vector<vgl::MeshVertex> parsedVertices;
+			std::vector<uint32_t> parsedIndices;
+			vgl::MeshProcessor::loadObj(objPath, parsedVertices, parsedIndices);
+
+			VkDeviceSize vertexBytes = parsedVertices.size() * sizeof(vgl::MeshVertex);
+			VkDeviceSize indexBytes = parsedIndices.size() * sizeof(uint32_t);
+			VkBuffer vertexBuffer = VK_NULL_HANDLE;
+			VkBuffer indexBuffer = VK_NULL_HANDLE;
+			vgl::MemoryAllocation vertexMemory;
+			vgl::MemoryAllocation indexMemory;
+			allocator->createBuffer(vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexMemory);
+			allocator->createBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexMemory);
+			uploadEngine->uploadBuffer(vertexBuffer, 0, parsedVertices.data(), vertexBytes);
+			uploadEngine->wait(uploadEngine->uploadBuffer(indexBuffer, 0, parsedIndices.data(), indexBytes));
+			allocator->destroyBuffer(vertexBuffer, vertexMemory);
+			allocator->destroyBuffer(indexBuffer, indexMemory);
+		}
+		double objMs = elapsedMs(start);
+
+		start = Clock::now();
+		{
+			vgl::MeshFile file(meshPath);
+			vgl::Mesh gpuMesh(logicalDevice, uploadEngine, file);
+			uploadEngine->wait(gpuMesh.getUploadTicket());
+		}
+		double binaryMs = elapsedMs(start);
+
+		if (repetition > 0) {
+			objLoadMs.push_back(objMs);
+			binaryLoadMs.push_back(binaryMs);
+		}
+	}
+	_report.add("mesh/load_obj_upload", "ms", objLoadMs, false);
+	_report.add("mesh/load_binary_upload", "ms", binaryLoadMs, false);
+
+	_vk.waitIdle();
+	std::error_code error;
+	std::filesystem::remove(objPath, error);
+	std::filesystem::remove(meshPath, error);
+}
+
+//Sorting and merging a crowd of draw requests into instanced draws, and the radix sort on its own against std::stable_sort
+void benchmarkBatching(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	vgl::DrawBatcher* batcher = _vk.getDrawBatcher();
+	vgl::JobSystem* jobSystem = _vk.getLogicalDevice()->getJobSystem();
+	const uint32_t repetitions = _options.quick ? 3 : 10;
+	const uint32_t requestCount = _options.quick ? 20000 : 100000;
+	const uint32_t sortCount = _options.quick ? 250000 : 1000000;
+
+	//One quad stands in for every crowd mesh, the batcher never touches the vertices before recording
+	std::vector<vgl::MeshVertex> quad(4);
+	quad[1].position = { 1.0f, 0.0f, 0.0f };
+	quad[2].position = { 0.0f, 1.0f, 0.0f };
+	quad[3].position = { 1.0f, 1.0f, 0.0f };
+	vgl::MeshBuildSettings quadSettings;
+	quadSettings.maxLods = 1;
+	vgl::Mesh mesh(_vk.getLogicalDevice(), _vk.getUploadEngine(), vgl::MeshProcessor::build(quad, { 0, 1, 2, 2, 1, 3 }, quadSettings));
+	const uint32_t meshCount = 64;
+	std::vector<vgl::BatchedMesh> meshes;
+	for (uint32_t i = 0; i < meshCount; i++) {
+		meshes.push_back(batcher->addMesh(&mesh));
+	}
+
+	//Crowd members in a random order, as a scene traversal would produce them
+	std::vector<vgl::DrawRequest> requests(requestCount);
+	std::mt19937 rng(3456);
+	for (vgl::DrawRequest& request : requests) {
+		request.pipeline = rng() % 2;
+		request.material = rng() % 8;
+		request.mesh = meshes[rng() % meshCount];
+		request.lod = rng() % 3;
+		request.depth = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+	}
+	std::vector<uint8_t> instanceData(batcher->getSettings().instanceStride, 0);
+
+	std::vector<double> buildMs;
+	std::vector<double> sortMs;
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		//Frame slot 0 is idle here, nothing has been submitted since the last waitIdle
+		batcher->beginFrame(0);
+		for (const vgl::DrawRequest& request : requests) {
+			batcher->submit(request, instanceData.data());
+		}
+		batcher->build();
+		if (repetition > 0) {
+			buildMs.push_back(batcher->getStats().buildMs);
+			sortMs.push_back(batcher->getStats().sortMs);
+		}
+	}
+	_report.add("batching/build_" + std::to_string(requestCount / 1000) + "k", "ms", buildMs, false);
+	_report.add("batching/sort_" + std::to_string(requestCount / 1000) + "k", "ms", sortMs, false);
+	_report.add("batching/draws", "draws", { static_cast<double>(batcher->getStats().batches) }, false);
+	batcher->beginFrame(0);
+	for (vgl::BatchedMesh batched : meshes) {
+		batcher->removeMesh(batched);
+	}
+
+	std::vector<uint64_t> keys(sortCount);
+	for (uint64_t& key : keys) {
+		key = (static_cast<uint64_t>(rng()) << 32) | rng();
+	}
+	std::vector<double> radixMs;
+	std::vector<double> stdMs;
+	std::vector<uint64_t> keyScratch;
+	std::vector<uint32_t> valueScratch;
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		std::vector<uint64_t> sorted = keys;
+		std::vector<uint32_t> values(sortCount);
+		auto start = Clock::now();
+		vgl::DrawBatcher::radixSort(sorted, values, keyScratch, valueScratch, jobSystem);
+		double radix = elapsedMs(start);
+
+		sorted = keys;
+		start = Clock::now();
+		std::stable_sort(sorted.begin(), sorted.end());
+		double standard = elapsedMs(start);
+
+		if (repetition > 0) {
+			radixMs.push_back(radix);
+			stdMs.push_back(standard);
+		}
+	}
+	_report.add("batching/radix_sort_" + std::to_string(sortCount / 1000) + "k", "ms", radixMs, false);
+	_report.add("batching/std_stable_sort_" + std::to_string(sortCount / 1000) + "k", "ms", stdMs, false);
+
+	_vk.waitIdle();
+}
+
+//Round trips of small command buffers through a fence per submit, a scheduler point per submit, and one scheduler batch
+//The difference between the first two is the cost of the fence, the batch shows what deferring the wait buys
+void benchmarkScheduler(Report& _report, const Options& _options, vgl::VulkanCore& _vk) {
+	vgl::LogicalDevice* logicalDevice = _vk.getLogicalDevice();
+	vgl::QueueScheduler* scheduler = logicalDevice->getQueueScheduler();
+	VkDevice device = logicalDevice->device;
+	const uint32_t submitCount = _options.quick ? 64 : 256;
+	const uint32_t repetitions = _options.quick ? 3 : 10;
+
+	const VkDeviceSize targetSize = 4096;
+	VkBuffer target = VK_NULL_HANDLE;
+	vgl::MemoryAllocation targetMemory;
+	logicalDevice->getAllocator()->createBuffer(targetSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target, targetMemory);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = scheduler->getQueueFamily(vgl::QueueType::Graphics);
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	vkCreateCommandPool(device, &poolInfo, vgl::HostAllocator::callbacks(), &commandPool);
+
+	//Recorded once and resubmitted, each is only ever in one pending submission
+	std::vector<VkCommandBuffer> commandBuffers(submitCount);
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = submitCount;
+	vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data());
+	for (uint32_t i = 0; i < submitCount; i++) {
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
+		vkCmdFillBuffer(commandBuffers[i], target, (i * 4) % targetSize, 4, i);
+		vkEndCommandBuffer(commandBuffers[i]);
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence = VK_NULL_HANDLE;
+	vkCreateFence(device, &fenceInfo, vgl::HostAllocator::callbacks(), &fence);
+	VkQueue queue = scheduler->getQueue(vgl::QueueType::Graphics);
+
+	std::vector<double> fenceUs;
+	std::vector<double> timelineUs;
+	std::vector<double> batchedUs;
+	for (uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+		auto start = Clock::now();
+		for (VkCommandBuffer commandBuffer : commandBuffers) {
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+			{
+				std::lock_guard<std::mutex> queueLock(scheduler->getQueueMutex(queue));
+				vkQueueSubmit(queue, 1, &submitInfo, fence);
+			}
+			vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+			vkResetFences(device, 1, &fence);
+		}
+		double fenceMs = elapsedMs(start);
+
+		start = Clock::now();
+		for (VkCommandBuffer commandBuffer : commandBuffers) {
+			scheduler->wait(scheduler->submit(vgl::QueueType::Graphics, commandBuffer));
+		}
+		double timelineMs = elapsedMs(start);
+
+		start = Clock::now();
+		vgl::QueuePoint last;
+		for (VkCommandBuffer commandBuffer : commandBuffers) {
+			last = scheduler->submit(vgl::QueueType::Graphics, commandBuffer);
+		}
+		scheduler->wait(last);
+		double batchedMs = elapsedMs(start);
+
+		if (repetition > 0) {
+			fenceUs.push_back(fenceMs * 1000.0 / submitCount);
+			timelineUs.push_back(timelineMs * 1000.0 / submitCount);
+			batchedUs.push_back(batchedMs * 1000.0 / submitCount);
+		}
+	}
+	_report.add("scheduler/fence_per_submit", "us", fenceUs, false);
+	_report.add("scheduler/timeline_per_submit", "us", timelineUs, false);
+	_report.add("scheduler/batched_" + std::to_string(submitCount), "us", batchedUs, false);
+
+	_vk.waitIdle();
+	vkDestroyFence(device, fence, vgl::HostAllocator::callbacks());
+	vkDestroyCommandPool(device, commandPool, vgl::HostAllocator::callbacks());
+	logicalDevice->getAllocator()->destroyBuffer(target, targetMemory);
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--out" && i + 1 < argc) {
+			options.outputPath = argv[++i];
+		}
+		else if (argument == "--filter" && i + 1 < argc) {
+			options.filter = argv[++i];
+		}
+		else if (argument == "--quick") {
+			options.quick = true;
+		}
+		else {
+			std::cout << "Usage: vgl_bench [--out report.json] [--filter name] [--quick]\n";
+			return argument == "--help" ? 0 : 1;
+		}
+	}
+
+	//Library messages would interleave with the results
+	vgl::Logger::get().setLevel(vgl::LogLevel::Warning);
+
+	auto selected = [&](const char* _name) {
+		return options.filter.empty() || std::string(_name).find(options.filter) != std::string::npos;
+	};
+
+	Report report;
+	if (selected("init")) {
+		benchmarkInit(report, options);
+	}
+
+	vgl::VulkanCore vk(makeSettings());
+	if (selected("memory")) {
+		benchmarkAllocation(report, options, vk);
+	}
+	if (selected("upload")) {
+		benchmarkUpload(report, options, vk);
+	}
+	if (selected("recording")) {
+		benchmarkRecording(report, options, vk);
+	}
+	if (selected("frame")) {
+		benchmarkFrame(report, options, vk);
+	}
+	if (selected("mesh")) {
+		benchmarkMesh(report, options, vk);
+	}
+	if (selected("batching")) {
+		benchmarkBatching(report, options, vk);
+	}
+	if (selected("scheduler")) {
+		benchmarkScheduler(report, options, vk);
+	}
+
+	if (!report.writeJson(options.outputPath, vk.getLogicalDevice()->getCapabilities(), options)) {
+		std::cout << "Failed to write " << options.outputPath << "\n";
+		return 1;
+	}
+	std::cout << "Wrote " << options.outputPath << "\n";
+}
@@ -0,0 +1,160 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "vgl/TlsfAllocator.h"
+
+//Naive first-fit allocator over a sorted free list, used as a baseline
+class FirstFitAllocator {
+public:
+	struct Allocation {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		bool valid = false;
+	};
+
+	FirstFitAllocator(uint64_t _size) : size(_size) { this->freeList.push_back({ 0, _size }); }
+
+	Allocation allocate(uint64_t _size, uint64_t _alignment) {
+		for (auto it = this->freeList.begin(); it != this->freeList.end(); ++it) {
+			uint64_t aligned = (it->offset + _alignment - 1) & ~(_alignment - 1);
+			uint64_t padding = aligned - it->offset;
+			if (it->size < padding + _size) { continue; }
+
+			//Padding is handed out with the allocation to keep the free list simple
+			Allocation alloc{ it->offset, padding + _size, true };
+			it->offset += alloc.size;
+			it->size -= alloc.size;
+			if (it->size == 0) { this->freeList.erase(it); }
+			return { alloc.offset, alloc.size, true };
+		}
+		return {};
+	}
+
+	void free(const Allocation& _alloc) {
+		auto it = this->freeList.begin();
+		while (it != this->freeList.end() && it->offset < _alloc.offset) { ++it; }
+		it = this->freeList.insert(it, { _alloc.offset, _alloc.size });
+
+		//Merge with neighbours
+		auto next = std::next(it);
+		if (next != this->freeList.end() && it->offset + it->size == next->offset) {
+			it->size += next->size;
+			this->freeList.erase(next);
+		}
+		if (it != this->freeList.begin()) {
+			auto prev = std::prev(it);
+			if (prev->offset + prev->size == it->offset) {
+				prev->size += it->size;
+				this->freeList.erase(it);
+			}
+		}
+	}
+
+	double fragmentation() const {
+		uint64_t total = 0, largest = 0;
+		for (const auto& range : this->freeList) {
+			total += range.size;
+			largest = std::max(largest, range.size);
+		}
+		return total == 0 ? 0.0 : 1.0 - double(largest) / double(total);
+	}
+
+private:
+	struct Range {
+		uint64_t offset;
+		uint64_t size;
+	};
+	uint64_t size;
+	std::list<Range> freeList;
+};
+
+struct Op {
+	bool isAlloc;
+	uint64_t size;
+	uint64_t alignment;
+	size_t victim;
+};
+
+//Mix of small uniform-sized and large texture-sized requests with random frees
+std::vector<Op> generateOps(size_t _count, uint32_t _seed) {
+	std::mt19937 rng(_seed);
+	std::uniform_int_distribution<uint64_t> smallSize(64, 64 * 1024);
+	std::uniform_int_distribution<uint64_t> largeSize(256 * 1024, 8 * 1024 * 1024);
+	std::uniform_int_distribution<int> percent(0, 99);
+	const uint64_t alignments[] = { 16, 64, 256, 4096, 65536 };
+
+	std::vector<Op> ops;
+	ops.reserve(_count);
+	size_t live = 0;
+	for (size_t i = 0; i < _count; i++) {
+		Op op{};
+		op.isAlloc = live == 0 || percent(rng) < 52;
+		if (op.isAlloc) {
+			op.size = percent(rng) < 97 ? smallSize(rng) : largeSize(rng);
+			op.alignment = alignments[percent(rng) % 5];
+			live++;
+		}
+		else {
+			op.victim = rng();
+			live--;
+		}
+		ops.push_back(op);
+	}
+	return ops;
+}
+
+template <typename Allocator, typename Allocation, typename Alloc, typename Free>
+void runBenchmark(const char* _name, Allocator& _allocator, const std::vector<Op>& _ops, Alloc _alloc, Free _free) {
+	std::vector<Allocation> live;
+	live.reserve(_ops.size());
+	size_t failed = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const Op& op : _ops) {
+		if (op.isAlloc) {
+			Allocation a = _alloc(_allocator, op.size, op.alignment);
+			if (a.valid) { live.push_back(a); }
+			else { failed++; }
+		}
+		else if (!live.empty()) {
+			size_t index = op.victim % live.size();
+			_free(_allocator, live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count() / double(_ops.size());
+
+	std::cout << _name << ": " << ns << "ns/op, " << failed << " failed allocations, " << live.size() << " live\n";
+}
+
+int main() {
+	const uint64_t heapSize = 256ull * 1024 * 1024;
+	const std::vector<Op> ops = generateOps(200000, 1234);
+
+	struct TlsfAlloc {
+		vgl::TlsfAllocator::Allocation alloc;
+		bool valid;
+	};
+	vgl::TlsfAllocator tlsf(heapSize);
+	runBenchmark<vgl::TlsfAllocator, TlsfAlloc>("TLSF", tlsf, ops,
+		[](vgl::TlsfAllocator& a, uint64_t size, uint64_t alignment) {
+			vgl::TlsfAllocator::Allocation alloc = a.allocate(size, alignment);
+			return TlsfAlloc{ alloc, alloc.isValid() };
+		},
+		[](vgl::TlsfAllocator& a, const TlsfAlloc& alloc) { a.free(alloc.alloc.blockIndex); });
+	vgl::TlsfAllocator::Stats stats = tlsf.getStats();
+	std::cout << "  used " << stats.usedSize << "/" << stats.totalSize << " bytes, " << stats.freeBlockCount << " free blocks, fragmentation "
+		<< stats.fragmentation() << "\n";
+
+	FirstFitAllocator firstFit(heapSize);
+	runBenchmark<FirstFitAllocator, FirstFitAllocator::Allocation>("First fit", firstFit, ops,
+		[](FirstFitAllocator& a, uint64_t size, uint64_t alignment) { return a.allocate(size, alignment); },
+		[](FirstFitAllocator& a, const FirstFitAllocator::Allocation& alloc) { a.free(alloc); });
+	std::cout << "  fragmentation " << firstFit.fragmentation() << "\n";
+}
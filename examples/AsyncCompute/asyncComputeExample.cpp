@@ -0,0 +1,119 @@
+#include <random>
+
+#include "vgl/VulkanCore.h"
+
+struct Particle {
+	float position[4];
+	float velocity[4];
+};
+
+struct PushConstants {
+	float deltaTime;
+	uint32_t count;
+};
+
+int main() {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Async Compute Example";
+
+	vgl::VulkanCore vk(settings);
+	VkDevice device = vk.getLogicalDevice()->device;
+	vgl::MemoryAllocator* allocator = vk.getLogicalDevice()->getAllocator();
+	vgl::AsyncCompute* compute = vk.getAsyncCompute();
+	vgl::FrameRenderer* renderer = vk.getRenderer();
+
+	std::cout << "Async compute queue family " << compute->getQueueFamily() << (compute->isDedicated() ? " (dedicated)\n" : " (shared with graphics)\n");
+
+	//Particle buffer is written by compute and read by graphics, so it is shared between both families
+	const uint32_t particleCount = 1 << 20;
+	std::vector<uint32_t> sharingFamilies = compute->getSharingFamilies();
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = sizeof(Particle) * particleCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	compute->setSharing(bufferInfo, sharingFamilies);
+
+	VkBuffer particleBuffer = VK_NULL_HANDLE;
+	vgl::MemoryAllocation particleMemory;
+	allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, particleBuffer, particleMemory);
+
+	//Initial state goes through the upload engine and compute waits for it
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<Particle> particles(particleCount);
+	for (auto& p : particles) {
+		p = { { dist(rng), 1.0f + dist(rng), dist(rng), 1.0f }, { dist(rng), 0.0f, dist(rng), 0.0f } };
+	}
+	vgl::UploadTicket uploadTicket = vk.getUploadEngine()->uploadBuffer(particleBuffer, 0, particles.data(), bufferInfo.size);
+	vk.getUploadEngine()->wait(uploadTicket);
+
+	//Descriptor set with the particle buffer
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout);
+
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 };
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool);
+
+	VkDescriptorSetAllocateInfo setInfo{};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = descriptorPool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &setLayout;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	vkAllocateDescriptorSets(device, &setInfo, &descriptorSet);
+
+	VkDescriptorBufferInfo descriptorBuffer{ particleBuffer, 0, VK_WHOLE_SIZE };
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &descriptorBuffer;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	{
+		vgl::ComputePipeline simulate(vk.getLogicalDevice(), vgl::ComputePipeline::readFile(VGL_SHADER_DIR "particles.comp.spv"), { setLayout }, sizeof(PushConstants));
+
+		for (int i = 0; i < 500; i++) {
+			//Simulate on the compute queue, waiting for the previous frame's graphics work that reads the particles
+			VkCommandBuffer commandBuffer = compute->begin();
+			PushConstants push{ 1.0f / 60.0f, particleCount };
+			simulate.bind(commandBuffer);
+			simulate.bindDescriptorSets(commandBuffer, { descriptorSet });
+			simulate.pushConstants(commandBuffer, &push, sizeof(push));
+			simulate.dispatch(commandBuffer, vgl::ComputePipeline::groupCount(particleCount, 256));
+
+			uint64_t simulated = compute->submit({ { renderer->getTimelineSemaphore(), renderer->getSubmittedValue(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT } });
+
+			//Graphics only waits where it would read the particles, the clear and everything before it overlaps with the simulation
+			renderer->addWaitSemaphore(compute->getSemaphore(), simulated, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+			vk.drawFrame();
+		}
+		vk.waitIdle();
+	}
+
+	const vgl::FrameStats& stats = vk.getFrameStats();
+	std::cout << "Simulated " << particleCount << " particles for " << stats.frameCount << " frames, average " << stats.averageFrameMs << "ms\n";
+	vk.getLogicalDevice()->getQueueScheduler()->printStats();
+
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	allocator->destroyBuffer(particleBuffer, particleMemory);
+}
@@ -0,0 +1,160 @@
+#include <chrono>
+
+#include "vgl/VulkanCore.h"
+
+//Matches the push constant block in textured.vert
+struct DrawConstants {
+	float offset[2];
+	float scale[2];
+	uint32_t textureHandle;
+};
+
+struct Texture {
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	vgl::MemoryAllocation memory;
+	uint32_t handle = vgl::BindlessHeap::invalidHandle;
+};
+
+//Draw thousands of quads that each sample a different texture, without binding a descriptor set per draw
+int main() {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Bindless Example";
+
+	vgl::VulkanCore vk(settings);
+	vgl::LogicalDevice* logicalDevice = vk.getLogicalDevice();
+	vgl::BindlessHeap* heap = vk.getBindlessHeap();
+
+	if (heap == nullptr || !logicalDevice->isDynamicRenderingEnabled()) {
+		std::cout << "Descriptor indexing or dynamic rendering is not supported\n";
+		return 0;
+	}
+
+	//Small solid colour textures, each gets a handle in the heap
+	const uint32_t textureCount = 256;
+	const uint32_t textureSize = 4;
+	std::vector<Texture> textures(textureCount);
+	vgl::UploadTicket lastUpload = 0;
+	for (uint32_t i = 0; i < textureCount; i++) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		imageInfo.extent = { textureSize, textureSize, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		logicalDevice->getAllocator()->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textures[i].image, textures[i].memory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = textures[i].image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		if (vkCreateImageView(logicalDevice->device, &viewInfo, nullptr, &textures[i].view) != VK_SUCCESS) {
+			throw std::runtime_error("FAILED TO CREATE TEXTURE IMAGE VIEW");
+		}
+
+		uint32_t colour = 0xFF000000u | ((i * 37u) & 0xFFu) | (((i * 91u) & 0xFFu) << 8) | (((i * 53u) & 0xFFu) << 16);
+		std::vector<uint32_t> texels(textureSize * textureSize, colour);
+		vgl::ImageUploadInfo uploadInfo;
+		uploadInfo.extent = { textureSize, textureSize, 1 };
+		lastUpload = vk.getUploadEngine()->uploadImage(textures[i].image, uploadInfo, texels.data(), texels.size() * sizeof(uint32_t));
+
+		textures[i].handle = heap->addTexture(textures[i].view);
+	}
+
+	vgl::SwapChain* swapChain = vk.getRenderer()->getSwapChain();
+	VkFormat format = swapChain ? swapChain->imageFormat : vk.getOffscreenTarget()->format;
+
+	//Every bindless pipeline uses the heap's set layout and push constant range, so the set stays bound across pipeline switches
+	vgl::GraphicsPipelineDesc desc;
+	desc.stages.push_back({ VK_SHADER_STAGE_VERTEX_BIT, vgl::ComputePipeline::readFile(VGL_SHADER_DIR "textured.vert.spv") });
+	desc.stages.push_back({ VK_SHADER_STAGE_FRAGMENT_BIT, vgl::ComputePipeline::readFile(VGL_SHADER_DIR "textured.frag.spv") });
+	desc.cullMode = VK_CULL_MODE_NONE;
+	desc.colorFormats = { format };
+	desc.setLayouts = { heap->getSetLayout() };
+	desc.pushConstantRanges = { heap->getPushConstantRange() };
+
+	auto pipeline = logicalDevice->getPipelineCompiler()->compile(desc);
+	pipeline->wait();
+	if (pipeline->hasFailed()) {
+		std::cout << "Pipeline failed to compile: " << pipeline->getError() << "\n";
+		return 1;
+	}
+
+	const uint32_t drawCount = 10000;
+	const uint32_t gridSize = 100;
+	std::vector<DrawConstants> draws(drawCount);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		float x = static_cast<float>(i % gridSize) / gridSize;
+		float y = static_cast<float>(i / gridSize) / gridSize;
+		draws[i] = { { x * 2.0f - 1.0f, y * 2.0f - 1.0f }, { 1.8f / gridSize, 1.8f / gridSize }, textures[i % textureCount].handle };
+	}
+
+	const uint32_t frameCount = 120;
+	double recordMs = 0.0;
+	uint32_t framesDrawn = 0;
+	for (uint32_t i = 0; i < frameCount; i++) {
+		vk.drawFrame([&](const vgl::FrameContext& frame) {
+			//Textures can't be sampled until the graphics queue has acquired them
+			if (!vk.getUploadEngine()->isReady(lastUpload)) {
+				return;
+			}
+
+			VkRenderingAttachmentInfo colourAttachment{};
+			colourAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colourAttachment.imageView = frame.imageView;
+			colourAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.renderArea = { { 0, 0 }, frame.extent };
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colourAttachment;
+
+			auto start = std::chrono::steady_clock::now();
+			vkCmdBeginRendering(frame.commandBuffer, &renderingInfo);
+			pipeline->bind(frame.commandBuffer);
+			heap->bind(frame.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+			VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(frame.extent.width), static_cast<float>(frame.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, frame.extent };
+			vkCmdSetViewport(frame.commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(frame.commandBuffer, 0, 1, &scissor);
+
+			//Only the push constants change between draws
+			for (const auto& draw : draws) {
+				heap->pushConstants(frame.commandBuffer, &draw, sizeof(DrawConstants));
+				vkCmdDraw(frame.commandBuffer, 6, 1, 0, 0);
+			}
+			vkCmdEndRendering(frame.commandBuffer);
+			recordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			framesDrawn++;
+		});
+	}
+	vk.waitIdle();
+
+	//Handles removed now are only handed out again once the frames in flight are done with them
+	for (uint32_t i = 0; i < textureCount; i += 2) {
+		heap->removeTexture(textures[i].handle);
+	}
+
+	vgl::BindlessHeap::Stats stats = heap->getStats();
+	std::cout << drawCount << " draws per frame with one descriptor set bind, " << (framesDrawn > 0 ? recordMs / framesDrawn : 0.0) << "ms recording per frame\n";
+	std::cout << "Textures in use: " << stats.used[vgl::BindlessHeap::Textures] << " of " << stats.capacity[vgl::BindlessHeap::Textures]
+		<< ", " << stats.writes << " descriptor writes\n";
+
+	for (auto& texture : textures) {
+		vkDestroyImageView(logicalDevice->device, texture.view, nullptr);
+		logicalDevice->getAllocator()->destroyImage(texture.image, texture.memory);
+	}
+}
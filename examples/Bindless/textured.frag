@@ -0,0 +1,12 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) flat in uint inTexture;
+layout(location = 0) out vec4 outColour;
+
+void main() {
+	outColour = texture(textures[nonuniformEXT(inTexture)], inUV);
+}
@@ -0,0 +1,22 @@
+#version 450
+
+//Shared bindless push constant block, the texture is picked by handle instead of by binding a descriptor set
+layout(push_constant) uniform Draw {
+	vec2 offset;
+	vec2 scale;
+	uint textureHandle;
+} draw;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) flat out uint outTexture;
+
+const vec2 corners[6] = vec2[](
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+	vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+	gl_Position = vec4(draw.offset + corners[gl_VertexIndex] * draw.scale, 0.0, 1.0);
+	outUV = corners[gl_VertexIndex];
+	outTexture = draw.textureHandle;
+}
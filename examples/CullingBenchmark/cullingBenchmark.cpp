@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "vgl/BoundingVolumes.h"
+
+struct Result {
+	std::string name;
+	double nsPerIteration = 0.0;
+	uint64_t iterations = 0;
+	double objectsPerSecond = 0.0;
+};
+
+//Run the function until at least minSeconds have passed, in the style of Google Benchmark's fixed time loop
+template <typename Function>
+Result runBenchmark(const std::string& _name, uint32_t _objectCount, double _minSeconds, Function _function) {
+	//Warm the caches and the branch predictor first
+	_function();
+
+	uint64_t iterations = 0;
+	auto start = std::chrono::steady_clock::now();
+	double elapsed = 0.0;
+	do {
+		_function();
+		iterations++;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < _minSeconds);
+
+	Result result;
+	result.name = _name;
+	result.iterations = iterations;
+	result.nsPerIteration = elapsed * 1e9 / static_cast<double>(iterations);
+	result.objectsPerSecond = static_cast<double>(_objectCount) * static_cast<double>(iterations) / elapsed;
+	return result;
+}
+
+//Objects scattered through a large world, the camera sees roughly a tenth of them
+vgl::BoundingVolumeSet generateScene(uint32_t _count, uint32_t _seed) {
+	std::mt19937 rng(_seed);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> size(0.5f, 8.0f);
+
+	vgl::BoundingVolumeSet scene;
+	scene.reserve(_count);
+	for (uint32_t i = 0; i < _count; i++) {
+		glm::vec3 center(position(rng), position(rng) * 0.1f, position(rng));
+		glm::vec3 extents(size(rng), size(rng), size(rng));
+		scene.add(vgl::Aabb{ center - extents, center + extents });
+	}
+	return scene;
+}
+
+int main() {
+	const uint32_t objectCounts[] = { 1024, 16384, 262144 };
+	const double minSeconds = 0.25;
+
+	glm::mat4 projection = glm::perspectiveRH_ZO(1.0f, 16.0f / 9.0f, 0.1f, 2000.0f);
+	projection[1][1] *= -1.0f;
+	glm::mat4 view = glm::lookAtRH(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(100.0f, 0.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	struct Kernel {
+		const char* name;
+		bool useAabbs;
+		float maxDistance;
+	};
+	const Kernel kernels[] = {
+		{ "Spheres", false, std::numeric_limits<float>::infinity() },
+		{ "Aabbs", true, std::numeric_limits<float>::infinity() },
+		{ "SpheresDistance", false, 500.0f },
+		{ "AabbsDistance", true, 500.0f },
+	};
+	const vgl::SimdLevel levels[] = { vgl::SimdLevel::Scalar, vgl::SimdLevel::Sse2, vgl::SimdLevel::Avx2 };
+
+	std::cout << "Best SIMD level: " << vgl::BoundingVolumeSet::getSimdLevelName(vgl::BoundingVolumeSet::getSimdLevel()) << "\n";
+	std::printf("%-40s %14s %12s %16s %10s\n", "Benchmark", "Time", "Iterations", "Objects/s", "Speedup");
+	std::cout << std::string(96, '-') << "\n";
+
+	uint32_t mismatches = 0;
+	for (uint32_t count : objectCounts) {
+		vgl::BoundingVolumeSet scene = generateScene(count, 42);
+
+		for (const Kernel& kernel : kernels) {
+			vgl::CullQuery query;
+			query.frustum = vgl::Frustum::fromViewProjection(projection * view);
+			query.useAabbs = kernel.useAabbs;
+			query.viewPoint = glm::vec3(0.0f, 50.0f, 0.0f);
+			query.maxDistance = kernel.maxDistance;
+
+			std::vector<uint32_t> reference;
+			scene.cull(query, reference, vgl::SimdLevel::Scalar);
+
+			double scalarNs = 0.0;
+			for (vgl::SimdLevel level : levels) {
+				if (!vgl::BoundingVolumeSet::isSupported(level)) {
+					continue;
+				}
+
+				//Every level has to return exactly what the scalar kernel does
+				std::vector<uint32_t> visible;
+				scene.cull(query, visible, level);
+				if (visible != reference) {
+					mismatches++;
+				}
+
+				std::string name = std::string("BM_Cull") + kernel.name + "<" + vgl::BoundingVolumeSet::getSimdLevelName(level) + ">/" + std::to_string(count);
+				Result result = runBenchmark(name, count, minSeconds, [&]() { scene.cull(query, visible, level); });
+				if (level == vgl::SimdLevel::Scalar) {
+					scalarNs = result.nsPerIteration;
+				}
+
+				std::printf("%-40s %11.0f ns %12llu %14.3fG %9.2fx\n", result.name.c_str(), result.nsPerIteration,
+					static_cast<unsigned long long>(result.iterations), result.objectsPerSecond / 1e9, scalarNs / result.nsPerIteration);
+			}
+		}
+	}
+
+	if (mismatches > 0) {
+		std::cout << mismatches << " SIMD results differed from the scalar kernel\n";
+		return 1;
+	}
+	std::cout << "Every SIMD level matched the scalar kernel\n";
+}
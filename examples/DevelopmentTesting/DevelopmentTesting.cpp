@@ -8,5 +8,12 @@ int main() {
 	 
 	while (window.isOpen()) {
 		window.pollEvents();
+		vk.drawFrame();
+
+		//Print frame timings every few seconds
+		const vgl::FrameStats& stats = vk.getFrameStats();
+		if (stats.frameCount % 1000 == 0) {
+			std::cout << "Frame " << stats.frameCount << ": " << stats.averageFrameMs << "ms (" << stats.fps() << " fps), fence wait " << stats.lastFenceWaitMs << "ms\n";
+		}
 	}
-}
\ No newline at end of file
+}
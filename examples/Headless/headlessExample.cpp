@@ -0,0 +1,58 @@
+#include "vgl/VulkanCore.h"
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+
+int main() {
+	//Runs without a display, e.g. on CI with Mesa lavapipe
+	vgl::HeadlessSettings settings;
+	settings.width = 1920;
+	settings.height = 1080;
+	settings.applicationName = "Headless Example";
+
+	vgl::VulkanCore vk(settings);
+
+	//Stream a large buffer to device local memory on the transfer queue while frames are rendered
+	std::vector<uint32_t> meshData(8 * 1024 * 1024, 0xFFu);
+	VkDeviceSize meshSize = meshData.size() * sizeof(uint32_t);
+	VkBuffer meshBuffer = VK_NULL_HANDLE;
+	vgl::MemoryAllocation meshMemory;
+	vgl::MemoryAllocator* allocator = vk.getLogicalDevice()->getAllocator();
+	allocator->createBuffer(meshSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshBuffer, meshMemory);
+
+	//Uploaded in 1MiB pieces to show them being coalesced into batches
+	vgl::UploadTicket meshTicket = 0;
+	const VkDeviceSize pieceSize = 1024 * 1024;
+	for (VkDeviceSize offset = 0; offset < meshSize; offset += pieceSize) {
+		meshTicket = vk.getUploadEngine()->uploadBuffer(meshBuffer, offset, reinterpret_cast<const char*>(meshData.data()) + offset, pieceSize);
+	}
+
+	//Render a fixed number of frames into the offscreen target
+	for (int i = 0; i < 500; i++) {
+		vk.drawFrame();
+	}
+	vk.waitIdle();
+
+	vgl::UploadEngine::Stats uploadStats = vk.getUploadEngine()->getStats();
+	std::cout << "Uploaded " << uploadStats.bytesUploaded / (1024 * 1024) << "MiB in " << uploadStats.uploadCount << " uploads and "
+		<< uploadStats.batchesSubmitted << " batches, mesh ready: " << vk.getUploadEngine()->isReady(meshTicket) << "\n";
+	allocator->destroyBuffer(meshBuffer, meshMemory);
+
+	const vgl::FrameStats& stats = vk.getFrameStats();
+	std::cout << "Rendered " << stats.frameCount << " frames, average " << stats.averageFrameMs << "ms (min " << stats.minFrameMs
+		<< "ms, max " << stats.maxFrameMs << "ms)\n";
+
+	//Host memory the driver allocated through the library's callbacks, per allocation scope
+	vgl::HostAllocator::Stats hostStats = vgl::HostAllocator::get().getStats();
+	std::cout << "Driver host memory: " << hostStats.bytesInUse / 1024 << "KiB in use, peak " << hostStats.peakBytes / 1024 << "KiB\n";
+	for (uint32_t i = 0; i < vgl::HostAllocator::scopeCount; i++) {
+		const vgl::HostAllocator::ScopeStats& scope = hostStats.scopes[i];
+		std::cout << "  " << vgl::HostAllocator::getScopeName(static_cast<VkSystemAllocationScope>(i)) << ": " << scope.allocationCount
+			<< " allocations, " << scope.reallocationCount << " reallocations, peak " << scope.peakBytes / 1024 << "KiB\n";
+	}
+
+	//Startup and frame stages of the library, open the trace in chrome://tracing or ui.perfetto.dev
+	vgl::CpuProfiler::get().printReport(std::cout);
+	if (vgl::CpuProfiler::get().writeChromeTrace("headless.trace.json")) {
+		std::cout << "Wrote headless.trace.json\n";
+	}
+}
@@ -0,0 +1,21 @@
+#version 450
+
+layout(push_constant) uniform Camera {
+	mat4 viewProjection;
+	uint gridSize;
+	float spacing;
+} camera;
+
+layout(location = 0) out vec3 outColour;
+
+//Objects are laid out on a grid, the same positions the example gives the culler
+void main() {
+	uint object = gl_InstanceIndex;
+	vec3 center = vec3(float(object % camera.gridSize), 0.0, float(object / camera.gridSize)) * camera.spacing;
+
+	//Corner of a unit cube from the low three bits of the vertex index
+	vec3 corner = vec3((gl_VertexIndex & 1) != 0 ? 0.5 : -0.5, (gl_VertexIndex & 2) != 0 ? 0.5 : -0.5, (gl_VertexIndex & 4) != 0 ? 0.5 : -0.5);
+
+	gl_Position = camera.viewProjection * vec4(center + corner, 1.0);
+	outColour = corner + 0.5;
+}
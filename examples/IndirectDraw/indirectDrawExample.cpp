@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "vgl/VulkanCore.h"
+#include "vgl/IndirectRenderer.h"
+
+//Matches the push constant block in cube.vert
+struct Camera {
+	float viewProjection[16];
+	uint32_t gridSize;
+	float spacing;
+};
+
+//Column major matrices with Vulkan's clip space, y pointing down and depth from 0 to 1
+static void perspective(float fovY, float aspect, float zNear, float zFar, float* m) {
+	float f = 1.0f / std::tan(fovY * 0.5f);
+	std::fill(m, m + 16, 0.0f);
+	m[0] = f / aspect;
+	m[5] = -f;
+	m[10] = zFar / (zNear - zFar);
+	m[11] = -1.0f;
+	m[14] = zNear * zFar / (zNear - zFar);
+}
+
+static void lookAt(const float* eye, const float* target, float* m) {
+	float f[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+	float fLength = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+	for (float& value : f) { value /= fLength; }
+
+	//Side is forward x up with up = (0, 1, 0)
+	float s[3] = { -f[2], 0.0f, f[0] };
+	float sLength = std::sqrt(s[0] * s[0] + s[2] * s[2]);
+	s[0] /= sLength;
+	s[2] /= sLength;
+	float u[3] = { s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0] };
+
+	std::fill(m, m + 16, 0.0f);
+	m[0] = s[0]; m[4] = s[1]; m[8] = s[2];
+	m[1] = u[0]; m[5] = u[1]; m[9] = u[2];
+	m[2] = -f[0]; m[6] = -f[1]; m[10] = -f[2];
+	m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+	m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+	m[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+	m[15] = 1.0f;
+}
+
+static void multiply(const float* a, const float* b, float* m) {
+	for (uint32_t column = 0; column < 4; column++) {
+		for (uint32_t row = 0; row < 4; row++) {
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < 4; k++) {
+				sum += a[k * 4 + row] * b[column * 4 + k];
+			}
+			m[column * 4 + row] = sum;
+		}
+	}
+}
+
+//Orbit a camera over a large grid of cubes, culling them on the GPU and drawing the survivors with one indirect draw
+int main() {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Indirect Draw Example";
+
+	vgl::VulkanCore vk(settings);
+	vgl::LogicalDevice* logicalDevice = vk.getLogicalDevice();
+
+	if (!logicalDevice->isDynamicRenderingEnabled()) {
+		std::cout << "Dynamic rendering is not supported, nothing to draw into\n";
+		return 0;
+	}
+	if (!logicalDevice->isDrawIndirectCountEnabled()) {
+		std::cout << "drawIndirectCount is not supported, culled objects are skipped with empty draws instead\n";
+	}
+
+	const uint32_t gridSize = 320;
+	const uint32_t objectCount = gridSize * gridSize;
+	const float spacing = 2.0f;
+	const uint32_t framesInFlight = vk.getRenderer()->getFramesInFlight();
+
+	vgl::IndirectRenderer renderer(logicalDevice, vk.getUploadEngine(), vk.getDescriptorAllocator(),
+		vgl::ComputePipeline::readFile(VGL_SHADER_DIR "cull.comp.spv"), objectCount, framesInFlight);
+
+	//Every object draws the same cube, the vertex shader places it using the object index passed as first instance
+	std::vector<vgl::IndirectObject> objects(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		objects[i].center[0] = static_cast<float>(i % gridSize) * spacing;
+		objects[i].center[2] = static_cast<float>(i / gridSize) * spacing;
+		objects[i].radius = 0.87f;
+		objects[i].indexCount = 36;
+		objects[i].firstInstance = i;
+	}
+	vgl::UploadTicket objectUpload = renderer.setObjects(objects);
+
+	//Cube corners are numbered by their x, y and z bits, see cube.vert
+	const std::vector<uint16_t> indices = {
+		0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+		0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+		0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3,
+	};
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	vgl::MemoryAllocation indexMemory;
+	logicalDevice->getAllocator()->createBuffer(indices.size() * sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexMemory);
+	vgl::UploadTicket indexUpload = vk.getUploadEngine()->uploadBuffer(indexBuffer, 0, indices.data(), indices.size() * sizeof(uint16_t));
+
+	vgl::SwapChain* swapChain = vk.getRenderer()->getSwapChain();
+	VkFormat format = swapChain ? swapChain->imageFormat : vk.getOffscreenTarget()->format;
+
+	vgl::GraphicsPipelineDesc desc;
+	desc.stages.push_back({ VK_SHADER_STAGE_VERTEX_BIT, vgl::ComputePipeline::readFile(VGL_SHADER_DIR "cube.vert.spv") });
+	desc.stages.push_back({ VK_SHADER_STAGE_FRAGMENT_BIT, vgl::ComputePipeline::readFile(VGL_SHADER_DIR "cube.frag.spv") });
+	desc.cullMode = VK_CULL_MODE_NONE;
+	desc.colorFormats = { format };
+	desc.pushConstantRanges = { VkPushConstantRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Camera) } };
+
+	auto pipeline = logicalDevice->getPipelineCompiler()->compile(desc);
+	pipeline->wait();
+	if (pipeline->hasFailed()) {
+		std::cout << "Pipeline failed to compile: " << pipeline->getError() << "\n";
+		return 1;
+	}
+
+	//What the CPU culler kept for each frame in flight, compared with the GPU count once the frame has finished
+	std::vector<int64_t> expected(framesInFlight, -1);
+	std::vector<uint32_t> visible;
+	uint64_t mismatches = 0;
+	uint32_t comparisons = 0;
+	double simdMs = 0.0;
+	double scalarMs = 0.0;
+	uint32_t framesCulled = 0;
+
+	//CPU culling and the GPU passes side by side in one trace, nullptr without timestamps
+	vgl::GpuProfiler* profiler = vk.getGpuProfiler();
+	vgl::ChromeTrace trace;
+
+	const uint32_t frameCount = 240;
+	for (uint32_t i = 0; i < frameCount; i++) {
+		vk.drawFrame([&](const vgl::FrameContext& frame) {
+			if (!vk.getUploadEngine()->isReady(objectUpload) || !vk.getUploadEngine()->isReady(indexUpload)) {
+				return;
+			}
+
+			//The fence for this frame index has signalled, so the count it read back is final
+			if (expected[frame.frameIndex] >= 0) {
+				int64_t difference = static_cast<int64_t>(renderer.getVisibleCount(frame.frameIndex)) - expected[frame.frameIndex];
+				mismatches += static_cast<uint64_t>(difference < 0 ? -difference : difference);
+				comparisons++;
+			}
+
+			Camera camera{};
+			camera.gridSize = gridSize;
+			camera.spacing = spacing;
+			float half = gridSize * spacing * 0.5f;
+			float angle = static_cast<float>(i) * 0.02f;
+			float eye[3] = { half + std::cos(angle) * half * 0.5f, 40.0f, half + std::sin(angle) * half * 0.5f };
+			float target[3] = { half, 0.0f, half };
+			float projection[16];
+			float view[16];
+			perspective(1.0f, static_cast<float>(frame.extent.width) / static_cast<float>(frame.extent.height), 0.1f, 500.0f, projection);
+			lookAt(eye, target, view);
+			multiply(projection, view, camera.viewProjection);
+
+			//CPU reference, the vectorised and scalar culler must agree exactly
+			vgl::Frustum frustum = vgl::Frustum::fromViewProjection(camera.viewProjection);
+			vgl::CpuTraceScope cpuCull(&trace, "CPU cull");
+			auto start = std::chrono::steady_clock::now();
+			uint32_t simdCount = renderer.getBoundingVolumes().cull(frustum, visible);
+			auto middle = std::chrono::steady_clock::now();
+			uint32_t scalarCount = renderer.getBoundingVolumes().cullScalar(frustum, visible);
+			auto end = std::chrono::steady_clock::now();
+			simdMs += std::chrono::duration<double, std::milli>(middle - start).count();
+			scalarMs += std::chrono::duration<double, std::milli>(end - middle).count();
+			framesCulled++;
+			if (simdCount != scalarCount) {
+				std::cout << "SIMD and scalar culling disagree: " << simdCount << " vs " << scalarCount << "\n";
+			}
+			expected[frame.frameIndex] = simdCount;
+
+			{
+				vgl::GpuProfileScope gpuCull(profiler, frame.commandBuffer, "Cull");
+				renderer.cull(frame.commandBuffer, frame.frameIndex, camera.viewProjection);
+			}
+
+			vgl::GpuProfileScope gpuDraw(profiler, frame.commandBuffer, "Draw");
+
+			VkRenderingAttachmentInfo colourAttachment{};
+			colourAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colourAttachment.imageView = frame.imageView;
+			colourAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.renderArea = { { 0, 0 }, frame.extent };
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colourAttachment;
+
+			vkCmdBeginRendering(frame.commandBuffer, &renderingInfo);
+			pipeline->bind(frame.commandBuffer);
+
+			VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(frame.extent.width), static_cast<float>(frame.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, frame.extent };
+			vkCmdSetViewport(frame.commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(frame.commandBuffer, 0, 1, &scissor);
+			vkCmdPushConstants(frame.commandBuffer, pipeline->getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Camera), &camera);
+			vkCmdBindIndexBuffer(frame.commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+			//One call for the whole scene, the GPU decides how many commands it executes
+			renderer.draw(frame.commandBuffer, frame.frameIndex);
+			vkCmdEndRendering(frame.commandBuffer);
+		});
+	}
+	vk.waitIdle();
+
+	std::cout << objectCount << " objects culled on the GPU and drawn with one indirect draw per frame\n";
+	if (framesCulled > 0) {
+		std::cout << "CPU reference: " << simdMs / framesCulled << "ms " << vgl::BoundingVolumeSet::getSimdLevelName(vgl::BoundingVolumeSet::getSimdLevel())
+			<< ", " << scalarMs / framesCulled << "ms scalar per frame\n";
+	}
+	//Spheres right on a plane can land either side depending on float rounding, so a handful of differences is expected
+	std::cout << "GPU and CPU visible counts differed by " << mismatches << " objects over " << comparisons << " frames\n";
+
+	if (profiler) {
+		std::cout << "GPU cull: " << profiler->getAverageMs("Cull") << "ms, draw: " << profiler->getAverageMs("Draw") << "ms per frame\n";
+		profiler->exportTo(trace);
+		if (trace.write("indirectDraw.trace.json") && profiler->writeCsv("indirectDraw.gpu.csv")) {
+			std::cout << "Wrote indirectDraw.trace.json and indirectDraw.gpu.csv\n";
+		}
+	}
+
+	logicalDevice->getAllocator()->destroyBuffer(indexBuffer, indexMemory);
+}
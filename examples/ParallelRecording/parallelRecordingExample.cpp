@@ -0,0 +1,112 @@
+#include <chrono>
+
+#include "vgl/VulkanCore.h"
+
+struct DrawConstants {
+	float offset[2];
+	float scale[2];
+	float colour[4];
+};
+
+int main() {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Parallel Recording Example";
+
+	vgl::VulkanCore vk(settings);
+	vgl::LogicalDevice* logicalDevice = vk.getLogicalDevice();
+	vgl::CommandRecorder* recorder = vk.getCommandRecorder();
+
+	if (!logicalDevice->isDynamicRenderingEnabled()) {
+		std::cout << "Dynamic rendering is not supported, nothing to record into\n";
+		return 0;
+	}
+
+	//Frames are rendered to the swap chain when a headless surface is used, otherwise to the offscreen target
+	vgl::SwapChain* swapChain = vk.getRenderer()->getSwapChain();
+	VkFormat format = swapChain ? swapChain->imageFormat : vk.getOffscreenTarget()->format;
+
+	vgl::GraphicsPipelineDesc desc;
+	desc.stages.push_back({ VK_SHADER_STAGE_VERTEX_BIT, vgl::ComputePipeline::readFile(VGL_SHADER_DIR "quad.vert.spv") });
+	desc.stages.push_back({ VK_SHADER_STAGE_FRAGMENT_BIT, vgl::ComputePipeline::readFile(VGL_SHADER_DIR "quad.frag.spv") });
+	desc.cullMode = VK_CULL_MODE_NONE;
+	desc.colorFormats = { format };
+	desc.pushConstantRanges = { VkPushConstantRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants) } };
+
+	auto pipeline = logicalDevice->getPipelineCompiler()->compile(desc);
+	pipeline->wait();
+	if (pipeline->hasFailed()) {
+		std::cout << "Pipeline failed to compile: " << pipeline->getError() << "\n";
+		return 1;
+	}
+
+	//One small quad per draw on a grid
+	const uint32_t drawCount = 50000;
+	const uint32_t gridSize = 224;
+	std::vector<DrawConstants> draws(drawCount);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		float x = static_cast<float>(i % gridSize) / gridSize;
+		float y = static_cast<float>(i / gridSize) / gridSize;
+		draws[i] = { { x * 2.0f - 1.0f, y * 2.0f - 1.0f }, { 1.5f / gridSize, 1.5f / gridSize }, { x, y, 1.0f - x, 1.0f } };
+	}
+
+	vgl::SecondaryInheritance inheritance;
+	inheritance.colorFormats = { format };
+
+	//Dynamic state is not inherited by secondaries, so every batch sets it again
+	auto recordDraws = [&](const vgl::FrameContext& frame, VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+		pipeline->bind(commandBuffer);
+
+		VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(frame.extent.width), static_cast<float>(frame.extent.height), 0.0f, 1.0f };
+		VkRect2D scissor{ { 0, 0 }, frame.extent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		for (uint32_t i = begin; i < end; i++) {
+			vkCmdPushConstants(commandBuffer, pipeline->getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &draws[i]);
+			vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+		}
+	};
+
+	//batchSize of drawCount records everything into a single secondary on the calling thread
+	auto run = [&](uint32_t batchSize, uint32_t frameCount) {
+		double recordMs = 0.0;
+		for (uint32_t i = 0; i < frameCount; i++) {
+			vk.drawFrame([&](const vgl::FrameContext& frame) {
+				VkRenderingAttachmentInfo colourAttachment{};
+				colourAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+				colourAttachment.imageView = frame.imageView;
+				colourAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				//The frame has already been cleared
+				colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+				colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+				VkRenderingInfo renderingInfo{};
+				renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+				renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+				renderingInfo.renderArea = { { 0, 0 }, frame.extent };
+				renderingInfo.layerCount = 1;
+				renderingInfo.colorAttachmentCount = 1;
+				renderingInfo.pColorAttachments = &colourAttachment;
+
+				auto start = std::chrono::steady_clock::now();
+				vkCmdBeginRendering(frame.commandBuffer, &renderingInfo);
+				recorder->recordParallel(frame.commandBuffer, drawCount, batchSize, inheritance, [&](VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+					recordDraws(frame, commandBuffer, begin, end);
+				});
+				vkCmdEndRendering(frame.commandBuffer);
+				recordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			});
+		}
+		return recordMs / frameCount;
+	};
+
+	const uint32_t frameCount = 60;
+	double singleMs = run(drawCount, frameCount);
+	double parallelMs = run(1024, frameCount);
+	vk.waitIdle();
+
+	std::cout << drawCount << " draws per frame\n";
+	std::cout << "Single thread recording: " << singleMs << "ms per frame\n";
+	std::cout << "Parallel recording on " << logicalDevice->getJobSystem()->getThreadCount() << " threads: " << parallelMs << "ms per frame\n";
+	std::cout << "Secondary command buffers allocated: " << recorder->getStats().allocated << "\n";
+}
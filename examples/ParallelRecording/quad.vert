@@ -0,0 +1,20 @@
+#version 450
+
+//Small quad placed by the push constants, one per draw
+layout(push_constant) uniform Draw {
+	vec2 offset;
+	vec2 scale;
+	vec4 colour;
+} draw;
+
+layout(location = 0) out vec4 outColour;
+
+const vec2 corners[6] = vec2[](
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+	vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+	gl_Position = vec4(draw.offset + corners[gl_VertexIndex] * draw.scale, 0.0, 1.0);
+	outColour = draw.colour;
+}
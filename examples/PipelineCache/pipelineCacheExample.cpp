@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+
+#include "vgl/VulkanCore.h"
+
+//Run once for a cold start, then again to see the warm start
+//Pass --clear to delete the cache first
+int main(int argc, char** argv) {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Pipeline Cache Example";
+
+	if (argc > 1 && strcmp(argv[1], "--clear") == 0) {
+		std::filesystem::remove_all(settings.pipelineCacheDirectory);
+	}
+
+	vgl::VulkanCore vk(settings);
+	VkDevice device = vk.getLogicalDevice()->device;
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout);
+
+	std::vector<char> spirv = vgl::ComputePipeline::readFile(VGL_SHADER_DIR "variants.comp.spv");
+
+	//Compile a batch of specialised pipelines, as an application would at startup
+	const uint32_t variantCount = 64;
+	auto start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::unique_ptr<vgl::ComputePipeline>> pipelines;
+		for (uint32_t variant = 0; variant < variantCount; variant++) {
+			VkSpecializationMapEntry entry{ 0, 0, sizeof(uint32_t) };
+			VkSpecializationInfo specialization{ 1, &entry, sizeof(uint32_t), &variant };
+			pipelines.push_back(std::make_unique<vgl::ComputePipeline>(vk.getLogicalDevice(), spirv, std::vector<VkDescriptorSetLayout>{ setLayout }, 0, &specialization));
+		}
+	}
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "Serial pipeline compilation took " << totalMs << "ms for " << variantCount << " pipelines\n";
+
+	//Compile another batch on the job system while frames keep being drawn
+	//Variant 0 was compiled above, it stands in for each pipeline until the real one is ready
+	vgl::PipelineCompiler* compiler = vk.getLogicalDevice()->getPipelineCompiler();
+
+	auto makeDesc = [&](uint32_t variant) {
+		vgl::ComputePipelineDesc desc;
+		desc.spirv = spirv;
+		desc.specialization.entries = { VkSpecializationMapEntry{ 0, 0, sizeof(uint32_t) } };
+		desc.specialization.data.resize(sizeof(uint32_t));
+		memcpy(desc.specialization.data.data(), &variant, sizeof(uint32_t));
+		desc.setLayouts = { setLayout };
+		return desc;
+	};
+
+	auto placeholder = compiler->compile(makeDesc(0));
+	placeholder->wait();
+
+	start = std::chrono::steady_clock::now();
+	std::vector<std::shared_ptr<vgl::PipelineHandle>> handles;
+	for (uint32_t variant = variantCount; variant < variantCount * 2; variant++) {
+		handles.push_back(compiler->compile(makeDesc(variant)));
+	}
+
+	uint32_t frames = 0;
+	uint32_t placeholderBinds = 0;
+	while (compiler->getPendingCount() > 0) {
+		vk.drawFrame([&](const vgl::FrameContext& frame) {
+			for (const auto& handle : handles) {
+				if (!handle->isReady()) { placeholderBinds++; }
+				handle->bind(frame.commandBuffer, placeholder.get());
+			}
+		});
+		frames++;
+	}
+	totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	uint32_t failed = 0;
+	for (const auto& handle : handles) {
+		if (handle->hasFailed()) {
+			std::cout << "Variant failed to compile: " << handle->getError() << "\n";
+			failed++;
+		}
+	}
+
+	vk.waitIdle();
+	vk.getLogicalDevice()->getPipelineCache()->printStats();
+	std::cout << "Parallel pipeline compilation took " << totalMs << "ms for " << variantCount << " pipelines on "
+		<< vk.getLogicalDevice()->getJobSystem()->getWorkerCount() << " workers, " << failed << " failed\n";
+	std::cout << frames << " frames drawn meanwhile, placeholder bound " << placeholderBinds << " times\n";
+
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+}
@@ -0,0 +1,89 @@
+#include "vgl/VulkanCore.h"
+
+//Blit the whole of one image onto the whole of another
+void blit(VkCommandBuffer commandBuffer, VkImage src, VkExtent2D srcExtent, VkImage dst, VkExtent2D dstExtent) {
+	VkImageBlit region{};
+	region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.srcOffsets[1] = { static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1 };
+	region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.dstOffsets[1] = { static_cast<int32_t>(dstExtent.width), static_cast<int32_t>(dstExtent.height), 1 };
+	vkCmdBlitImage(commandBuffer, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+}
+
+//Fill an image, then downsample it twice and upscale the result onto the frame
+//Passes are declared in the order their results are consumed
+//The full and quarter size images are never alive at the same time so they share memory, and the debug pass nobody reads is culled
+int main() {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Render Graph Example";
+
+	vgl::VulkanCore vk(settings);
+	vgl::RenderGraph* graph = vk.getRenderGraph();
+
+	const uint32_t frameCount = 10;
+	for (uint32_t i = 0; i < frameCount; i++) {
+		vk.drawFrame([&](const vgl::FrameContext& frame) {
+			graph->reset();
+
+			vgl::RenderGraphResource output = graph->importFrame(frame);
+
+			VkExtent2D full = frame.extent;
+			VkExtent2D half = { std::max(full.width / 2, 1u), std::max(full.height / 2, 1u) };
+			VkExtent2D quarter = { std::max(full.width / 4, 1u), std::max(full.height / 4, 1u) };
+
+			vgl::RenderGraphResource scene = graph->createTexture("scene", { VK_FORMAT_R8G8B8A8_UNORM, full });
+			vgl::RenderGraphResource halfRes = graph->createTexture("half", { VK_FORMAT_R8G8B8A8_UNORM, half });
+			vgl::RenderGraphResource quarterRes = graph->createTexture("quarter", { VK_FORMAT_R8G8B8A8_UNORM, quarter });
+			vgl::RenderGraphResource debug = graph->createTexture("debug", { VK_FORMAT_R8G8B8A8_UNORM, full });
+
+			graph->addPass("scene", [&](vgl::RenderGraph::PassBuilder& pass) {
+				pass.write(scene, vgl::RenderGraphAccess::TransferDst);
+			}, [&](vgl::RenderGraph::PassContext& context) {
+				float t = static_cast<float>(i) / frameCount;
+				VkClearColorValue colour = { { t, 0.5f, 1.0f - t, 1.0f } };
+				VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+				vkCmdClearColorImage(context.commandBuffer, context.getImage(scene), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &colour, 1, &range);
+			});
+
+			graph->addPass("downsampleHalf", [&](vgl::RenderGraph::PassBuilder& pass) {
+				pass.read(scene, vgl::RenderGraphAccess::TransferSrc);
+				pass.write(halfRes, vgl::RenderGraphAccess::TransferDst);
+			}, [&](vgl::RenderGraph::PassContext& context) {
+				blit(context.commandBuffer, context.getImage(scene), full, context.getImage(halfRes), half);
+			});
+
+			graph->addPass("debug", [&](vgl::RenderGraph::PassBuilder& pass) {
+				pass.read(scene, vgl::RenderGraphAccess::TransferSrc);
+				pass.write(debug, vgl::RenderGraphAccess::TransferDst);
+			}, [&](vgl::RenderGraph::PassContext& context) {
+				blit(context.commandBuffer, context.getImage(scene), full, context.getImage(debug), full);
+			});
+
+			graph->addPass("downsampleQuarter", [&](vgl::RenderGraph::PassBuilder& pass) {
+				pass.read(halfRes, vgl::RenderGraphAccess::TransferSrc);
+				pass.write(quarterRes, vgl::RenderGraphAccess::TransferDst);
+			}, [&](vgl::RenderGraph::PassContext& context) {
+				blit(context.commandBuffer, context.getImage(halfRes), half, context.getImage(quarterRes), quarter);
+			});
+
+			graph->addPass("upscale", [&](vgl::RenderGraph::PassBuilder& pass) {
+				pass.read(quarterRes, vgl::RenderGraphAccess::TransferSrc);
+				pass.write(output, vgl::RenderGraphAccess::TransferDst);
+			}, [&](vgl::RenderGraph::PassContext& context) {
+				blit(context.commandBuffer, context.getImage(quarterRes), quarter, context.getImage(output), full);
+			});
+
+			graph->execute(frame.commandBuffer);
+		});
+	}
+	vk.waitIdle();
+
+	const vgl::RenderGraph::Stats& stats = graph->getStats();
+	std::cout << "Execution order:";
+	for (const auto& name : graph->getExecutionOrder()) {
+		std::cout << " " << name;
+	}
+	std::cout << "\n" << stats.passes << " passes, " << stats.culledPasses << " culled, " << stats.barriers << " barriers\n";
+	std::cout << "Transient memory " << stats.transientBytes << " bytes without aliasing, " << stats.allocatedBytes << " bytes allocated\n";
+	std::cout << "Transient resources created " << stats.reallocations << " times over " << frameCount << " frames\n";
+}
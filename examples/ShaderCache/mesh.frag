@@ -0,0 +1,19 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform Camera {
+	mat4 viewProjection;
+} camera;
+
+layout(set = 1, binding = 0) uniform sampler2D albedo;
+
+layout(push_constant) uniform Draw {
+	mat4 model;
+	vec4 colour;
+} draw;
+
+layout(location = 0) in vec4 inColour;
+layout(location = 0) out vec4 outColour;
+
+void main() {
+	outColour = inColour * texture(albedo, gl_FragCoord.xy / 512.0) * draw.colour;
+}
@@ -0,0 +1,19 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform Camera {
+	mat4 viewProjection;
+} camera;
+
+//Shared with the fragment stage, the layout gets one range visible to both
+layout(push_constant) uniform Draw {
+	mat4 model;
+	vec4 colour;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 0) out vec4 outColour;
+
+void main() {
+	gl_Position = camera.viewProjection * draw.model * vec4(inPosition, 1.0);
+	outColour = draw.colour;
+}
@@ -0,0 +1,76 @@
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "vgl/VulkanCore.h"
+
+namespace {
+
+	const char* getTypeName(VkDescriptorType type) {
+		switch (type) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER: return "sampler";
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return "combined image sampler";
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return "sampled image";
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return "storage image";
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return "uniform buffer";
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return "storage buffer";
+		default: return "other";
+		}
+	}
+
+	void printReflection(const vgl::Shader& shader) {
+		const vgl::ShaderReflection& reflection = shader.getReflection();
+		std::cout << shader.getName() << " (hash " << std::hex << shader.getHash() << std::dec << "), entry point " << reflection.entryPoint;
+		if (reflection.stage == VK_SHADER_STAGE_COMPUTE_BIT) {
+			std::cout << ", workgroup " << reflection.localSize[0] << "x" << reflection.localSize[1] << "x" << reflection.localSize[2];
+		}
+		std::cout << ", " << reflection.pushConstantSize << " bytes of push constants\n";
+		for (const vgl::ShaderBinding& binding : reflection.bindings) {
+			std::cout << "  set " << binding.set << " binding " << binding.binding << ": " << getTypeName(binding.type) << " x" << binding.count << "\n";
+		}
+	}
+
+}
+
+//Run once to parse the shaders, then again to see the reflections come from the cache
+//Pass --clear to delete the cache first
+int main(int argc, char** argv) {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Shader Cache Example";
+
+	if (argc > 1 && strcmp(argv[1], "--clear") == 0) {
+		std::filesystem::remove_all(settings.pipelineCacheDirectory);
+	}
+
+	vgl::VulkanCore vk(settings);
+	vgl::ShaderCache* shaderCache = vk.getLogicalDevice()->getShaderCache();
+
+	auto blur = shaderCache->load(VGL_SHADER_DIR "blur.comp.spv");
+	auto vertex = shaderCache->load(VGL_SHADER_DIR "mesh.vert.spv");
+	auto fragment = shaderCache->load(VGL_SHADER_DIR "mesh.frag.spv");
+	printReflection(*blur);
+	printReflection(*vertex);
+	printReflection(*fragment);
+
+	//The same code loaded again, from a file or from memory, shares the first module
+	std::vector<char> spirv = vgl::ComputePipeline::readFile(VGL_SHADER_DIR "blur.comp.spv");
+	auto again = shaderCache->create(spirv.data(), spirv.size(), "blur copy");
+	std::cout << "Module shared with the copy: " << (again->getModule() == blur->getModule() ? "yes" : "no") << "\n";
+
+	//Layouts for both stages of the mesh pipeline, the camera binding and push constants are merged
+	const vgl::ShaderLayout& meshLayout = shaderCache->getLayout({ vertex, fragment });
+	std::cout << "Mesh layout: " << meshLayout.setLayouts.size() << " sets, " << meshLayout.bindings.size() << " bindings";
+	if (!meshLayout.pushConstantRanges.empty()) {
+		std::cout << ", push constants visible to stages 0x" << std::hex << meshLayout.pushConstantRanges[0].stageFlags << std::dec;
+	}
+	std::cout << "\n";
+
+	//Only the shader is given, the pipeline compiler builds the layout from the reflection
+	vgl::ComputePipelineDesc desc;
+	desc.shader = blur;
+	auto pipeline = vk.getLogicalDevice()->getPipelineCompiler()->compile(desc);
+	pipeline->wait();
+	std::cout << "Blur pipeline " << (pipeline->isReady() ? "compiled" : "failed: " + pipeline->getError()) << " in " << pipeline->getCompileMs() << "ms\n";
+
+	shaderCache->printStats();
+}
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "vgl/VulkanCore.h"
+
+namespace {
+
+	//Write a checkerboard with a full mip chain as an RGBA8 KTX2 file
+	//Levels are stored coarsest first as KTX2 requires, the data format descriptor is left out since the streamer doesn't read it
+	void writeTexture(const std::string& path, uint32_t size, uint32_t seed) {
+		uint32_t levelCount = 1;
+		while ((size >> levelCount) > 0) { levelCount++; }
+
+		const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+		uint32_t header[13] = { VK_FORMAT_R8G8B8A8_UNORM, 1, size, size, 0, 0, 1, levelCount, 0, 0, 0, 0, 0 };
+		uint64_t supercompression[2] = { 0, 0 };
+
+		std::vector<uint64_t> levelIndex(levelCount * 3);
+		uint64_t offset = sizeof(identifier) + sizeof(header) + sizeof(supercompression) + levelIndex.size() * sizeof(uint64_t);
+		for (uint32_t level = levelCount; level-- > 0;) {
+			uint64_t extent = std::max(size >> level, 1u);
+			levelIndex[level * 3 + 0] = offset;
+			levelIndex[level * 3 + 1] = extent * extent * 4;
+			levelIndex[level * 3 + 2] = extent * extent * 4;
+			offset += extent * extent * 4;
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(identifier), sizeof(identifier));
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(supercompression), sizeof(supercompression));
+		file.write(reinterpret_cast<const char*>(levelIndex.data()), levelIndex.size() * sizeof(uint64_t));
+		for (uint32_t level = levelCount; level-- > 0;) {
+			uint32_t extent = std::max(size >> level, 1u);
+			std::vector<uint32_t> texels(extent * extent);
+			for (uint32_t y = 0; y < extent; y++) {
+				for (uint32_t x = 0; x < extent; x++) {
+					bool odd = (((x << level) / 64) + ((y << level) / 64)) % 2;
+					texels[y * extent + x] = odd ? 0xFFFFFFFFu : 0xFF000000u | (seed * 0x9E3779B9u >> 8);
+				}
+			}
+			file.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(uint32_t));
+		}
+	}
+
+}
+
+//Walk through a row of areas that each use a few large textures, with a memory cap smaller than all of them together
+//Textures of the area being visited gain detail while the ones left behind lose it, and nothing waits on the disk
+int main() {
+	vgl::HeadlessSettings settings;
+	settings.applicationName = "Texture Streaming Example";
+
+	vgl::VulkanCore vk(settings);
+	vgl::TextureStreamer* streamer = vk.getTextureStreamer();
+
+	//Each 2048x2048 texture is 21MB with its mips, 16 of them would need 341MB
+	vgl::TextureStreamerSettings streamerSettings;
+	streamerSettings.memoryCap = 96ull * 1024 * 1024;
+	streamer->setSettings(streamerSettings);
+
+	const uint32_t textureCount = 16;
+	const uint32_t texturesPerArea = 4;
+	const std::string directory = "streamed_textures";
+	std::filesystem::create_directories(directory);
+
+	std::vector<vgl::StreamedTexture> textures;
+	for (uint32_t i = 0; i < textureCount; i++) {
+		std::string path = directory + "/texture_" + std::to_string(i) + ".ktx2";
+		if (!std::filesystem::exists(path)) {
+			writeTexture(path, 2048, i);
+		}
+		textures.push_back(streamer->load(path));
+	}
+
+	const uint32_t framesPerArea = 60;
+	const uint32_t areaCount = textureCount / texturesPerArea;
+	for (uint32_t frame = 0; frame < framesPerArea * areaCount; frame++) {
+		uint32_t area = frame / framesPerArea;
+		for (uint32_t i = 0; i < texturesPerArea; i++) {
+			streamer->markUsed(textures[area * texturesPerArea + i]);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		vk.drawFrame();
+		double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (frame % framesPerArea == framesPerArea - 1) {
+			std::cout << "Area " << area << " after " << framesPerArea << " frames (last frame " << frameMs << "ms), finest resident level per texture:";
+			for (vgl::StreamedTexture texture : textures) {
+				std::cout << " " << streamer->getResidentLevel(texture);
+			}
+			std::cout << "\n";
+		}
+	}
+	vk.waitIdle();
+
+	streamer->printStats();
+}
@@ -0,0 +1,94 @@
+#ifndef VGL_ASYNCCOMPUTE_H
+#define VGL_ASYNCCOMPUTE_H
+
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+
+namespace vgl {
+
+	/*
+	Records and submits work to the async compute queue so it can overlap with rasterisation on the graphics queue.
+	Submissions go through the QueueScheduler's compute queue and signal its timeline, the graphics queue waits on it only where
+	it consumes the results (e.g. FrameRenderer::addWaitSemaphore with the vertex input or draw indirect stage), and compute can wait on the
+	FrameRenderer's timeline semaphore to consume what a frame rendered. Submissions are batched with the frame's and reach the GPU
+	when the frame ends, or earlier if something waits on them.
+
+	Resources written on one queue and read on the other should be created with VK_SHARING_MODE_CONCURRENT over getSharingFamilies(),
+	which avoids ownership transfers. If the device has no compute only family, the graphics queue is used and the work is serialised.
+
+	Not thread safe, begin and submit should be called from the thread that submits frames.
+	*/
+	class AsyncCompute {
+
+	public:
+
+		//Number of submissions that can be in flight before begin has to wait
+		static constexpr uint32_t defaultSlotCount = 3;
+
+		AsyncCompute(vgl::LogicalDevice* _logicalDevice, uint32_t _slotCount = defaultSlotCount);
+		~AsyncCompute();
+
+		//Owns Vulkan handles so can not be copied
+		AsyncCompute(const AsyncCompute&) = delete;
+		AsyncCompute& operator=(const AsyncCompute&) = delete;
+
+		//Start recording a submission, only blocks if the slot's previous submission hasn't finished
+		VkCommandBuffer begin();
+
+		//Submit everything recorded since begin after the waits have been met
+		//Returns the value the timeline semaphore reaches when the work has finished
+		uint64_t submit(const std::vector<vgl::SemaphoreWait>& waits = {});
+
+		//The point submit's value is on, for waits through the QueueScheduler
+		vgl::QueuePoint getPoint(uint64_t value) const;
+
+		bool isComplete(uint64_t value) const;
+		void wait(uint64_t value) const;
+
+		VkSemaphore getSemaphore() const;
+		//Value signalled by the most recent submission
+		uint64_t getSubmittedValue() const;
+
+		VkQueue getQueue() const;
+		uint32_t getQueueFamily() const;
+		//Whether work actually runs on a separate queue from graphics
+		bool isDedicated() const;
+
+		//Queue families a resource shared between graphics and compute has to list for VK_SHARING_MODE_CONCURRENT
+		//Empty when compute runs on the graphics family, use VK_SHARING_MODE_EXCLUSIVE then
+		std::vector<uint32_t> getSharingFamilies() const;
+
+		//Fill a create info for a buffer that is shared between graphics and compute
+		//sharingFamilies has to outlive the create info since it is pointed to
+		void setSharing(VkBufferCreateInfo& bufferInfo, const std::vector<uint32_t>& sharingFamilies) const;
+
+	private:
+
+		//Each slot is reset and reused once the submission that used it has finished
+		struct Slot {
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			uint64_t value = 0;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::QueueScheduler* scheduler = nullptr;
+
+		VkQueue queue = VK_NULL_HANDLE;
+		uint32_t queueFamily = 0;
+		bool dedicated = false;
+
+		std::vector<Slot> slots;
+		uint32_t currentSlot = 0;
+		bool recording = false;
+
+		uint64_t submittedValue = 0;
+
+	};
+
+}
+
+#endif // !VGL_ASYNCCOMPUTE_H
@@ -0,0 +1,142 @@
+#ifndef VGL_BINDLESSHEAP_H
+#define VGL_BINDLESSHEAP_H
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+
+namespace vgl {
+
+	//Number of descriptors in each of the bindless heap's arrays
+	struct BindlessCapacity {
+		uint32_t textures = 16384;
+		uint32_t storageImages = 1024;
+		uint32_t storageBuffers = 16384;
+	};
+
+	/*
+	Global descriptor heap for bindless rendering.
+	Every texture, storage image and storage buffer is written into one large descriptor set that is bound once per command buffer.
+	Draws and dispatches pass the integer handles of what they use through push constants, so switching materials never rebinds descriptors.
+
+	The set has three runtime sized arrays, declared in shaders as:
+		layout(set = 0, binding = 0) uniform sampler2D textures[];
+		layout(set = 0, binding = 1, rgba8) uniform image2D storageImages[];
+		layout(set = 0, binding = 2) buffer StorageBuffers { uint data[]; } storageBuffers[];
+	Bindings are partially bound and update after bind, so descriptors can be added while the set is bound in pending command buffers
+	and slots that were never written are fine as long as shaders don't read them.
+
+	Handles come from a free list per binding. Removed handles are only reused after framesInFlight frames, so a command buffer still
+	in flight never sees its descriptor replaced.
+
+	Requires LogicalDevice::isBindlessEnabled(). All functions are thread safe.
+	*/
+	class BindlessHeap {
+
+	public:
+
+		static constexpr uint32_t invalidHandle = UINT32_MAX;
+
+		//Size of the push constant block every bindless pipeline shares, the minimum every device supports
+		static constexpr uint32_t pushConstantSize = 128;
+
+		enum Binding : uint32_t {
+			Textures = 0,
+			StorageImages = 1,
+			StorageBuffers = 2,
+			BindingCount = 3,
+		};
+
+		struct Stats {
+			//Handles currently in use for each binding
+			uint32_t used[BindingCount] = {};
+			//Size of each array after clamping to the device limits
+			uint32_t capacity[BindingCount] = {};
+			//Descriptor writes since creation
+			uint64_t writes = 0;
+		};
+
+		//_capacity is clamped to the device's update after bind limits
+		//_framesInFlight is how many frames removed handles wait before being reused
+		BindlessHeap(vgl::LogicalDevice* _logicalDevice, uint32_t _framesInFlight, const vgl::BindlessCapacity& _capacity = {});
+		~BindlessHeap();
+
+		//Owns Vulkan handles so can not be copied
+		BindlessHeap(const BindlessHeap&) = delete;
+		BindlessHeap& operator=(const BindlessHeap&) = delete;
+
+		//Make handles removed long enough ago available again
+		//Must be called once per frame after the frame's fence has signalled
+		void beginFrame();
+
+		//_sampler of VK_NULL_HANDLE uses the heap's linear repeat sampler
+		uint32_t addTexture(VkImageView view, VkSampler sampler = VK_NULL_HANDLE, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uint32_t addStorageImage(VkImageView view);
+		uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+		//Point an existing handle at a different resource, e.g. when a streamed texture gets more mips
+		//Only safe when no command buffer in flight reads the handle, otherwise remove it and add a new one
+		void updateTexture(uint32_t handle, VkImageView view, VkSampler sampler = VK_NULL_HANDLE, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		//The handle is reused once the frames in flight have finished with it
+		void removeTexture(uint32_t handle);
+		void removeStorageImage(uint32_t handle);
+		void removeStorageBuffer(uint32_t handle);
+
+		//Bind the heap as set 0, once per command buffer and bind point is enough for any pipeline created with getPipelineLayout
+		//or with a layout that has getSetLayout as set 0 and getPushConstantRange as its only push constant range
+		void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const;
+
+		//Push handles and other per-draw data, size must not exceed pushConstantSize
+		void pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset = 0) const;
+
+		VkDescriptorSetLayout getSetLayout() const;
+		VkDescriptorSet getSet() const;
+		//Layout with just the heap and the shared push constant block, for pipelines that need nothing else
+		VkPipelineLayout getPipelineLayout() const;
+		VkPushConstantRange getPushConstantRange() const;
+		VkSampler getDefaultSampler() const;
+
+		Stats getStats() const;
+
+	private:
+
+		//Free list for one binding, handles freed in a frame are held back until the frame is no longer in flight
+		struct Slots {
+			uint32_t capacity = 0;
+			//Next handle never handed out
+			uint32_t next = 0;
+			std::vector<uint32_t> free;
+			//Removed handles and the frame they were removed in
+			std::vector<std::pair<uint64_t, uint32_t>> retired;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		uint32_t framesInFlight = 0;
+
+		VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkSampler defaultSampler = VK_NULL_HANDLE;
+
+		Slots slots[BindingCount];
+		uint64_t frameNumber = 0;
+		uint64_t writes = 0;
+
+		mutable std::mutex mutex;
+
+		uint32_t allocate(Binding binding);
+		void release(Binding binding, uint32_t handle);
+
+		void writeImage(Binding binding, uint32_t handle, const VkDescriptorImageInfo& imageInfo);
+
+	};
+
+}
+
+#endif // !VGL_BINDLESSHEAP_H
@@ -0,0 +1,128 @@
+#ifndef VGL_BOUNDINGVOLUMES_H
+#define VGL_BOUNDINGVOLUMES_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vgl {
+
+	struct Sphere {
+		glm::vec3 center{ 0.0f };
+		float radius = 0.0f;
+	};
+
+	struct Aabb {
+		glm::vec3 min{ 0.0f };
+		glm::vec3 max{ 0.0f };
+
+		glm::vec3 getCenter() const;
+		glm::vec3 getExtents() const;
+		//Smallest sphere around the box, centred on it
+		vgl::Sphere getBoundingSphere() const;
+	};
+
+	//Six planes facing into the view volume, each stored as (normal, distance) with a unit length normal
+	struct Frustum {
+		enum Plane : uint32_t {
+			Left = 0,
+			Right = 1,
+			Bottom = 2,
+			Top = 3,
+			Near = 4,
+			Far = 5,
+			PlaneCount = 6,
+		};
+
+		glm::vec4 planes[PlaneCount];
+
+		//Extract the planes from a view projection matrix with Vulkan's 0 to 1 depth range
+		static Frustum fromViewProjection(const glm::mat4& viewProjection);
+		//Column major matrix as 16 floats
+		static Frustum fromViewProjection(const float* viewProjection);
+
+		bool intersects(const vgl::Sphere& sphere) const;
+		bool intersects(const vgl::Aabb& box) const;
+	};
+
+	//Instruction sets the culling kernels are compiled for, the best one the CPU supports is picked at runtime
+	enum class SimdLevel : uint32_t {
+		Scalar = 0,
+		//4 objects per instruction, always available on x86-64
+		Sse2 = 1,
+		//8 objects per instruction
+		Avx2 = 2,
+	};
+
+	//What an object's bounding volume is tested against
+	struct CullQuery {
+		vgl::Frustum frustum;
+		//Test the boxes instead of the spheres, tighter for long thin objects but about twice the work
+		bool useAabbs = false;
+		//Objects further than maxDistance from viewPoint are culled as well, infinity disables the test
+		glm::vec3 viewPoint{ 0.0f };
+		float maxDistance = std::numeric_limits<float>::infinity();
+	};
+
+	/*
+	Bounding spheres and boxes of every object in a scene, stored as structure of arrays so each SIMD instruction tests 4 (SSE2) or 8 (AVX2)
+	objects against a plane. This is the CPU side of the visibility pass, run before draws are submitted or as a reference for GPU culling.
+
+	Every object has both a sphere and a box, whichever one is added the other is derived from it.
+	Every SIMD level returns exactly the same indices as the scalar kernel, the operations are done in the same order and without FMA.
+	The AVX2 kernels are compiled for that target on their own, the rest of the library doesn't need AVX2 to be enabled.
+	*/
+	class BoundingVolumeSet {
+
+	public:
+
+		void clear();
+		void reserve(uint32_t count);
+
+		//Returns the index of the object
+		uint32_t add(const vgl::Sphere& sphere);
+		uint32_t add(const vgl::Aabb& box);
+		void set(uint32_t index, const vgl::Sphere& sphere);
+		void set(uint32_t index, const vgl::Aabb& box);
+
+		vgl::Sphere getSphere(uint32_t index) const;
+		vgl::Aabb getAabb(uint32_t index) const;
+
+		uint32_t size() const;
+
+		//Fill visible with the indices of the objects that pass the query in increasing order, returns how many there are
+		uint32_t cull(const vgl::CullQuery& query, std::vector<uint32_t>& visible) const;
+		uint32_t cull(const vgl::CullQuery& query, std::vector<uint32_t>& visible, vgl::SimdLevel level) const;
+
+		//Spheres against the frustum
+		uint32_t cull(const vgl::Frustum& frustum, std::vector<uint32_t>& visible) const;
+		uint32_t cullScalar(const vgl::Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+		//Best level supported by both the build and the CPU, checked once
+		static vgl::SimdLevel getSimdLevel();
+		static bool isSupported(vgl::SimdLevel level);
+		static const char* getSimdLevelName(vgl::SimdLevel level);
+
+	private:
+
+		//Sphere
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+
+		//Box as its centre and half size
+		std::vector<float> boxX;
+		std::vector<float> boxY;
+		std::vector<float> boxZ;
+		std::vector<float> extentX;
+		std::vector<float> extentY;
+		std::vector<float> extentZ;
+
+	};
+
+}
+
+#endif // !VGL_BOUNDINGVOLUMES_H
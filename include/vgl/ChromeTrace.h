@@ -0,0 +1,93 @@
+#ifndef VGL_CHROMETRACE_H
+#define VGL_CHROMETRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vgl {
+
+	//One complete ("X") event of a trace, times are microseconds on the trace clock
+	struct TraceEvent {
+		std::string name;
+		std::string category;
+		uint32_t processId = 0;
+		uint32_t threadId = 0;
+		double beginUs = 0.0;
+		double durationUs = 0.0;
+	};
+
+	/*
+	Events collected from the CPU and the GPU written out in the Chrome trace event format, open the file in chrome://tracing or https://ui.perfetto.dev.
+	CPU scopes go under cpuProcess with a track per thread, GPU scopes under gpuProcess with a track per queue.
+
+	Every event uses the same clock, microseconds of std::chrono::steady_clock since the first time the clock was read,
+	so GPU timestamps have to be converted onto it before they are added, see GpuProfiler.
+	*/
+	class ChromeTrace {
+
+	public:
+
+		static constexpr uint32_t cpuProcess = 1;
+		static constexpr uint32_t gpuProcess = 2;
+
+		//Current time on the trace clock
+		static double now();
+		static double toTraceTime(std::chrono::steady_clock::time_point time);
+
+		//Small id of the calling thread, stable for the thread's lifetime, used as the CPU track
+		static uint32_t getThreadId();
+
+		//Safe to call from any thread
+		void addEvent(const vgl::TraceEvent& event);
+		void addEvents(const std::vector<vgl::TraceEvent>& events);
+		//Scope on the calling thread's CPU track
+		void addCpuScope(const std::string& name, double beginUs, double endUs);
+
+		//Label shown for a track instead of its id
+		void setThreadName(uint32_t processId, uint32_t threadId, const std::string& name);
+
+		size_t getEventCount() const;
+		void clear();
+
+		//Returns false if the file couldn't be written
+		bool write(const std::string& path) const;
+
+	private:
+
+		struct ThreadName {
+			uint32_t processId = 0;
+			uint32_t threadId = 0;
+			std::string name;
+		};
+
+		mutable std::mutex mutex;
+		std::vector<vgl::TraceEvent> events;
+		std::vector<ThreadName> threadNames;
+
+	};
+
+	//Adds a CPU scope covering its own lifetime to a trace, does nothing if the trace is nullptr
+	class CpuTraceScope {
+
+	public:
+
+		CpuTraceScope(vgl::ChromeTrace* _trace, const char* _name);
+		~CpuTraceScope();
+
+		CpuTraceScope(const CpuTraceScope&) = delete;
+		CpuTraceScope& operator=(const CpuTraceScope&) = delete;
+
+	private:
+
+		vgl::ChromeTrace* trace = nullptr;
+		const char* name = nullptr;
+		double beginUs = 0.0;
+
+	};
+
+}
+
+#endif // !VGL_CHROMETRACE_H
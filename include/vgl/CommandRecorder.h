@@ -0,0 +1,114 @@
+#ifndef VGL_COMMANDRECORDER_H
+#define VGL_COMMANDRECORDER_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/JobSystem.h"
+
+namespace vgl {
+
+	//What secondary command buffers inherit from the primary they are executed in
+	//Leave everything empty for secondaries executed outside of rendering (compute, copies)
+	struct SecondaryInheritance {
+		//Render pass the secondaries continue, VK_NULL_HANDLE when using dynamic rendering
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		uint32_t subpass = 0;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+		//Attachment formats of the dynamic rendering instance the secondaries continue
+		//The primary must begin rendering with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+		std::vector<VkFormat> colorFormats;
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+		//Whether the secondaries are executed inside a render pass or dynamic rendering
+		bool continuesRendering() const { return renderPass != VK_NULL_HANDLE || !colorFormats.empty() || depthFormat != VK_FORMAT_UNDEFINED; }
+	};
+
+	/*
+	Records secondary command buffers in parallel on the job system.
+	Command pools can only be used by one thread at a time, so every thread of the job system gets its own pool for every frame in flight.
+	Secondaries are never freed, beginFrame resets the frame's pools wholesale and the buffers are handed out again.
+
+	Recording is split into batches, each batch goes into its own secondary and the secondaries are returned in batch order,
+	so the result is the same no matter which threads recorded them. They can be executed straight away or kept
+	and stitched into the primary later, e.g. in the order a render graph runs its passes.
+	*/
+	class CommandRecorder {
+
+	public:
+
+		//Records the items in [begin, end) into commandBuffer, called from several threads at once
+		using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+
+		struct Stats {
+			//Secondaries recorded since the last beginFrame
+			uint32_t recordedThisFrame = 0;
+			//Secondaries allocated across every pool, stays flat once the pools have warmed up
+			uint32_t allocated = 0;
+		};
+
+		//_queueFamily is the family of the queue the primaries are submitted to
+		CommandRecorder(vgl::LogicalDevice* _logicalDevice, vgl::JobSystem* _jobSystem, uint32_t _queueFamily, uint32_t _frameCount);
+		~CommandRecorder();
+
+		//Owns command pools so can not be copied
+		CommandRecorder(const CommandRecorder&) = delete;
+		CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+		//Reset every pool used the last time this frame index was recorded
+		//Must only be called once the GPU has finished with that frame
+		void beginFrame(uint32_t frameIndex);
+
+		//Record [0, count) in batches of batchSize across the job system, returns one secondary per batch in batch order
+		//The secondaries are valid until beginFrame is called for this frame index again
+		std::vector<VkCommandBuffer> recordSecondaries(uint32_t count, uint32_t batchSize, const vgl::SecondaryInheritance& inheritance, const RecordFunction& record);
+
+		//Record secondaries and execute them in primary
+		void recordParallel(VkCommandBuffer primary, uint32_t count, uint32_t batchSize, const vgl::SecondaryInheritance& inheritance, const RecordFunction& record);
+
+		//Execute secondaries in primary in the order given
+		static void execute(VkCommandBuffer primary, const std::vector<VkCommandBuffer>& secondaries);
+
+		Stats getStats() const;
+
+	private:
+
+		//Pool owned by one thread for one frame in flight
+		struct ThreadPool {
+			VkCommandPool pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> buffers;
+			//Buffers handed out since the pool was last reset
+			uint32_t used = 0;
+		};
+
+		//Secondaries allocated at once when a pool runs out
+		static constexpr uint32_t allocationChunk = 8;
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::JobSystem* jobSystem = nullptr;
+
+		//Indexed by [frame][thread index]
+		std::vector<std::vector<ThreadPool>> frames;
+		uint32_t currentFrame = 0;
+
+		//Threads that aren't workers all share thread index 0, so only one of them can record at a time
+		std::mutex recordMutex;
+
+		Stats stats;
+		std::atomic<uint32_t> allocatedCount{ 0 };
+
+		//Take the next free secondary from the calling thread's pool
+		VkCommandBuffer acquireSecondary(ThreadPool& threadPool);
+
+	};
+
+}
+
+#endif // !VGL_COMMANDRECORDER_H
@@ -0,0 +1,57 @@
+#ifndef VGL_COMPUTEPIPELINE_H
+#define VGL_COMPUTEPIPELINE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+
+namespace vgl {
+
+	/*
+	A compute shader and the pipeline layout it is used with.
+	Commands can be recorded into command buffers for either the graphics queue or the async compute queue.
+	*/
+	class ComputePipeline {
+
+	public:
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+
+		//_spirv is the compiled shader, _pushConstantSize is the size of the push constant block in bytes (0 if there isn't one)
+		//_specialization can be nullptr, the entry point is read from the SPIR-V
+		//The pipeline is created with the device's pipeline cache
+		ComputePipeline(vgl::LogicalDevice* _logicalDevice, const std::vector<char>& _spirv, const std::vector<VkDescriptorSetLayout>& _setLayouts = {},
+			uint32_t _pushConstantSize = 0, const VkSpecializationInfo* _specialization = nullptr);
+		~ComputePipeline();
+
+		//Owns Vulkan handles so can not be copied
+		ComputePipeline(const ComputePipeline&) = delete;
+		ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer) const;
+		void bindDescriptorSets(VkCommandBuffer commandBuffer, const std::vector<VkDescriptorSet>& sets, uint32_t firstSet = 0) const;
+		void pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset = 0) const;
+
+		//Dispatch workgroups directly
+		void dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1) const;
+
+		//Number of workgroups needed to cover a number of invocations
+		static uint32_t groupCount(uint32_t invocations, uint32_t groupSize);
+
+		//Read a compiled SPIR-V file
+		static std::vector<char> readFile(const std::string& filename);
+
+	private:
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+
+	};
+
+}
+
+#endif // !VGL_COMPUTEPIPELINE_H
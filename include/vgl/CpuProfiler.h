@@ -0,0 +1,162 @@
+#ifndef VGL_CPUPROFILER_H
+#define VGL_CPUPROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vgl/ChromeTrace.h"
+
+//Scoped timers, compiled out unless the library is built with VGL_ENABLE_PROFILING which defines VGL_PROFILING
+//name must be a string literal or otherwise outlive the profiler
+#ifdef VGL_PROFILING
+#define VGL_PROFILE_CONCAT_INNER(a, b) a##b
+#define VGL_PROFILE_CONCAT(a, b) VGL_PROFILE_CONCAT_INNER(a, b)
+#define VGL_PROFILE_SCOPE(name) vgl::CpuProfileScope VGL_PROFILE_CONCAT(vglProfileScope, __LINE__)(name)
+#define VGL_PROFILE_FUNCTION() VGL_PROFILE_SCOPE(__func__)
+#else
+#define VGL_PROFILE_SCOPE(name) ((void)0)
+#define VGL_PROFILE_FUNCTION() ((void)0)
+#endif
+
+namespace vgl {
+
+	//Timings of every sample of one scope name
+	struct CpuScopeStats {
+		std::string name;
+		uint64_t count = 0;
+		double totalMs = 0.0;
+		double meanMs = 0.0;
+		double p50Ms = 0.0;
+		double p99Ms = 0.0;
+		double maxMs = 0.0;
+	};
+
+	/*
+	Process wide profiler behind the VGL_PROFILE_SCOPE macros.
+	Every thread writes its samples to its own fixed size ring without locking, the only shared writes are registering the ring
+	the first time a thread records and draining and freeing it when the thread exits. collect drains the rings into per-name durations and trace events, VulkanCore calls it at
+	the start of every frame, otherwise call it before the rings fill up (ringCapacity samples per thread), newer samples are dropped when full.
+	*/
+	class CpuProfiler {
+
+	public:
+
+		//Samples each thread can hold before collect has to run
+		static constexpr uint32_t ringCapacity = 8192;
+		//Durations kept per scope name for the percentiles, the oldest are replaced after that
+		static constexpr uint32_t maxSamplesPerScope = 16384;
+		//Samples kept for the trace, later ones are only counted in the stats
+		static constexpr uint32_t maxTraceEvents = 1u << 20;
+
+		//The one profiler every scope records to, never destroyed so threads can record until the process exits
+		static vgl::CpuProfiler& get();
+
+		//Disabling at runtime stops new samples being recorded, the macros still cost an atomic load
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+
+		//Record a sample on the calling thread's ring, times are steady_clock nanoseconds
+		void record(const char* name, int64_t beginNs, int64_t endNs);
+
+		//Move every thread's samples into the stats and the trace, safe to call from any thread
+		void collect();
+
+		//Collects first, sorted by total time
+		std::vector<vgl::CpuScopeStats> getReport();
+		//Table of the report, one row per scope
+		void printReport(std::ostream& out);
+
+		//Samples dropped because a ring was full
+		uint64_t getDroppedCount() const;
+
+		//Collects first then adds every kept sample to the trace as CPU events
+		void exportTo(vgl::ChromeTrace& trace);
+		bool writeChromeTrace(const std::string& path);
+
+		//Forget every collected sample, samples still in the rings are dropped too
+		void reset();
+
+	private:
+
+		struct Sample {
+			const char* name = nullptr;
+			int64_t beginNs = 0;
+			int64_t endNs = 0;
+		};
+
+		//Written only by its thread, read only by collect
+		struct ThreadRing {
+			uint32_t threadId = 0;
+			std::unique_ptr<Sample[]> samples;
+			std::atomic<uint64_t> head{ 0 };
+			std::atomic<uint64_t> tail{ 0 };
+		};
+
+		struct ScopeSamples {
+			std::vector<double> durationsMs;
+			//Next slot to overwrite once durationsMs is full
+			size_t next = 0;
+			uint64_t count = 0;
+			double totalMs = 0.0;
+			double maxMs = 0.0;
+		};
+
+		struct TraceSample {
+			const char* name = nullptr;
+			uint32_t threadId = 0;
+			int64_t beginNs = 0;
+			int64_t endNs = 0;
+		};
+
+		std::atomic<bool> enabled{ true };
+		std::atomic<uint64_t> dropped{ 0 };
+
+		//Guards the list of rings, taken once per thread and by collect
+		std::mutex ringMutex;
+		std::vector<std::unique_ptr<ThreadRing>> rings;
+
+		//Guards everything collect writes
+		std::mutex collectMutex;
+		std::unordered_map<std::string, ScopeSamples> scopes;
+		//Same scopes looked up by the name's address
+		std::unordered_map<const char*, ScopeSamples*> scopesByName;
+		std::vector<TraceSample> trace;
+
+		CpuProfiler() = default;
+
+		//nullptr once the thread's ring has been released on thread exit
+		ThreadRing* getThreadRing();
+		//Drain a ring and free it, called when its thread exits
+		void releaseThreadRing(ThreadRing* ring);
+		//Move a ring's samples into the stats and the trace, caller holds collectMutex and ringMutex
+		void drain(ThreadRing& ring);
+
+	};
+
+	//Records the time between its construction and destruction, use through VGL_PROFILE_SCOPE
+	class CpuProfileScope {
+
+	public:
+
+		explicit CpuProfileScope(const char* _name);
+		~CpuProfileScope();
+
+		CpuProfileScope(const CpuProfileScope&) = delete;
+		CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+	private:
+
+		const char* name = nullptr;
+		int64_t beginNs = 0;
+
+	};
+
+}
+
+#endif // !VGL_CPUPROFILER_H
@@ -0,0 +1,191 @@
+#ifndef VGL_DESCRIPTORALLOCATOR_H
+#define VGL_DESCRIPTORALLOCATOR_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/JobSystem.h"
+
+namespace vgl {
+
+	//Collects the descriptors of one set, hashed so identical sets can be found in a cache
+	class DescriptorWriter {
+
+	public:
+
+		DescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE,
+			uint32_t arrayElement = 0);
+		DescriptorWriter& writeImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler = VK_NULL_HANDLE,
+			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, uint32_t arrayElement = 0);
+
+		//Write every descriptor collected into set
+		void update(VkDevice device, VkDescriptorSet set) const;
+
+		//Hash of every descriptor collected, in the order they were added
+		uint64_t hash() const;
+
+		bool operator==(const DescriptorWriter& other) const;
+
+		void clear();
+
+	private:
+
+		struct Entry {
+			uint32_t binding = 0;
+			uint32_t arrayElement = 0;
+			VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			bool image = false;
+			VkDescriptorImageInfo imageInfo{};
+			VkDescriptorBufferInfo bufferInfo{};
+		};
+
+		std::vector<Entry> entries;
+
+	};
+
+	/*
+	Creates each distinct descriptor set layout once.
+	Layouts are looked up by their bindings and flags, so every system asking for the same layout gets the same handle,
+	which also keeps pipeline layouts compatible between pipelines created by different systems.
+	Layouts live until the cache is destroyed. Thread safe.
+	*/
+	class DescriptorLayoutCache {
+
+	public:
+
+		DescriptorLayoutCache(VkDevice _device);
+		~DescriptorLayoutCache();
+
+		//Owns descriptor set layouts so can not be copied
+		DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+		DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+		//_bindingFlags is empty or has one entry per binding
+		VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0,
+			const std::vector<VkDescriptorBindingFlags>& bindingFlags = {});
+
+		uint32_t getLayoutCount() const;
+
+	private:
+
+		//Flattened bindings, flags and immutable samplers
+		using Key = std::vector<uint64_t>;
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+
+		std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> layouts;
+		mutable std::mutex mutex;
+
+	};
+
+	/*
+	Descriptor set allocation for pipelines that don't use the bindless heap, e.g. on devices without descriptor indexing.
+
+	Transient sets are allocated from pools owned by one thread for one frame in flight, so threads recording in parallel never contend.
+	Sets are never freed on their own, beginFrame resets every pool the frame used with vkResetDescriptorPool and they are reused.
+	When a pool runs out another is taken from the frame's list, which only grows while the application warms up.
+
+	Persistent sets are for descriptors that don't change between frames, e.g. a material's textures.
+	They are cached by layout and contents, so asking for the same set again returns the existing one instead of allocating.
+	*/
+	class DescriptorAllocator {
+
+	public:
+
+		struct Stats {
+			//Transient sets allocated since the last beginFrame
+			uint32_t transientSetsThisFrame = 0;
+			//Pools created for transient and persistent sets, stays flat once warmed up
+			uint32_t poolsCreated = 0;
+			uint32_t persistentSets = 0;
+			//Persistent set requests answered from the cache
+			uint64_t persistentHits = 0;
+		};
+
+		//Descriptors of each type reserved per set in a pool, scaled by the pool's set count
+		struct PoolRatio {
+			VkDescriptorType type;
+			float perSet;
+		};
+
+		static constexpr uint32_t setsPerPool = 256;
+
+		DescriptorAllocator(vgl::LogicalDevice* _logicalDevice, vgl::JobSystem* _jobSystem, uint32_t _frameCount);
+		~DescriptorAllocator();
+
+		//Owns descriptor pools so can not be copied
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		//Reset every pool used the last time this frame index was recorded
+		//Must only be called once the GPU has finished with that frame and nothing is recording
+		void beginFrame(uint32_t frameIndex);
+
+		//Set valid until beginFrame is called for the current frame index again, safe to call from any job system thread
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+		//Allocate and write in one step
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout, const vgl::DescriptorWriter& writer);
+
+		//Set that lives as long as the allocator, the same layout and contents return the same set
+		VkDescriptorSet getPersistent(VkDescriptorSetLayout layout, const vgl::DescriptorWriter& writer);
+
+		vgl::DescriptorLayoutCache* getLayoutCache();
+
+		Stats getStats() const;
+
+	private:
+
+		//Pools owned by one thread for one frame in flight
+		struct ThreadPools {
+			std::vector<VkDescriptorPool> pools;
+			//Pools before this one are full, pools after it are empty
+			uint32_t current = 0;
+			bool used = false;
+		};
+
+		struct PersistentSet {
+			VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+			vgl::DescriptorWriter writer;
+			VkDescriptorSet set = VK_NULL_HANDLE;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::JobSystem* jobSystem = nullptr;
+
+		vgl::DescriptorLayoutCache layoutCache;
+
+		//Indexed by [frame][thread index]
+		std::vector<std::vector<ThreadPools>> frames;
+		uint32_t currentFrame = 0;
+
+		//Threads that aren't workers all share thread index 0
+		std::mutex sharedThreadMutex;
+
+		//Keyed by the hash of the layout and contents, several sets per hash in case of collisions
+		std::unordered_multimap<uint64_t, PersistentSet> persistent;
+		std::vector<VkDescriptorPool> persistentPools;
+		mutable std::mutex persistentMutex;
+
+		std::atomic<uint32_t> transientCount{ 0 };
+		std::atomic<uint32_t> poolCount{ 0 };
+		std::atomic<uint64_t> persistentHits{ 0 };
+
+		VkDescriptorPool createPool();
+
+		//Allocate from the back of pools, adding a pool if it is full
+		VkDescriptorSet allocateFrom(std::vector<VkDescriptorPool>& pools, uint32_t& current, VkDescriptorSetLayout layout);
+
+	};
+
+}
+
+#endif // !VGL_DESCRIPTORALLOCATOR_H
@@ -0,0 +1,125 @@
+#ifndef VGL_DEVICECAPABILITIES_H
+#define VGL_DEVICECAPABILITIES_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/QueueFamilyIndices.h"
+
+namespace vgl {
+
+	/*
+	Everything the library needs to know about a physical device, queried once.
+	Device selection, device creation, the allocator and the pipeline cache all read from the same snapshot instead of
+	calling vkGetPhysicalDevice* and vkEnumerateDeviceExtensionProperties themselves.
+
+	Only surface independent state is captured, present support and swap chain support depend on the surface and are still queried directly.
+
+	The snapshot can be persisted to <directory>/device_caps_<uuid>.bin (device_caps_<vendorID>_<deviceID>.bin without a UUID), so identical
+	GPUs get a file each. It is keyed by vendorID, deviceID, driverVersion, apiVersion and pipelineCacheUUID, so a driver update invalidates it.
+	The UUID is never stored, a warm start reads it live along with vkGetPhysicalDeviceProperties.
+
+	Instances are handed out as shared_ptr<const DeviceCapabilities> and never change after being created.
+	*/
+	class DeviceCapabilities {
+
+	public:
+
+		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+		VkPhysicalDeviceProperties properties{};
+		//Descriptor indexing and timeline limits, zeroed if the device doesn't support Vulkan 1.2
+		VkPhysicalDeviceVulkan12Properties properties12{};
+		//32 hex digits, empty if the device does not report one (pre Vulkan 1.1)
+		std::string uuid;
+
+		//pNext of the 1.2 and 1.3 structures is always null, they are zeroed if the device doesn't support that version
+		VkPhysicalDeviceFeatures features{};
+		VkPhysicalDeviceVulkan12Features features12{};
+		VkPhysicalDeviceVulkan13Features features13{};
+
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+		std::vector<VkQueueFamilyProperties> queueFamilies;
+
+		//Query everything from the device, or load it from _directory if a snapshot for the same driver was saved there
+		//An empty _directory always queries and never saves
+		static std::shared_ptr<const vgl::DeviceCapabilities> query(VkPhysicalDevice _physicalDevice, const std::string& _directory = "");
+
+		//Binary search over the sorted extension names
+		bool hasExtension(const char* name) const;
+		bool hasExtensions(const std::vector<const char*>& names) const;
+		//Sorted by name
+		const std::vector<std::string>& getExtensions() const;
+
+		//Total size of the heaps flagged VK_MEMORY_HEAP_DEVICE_LOCAL_BIT
+		VkDeviceSize getDeviceLocalBytes() const;
+
+		//Maximum number of samples supported by both colour and depth attachments
+		VkSampleCountFlagBits getMaxUsableSampleCount() const;
+
+		/*
+		Anything from drawing to uploading textures, requires commands to be submitted to a queue.
+		There are different types of queues that originate from different queue families and each family of queues allows only a subset of commands.
+			For example;
+				There could be a queue family that only allows processing of compute commands
+				There could be one that only allows memory transfer related commands.
+		Need to check which queue families are supported by the device and which one of these supports the commands that are wanted to use.
+		Present support is only looked for when _surface is not VK_NULL_HANDLE.
+		*/
+		vgl::QueueFamilyIndices findQueueFamilies(VkSurfaceKHR _surface) const;
+
+		//Whether the snapshot came from disk rather than from the driver
+		bool isFromDisk() const;
+
+		//Time spent building the snapshot, either querying or loading
+		double getQueryMs() const;
+
+	private:
+
+		struct FileHeader {
+			uint32_t magic = 0;
+			uint32_t version = 0;
+			uint32_t vendorID = 0;
+			uint32_t deviceID = 0;
+			uint32_t driverVersion = 0;
+			uint32_t apiVersion = 0;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE] = {};
+			//Guards against loading a file written by a build with different Vulkan headers
+			uint32_t layoutSize = 0;
+			uint64_t dataSize = 0;
+			uint64_t checksum = 0;
+		};
+
+		static constexpr uint32_t fileMagic = 0x43444756; //"VGDC"
+		static constexpr uint32_t fileVersion = 3;
+
+		std::vector<std::string> extensions;
+
+		bool fromDisk = false;
+		double queryMs = 0.0;
+
+		//Read the device UUID from the driver, properties must already be set
+		void queryUuid();
+
+		//Fill in everything from the driver, properties and uuid must already be set
+		void queryDevice();
+
+		std::vector<char> serialize() const;
+		//Returns false if the data is malformed
+		bool deserialize(const std::vector<char>& data);
+
+		//Load a snapshot matching properties from path, returns false if there is none or it doesn't match
+		bool load(const std::string& path);
+		bool save(const std::string& path) const;
+
+		static uint32_t layoutSize();
+
+	};
+
+}
+
+#endif // !VGL_DEVICECAPABILITIES_H
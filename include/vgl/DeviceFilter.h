@@ -0,0 +1,32 @@
+#ifndef VGL_DEVICEFILTER_H
+#define VGL_DEVICEFILTER_H
+
+#include <string>
+
+namespace vgl {
+
+	//Restricts which GPUs PhysicalDevice may pick from, the best scoring device that matches is used
+	//All fields are optional, an empty filter lets every suitable device compete
+	struct DeviceFilter {
+		//Case insensitive substring of the device name, e.g. "RTX" or "Radeon"
+		std::string name;
+
+		//Device UUID as 32 hex digits, dashes are ignored
+		std::string uuid;
+
+		//Index of the device in enumeration order, -1 to not filter by index
+		int index = -1;
+
+		//Never pick CPU implementations such as lavapipe or SwiftShader
+		bool rejectCpu = false;
+
+		//Environment variable read by PhysicalDevice when selecting, it replaces name, uuid and index when set
+		//The value is an index if it is all digits, a UUID if it is 32 hex digits, otherwise a name
+		static constexpr const char* environmentVariable = "VGL_DEVICE";
+
+		bool isEmpty() const { return name.empty() && uuid.empty() && index < 0; }
+	};
+
+}
+
+#endif // !VGL_DEVICEFILTER_H
@@ -0,0 +1,193 @@
+#ifndef VGL_DRAWBATCHER_H
+#define VGL_DRAWBATCHER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/JobSystem.h"
+#include "vgl/LinearArena.h"
+#include "vgl/Mesh.h"
+
+namespace vgl {
+
+	//Identifies a mesh added to a DrawBatcher
+	using BatchedMesh = uint32_t;
+
+	//One object to draw this frame, the ids are the application's own and only have to fit in the sort key
+	struct DrawRequest {
+		//Less than DrawBatcher::maxPasses, passes are recorded separately
+		uint32_t pass = 0;
+		//Less than DrawBatcher::maxPipelines
+		uint32_t pipeline = 0;
+		//Less than DrawBatcher::maxMaterials
+		uint32_t material = 0;
+		vgl::BatchedMesh mesh = 0;
+		//Less than DrawBatcher::maxLods
+		uint32_t lod = 0;
+		//View depth from 0 at the camera to 1 at the far plane, clamped
+		float depth = 0.0f;
+	};
+
+	//Consecutive requests with the same pass, pipeline, material, mesh and lod, drawn as one instanced draw
+	struct DrawBatch {
+		uint32_t pass = 0;
+		uint32_t pipeline = 0;
+		uint32_t material = 0;
+		vgl::BatchedMesh mesh = 0;
+		uint32_t lod = 0;
+		//Into this frame's instance data
+		uint32_t firstInstance = 0;
+		uint32_t instanceCount = 0;
+	};
+
+	struct DrawBatcherSettings {
+		//Bytes of per-instance data copied for every request, e.g. 64 for a model matrix
+		uint32_t instanceStride = 64;
+		//Size of each frame's region of the instance buffer, requests past it are dropped with a warning
+		VkDeviceSize instanceBytesPerFrame = 16ull * 1024 * 1024;
+		//Bit n set sorts pass n back to front by depth before state, for blending, other passes sort by state then front to back
+		uint32_t backToFrontPasses = 0;
+		//Fewer requests than this are sorted on the calling thread, the job system costs more than it saves on small frames
+		uint32_t parallelSortThreshold = 16384;
+	};
+
+	/*
+	Submission front end that turns per-object draw requests into as few state changes and draw calls as possible.
+
+	Each request gets a 64 bit sort key, from the most significant bits:
+		pass (4) | pipeline (12) | material (16) | mesh (13) | lod (3) | depth (16)
+	so a pass is drawn pipeline by pipeline, material by material, with each mesh's objects together and front to back within them.
+	Passes in DrawBatcherSettings::backToFrontPasses move depth to just after the pass instead, farthest first.
+	Keys are sorted with a stable LSD radix sort, split across the job system for large frames, so requests with equal keys
+	keep the order they were submitted in. Runs of requests with the same state and mesh are merged into one instanced draw,
+	which for back to front passes still draws the instances in depth order.
+
+	The per-instance data of every request is written in sorted order into a host visible buffer with a region per frame in flight,
+	so each batch's instances are contiguous. Shaders read it either as a per-instance vertex binding (getInstanceBindings)
+	or as a storage buffer at getInstanceOffset indexed by gl_InstanceIndex.
+
+	beginFrame must be called once the frame's fence has signalled, submit from any number of job system workers and one other thread,
+	then build once before recording the frame's passes.
+	*/
+	class DrawBatcher {
+
+	public:
+
+		struct Stats {
+			uint32_t requests = 0;
+			//Draw calls after merging
+			uint32_t batches = 0;
+			//Times the pipeline or material changes between consecutive batches of a pass, what record has to bind
+			uint32_t pipelineChanges = 0;
+			uint32_t materialChanges = 0;
+			//Requests that didn't fit in the frame's instance data
+			uint32_t dropped = 0;
+			double sortMs = 0.0;
+			//Sorting, merging and writing the instance data
+			double buildMs = 0.0;
+		};
+
+		//Binding the instance data is bound to by record, binding 0 is the mesh's vertices
+		static constexpr uint32_t instanceBinding = 1;
+
+		static constexpr uint32_t maxPasses = 1u << 4;
+		static constexpr uint32_t maxPipelines = 1u << 12;
+		static constexpr uint32_t maxMaterials = 1u << 16;
+		static constexpr uint32_t maxMeshes = 1u << 13;
+		static constexpr uint32_t maxLods = 1u << 3;
+
+		//Called by record when the next batch needs a different pipeline or material
+		//Bind the pipeline if pipelineChanged, then the material's descriptors or push constants
+		using BindFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t pipeline, uint32_t material, bool pipelineChanged)>;
+
+		DrawBatcher(vgl::LogicalDevice* _logicalDevice, vgl::JobSystem* _jobSystem, uint32_t _framesInFlight, const vgl::DrawBatcherSettings& _settings = {});
+
+		//Owns a buffer so can not be copied
+		DrawBatcher(const DrawBatcher&) = delete;
+		DrawBatcher& operator=(const DrawBatcher&) = delete;
+
+		//Meshes must outlive the frames that draw them, not thread safe with submit or build
+		vgl::BatchedMesh addMesh(const vgl::Mesh* mesh);
+		void removeMesh(vgl::BatchedMesh mesh);
+
+		//Drop the previous frame's requests and reuse this frame's region of the instance buffer
+		void beginFrame(uint32_t frameIndex);
+
+		//Queue a draw, instanceData is DrawBatcherSettings::instanceStride bytes and is copied
+		//Throws if an id doesn't fit in the sort key or the calling thread is a worker of another job system
+		void submit(const vgl::DrawRequest& request, const void* instanceData);
+
+		//Sort and merge everything submitted this frame and write the instance data, submit must not be called after this until beginFrame
+		void build();
+
+		//Batches of a pass in draw order, valid until the next beginFrame
+		const std::vector<vgl::DrawBatch>& getBatches(uint32_t pass) const;
+
+		//Bind the instance data and draw every batch of pass, calling bind whenever the pipeline or material changes
+		//Batches whose mesh hasn't finished uploading are skipped
+		void record(VkCommandBuffer commandBuffer, uint32_t pass, const BindFunction& bind) const;
+
+		//Where this frame's instance data is, for shaders reading it as a storage buffer
+		VkBuffer getInstanceBuffer() const;
+		VkDeviceSize getInstanceOffset() const;
+
+		//Vertex input state for the instance data, added after Mesh::getVertexBindings
+		std::vector<VkVertexInputBindingDescription> getInstanceBindings() const;
+
+		const vgl::DrawBatcherSettings& getSettings() const;
+
+		//Stats of the last build
+		Stats getStats() const;
+
+		//Log how many draws the last frame's requests were merged into
+		void printStats() const;
+
+		//Sort key of a request, see the class description for the layout
+		uint64_t makeSortKey(const vgl::DrawRequest& request) const;
+
+		//Stable LSD radix sort of keys and the values that go with them, 8 bits per pass, passes where every key has the same digit are skipped
+		//Large inputs are split across jobSystem, which can be nullptr to sort on the calling thread
+		//scratch is resized as needed and can be kept between calls to avoid reallocating
+		static void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch,
+			vgl::JobSystem* jobSystem);
+
+	private:
+
+		//Requests submitted from one thread of the job system
+		struct ThreadRequests {
+			std::vector<uint64_t> keys;
+			std::vector<uint8_t> instanceData;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::JobSystem* jobSystem = nullptr;
+		vgl::DrawBatcherSettings settings;
+
+		std::unique_ptr<vgl::LinearArena> instanceArena;
+		vgl::LinearArena::Allocation instances;
+
+		std::vector<const vgl::Mesh*> meshes;
+		std::vector<vgl::BatchedMesh> freeMeshes;
+
+		//Indexed by JobSystem::getThreadIndex
+		std::vector<ThreadRequests> threadRequests;
+
+		//Reused every frame
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> order;
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint32_t> orderScratch;
+
+		std::vector<std::vector<vgl::DrawBatch>> passBatches;
+
+		Stats stats;
+
+	};
+
+}
+
+#endif // !VGL_DRAWBATCHER_H
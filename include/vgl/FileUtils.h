@@ -0,0 +1,27 @@
+#ifndef VGL_FILEUTILS_H
+#define VGL_FILEUTILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vgl {
+
+	//Offset basis of 64 bit FNV-1a, the hash of nothing
+	constexpr uint64_t fnv1aOffset = 0xcbf29ce484222325ull;
+	constexpr uint64_t fnv1aPrime = 0x100000001b3ull;
+
+	//64 bit FNV-1a of size bytes, pass the previous result as hash to continue over several ranges
+	//Used as the checksum of every file the library writes, it only catches corruption and isn't meant to resist tampering
+	uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = fnv1aOffset);
+
+	//Write parts one after the other to a temporary file next to path, then rename it over path in one step
+	//so a crash or a full disk never leaves a partly written file behind, missing parent directories are created
+	//Returns false if anything failed, path is left as it was
+	bool writeFileAtomically(const std::string& path, const std::vector<std::pair<const void*, size_t>>& parts);
+
+}
+
+#endif // !VGL_FILEUTILS_H
@@ -0,0 +1,173 @@
+#ifndef VGL_FRAMERENDERER_H
+#define VGL_FRAMERENDERER_H
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/Window.h"
+#include "vgl/PhysicalDevice.h"
+#include "vgl/LogicalDevice.h"
+#include "vgl/SwapChain.h"
+#include "vgl/OffscreenTarget.h"
+#include "vgl/FrameStats.h"
+
+namespace vgl {
+
+	//Everything needed to record the commands for one frame
+	//The image is in VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL and has already been cleared when handed out
+	struct FrameContext {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+		//Index of the frame in flight, in the range [0, framesInFlight)
+		//Use this to index per-frame resources such as uniform buffers
+		uint32_t frameIndex = 0;
+
+		//Index of the swap chain image being rendered to, always 0 when rendering offscreen
+		uint32_t imageIndex = 0;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+	};
+
+	/*
+	Frame loop that keeps several frames in flight so the CPU can record frame N+1 while the GPU is still working on frame N.
+	Each frame in flight has its own command pool, command buffer and image available semaphore, and remembers the point on the
+	QueueScheduler's graphics timeline its last submit signals. The CPU only blocks when it gets framesInFlight frames ahead of the GPU.
+	Every frame's submit flushes the scheduler, so work queued on other queues during the frame is batched with it.
+	Renders either to a swap chain (window or headless surface) or to an OffscreenTarget.
+	*/
+	class FrameRenderer {
+
+	public:
+
+		using RecordFunction = std::function<void(const vgl::FrameContext&)>;
+		using FrameBeginCallback = std::function<void(uint32_t frameIndex)>;
+		using ResizeCallback = std::function<void(VkExtent2D extent)>;
+
+		static constexpr uint32_t defaultFramesInFlight = 2;
+
+		//Colour the target is cleared to at the start of each frame
+		VkClearColorValue clearColour = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+		//Render to a swap chain created on _surface
+		//_window is used to handle resizes and can be nullptr for headless surfaces
+		FrameRenderer(vgl::PhysicalDevice* _physicalDevice, vgl::LogicalDevice* _logicalDevice, VkSurfaceKHR _surface, vgl::Window* _window,
+			VkExtent2D _initialExtent, uint32_t _framesInFlight = defaultFramesInFlight);
+		//Render to an offscreen target, nothing is presented
+		FrameRenderer(vgl::LogicalDevice* _logicalDevice, vgl::OffscreenTarget* _target, uint32_t _framesInFlight = defaultFramesInFlight);
+		~FrameRenderer();
+
+		//Owns Vulkan handles so can not be copied
+		FrameRenderer(const FrameRenderer&) = delete;
+		FrameRenderer& operator=(const FrameRenderer&) = delete;
+
+		//Record and submit one frame, record is called between beginFrame and endFrame
+		//Returns false if the frame was skipped because the swap chain had to be recreated
+		bool drawFrame(const RecordFunction& record = nullptr);
+
+		//Split form of drawFrame
+		//beginFrame waits for the frame slot to be free and returns nullptr if the frame has to be skipped
+		const vgl::FrameContext* beginFrame();
+		void endFrame();
+
+		//Called from beginFrame once the frame slot's previous submission has finished
+		//Anything the GPU used for the previous frame with this index (per-frame arenas, pools) can be reset in the callback
+		void addFrameBeginCallback(const FrameBeginCallback& callback);
+
+		//Called from beginFrame once the command buffer has begun, before the target is cleared and before the user's record function
+		//Used to insert commands every frame needs first, such as acquiring resources from other queues
+		void addRecordCallback(const RecordFunction& callback);
+
+		//Called once the swap chain has been recreated, while the device is still idle and before the next frame is recorded
+		void addResizeCallback(const ResizeCallback& callback);
+
+		//Make the next submitted frame wait on a timeline semaphore reaching value before stage
+		//Only affects the frame currently being recorded, or the next one if called outside beginFrame/endFrame
+		void addWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage);
+
+		//The QueueScheduler's graphics timeline, which every frame's submit signals
+		//Other queues can wait on it to consume what a frame rendered, other graphics submissions signal it as well
+		VkSemaphore getTimelineSemaphore() const;
+		//Value signalled by the most recently submitted frame
+		uint64_t getSubmittedValue() const;
+		vgl::QueuePoint getSubmittedPoint() const;
+
+		const vgl::FrameStats& getStats() const;
+		uint32_t getFramesInFlight() const;
+		uint32_t getCurrentFrame() const;
+
+		//nullptr when rendering offscreen
+		vgl::SwapChain* getSwapChain() const;
+
+	private:
+
+		//Resources that are duplicated for every frame in flight
+		struct FrameData {
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			//Signalled when the swap chain image is ready to be rendered to
+			VkSemaphore imageAvailable = VK_NULL_HANDLE;
+			//Reached when the GPU has finished the frame so its resources can be reused
+			vgl::QueuePoint submitted;
+		};
+
+		vgl::PhysicalDevice* physicalDevice = nullptr;
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::Window* window = nullptr;
+
+		std::unique_ptr<vgl::SwapChain> swapChain;
+		vgl::OffscreenTarget* offscreenTarget = nullptr;
+
+		uint32_t framesInFlight = defaultFramesInFlight;
+		uint32_t currentFrame = 0;
+		std::vector<FrameData> frames;
+
+		//Signalled when rendering to a swap chain image has finished so it can be presented
+		//One per swap chain image rather than per frame, since a semaphore can't be reused until the present waiting on it has completed
+		std::vector<VkSemaphore> renderFinished;
+
+		vgl::QueuePoint submittedPoint;
+
+		std::vector<FrameBeginCallback> frameBeginCallbacks;
+		std::vector<RecordFunction> recordCallbacks;
+		std::vector<ResizeCallback> resizeCallbacks;
+
+		//Extra timeline semaphore waits for the next submit
+		std::vector<vgl::SemaphoreWait> waitSemaphores;
+
+		//Frame currently being recorded, only valid between beginFrame and endFrame
+		vgl::FrameContext context;
+		bool frameStarted = false;
+
+		//Timing
+		vgl::FrameStats stats;
+		std::array<double, vgl::FrameStats::windowSize> frameTimes{};
+		std::chrono::steady_clock::time_point lastFrameStart;
+		std::chrono::steady_clock::time_point recordStart;
+
+		void createFrameData();
+		void createRenderFinishedSemaphores();
+		void destroyRenderFinishedSemaphores();
+
+		//Wait for the window to have a non zero size then rebuild the swap chain
+		void recreateSwapChain();
+
+		void updateFrameTime(std::chrono::steady_clock::time_point frameStart);
+
+		//Transition the frame's image and clear it
+		void recordClear(VkCommandBuffer commandBuffer, VkImage image);
+		void transitionImage(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+			VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+
+	};
+
+}
+
+#endif // !VGL_FRAMERENDERER_H
@@ -0,0 +1,37 @@
+#ifndef VGL_FRAMESTATS_H
+#define VGL_FRAMESTATS_H
+
+#include <cstdint>
+
+namespace vgl {
+
+    //Timings collected by the frame loop, all times are in milliseconds
+    struct FrameStats {
+        //Number of frames submitted since the renderer was created
+        uint64_t frameCount = 0;
+
+        //CPU time between the start of the last two frames
+        double lastFrameMs = 0.0;
+
+        //Average, minimum and maximum frame time over the last FrameStats::windowSize frames
+        double averageFrameMs = 0.0;
+        double minFrameMs = 0.0;
+        double maxFrameMs = 0.0;
+
+        //Time the CPU spent blocked waiting for the frame slot's previous submission last frame
+        //Close to zero when the CPU is the bottleneck, close to the frame time when the GPU is
+        double lastFenceWaitMs = 0.0;
+
+        //Time spent recording and submitting the last frame
+        double lastRecordMs = 0.0;
+
+        double fps() const {
+            return averageFrameMs > 0.0 ? 1000.0 / averageFrameMs : 0.0;
+        }
+
+        static constexpr uint32_t windowSize = 120;
+    };
+
+}
+
+#endif // !VGL_FRAMESTATS_H
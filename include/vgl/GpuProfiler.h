@@ -0,0 +1,185 @@
+#ifndef VGL_GPUPROFILER_H
+#define VGL_GPUPROFILER_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/ChromeTrace.h"
+
+namespace vgl {
+
+	//GPU time of one scope
+	struct GpuScopeResult {
+		std::string name;
+		//How many scopes it is nested in
+		uint32_t depth = 0;
+		//Relative to the first scope of the frame
+		double beginMs = 0.0;
+		double durationMs = 0.0;
+	};
+
+	//Every scope of one frame that had finished on the GPU
+	struct GpuFrameResult {
+		//Counts every frame recorded since the profiler was created
+		uint64_t frameNumber = 0;
+		//Start of the first scope on the trace clock
+		double beginUs = 0.0;
+		//From the start of the first scope to the end of the last one
+		double durationMs = 0.0;
+		//Ordered by when they started
+		std::vector<vgl::GpuScopeResult> scopes;
+	};
+
+	/*
+	Measures how long ranges of commands take on the GPU with timestamp queries.
+	Each frame in flight has its own query pool. It is reset at the start of the frame's command buffer and read back without waiting
+	when the frame's fence has signalled, so results arrive framesInFlight frames after they were recorded.
+	Ticks are converted with timestampPeriod from the cached device properties.
+
+	Scopes can be opened from any thread and nested, or overlap on different command buffers, but every command buffer
+	they are written to must be executed by the frame's primary command buffer after it has begun.
+	Scopes that don't fit in maxScopes for the frame are dropped.
+
+	GPU timestamps are placed on the CPU trace clock so GPU scopes line up with CPU scopes in the Chrome trace.
+	With VK_EXT_calibrated_timestamps both clocks are sampled together, and again every calibrationInterval frames since they drift apart.
+	Without it a single timestamp is submitted and timed, which is only accurate to within the submission latency and only while nothing
+	else is queued, so it is done when the profiler is created and again by calibrate, which VulkanCore calls when the swap chain is resized.
+	*/
+	class GpuProfiler {
+
+	public:
+
+		static constexpr uint32_t defaultMaxScopes = 512;
+		static constexpr uint32_t defaultHistorySize = 240;
+		//Frames between calibrations when calibrated timestamps are enabled
+		static constexpr uint64_t calibrationInterval = 1000;
+		//Returned by beginScope when the scope isn't recorded
+		static constexpr uint32_t invalidScope = ~0u;
+
+		//_historySize is how many resolved frames are kept for export
+		GpuProfiler(vgl::LogicalDevice* _logicalDevice, uint32_t _framesInFlight, uint32_t _maxScopes = defaultMaxScopes,
+			uint32_t _historySize = defaultHistorySize);
+		~GpuProfiler();
+
+		//Owns Vulkan handles so can not be copied
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		//Whether the graphics queue supports timestamps, nothing is recorded without them
+		static bool isSupported(const vgl::LogicalDevice* logicalDevice);
+
+		//Collect the results of the last frame that used frameIndex, its fence must have signalled
+		//Recalibrates every calibrationInterval frames if calibrated timestamps are enabled
+		void beginFrame(uint32_t frameIndex);
+		//Reset the frame's queries, must be recorded at the start of the frame's primary command buffer outside a render pass
+		void beginCommandBuffer(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+		//Returns the scope to pass to endScope, or invalidScope if the frame has run out of queries
+		uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+		void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+		//Most recently resolved frame, frameNumber is 0 and there are no scopes before the first one arrives
+		vgl::GpuFrameResult getLatestFrame() const;
+		std::vector<vgl::GpuFrameResult> getHistory() const;
+
+		//Average duration of every scope with this name over the history, 0 if there are none
+		double getAverageMs(const std::string& name) const;
+
+		//Add every frame in the history to a trace as GPU events, export into the trace holding the CPU scopes to see both together
+		void exportTo(vgl::ChromeTrace& trace) const;
+		//Write the history on its own as a Chrome trace
+		bool writeChromeTrace(const std::string& path) const;
+		//One row per scope: frame, name, depth, begin and duration in milliseconds
+		bool writeCsv(const std::string& path) const;
+
+		//Nanoseconds per timestamp tick
+		double getTimestampPeriod() const;
+
+		//Line GPU timestamps up with the trace clock again
+		//Without calibrated timestamps this submits to the graphics queue and waits, so only call it while the device is idle
+		void calibrate();
+
+	private:
+
+		struct Scope {
+			std::string name;
+			uint32_t query = 0;
+			bool ended = false;
+		};
+
+		struct FrameQueries {
+			VkQueryPool pool = VK_NULL_HANDLE;
+			std::vector<Scope> scopes;
+			uint64_t frameNumber = 0;
+			//Set once the reset has been recorded, results are only read from frames that were recorded
+			bool recorded = false;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+
+		uint32_t maxScopes = 0;
+		uint32_t historySize = 0;
+
+		double timestampPeriod = 1.0;
+		uint64_t timestampMask = ~0ull;
+
+		//GPU tick and trace time measured together by calibrate
+		uint64_t calibrationTicks = 0;
+		double calibrationUs = 0.0;
+		//nullptr without VK_EXT_calibrated_timestamps
+		PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = nullptr;
+		uint64_t framesSinceCalibration = 0;
+
+		//Only created without calibrated timestamps, separate from the frames' pools so it can be written while they are in flight
+		VkQueryPool calibrationPool = VK_NULL_HANDLE;
+		VkCommandPool calibrationCommandPool = VK_NULL_HANDLE;
+		VkCommandBuffer calibrationCommandBuffer = VK_NULL_HANDLE;
+
+		std::vector<FrameQueries> frames;
+		uint32_t currentFrame = 0;
+		uint64_t frameCount = 0;
+
+		//Guards the current frame's scopes
+		std::mutex scopeMutex;
+
+		mutable std::mutex historyMutex;
+		std::deque<vgl::GpuFrameResult> history;
+
+		//Scratch space for vkGetQueryPoolResults, a value and an availability word per query
+		std::vector<uint64_t> queryResults;
+
+		void calibrateWithHostClock();
+		//Submit a single timestamp and wait for it
+		void calibrateWithSubmit();
+
+		double toTraceUs(uint64_t ticks) const;
+
+	};
+
+	//Profiles the commands recorded during its lifetime, does nothing if the profiler is nullptr
+	class GpuProfileScope {
+
+	public:
+
+		GpuProfileScope(vgl::GpuProfiler* _profiler, VkCommandBuffer _commandBuffer, const char* _name);
+		~GpuProfileScope();
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+	private:
+
+		vgl::GpuProfiler* profiler = nullptr;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint32_t scope = vgl::GpuProfiler::invalidScope;
+
+	};
+
+}
+
+#endif // !VGL_GPUPROFILER_H
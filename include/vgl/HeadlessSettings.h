@@ -0,0 +1,37 @@
+#ifndef VGL_HEADLESSSETTINGS_H
+#define VGL_HEADLESSSETTINGS_H
+
+#include <string>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/DeviceFilter.h"
+
+namespace vgl {
+
+    //Settings used to create a VulkanCore without a window
+    //Used on machines with no display (CI, render farms) where GLFW can not create a window
+    struct HeadlessSettings {
+        //Size of the offscreen render target
+        uint32_t width = 800;
+        uint32_t height = 600;
+
+        std::string applicationName = "Vulkan App";
+
+        //Format of the offscreen render target
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+        //If the instance supports VK_EXT_headless_surface then create a surface from it
+        //This lets swap chain code paths run without a display, otherwise no surface is created and no present queue is required
+        bool useHeadlessSurface = false;
+
+        //Directory the pipeline cache is saved to between runs, empty to keep it in memory only
+        std::string pipelineCacheDirectory = "vgl_cache";
+
+        //Restricts which GPU is picked, e.g. to pin a render farm job to one adapter
+        vgl::DeviceFilter deviceFilter;
+    };
+
+}
+
+#endif // !VGL_HEADLESSSETTINGS_H
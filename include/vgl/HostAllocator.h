@@ -0,0 +1,162 @@
+#ifndef VGL_HOSTALLOCATOR_H
+#define VGL_HOSTALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+namespace vgl {
+
+	/*
+	Process wide VkAllocationCallbacks that every vkCreate*, vkDestroy*, vkAllocateMemory and vkFreeMemory in the library passes as pAllocator.
+	Drivers make many small, short lived host allocations (command recording especially), so requests of up to maxClassSize bytes
+	including the header are served from power of two size classes carved out of slabSize slabs, each class with its own free list and lock.
+	Anything larger goes straight to an aligned system allocation.
+
+	Every allocation is counted against the VkSystemAllocationScope the driver gave for it, along with the internal allocations the
+	driver reports but makes itself, so the host memory behind each kind of object can be seen over the life of the process.
+	Slabs are kept once allocated and reused by later allocations of the same class, so memory does not fragment between classes.
+
+	Objects have to be destroyed with the same callbacks they were created with, so whether the allocator is used is decided once
+	per process. Setting the VGL_HOST_ALLOCATOR environment variable to 0 or off makes callbacks() return nullptr and the driver allocates for itself.
+	All functions are thread safe.
+	*/
+	class HostAllocator {
+
+	public:
+
+		static constexpr const char* environmentVariable = "VGL_HOST_ALLOCATOR";
+
+		static constexpr uint32_t scopeCount = 5;
+		//Size classes are 16, 32, ... maxClassSize bytes
+		static constexpr size_t minClassSize = 16;
+		static constexpr size_t maxClassSize = 4096;
+		static constexpr uint32_t classCount = 9;
+		static constexpr size_t slabSize = 64 * 1024;
+
+		//Host memory the driver asked for with one VkSystemAllocationScope
+		struct ScopeStats {
+			uint64_t bytesInUse = 0;
+			uint64_t peakBytes = 0;
+			uint64_t allocationsInUse = 0;
+
+			uint64_t allocationCount = 0;
+			uint64_t reallocationCount = 0;
+			uint64_t freeCount = 0;
+
+			//Reported through pfnInternalAllocation, the driver makes these itself (e.g. executable memory)
+			uint64_t internalBytesInUse = 0;
+			uint64_t internalAllocationCount = 0;
+		};
+
+		struct Stats {
+			ScopeStats scopes[scopeCount];
+
+			//Across every scope
+			uint64_t bytesInUse = 0;
+			uint64_t peakBytes = 0;
+
+			//Bytes taken from the system, slabs plus large allocations with their headers
+			uint64_t bytesReserved = 0;
+			//Slab bytes not handed out to any allocation, reused before a new slab is made
+			uint64_t idleSlabBytes = 0;
+
+			uint32_t slabCount = 0;
+			uint64_t largeAllocationsInUse = 0;
+			//Allocations that returned null because the system was out of memory
+			uint64_t failedCount = 0;
+		};
+
+		//Never destroyed, drivers can free memory until the process exits
+		static vgl::HostAllocator& get();
+		//What to pass as pAllocator, nullptr when disabled
+		static const VkAllocationCallbacks* callbacks();
+
+		//Process wide state so can not be copied
+		HostAllocator(const HostAllocator&) = delete;
+		HostAllocator& operator=(const HostAllocator&) = delete;
+
+		bool isEnabled() const;
+
+		Stats getStats() const;
+		//Start the peaks again from the bytes in use now, e.g. after loading
+		void resetPeaks();
+		//One line per scope that has been used
+		void logStats() const;
+
+		static const char* getScopeName(VkSystemAllocationScope scope);
+
+	private:
+
+		//Sits right before every pointer handed to the driver
+		struct Header {
+			uint64_t size;
+			//Distance back to the start of the block
+			uint32_t offset;
+			uint8_t sizeClass;
+			uint8_t scope;
+			uint16_t padding;
+		};
+		static constexpr uint8_t largeClass = 0xFF;
+
+		struct SizeClass {
+			std::mutex mutex;
+			//Free blocks are linked through their first bytes
+			void* freeList = nullptr;
+			std::vector<void*> slabs;
+			uint64_t blocksInUse = 0;
+		};
+
+		struct ScopeCounters {
+			std::atomic<uint64_t> bytesInUse{ 0 };
+			std::atomic<uint64_t> peakBytes{ 0 };
+			std::atomic<uint64_t> allocationsInUse{ 0 };
+			std::atomic<uint64_t> allocationCount{ 0 };
+			std::atomic<uint64_t> reallocationCount{ 0 };
+			std::atomic<uint64_t> freeCount{ 0 };
+			std::atomic<uint64_t> internalBytesInUse{ 0 };
+			std::atomic<uint64_t> internalAllocationCount{ 0 };
+		};
+
+		bool enabled = true;
+		VkAllocationCallbacks vkCallbacks{};
+
+		//Locked by getStats as well
+		mutable SizeClass classes[classCount];
+		ScopeCounters scopes[scopeCount];
+
+		std::atomic<uint64_t> bytesInUse{ 0 };
+		std::atomic<uint64_t> peakBytes{ 0 };
+		std::atomic<uint64_t> largeBytesReserved{ 0 };
+		std::atomic<uint64_t> largeAllocationsInUse{ 0 };
+		std::atomic<uint64_t> failedCount{ 0 };
+
+		HostAllocator();
+
+		void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void free(void* memory);
+
+		//Take a block from a size class, making a new slab when the free list is empty
+		void* allocateBlock(uint32_t sizeClass);
+		void freeBlock(uint32_t sizeClass, void* block);
+
+		void track(uint32_t scope, int64_t bytes, int64_t allocations);
+		static void updatePeak(std::atomic<uint64_t>& peak, uint64_t value);
+		static uint32_t toScopeIndex(VkSystemAllocationScope scope);
+
+		static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL freeCallback(void* userData, void* memory);
+		static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+	};
+
+}
+
+#endif // !VGL_HOSTALLOCATOR_H
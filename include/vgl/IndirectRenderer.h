@@ -0,0 +1,170 @@
+#ifndef VGL_INDIRECTRENDERER_H
+#define VGL_INDIRECTRENDERER_H
+
+#include <memory>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/UploadEngine.h"
+#include "vgl/DescriptorAllocator.h"
+#include "vgl/ComputePipeline.h"
+#include "vgl/BoundingVolumes.h"
+
+namespace vgl {
+
+	//One object of a GPU driven scene, matches the std430 Object struct of the culling shader
+	struct IndirectObject {
+		//World space bounding sphere
+		float center[3] = {};
+		float radius = 0.0f;
+
+		//Indexed draw of the object's mesh
+		uint32_t indexCount = 0;
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		//Passed through to the draw so the vertex shader can find per object data with gl_InstanceIndex
+		uint32_t firstInstance = 0;
+	};
+
+	/*
+	GPU driven rendering of large static scenes with a single indirect draw.
+	Objects are uploaded once to a storage buffer. Each frame a compute pass tests every object against the view frustum,
+	and optionally against a depth pyramid, and appends a VkDrawIndexedIndirectCommand for each visible one.
+	The draw then executes however many commands the pass wrote with vkCmdDrawIndexedIndirectCount, the CPU never sees the count.
+
+	The culling shader is supplied by the application and must declare:
+		layout(local_size_x = 64) in;
+		layout(set = 0, binding = 0) uniform Cull { vec4 planes[6]; mat4 viewProjection; vec4 pyramid; uint objectCount; uint flags; };
+		layout(std430, set = 0, binding = 1) readonly buffer Objects { Object objects[]; };
+		layout(std430, set = 0, binding = 2) writeonly buffer Draws { DrawCommand draws[]; };
+		layout(std430, set = 0, binding = 3) buffer Count { uint drawCount; };
+		layout(set = 0, binding = 4) uniform sampler2D depthPyramid;
+	pyramid is (width, height, mip count, 0). flags has compactBit when draws should be appended at drawCount,
+	otherwise every object writes its own slot with an instance count of 0 when culled, and occlusionBit when the depth pyramid should be tested.
+	drawCount must be incremented for every visible object in both cases.
+	See examples/IndirectDraw/cull.comp.
+
+	Without drawIndirectCount the uncompacted commands are drawn instead, and cullOnCpu runs the same test with BoundingVolumeSet
+	and writes only the visible commands from the CPU.
+
+	Buffers are per frame in flight, so cull and draw for a frame must be recorded with that frame's index.
+	*/
+	class IndirectRenderer {
+
+	public:
+
+		static constexpr uint32_t workgroupSize = 64;
+
+		static constexpr uint32_t compactBit = 1;
+		static constexpr uint32_t occlusionBit = 2;
+
+		//_cullSpirv is the compiled culling shader, descriptor layouts and sets come from _descriptorAllocator
+		IndirectRenderer(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, vgl::DescriptorAllocator* _descriptorAllocator,
+			const std::vector<char>& _cullSpirv, uint32_t _maxObjects, uint32_t _framesInFlight);
+		~IndirectRenderer();
+
+		//Owns Vulkan handles so can not be copied
+		IndirectRenderer(const IndirectRenderer&) = delete;
+		IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+		//Replace every object, the scene can be culled once the upload is ready
+		//Must not be called while frames that cull the previous objects are in flight
+		vgl::UploadTicket setObjects(const std::vector<vgl::IndirectObject>& objects);
+
+		//Test objects against a depth pyramid as well as the frustum
+		//Each texel of mip n must hold the farthest depth of the texels it covers in mip n - 1, the view must be in SHADER_READ_ONLY_OPTIMAL
+		//Usually last frame's depth, so objects that become visible this frame may be missing for one frame
+		void setDepthPyramid(VkImageView view, uint32_t width, uint32_t height, uint32_t mipCount);
+		void clearDepthPyramid();
+
+		//Record the culling pass, must be outside a render pass
+		//viewProjection is a column major matrix with Vulkan's 0 to 1 depth range
+		void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const float* viewProjection);
+
+		//Cull on the CPU and write the visible commands for the frame directly, nothing needs to be recorded before draw
+		//Use when compute culling isn't available or to validate the GPU pass
+		void cullOnCpu(uint32_t frameIndex, const float* viewProjection);
+
+		//Draw whatever the last cull for this frame left visible
+		//The pipeline, index buffer and anything the vertex shader reads must already be bound
+		void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+		//Objects the GPU pass kept visible the last time this frame index finished, only valid once its fence has signalled
+		uint32_t getVisibleCount(uint32_t frameIndex) const;
+
+		uint32_t getObjectCount() const;
+		uint32_t getMaxObjects() const;
+
+		//Spheres of the current objects, kept for the CPU path
+		const vgl::BoundingVolumeSet& getBoundingVolumes() const;
+
+		vgl::ComputePipeline* getPipeline() const;
+
+	private:
+
+		struct Buffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			vgl::MemoryAllocation memory;
+		};
+
+		struct FrameResources {
+			//Host visible Cull block
+			Buffer uniforms;
+			//Written by the culling pass
+			Buffer draws;
+			Buffer count;
+			//Host visible copy of count for getVisibleCount
+			Buffer readback;
+			//Host visible commands written by cullOnCpu
+			Buffer cpuDraws;
+
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			//Set has to be fetched again after the depth pyramid changes
+			bool setDirty = true;
+
+			bool culledOnCpu = false;
+			uint32_t cpuDrawCount = 0;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::UploadEngine* uploadEngine = nullptr;
+		vgl::DescriptorAllocator* descriptorAllocator = nullptr;
+
+		uint32_t maxObjects = 0;
+		uint32_t objectCount = 0;
+
+		VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+		std::unique_ptr<vgl::ComputePipeline> pipeline;
+
+		Buffer objects;
+		std::vector<vgl::IndirectObject> cpuObjects;
+		vgl::BoundingVolumeSet boundingVolumes;
+		std::vector<uint32_t> cpuVisible;
+
+		std::vector<FrameResources> frames;
+
+		//Bound in place of a depth pyramid when there isn't one, cleared on first use
+		VkImage defaultPyramid = VK_NULL_HANDLE;
+		vgl::MemoryAllocation defaultPyramidMemory;
+		VkImageView defaultPyramidView = VK_NULL_HANDLE;
+		bool defaultPyramidCleared = false;
+
+		VkSampler pyramidSampler = VK_NULL_HANDLE;
+		VkImageView pyramidView = VK_NULL_HANDLE;
+		float pyramidSize[3] = {};
+
+		void createBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		void destroyBuffer(Buffer& buffer);
+
+		void createDefaultPyramid();
+		void clearDefaultPyramid(VkCommandBuffer commandBuffer);
+
+		VkDescriptorSet getSet(FrameResources& frame);
+
+	};
+
+}
+
+#endif // !VGL_INDIRECTRENDERER_H
@@ -0,0 +1,76 @@
+#ifndef VGL_JOBSYSTEM_H
+#define VGL_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vgl {
+
+	/*
+	Pool of worker threads owned by the library, used for anything that can be split across cores
+	(pipeline compilation, command recording, culling, sorting).
+	Jobs are taken from a shared FIFO queue. Jobs must not block waiting on other jobs they submitted,
+	use parallelFor for fork/join work since the calling thread helps run it.
+	*/
+	class JobSystem {
+
+	public:
+
+		//_workerCount of 0 uses one thread per core, leaving one for the calling thread
+		explicit JobSystem(uint32_t _workerCount = 0);
+		//Finishes every queued job before joining the workers
+		~JobSystem();
+
+		//Owns threads so can not be copied
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		//Run a job on a worker, the future holds the result or the exception it threw
+		template <typename Function>
+		auto submit(Function&& function) -> std::future<std::invoke_result_t<std::decay_t<Function>>> {
+			using Result = std::invoke_result_t<std::decay_t<Function>>;
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+			std::future<Result> future = task->get_future();
+			this->enqueue([task]() { (*task)(); });
+			return future;
+		}
+
+		//Run function(begin, end) over [0, count) split into ranges of at most batchSize, returns once every range has run
+		//The calling thread runs ranges as well, so this is safe to call from inside a job
+		//If a range throws the rest still run and the first exception is rethrown here
+		void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+		uint32_t getWorkerCount() const;
+
+		//Number of distinct thread indices, workers plus the threads that are not workers
+		uint32_t getThreadCount() const;
+
+		//0 on any thread that isn't a worker, 1 to workerCount on workers
+		//Use to index per-thread resources such as command pools
+		static uint32_t getThreadIndex();
+
+	private:
+
+		std::vector<std::thread> workers;
+
+		std::deque<std::function<void()>> queue;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping = false;
+
+		void enqueue(std::function<void()> job);
+		void workerLoop(uint32_t index);
+
+	};
+
+}
+
+#endif // !VGL_JOBSYSTEM_H
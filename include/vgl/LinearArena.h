@@ -0,0 +1,81 @@
+#ifndef VGL_LINEARARENA_H
+#define VGL_LINEARARENA_H
+
+#include <cstring>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/MemoryAllocator.h"
+
+namespace vgl {
+
+	/*
+	Per-frame bump allocator for transient data (uniforms, staging, per-draw constants).
+	One host visible buffer is split into a region for every frame in flight.
+	Allocating just moves an offset forward and everything in a frame's region is released at once by beginFrame,
+	which must only be called once the GPU has finished with that frame (i.e. after its fence has signalled).
+	*/
+	class LinearArena {
+
+	public:
+
+		struct Allocation {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			//Offset into buffer, use this when binding or copying
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+
+			bool isValid() const { return mapped != nullptr; }
+		};
+
+		//_usage is the set of ways the transient data can be used, e.g. uniform buffer and transfer source
+		LinearArena(vgl::MemoryAllocator* _allocator, VkDeviceSize _sizePerFrame, uint32_t _frameCount, VkBufferUsageFlags _usage);
+		~LinearArena();
+
+		//Owns a buffer so can not be copied
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+
+		//Release everything allocated the last time this frame index was used
+		void beginFrame(uint32_t frameIndex);
+
+		//Returns an invalid allocation when the frame's region is full
+		//Alignment defaults to the strictest uniform/storage buffer offset alignment of the device
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+		//Allocate and copy data in
+		Allocation push(const void* data, VkDeviceSize size, VkDeviceSize alignment = 0);
+
+		//Make the current frame's writes visible to the GPU, does nothing for host coherent memory
+		void flush();
+
+		VkBuffer getBuffer() const;
+		VkDeviceSize getSizePerFrame() const;
+		//Bytes allocated in the current frame
+		VkDeviceSize getUsedBytes() const;
+		//Most bytes used by any frame so far, useful for sizing the arena
+		VkDeviceSize getPeakUsedBytes() const;
+
+	private:
+
+		vgl::MemoryAllocator* allocator = nullptr;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		vgl::MemoryAllocation allocation;
+
+		VkDeviceSize sizePerFrame = 0;
+		uint32_t frameCount = 0;
+		VkDeviceSize defaultAlignment = 1;
+
+		uint32_t currentFrame = 0;
+		//Offset of the next allocation, relative to the start of the current frame's region
+		VkDeviceSize head = 0;
+		VkDeviceSize peakUsed = 0;
+
+	};
+
+}
+
+#endif // !VGL_LINEARARENA_H
@@ -0,0 +1,223 @@
+#ifndef VGL_LOGGER_H
+#define VGL_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//Stream style logging, message is only formatted when the level is enabled
+//e.g. VGL_LOG_INFO("Device", "SELECTED " << name)
+#define VGL_LOG(level, category, message) \
+	do { \
+		if (vgl::Logger::get().isEnabled(level)) { \
+			std::ostringstream vglLogStream; \
+			vglLogStream << message; \
+			vgl::Logger::get().log(level, category, vglLogStream.str()); \
+		} \
+	} while (0)
+#define VGL_LOG_VERBOSE(category, message) VGL_LOG(vgl::LogLevel::Verbose, category, message)
+#define VGL_LOG_INFO(category, message) VGL_LOG(vgl::LogLevel::Info, category, message)
+#define VGL_LOG_WARNING(category, message) VGL_LOG(vgl::LogLevel::Warning, category, message)
+#define VGL_LOG_ERROR(category, message) VGL_LOG(vgl::LogLevel::Error, category, message)
+
+namespace vgl {
+
+	enum class LogLevel : uint32_t {
+		Verbose = 0,
+		Info = 1,
+		Warning = 2,
+		Error = 3,
+		//Only used as a minimum level, nothing is logged
+		Off = 4,
+	};
+
+	struct LogMessage {
+		vgl::LogLevel level = vgl::LogLevel::Info;
+		std::string category;
+		std::string text;
+		std::chrono::system_clock::time_point time;
+		//ChromeTrace::getThreadId of the thread that logged it
+		uint32_t threadId = 0;
+	};
+
+	//Where messages end up, only ever called from the logger's thread so sinks don't need to be thread safe
+	class LogSink {
+
+	public:
+
+		virtual ~LogSink() = default;
+
+		virtual void write(const vgl::LogMessage& message) = 0;
+		//Called once the queue is empty, so sinks can buffer writes in between
+		virtual void flush() {}
+
+		//"[12:34:56.789] [WARNING] [Category] text"
+		static std::string format(const vgl::LogMessage& message);
+		static const char* getLevelName(vgl::LogLevel level);
+
+	};
+
+	//Warnings and errors to stderr, everything else to stdout
+	class ConsoleSink : public LogSink {
+
+	public:
+
+		void write(const vgl::LogMessage& message) override;
+		void flush() override;
+
+	};
+
+	//Appends to a file, the file is truncated when the sink is created
+	class FileSink : public LogSink {
+
+	public:
+
+		explicit FileSink(const std::string& _path);
+
+		void write(const vgl::LogMessage& message) override;
+		void flush() override;
+
+		bool isOpen() const;
+
+	private:
+
+		std::ofstream file;
+
+	};
+
+	//Forwards every message to a function, e.g. to show them in an in-game console
+	class CallbackSink : public LogSink {
+
+	public:
+
+		using Callback = std::function<void(const vgl::LogMessage&)>;
+
+		explicit CallbackSink(Callback _callback);
+
+		void write(const vgl::LogMessage& message) override;
+
+	private:
+
+		Callback callback;
+
+	};
+
+	/*
+	Process wide logger. log only pushes the message onto a lock-free multiple producer queue, a background thread formats it
+	and hands it to the sinks, so threads that log never wait on each other or on the console.
+
+	Messages logged with a repeat key, such as the validation layer's message ID, are rate limited: only repeatLimit of them are written
+	per repeatWindow and the rest are counted and reported once the window ends.
+
+	The minimum level defaults to Info and can be overridden with the VGL_LOG_LEVEL environment variable (verbose, info, warning, error, off).
+	Messages are written in the order they were logged. The logger is never destroyed, once its thread has been stopped at exit
+	messages are written straight to the sinks, so logging from static destructors is safe.
+	*/
+	class Logger {
+
+	public:
+
+		static constexpr const char* environmentVariable = "VGL_LOG_LEVEL";
+
+		//Messages that can wait in the queue before new ones are dropped
+		static constexpr uint32_t maxQueued = 65536;
+		//Messages with the same repeat key written per window
+		static constexpr uint32_t repeatLimit = 5;
+		static constexpr std::chrono::milliseconds repeatWindow{ 1000 };
+
+		static vgl::Logger& get();
+
+		Logger(const Logger&) = delete;
+		Logger& operator=(const Logger&) = delete;
+
+		void setLevel(vgl::LogLevel level);
+		vgl::LogLevel getLevel() const;
+		bool isEnabled(vgl::LogLevel level) const;
+
+		void log(vgl::LogLevel level, const std::string& category, std::string text);
+		//repeatKey of 0 is never rate limited
+		void log(vgl::LogLevel level, const std::string& category, std::string text, uint64_t repeatKey);
+
+		//The console sink is added by default
+		void addSink(std::shared_ptr<vgl::LogSink> sink);
+		void removeSink(const std::shared_ptr<vgl::LogSink>& sink);
+		void clearSinks();
+
+		//Block until everything logged so far has been written and the sinks have been flushed
+		void flush();
+
+		//Messages dropped because the queue was full
+		uint64_t getDroppedCount() const;
+		//Repeated messages that were counted instead of written
+		uint64_t getSuppressedCount() const;
+
+	private:
+
+		struct Node {
+			std::atomic<Node*> next{ nullptr };
+			vgl::LogMessage message;
+			uint64_t repeatKey = 0;
+		};
+
+		struct RepeatState {
+			std::chrono::steady_clock::time_point windowStart;
+			uint32_t written = 0;
+			uint64_t suppressed = 0;
+			vgl::LogLevel level = vgl::LogLevel::Info;
+			std::string category;
+		};
+
+		std::atomic<uint32_t> level{ static_cast<uint32_t>(vgl::LogLevel::Info) };
+
+		//Vyukov queue, producers exchange head and the logger thread owns tail, which always points at a consumed node
+		std::atomic<Node*> head{ nullptr };
+		Node* tail = nullptr;
+
+		std::atomic<uint64_t> enqueued{ 0 };
+		std::atomic<uint64_t> dropped{ 0 };
+		std::atomic<uint64_t> suppressed{ 0 };
+		//Written by whoever drains, messages up to this count have reached the sinks
+		std::atomic<uint64_t> processed{ 0 };
+
+		std::mutex sinkMutex;
+		std::vector<std::shared_ptr<vgl::LogSink>> sinks;
+
+		//Only touched by whoever is draining, under drainMutex
+		std::mutex drainMutex;
+		std::unordered_map<uint64_t, RepeatState> repeats;
+		uint64_t droppedReported = 0;
+
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		std::condition_variable drained;
+		bool stopping = false;
+		std::atomic<bool> running{ false };
+		std::thread thread;
+
+		Logger();
+
+		//Stops the thread and writes whatever is still queued, called once at exit, later messages are written by the thread that logs them
+		void shutdown();
+		void threadLoop();
+		//Write everything queued, returns how many messages were taken off the queue
+		uint64_t drain();
+		void write(const vgl::LogMessage& message);
+		//Report repeats whose window has ended, or every repeat still being counted
+		void reportRepeats(bool all);
+		void reportRepeat(uint64_t repeatKey, RepeatState& state);
+
+	};
+
+}
+
+#endif // !VGL_LOGGER_H
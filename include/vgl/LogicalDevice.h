@@ -1,11 +1,19 @@
 #ifndef VGL_LOGICALDEVICE_H
 #define VGL_LOGICALDEVICE_H
 
+#include <map>
 #include <set>
 
 #include "vulkan/vulkan.hpp"
 
 #include "vgl/QueueFamilyIndices.h"
+#include "vgl/DeviceCapabilities.h"
+#include "vgl/MemoryAllocator.h"
+#include "vgl/PipelineCache.h"
+#include "vgl/JobSystem.h"
+#include "vgl/PipelineCompiler.h"
+#include "vgl/ShaderCache.h"
+#include "vgl/QueueScheduler.h"
 
 namespace vgl {
 
@@ -15,13 +23,84 @@ namespace vgl {
 
 		VkDevice device = VK_NULL_HANDLE;
 
-		LogicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, std::shared_ptr<VkSurfaceKHR> _surface, std::unique_ptr<VkPhysicalDevice> _physicalDevice);
+		//Handles to the queues created with the device
+		//presentQueue is VK_NULL_HANDLE when running headless
+		VkQueue graphicsQueue = VK_NULL_HANDLE;
+		VkQueue presentQueue = VK_NULL_HANDLE;
+		//Queue from the dedicated transfer family if there is one, otherwise the same queue as graphicsQueue
+		VkQueue transferQueue = VK_NULL_HANDLE;
+		//Queue from the dedicated compute family if there is one, otherwise the same queue as graphicsQueue
+		//When the transfer queue comes from the same family a second queue is used for it if the family has one
+		VkQueue computeQueue = VK_NULL_HANDLE;
+
+		//Queue families the queues were created from
+		QueueFamilyIndices queueFamilyIndices;
+
+		//_surface can be null (or hold VK_NULL_HANDLE) when running headless, then no present queue is created
+		//_validationLayers is empty if validation layers are disabled
+		//_capabilities is the snapshot of the physical device to create the device on, see PhysicalDevice::getCapabilities
+		//_pipelineCacheDirectory is where the pipeline cache is persisted, empty to keep it in memory only
+		LogicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, const std::vector<const char*>& _validationLayers, std::shared_ptr<VkSurfaceKHR> _surface,
+			std::shared_ptr<const vgl::DeviceCapabilities> _capabilities, const std::string& _pipelineCacheDirectory = "");
+		~LogicalDevice();
+
+		//Owns the VkDevice so can not be copied
+		LogicalDevice(const LogicalDevice&) = delete;
+		LogicalDevice& operator=(const LogicalDevice&) = delete;
+
+		//All buffer and image memory should be allocated through this rather than vkAllocateMemory
+		vgl::MemoryAllocator* getAllocator() const;
+
+		//All pipelines should be created with this cache so they are compiled faster on the next run
+		vgl::PipelineCache* getPipelineCache() const;
+
+		//Shared shader modules and layouts built from their reflection, reflections are persisted next to the pipeline cache
+		vgl::ShaderCache* getShaderCache() const;
+
+		//Worker threads shared by everything created from the device
+		vgl::JobSystem* getJobSystem() const;
+
+		//Compiles pipelines on the job system, the render loop can draw with a placeholder until they are ready
+		vgl::PipelineCompiler* getPipelineCompiler() const;
+
+		//Submits to the graphics, compute and transfer queues and tracks the work with a timeline per queue
+		vgl::QueueScheduler* getQueueScheduler() const;
+
+		//Whether VK_KHR_dynamic_rendering (core in 1.3) is enabled, so pipelines and passes don't need a VkRenderPass
+		bool isDynamicRenderingEnabled() const;
+
+		//Whether the Vulkan 1.2 descriptor indexing features used by BindlessHeap are enabled
+		bool isBindlessEnabled() const;
+
+		//Whether vkCmdDrawIndexedIndirectCount (core in 1.2) can be used, so the draw count can come from a GPU buffer
+		bool isDrawIndirectCountEnabled() const;
+
+		//Whether one indirect draw call can execute more than one command
+		bool isMultiDrawIndirectEnabled() const;
+
+		//Whether VK_EXT_memory_budget is enabled, so MemoryAllocator::queryBudget reports the driver's budget rather than an estimate
+		bool isMemoryBudgetEnabled() const;
+
+		//Whether VK_EXT_calibrated_timestamps is enabled with the device and host clock domains, so GpuProfiler can calibrate without a submit
+		bool isCalibratedTimestampsEnabled() const;
+		//Host clock domain calibrated timestamps are sampled in, the one std::chrono::steady_clock and so the trace clock use
+		static VkTimeDomainEXT getHostTimeDomain();
+
+		//Whether VK_KHR_synchronization2 (core in 1.3) is enabled, so QueueScheduler batches with vkQueueSubmit2
+		bool isSynchronization2Enabled() const;
+
+		//Properties, features, memory types and queue families of the physical device, queried once
+		const vgl::DeviceCapabilities& getCapabilities() const;
+		VkPhysicalDevice getPhysicalDevice() const;
 
 	private:
 
 		//Vector to store all device extensions required
 		const std::vector<const char*> deviceExtensions;
 
+		//Validation layers to enable on the device, empty if disabled
+		const std::vector<const char*> validationLayers;
+
 		//Store pointer to vulkan instance
 		std::shared_ptr<const VkInstance> instance;
 
@@ -29,17 +108,39 @@ namespace vgl {
 		std::shared_ptr<VkSurfaceKHR> surface;
 
 		// Store the physical device
-		std::unique_ptr<VkPhysicalDevice> physicalDevice = nullptr;
-
-		/*
-		Anything from drawing to uploading textures, requires commands to be submitted to a queue.
-		There are different types of queues that originate from different queue families and each family of queues allows only a subset of commands.
-			For example;
-				There could be a queue family that only allows processing of compute commands
-				There could be one that only allows memory transfer related commands.
-		Need to check which queue families are supported by the device and which one of these supports the commands that are wanted to use.
-		*/
-		QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
+		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+		//Shared with the PhysicalDevice that selected it
+		std::shared_ptr<const vgl::DeviceCapabilities> capabilities;
+
+		//Sub-allocates device memory, destroyed before the device
+		std::unique_ptr<vgl::MemoryAllocator> allocator;
+
+		//Persistent pipeline cache, saved and destroyed before the device
+		std::unique_ptr<vgl::PipelineCache> pipelineCache;
+
+		//Destroyed after the pipeline compiler, whose jobs can use its modules
+		std::unique_ptr<vgl::ShaderCache> shaderCache;
+
+		//Created before and destroyed after the pipeline compiler, which queues jobs on it
+		std::unique_ptr<vgl::JobSystem> jobSystem;
+
+		//Destroyed before the pipeline cache so pending jobs can still use it
+		std::unique_ptr<vgl::PipelineCompiler> pipelineCompiler;
+
+		//Created once the queues are fetched, destroyed first so submitted work finishes before anything it uses
+		std::unique_ptr<vgl::QueueScheduler> queueScheduler;
+
+		bool dynamicRenderingEnabled = false;
+		bool bindlessEnabled = false;
+		bool drawIndirectCountEnabled = false;
+		bool multiDrawIndirectEnabled = false;
+		bool memoryBudgetEnabled = false;
+		bool calibratedTimestampsEnabled = false;
+		bool synchronization2Enabled = false;
+
+		//Whether a surface was given, if not then the device is headless
+		bool hasSurface() const;
 
 	};
 
@@ -48,4 +149,4 @@ namespace vgl {
 
 
 
-#endif VGL_LOGICALDEVICE_H
\ No newline at end of file
+#endif // !VGL_LOGICALDEVICE_H
@@ -0,0 +1,57 @@
+#ifndef VGL_MAPPEDFILE_H
+#define VGL_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vgl {
+
+	/*
+	Read only view of a whole file mapped into memory.
+	Pages are only read from disk when they are touched and come straight from the OS file cache, so large assets
+	don't have to be copied into a buffer first. The data is page aligned and stays valid until the file is unmapped.
+	*/
+	class MappedFile {
+
+	public:
+
+		MappedFile() = default;
+		//Throws if the file can't be opened or mapped
+		explicit MappedFile(const std::string& _path);
+		~MappedFile();
+
+		//Owns the mapping so can not be copied
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		//Empty files are open but have no data
+		bool isOpen() const;
+		void close();
+
+		const uint8_t* data() const;
+		size_t size() const;
+		const std::string& getPath() const;
+
+	private:
+
+		const uint8_t* memory = nullptr;
+		size_t fileSize = 0;
+		bool open = false;
+		std::string path;
+
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#endif
+
+		void swap(MappedFile& other) noexcept;
+
+	};
+
+}
+
+#endif // !VGL_MAPPEDFILE_H
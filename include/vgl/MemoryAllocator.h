@@ -0,0 +1,185 @@
+#ifndef VGL_MEMORYALLOCATOR_H
+#define VGL_MEMORYALLOCATOR_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/TlsfAllocator.h"
+#include "vgl/DeviceCapabilities.h"
+
+namespace vgl {
+
+	//Region of device memory handed out by the MemoryAllocator
+	struct MemoryAllocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+
+		//Pointer to the start of the allocation if the memory is host visible, otherwise nullptr
+		//Host visible blocks are mapped once when created and stay mapped
+		void* mapped = nullptr;
+
+		uint32_t memoryTypeIndex = 0;
+
+		//Block and TLSF block the allocation came from, used to free it
+		void* block = nullptr;
+		uint32_t blockIndex = vgl::TlsfAllocator::invalidIndex;
+
+		bool isValid() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	//How much of one memory heap the process is using and how much it can use
+	struct HeapBudget {
+		VkDeviceSize size = 0;
+		VkMemoryHeapFlags flags = 0;
+		//Bytes the process can use before the driver or OS starts evicting or failing allocations, can change every frame
+		//Without VK_EXT_memory_budget this is a fixed fraction of the heap size
+		VkDeviceSize budget = 0;
+		//Bytes the whole process has allocated from the heap
+		//Without VK_EXT_memory_budget only memory reserved by this allocator is counted
+		VkDeviceSize usage = 0;
+	};
+
+	struct MemoryBudget {
+		uint32_t heapCount = 0;
+		vgl::HeapBudget heaps[VK_MAX_MEMORY_HEAPS];
+		//Whether the numbers came from VK_EXT_memory_budget
+		bool fromExtension = false;
+
+		//Totals over the heaps flagged VK_MEMORY_HEAP_DEVICE_LOCAL_BIT
+		VkDeviceSize getDeviceLocalBudget() const;
+		VkDeviceSize getDeviceLocalUsage() const;
+	};
+
+	/*
+	Devices limit the number of live vkAllocateMemory calls (maxMemoryAllocationCount, can be as low as 4096) and every call is a round trip into the driver.
+	Instead large blocks are allocated per memory type and buffers/images are sub-allocated from them with a TLSF allocator.
+	Resources larger than half a block get their own dedicated allocation.
+
+	Linear resources (buffers, linear images) and optimal tiling images are kept in separate blocks,
+	so bufferImageGranularity never has to be respected between neighbouring allocations.
+
+	All functions are thread safe.
+	*/
+	class MemoryAllocator {
+
+	public:
+
+		struct Stats {
+			//Bytes allocated from the driver with vkAllocateMemory
+			VkDeviceSize bytesReserved = 0;
+			//Bytes handed out to resources
+			VkDeviceSize bytesUsed = 0;
+
+			uint32_t blockCount = 0;
+			uint32_t allocationCount = 0;
+			uint32_t dedicatedAllocationCount = 0;
+
+			//0 when the free space in every block is contiguous, approaches 1 as it is split into small pieces
+			//Weighted by the free space in each block
+			double fragmentation = 0.0;
+		};
+
+		static constexpr VkDeviceSize defaultBlockSize = 256ull * 1024 * 1024;
+
+		//Fraction of a heap assumed to be available when VK_EXT_memory_budget isn't enabled
+		static constexpr double fallbackBudgetFraction = 0.8;
+
+		//Memory types and limits are read from the device's capability snapshot
+		//_memoryBudgetEnabled is whether the device was created with VK_EXT_memory_budget
+		MemoryAllocator(const vgl::DeviceCapabilities& _capabilities, VkDevice _device, VkDeviceSize _blockSize = defaultBlockSize, bool _memoryBudgetEnabled = false);
+		~MemoryAllocator();
+
+		//Owns device memory so can not be copied
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+		//Sub-allocate memory that meets the requirements and has all of requiredProperties
+		//Memory types that also have preferredProperties are chosen first
+		//_linear is true for buffers and linear tiling images, false for optimal tiling images
+		vgl::MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags requiredProperties,
+			VkMemoryPropertyFlags preferredProperties, bool _linear);
+		void free(vgl::MemoryAllocation& allocation);
+
+		//Create a resource and bind sub-allocated memory to it
+		//Throws if either fails, nothing is left behind and the resource is left as VK_NULL_HANDLE
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, vgl::MemoryAllocation& allocation,
+			VkMemoryPropertyFlags preferredProperties = 0);
+		//Full create info form, e.g. for buffers shared between queue families with VK_SHARING_MODE_CONCURRENT
+		void createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, vgl::MemoryAllocation& allocation,
+			VkMemoryPropertyFlags preferredProperties = 0);
+		void destroyBuffer(VkBuffer& buffer, vgl::MemoryAllocation& allocation);
+		void createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, vgl::MemoryAllocation& allocation,
+			VkMemoryPropertyFlags preferredProperties = 0);
+		void destroyImage(VkImage& image, vgl::MemoryAllocation& allocation);
+
+		//Make CPU writes visible to the GPU, only does anything for memory that is not host coherent
+		void flush(const vgl::MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		//Find a memory type that is allowed by typeFilter and has all of the requested properties
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+		Stats getStats() const;
+		Stats getStats(uint32_t memoryTypeIndex) const;
+
+		//Current budget and usage of every heap, queried from the driver each call so it reflects other processes as well
+		vgl::MemoryBudget queryBudget() const;
+		//Heap a memory type allocates from
+		uint32_t getHeapIndex(uint32_t memoryTypeIndex) const;
+
+		const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const;
+		const VkPhysicalDeviceLimits& getLimits() const;
+
+		VkDevice getDevice() const;
+
+	private:
+
+		//One vkAllocateMemory allocation that resources are sub-allocated from
+		struct MemoryBlock {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t memoryTypeIndex = 0;
+			bool linear = true;
+			//Dedicated blocks hold a single resource and are freed with it
+			bool dedicated = false;
+			void* mapped = nullptr;
+			vgl::TlsfAllocator tlsf;
+		};
+
+		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+		VkDevice device = VK_NULL_HANDLE;
+
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		VkPhysicalDeviceLimits limits{};
+
+		VkDeviceSize blockSize = defaultBlockSize;
+
+		bool memoryBudgetEnabled = false;
+
+		//Blocks for each memory type
+		std::vector<std::unique_ptr<MemoryBlock>> blocks[VK_MAX_MEMORY_TYPES];
+
+		mutable std::mutex mutex;
+
+		//Size of the blocks for a memory type, smaller heaps (e.g. 256MB BAR memory) get smaller blocks
+		VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+
+		//Try to allocate from a specific memory type, returns an invalid allocation if it fails
+		vgl::MemoryAllocation allocateFromType(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceSize alignment, bool _linear);
+
+		MemoryBlock* createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool _linear, bool _dedicated);
+		void destroyBlock(MemoryBlock* block);
+
+		bool isHostCoherent(uint32_t memoryTypeIndex) const;
+
+		//Add a block to the totals, fragmentation is accumulated weighted by free bytes and divided out by the caller
+		static void addStats(Stats& stats, double& weightedFragmentation, const MemoryBlock& block);
+
+	};
+
+}
+
+#endif // !VGL_MEMORYALLOCATOR_H
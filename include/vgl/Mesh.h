@@ -0,0 +1,85 @@
+#ifndef VGL_MESH_H
+#define VGL_MESH_H
+
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/UploadEngine.h"
+#include "vgl/MeshFile.h"
+#include "vgl/MeshProcessor.h"
+
+namespace vgl {
+
+	/*
+	Vertex and index buffers of a processed mesh in device local memory.
+	Created from a MeshFile the sections are copied straight from the mapping into staging memory by the UploadEngine,
+	so the CPU cost of loading is the copy, nothing is parsed or converted per vertex.
+	The buffers can be bound once the upload is ready, see isReady. Vertices use the PackedVertex layout from getVertexAttributes,
+	the shader dequantises positions with getPositionScale and getPositionOffset.
+	*/
+	class Mesh {
+
+	public:
+
+		//The file can be closed once the constructor returns
+		Mesh(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, const vgl::MeshFile& _file);
+		Mesh(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, const vgl::MeshData& _mesh);
+		//The GPU must be done with the buffers, waits for the upload if it hasn't finished
+		~Mesh();
+
+		//Owns Vulkan handles so can not be copied
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+
+		//Whether frames recorded from now on can draw the mesh
+		bool isReady() const;
+		vgl::UploadTicket getUploadTicket() const;
+
+		//Bind the vertex buffer to binding 0 and the index buffer
+		void bind(VkCommandBuffer commandBuffer) const;
+		//Indexed draw of one level of detail, the mesh must be bound
+		void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+		//Coarsest level whose error is at most maxError (relative to the bounds diagonal), 0 if none are
+		uint32_t selectLod(float maxError) const;
+		const std::vector<vgl::MeshLod>& getLods() const;
+		const vgl::Aabb& getBounds() const;
+		uint32_t getVertexCount() const;
+
+		glm::vec3 getPositionScale() const;
+		glm::vec3 getPositionOffset() const;
+
+		VkBuffer getVertexBuffer() const;
+		VkBuffer getIndexBuffer() const;
+		VkIndexType getIndexType() const;
+
+		//Vertex input state for pipelines drawing meshes
+		static std::vector<VkVertexInputBindingDescription> getVertexBindings();
+		static std::vector<VkVertexInputAttributeDescription> getVertexAttributes();
+
+	private:
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::UploadEngine* uploadEngine = nullptr;
+
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		vgl::MemoryAllocation vertexAllocation;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		vgl::MemoryAllocation indexAllocation;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		uint32_t vertexCount = 0;
+
+		std::vector<vgl::MeshLod> lods;
+		vgl::Aabb bounds;
+		vgl::UploadTicket ticket = 0;
+
+		//Create both buffers and queue their uploads
+		void upload(const void* vertices, VkDeviceSize vertexBytes, const void* indices, VkDeviceSize indexBytes);
+
+	};
+
+}
+
+#endif // !VGL_MESH_H
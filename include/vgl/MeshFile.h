@@ -0,0 +1,81 @@
+#ifndef VGL_MESHFILE_H
+#define VGL_MESHFILE_H
+
+#include <cstdint>
+#include <string>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/MappedFile.h"
+#include "vgl/MeshProcessor.h"
+
+namespace vgl {
+
+	/*
+	Binary mesh written by MeshFile::save from a processed MeshData, laid out exactly as the GPU reads it:
+		header, LOD table, vertices (PackedVertex), indices (16 bit when every vertex can be indexed with 16 bits, otherwise 32 bit)
+	Each section starts 16 byte aligned. Opening a file maps it and only checks the header and LOD table, the vertex and
+	index sections are handed to the UploadEngine straight from the mapping so loading never parses individual vertices.
+	The checksum only covers the header and LOD table for the same reason, truncated files are still rejected by their size.
+	*/
+	class MeshFile {
+
+	public:
+
+		MeshFile() = default;
+		//Throws if the file can't be mapped or isn't a valid mesh file
+		explicit MeshFile(const std::string& _path);
+
+		const vgl::MeshLod* getLods() const;
+		uint32_t getLodCount() const;
+		const vgl::Aabb& getBounds() const;
+
+		const void* getVertexData() const;
+		VkDeviceSize getVertexDataSize() const;
+		uint32_t getVertexCount() const;
+
+		const void* getIndexData() const;
+		VkDeviceSize getIndexDataSize() const;
+		uint32_t getIndexCount() const;
+		VkIndexType getIndexType() const;
+
+		//Write the mesh to a temporary file and rename it over _path, returns false if anything fails
+		static bool save(const std::string& _path, const vgl::MeshData& mesh);
+
+	private:
+
+		struct FileHeader {
+			uint32_t magic = 0;
+			uint32_t version = 0;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+			uint32_t lodCount = 0;
+			uint32_t vertexStride = 0;
+			//2 or 4
+			uint32_t indexSize = 0;
+			uint32_t padding = 0;
+			float boundsMin[3] = {};
+			float boundsMax[3] = {};
+			uint64_t lodOffset = 0;
+			uint64_t vertexOffset = 0;
+			uint64_t indexOffset = 0;
+			uint64_t fileSize = 0;
+			//Of the header with this field set to 0 followed by the LOD table
+			uint64_t checksum = 0;
+		};
+
+		static constexpr uint32_t fileMagic = 0x534D4756; //"VGMS"
+		static constexpr uint32_t fileVersion = 1;
+		static constexpr uint64_t sectionAlignment = 16;
+
+		vgl::MappedFile file;
+		FileHeader header;
+		vgl::Aabb bounds;
+
+		static uint64_t checksum(const FileHeader& header, const void* lods, size_t lodsSize);
+
+	};
+
+}
+
+#endif // !VGL_MESHFILE_H
@@ -0,0 +1,127 @@
+#ifndef VGL_MESHPROCESSOR_H
+#define VGL_MESHPROCESSOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "vgl/BoundingVolumes.h"
+
+namespace vgl {
+
+	//Full precision vertex as it comes from an asset, the input to the MeshProcessor
+	struct MeshVertex {
+		glm::vec3 position{ 0.0f };
+		glm::vec3 normal{ 0.0f, 0.0f, 1.0f };
+		glm::vec2 uv{ 0.0f };
+	};
+
+	/*
+	Quantised vertex as it is stored on disk and in the vertex buffer, 16 bytes instead of 32.
+	Read by the vertex shader as:
+		location 0, VK_FORMAT_R16G16B16A16_UNORM, position = offset + value.xyz * scale (see MeshData::getPositionScale)
+		location 1, VK_FORMAT_R8G8_SNORM, octahedral encoded unit normal
+		location 2, VK_FORMAT_R16G16_SFLOAT, uv
+	*/
+	struct PackedVertex {
+		//Position within the mesh bounds, w is unused
+		uint16_t position[4];
+		int8_t normal[2];
+		uint8_t padding[2];
+		//Half floats so tiling uvs outside 0 to 1 keep working
+		uint16_t uv[2];
+	};
+	static_assert(sizeof(vgl::PackedVertex) == 16, "PackedVertex must match the vertex input layout");
+
+	//Range of the index buffer drawn for one level of detail, every level indexes the same vertices
+	struct MeshLod {
+		uint32_t indexOffset = 0;
+		uint32_t indexCount = 0;
+		//Largest distance a vertex moved, relative to the diagonal of the mesh bounds, 0 for the full detail level
+		float error = 0.0f;
+		uint32_t padding = 0;
+	};
+
+	//Processed mesh ready to be saved as a MeshFile or uploaded
+	struct MeshData {
+		std::vector<vgl::PackedVertex> vertices;
+		//Every level's indices one after the other, most detailed first
+		std::vector<uint32_t> indices;
+		std::vector<vgl::MeshLod> lods;
+		vgl::Aabb bounds;
+
+		//Dequantisation of the UNORM16 positions
+		glm::vec3 getPositionScale() const;
+		glm::vec3 getPositionOffset() const;
+	};
+
+	struct MeshBuildSettings {
+		//Reorder triangles so vertices are reused while they are still in the post-transform cache
+		bool optimizeVertexCache = true;
+		//Reorder vertices into the order the triangles first use them so vertex fetches are close together in memory
+		bool optimizeVertexFetch = true;
+
+		//Most levels of detail including the full detail level, 1 to only keep the input
+		uint32_t maxLods = 4;
+		//Each level aims for this fraction of the triangles of the previous one
+		float lodReduction = 0.5f;
+		//No level is built with fewer triangles than this
+		uint32_t minLodTriangles = 64;
+	};
+
+	struct MeshBuildStats {
+		//Average transformed vertices per triangle with a 16 entry FIFO cache, 0.5 is the best possible and 3 the worst
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+		uint32_t inputVertices = 0;
+		uint32_t inputTriangles = 0;
+		double buildMs = 0.0;
+	};
+
+	/*
+	Turns a triangle list into the mesh data the renderer draws, either offline in a tool or when an asset is first loaded:
+		Triangles are reordered for the post-transform vertex cache (Forsyth's linear speed vertex cache optimisation)
+		Levels of detail are built by quadric weighted vertex clustering, each level keeps a subset of the original vertices
+		Vertices are reordered for fetch locality and quantised to 16 bytes
+	The result is saved with MeshFile::save and later mapped and uploaded without touching individual vertices.
+	*/
+	class MeshProcessor {
+
+	public:
+
+		//Run every step on a triangle list, indices must be a multiple of 3 and reference valid vertices
+		static vgl::MeshData build(const std::vector<vgl::MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+			const vgl::MeshBuildSettings& settings = {}, vgl::MeshBuildStats* stats = nullptr);
+
+		//Triangle order that reuses vertices in the post-transform cache
+		static std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+		//Reorder vertices by first use in indices and rewrite indices to match, vertices that are never used are removed
+		static void optimizeVertexFetch(std::vector<vgl::MeshVertex>& vertices, std::vector<uint32_t>& indices);
+
+		//Triangle list using a subset of the vertices with at most targetIndexCount indices, empty if it can't be reduced that far
+		//error is set to the largest distance a vertex moved relative to the bounds diagonal
+		static std::vector<uint32_t> simplify(const std::vector<vgl::MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+			size_t targetIndexCount, float* error = nullptr);
+
+		//Average cache misses per triangle for a FIFO cache of cacheSize vertices
+		static float computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+		//Size of the bounds each UNORM16 position axis covers, used by quantize and dequantize and passed to the vertex shader
+		static glm::vec3 getPositionScale(const vgl::Aabb& bounds);
+
+		static vgl::PackedVertex quantize(const vgl::MeshVertex& vertex, const vgl::Aabb& bounds);
+		static vgl::MeshVertex dequantize(const vgl::PackedVertex& vertex, const vgl::Aabb& bounds);
+
+		//Minimal Wavefront OBJ reader for v, vt, vn and f lines, polygons are triangulated as fans
+		//Corners with the same position, uv and normal share a vertex, normals are generated when the file has none
+		//Throws if the file can't be opened or references missing data
+		static void loadObj(const std::string& path, std::vector<vgl::MeshVertex>& vertices, std::vector<uint32_t>& indices);
+
+	};
+
+}
+
+#endif // !VGL_MESHPROCESSOR_H
@@ -0,0 +1,38 @@
+#ifndef VGL_OFFSCREENTARGET_H
+#define VGL_OFFSCREENTARGET_H
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+
+namespace vgl {
+
+	//Colour image that can be rendered to when there is no window/swap chain to present to
+	//Used by the headless VulkanCore so batch rendering and CI can run without a display
+	class OffscreenTarget {
+
+	public:
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		vgl::MemoryAllocation imageMemory;
+
+		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+		VkExtent2D extent{};
+
+		OffscreenTarget(vgl::LogicalDevice* _logicalDevice, VkExtent2D _extent, VkFormat _format);
+		~OffscreenTarget();
+
+		//Owns Vulkan handles so can not be copied
+		OffscreenTarget(const OffscreenTarget&) = delete;
+		OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+	private:
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+
+	};
+
+}
+
+#endif // !VGL_OFFSCREENTARGET_H
@@ -4,34 +4,99 @@
 #include "vulkan/vulkan.hpp"
 
 #include <set>
+#include <string>
+#include <vector>
 #include <iostream>
 
 #include "vgl/QueueFamilyIndices.h"
 #include "vgl/SwapChainSupportDetails.h"
+#include "vgl/DeviceFilter.h"
+#include "vgl/DeviceCapabilities.h"
 
 namespace vgl {
 
+	/*
+	Selects the GPU to use.
+	Every device is scored instead of taking the first suitable one, on multi-GPU machines the first device is often the integrated GPU or a software rasteriser.
+	The score orders by, most significant first:
+		Device type, discrete > integrated > virtual > other > CPU
+		Device local memory
+		Queue topology, a dedicated transfer family and an async compute family
+		Optional features and limits the library can use
+	Ties are broken by UUID so the same machine always picks the same device whatever order the driver enumerates them in.
+	*/
 	class PhysicalDevice {
 
 	public:
 
+		//A device that was considered during selection
+		struct Candidate {
+			VkPhysicalDevice device = VK_NULL_HANDLE;
+			//Position in vkEnumeratePhysicalDevices
+			uint32_t index = 0;
+
+			std::string name;
+			//32 hex digits, empty if the device does not report one (pre Vulkan 1.1)
+			std::string uuid;
+			VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+			uint32_t apiVersion = 0;
+			VkDeviceSize deviceLocalBytes = 0;
+
+			vgl::QueueFamilyIndices queueFamilyIndices;
+
+			std::shared_ptr<const vgl::DeviceCapabilities> capabilities;
+
+			//Whether the device meets the library's requirements, if not then rejectReason says why
+			bool suitable = false;
+			//Whether the device passes the filter
+			bool matchesFilter = true;
+			std::string rejectReason;
+
+			//Higher is better, only meaningful between suitable devices
+			uint64_t score = 0;
+		};
+
 		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 
 		//Store number of samples used for MSAA multisampling
 		//By default use a single sample per pixel (equivalent to no multisampling)
 		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
+		//Queue families found on the selected device
+		vgl::QueueFamilyIndices queueFamilyIndices;
+
 		PhysicalDevice() {};
-		PhysicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, std::shared_ptr<VkSurfaceKHR> _surface);
+		//_surface can be null (or hold VK_NULL_HANDLE) when running headless
+		//In that case no present queue or swap chain support is required from the device
+		//_filter narrows the devices that can be picked, the VGL_DEVICE environment variable overrides it
+		//_cacheDirectory is where device capabilities are persisted between runs, empty to query them every time
+		PhysicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, std::shared_ptr<VkSurfaceKHR> _surface,
+			const vgl::DeviceFilter& _filter = {}, const std::string& _cacheDirectory = "");
 
 		//Implicitly define copy constructors
 		PhysicalDevice(const PhysicalDevice&) = default;
-		vgl::PhysicalDevice& vgl::PhysicalDevice::operator=(vgl::PhysicalDevice& d) { return d; }
 
 		void setInstance(std::shared_ptr<const VkInstance> _instance);
 
 		void setSurface(std::shared_ptr<VkSurfaceKHR> _surface);
 
+		//Whether a surface was given, if not then the device was selected for headless use
+		bool hasSurface() const;
+
+		//Query the current surface support of the selected device
+		//Surface capabilities change when the window is resized so this is queried again whenever the swap chain is recreated
+		vgl::SwapChainSupportDetails querySwapChainSupport();
+
+		//Every device found, best first, suitable devices that match the filter come before the rest
+		//The selected device is the first entry
+		const std::vector<Candidate>& getRankedDevices() const;
+
+		//Filter that was used after applying the environment variable
+		const vgl::DeviceFilter& getFilter() const;
+
+		//Capability snapshot of the selected device, shared with the logical device and everything created from it
+		std::shared_ptr<const vgl::DeviceCapabilities> getCapabilities() const;
+
 	private:
 
 		//Vector to store all device extensions required
@@ -43,29 +108,29 @@ namespace vgl {
 		//Store the surface created by the window
 		std::shared_ptr<VkSurfaceKHR> surface;
 
+		vgl::DeviceFilter filter;
+
+		std::vector<Candidate> rankedDevices;
+
+		//Snapshot of the selected device
+		std::shared_ptr<const vgl::DeviceCapabilities> capabilities;
+
+		//Fill in a candidate's properties, suitability and score
+		Candidate evaluateDevice(std::shared_ptr<const vgl::DeviceCapabilities> _capabilities, uint32_t index);
+
+		//Whether the candidate passes the filter
+		bool matchesFilter(const Candidate& candidate) const;
+
+		//Replace the filter's name, uuid or index with the environment variable if it is set
+		static vgl::DeviceFilter applyEnvironment(vgl::DeviceFilter filter);
+
 		//Check whether a given physical device is suitable
-		//Based on certain parameters required in the function
-		bool isDeviceSuitable(const VkPhysicalDevice& device);
-
-		//Check if the device supports all required extensions
-		bool checkDeviceExtensionSupport(const VkPhysicalDevice& device);
-
-		/*
-		Anything from drawing to uploading textures, requires commands to be submitted to a queue.
-		There are different types of queues that originate from different queue families and each family of queues allows only a subset of commands.
-			For example;
-				There could be a queue family that only allows processing of compute commands
-				There could be one that only allows memory transfer related commands.
-		Need to check which queue families are supported by the device and which one of these supports the commands that are wanted to use.
-		*/
-		vgl::QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& device);
+		//Based on certain parameters required in the function, sets reason to why the device was rejected
+		bool isDeviceSuitable(const vgl::DeviceCapabilities& caps, const vgl::QueueFamilyIndices& indices, std::string& reason);
 
 		//Populate SwapChainSupportDetails struct
 		vgl::SwapChainSupportDetails querySwapChainSupport(const VkPhysicalDevice& device);
 
-		//Get maximum number of samples supported by the device
-		VkSampleCountFlagBits getMaxUsableSampleCount();
-
 	};
 
 
@@ -74,4 +139,4 @@ namespace vgl {
 
 
 
-#endif VGL_PHYSICALDEVICE_H
\ No newline at end of file
+#endif // !VGL_PHYSICALDEVICE_H
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef VGL_PIPELINECACHE_H
+#define VGL_PIPELINECACHE_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/DeviceCapabilities.h"
+
+namespace vgl {
+
+	/*
+	VkPipelineCache that persists across runs.
+	Compiling pipelines from SPIR-V is slow, with a warm cache the driver can skip most of the work.
+
+	The blob is stored in <directory>/pipeline_cache_<vendorID>_<deviceID>.bin behind a header holding the
+	vendorID, deviceID, driverVersion and pipelineCacheUUID it was created with plus a checksum of the data.
+	Blobs from a different driver, a different device, or that are truncated or corrupt are rejected and the cache starts empty.
+	Saving writes to a temporary file and renames it over the old one, so a crash mid-save never leaves a broken cache behind.
+
+	All functions are thread safe, vkCreate*Pipelines can be called with the same VkPipelineCache from multiple threads.
+	*/
+	class PipelineCache {
+
+	public:
+
+		struct Stats {
+			//Whether a valid blob was loaded from disk, i.e. this is a warm start
+			bool warm = false;
+			size_t loadedBytes = 0;
+			//Why the blob on disk was not used, empty if it was loaded or there was no file
+			std::string rejectReason;
+
+			double loadMs = 0.0;
+			double saveMs = 0.0;
+
+			//Pipelines created with the cache and the time spent in vkCreate*Pipelines for them
+			uint32_t pipelinesCreated = 0;
+			double totalCreateMs = 0.0;
+			double maxCreateMs = 0.0;
+		};
+
+		//Directory used by VulkanCore unless told otherwise, relative to the working directory
+		static constexpr const char* defaultDirectory = "vgl_cache";
+
+		//An empty _directory keeps the cache in memory only
+		PipelineCache(const vgl::DeviceCapabilities& _capabilities, VkDevice _device, const std::string& _directory);
+		//Saves the cache if anything was added to it
+		~PipelineCache();
+
+		//Owns the VkPipelineCache so can not be copied
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		VkPipelineCache getCache() const;
+
+		//Write the cache to disk, returns false if it could not be written
+		bool save();
+
+		//Record the time taken to create a pipeline with the cache
+		void recordCreation(double milliseconds);
+
+		Stats getStats() const;
+		const std::string& getPath() const;
+
+		//Log whether the start was cold or warm and the time spent creating pipelines
+		void printStats() const;
+
+	private:
+
+		//Written in front of the driver's blob
+		struct FileHeader {
+			uint32_t magic = 0;
+			uint32_t version = 0;
+			uint32_t vendorID = 0;
+			uint32_t deviceID = 0;
+			uint32_t driverVersion = 0;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE] = {};
+			uint64_t dataSize = 0;
+			uint64_t checksum = 0;
+		};
+
+		static constexpr uint32_t fileMagic = 0x50434756; //"VGCP"
+		static constexpr uint32_t fileVersion = 1;
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties properties{};
+
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		std::string path;
+
+		Stats stats;
+		mutable std::mutex mutex;
+
+		//Read and validate the blob on disk, returns an empty vector and sets rejectReason if it can't be used
+		std::vector<char> load();
+
+		//Check the data is a blob the driver will accept, returns an empty string if it is valid
+		std::string validate(const FileHeader& header, const std::vector<char>& data) const;
+
+	};
+
+}
+
+#endif // !VGL_PIPELINECACHE_H
@@ -0,0 +1,191 @@
+#ifndef VGL_PIPELINECOMPILER_H
+#define VGL_PIPELINECOMPILER_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/JobSystem.h"
+#include "vgl/PipelineCache.h"
+#include "vgl/ShaderCache.h"
+
+namespace vgl {
+
+	//Specialization constants for one shader stage, data holds the values the entries point into
+	struct PipelineSpecialization {
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<char> data;
+	};
+
+	struct ComputePipelineDesc {
+		std::vector<char> spirv;
+		//Module from the ShaderCache, used instead of spirv when set
+		//When setLayouts and pushConstantRanges are both empty they are built from its reflection
+		std::shared_ptr<const vgl::Shader> shader;
+		PipelineSpecialization specialization;
+
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+	};
+
+	struct GraphicsShaderStage {
+		VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+		std::vector<char> spirv;
+		//Module from the ShaderCache, used instead of spirv when set, the stage and entry point then come from its reflection
+		std::shared_ptr<const vgl::Shader> shader;
+		std::string entryPoint = "main";
+		PipelineSpecialization specialization;
+	};
+
+	//Fixed function state of a graphics pipeline, viewport and scissor are always dynamic
+	struct GraphicsPipelineDesc {
+		std::vector<GraphicsShaderStage> stages;
+
+		std::vector<VkVertexInputBindingDescription> vertexBindings;
+		std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+		VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+		bool depthTest = false;
+		bool depthWrite = false;
+		VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+
+		//Standard alpha blending on every colour attachment when enabled
+		bool blendEnable = false;
+
+		//With a render pass the formats are ignored, without one the pipeline is created for dynamic rendering
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		uint32_t subpass = 0;
+		std::vector<VkFormat> colorFormats;
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+		//Built from the reflection of the stages when both are empty and every stage has a shader from the ShaderCache
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+	};
+
+	/*
+	A pipeline that is being compiled on the job system.
+	The layout exists as soon as the handle is returned, so descriptor sets can be bound against it straight away.
+	The pipeline itself becomes available once the job finishes, until then the render loop should draw with a placeholder.
+	*/
+	class PipelineHandle {
+
+	public:
+
+		enum class State { Pending, Ready, Failed };
+
+		State getState() const;
+		bool isReady() const;
+		bool hasFailed() const;
+
+		//The compiled pipeline, or _placeholder if it isn't ready yet or failed to compile
+		VkPipeline get(VkPipeline _placeholder = VK_NULL_HANDLE) const;
+		VkPipelineLayout getLayout() const;
+		VkPipelineBindPoint getBindPoint() const;
+
+		//Bind the pipeline, or the placeholder's pipeline while this one isn't ready
+		//The placeholder must have been created with a compatible layout, returns false if neither could be bound
+		bool bind(VkCommandBuffer commandBuffer, const PipelineHandle* _placeholder = nullptr) const;
+
+		//Block until compilation has finished, whether or not it succeeded
+		void wait() const;
+
+		//Why compilation failed, only valid once hasFailed() returns true
+		const std::string& getError() const;
+
+		//Time spent in the job, only valid once the handle is no longer pending
+		double getCompileMs() const;
+
+	private:
+
+		friend class PipelineCompiler;
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+		//Written by the job before the state is published
+		std::atomic<State> state{ State::Pending };
+		std::string error;
+		double compileMs = 0.0;
+
+		std::shared_future<void> done;
+
+	};
+
+	/*
+	Compiles pipelines concurrently on the library's job system.
+	Each description is compiled by its own job with the device's pipeline cache, vkCreate*Pipelines is thread safe so the
+	driver compiles them in parallel across cores instead of one after another on the render thread.
+
+	Handles stay owned by the compiler, every pipeline is destroyed with it unless released earlier.
+	*/
+	class PipelineCompiler {
+
+	public:
+
+		//_dynamicRendering is whether the device has dynamicRendering enabled, needed for graphics pipelines without a render pass
+		//_shaderCache builds layouts for descriptions that only give shaders
+		PipelineCompiler(VkDevice _device, vgl::PipelineCache* _pipelineCache, vgl::ShaderCache* _shaderCache, vgl::JobSystem* _jobSystem, bool _dynamicRendering);
+		//Waits for pending jobs then destroys every pipeline
+		~PipelineCompiler();
+
+		//Owns Vulkan handles so can not be copied
+		PipelineCompiler(const PipelineCompiler&) = delete;
+		PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+		//Queue a pipeline for compilation and return immediately
+		//Throws if the pipeline layout can't be created, compile errors are reported through the handle
+		std::shared_ptr<vgl::PipelineHandle> compile(vgl::ComputePipelineDesc _desc);
+		std::shared_ptr<vgl::PipelineHandle> compile(vgl::GraphicsPipelineDesc _desc);
+
+		//Destroy a pipeline before the compiler is destroyed, waits for it to finish compiling first
+		//The pipeline must no longer be in use by the GPU
+		void release(const std::shared_ptr<vgl::PipelineHandle>& _handle);
+
+		//Block until every queued pipeline has finished compiling
+		void waitIdle();
+
+		//Number of pipelines still compiling
+		uint32_t getPendingCount() const;
+
+	private:
+
+		VkDevice device = VK_NULL_HANDLE;
+		vgl::PipelineCache* pipelineCache = nullptr;
+		vgl::ShaderCache* shaderCache = nullptr;
+		vgl::JobSystem* jobSystem = nullptr;
+		bool dynamicRendering = false;
+
+		std::vector<std::shared_ptr<vgl::PipelineHandle>> handles;
+		mutable std::mutex mutex;
+
+		//Create the layout now so it is usable before the pipeline is
+		std::shared_ptr<vgl::PipelineHandle> createHandle(VkPipelineBindPoint _bindPoint, const std::vector<VkDescriptorSetLayout>& _setLayouts,
+			const std::vector<VkPushConstantRange>& _pushConstantRanges);
+
+		//Run on a worker, returns the pipeline or throws
+		VkPipeline build(const vgl::ComputePipelineDesc& _desc, VkPipelineLayout _layout) const;
+		VkPipeline build(const vgl::GraphicsPipelineDesc& _desc, VkPipelineLayout _layout) const;
+
+		VkShaderModule createShaderModule(const std::vector<char>& _spirv) const;
+
+		//Queue the job that builds the pipeline and publishes the result to the handle
+		template <typename Desc>
+		void submit(const std::shared_ptr<vgl::PipelineHandle>& _handle, Desc _desc);
+
+	};
+
+}
+
+#endif // !VGL_PIPELINECOMPILER_H
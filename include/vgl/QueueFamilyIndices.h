@@ -10,8 +10,25 @@ namespace vgl {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
 
-        bool isComplete() {
-            return graphicsFamily.has_value() && presentFamily.has_value();
+        //Family without graphics support that can do transfers, so uploads run alongside rendering
+        //Empty if the device has no such family, transfers then go through the graphics queue
+        std::optional<uint32_t> transferFamily;
+
+        //Family with compute but no graphics support, so compute work can run alongside rasterisation
+        //Empty if the device has no such family, compute work then goes through the graphics queue
+        std::optional<uint32_t> computeFamily;
+
+        //Headless devices have no surface so a present queue is not required
+        bool isComplete(bool _requirePresent = true) const {
+            return graphicsFamily.has_value() && (presentFamily.has_value() || !_requirePresent);
+        }
+
+        bool hasDedicatedTransfer() const {
+            return transferFamily.has_value() && transferFamily != graphicsFamily;
+        }
+
+        bool hasDedicatedCompute() const {
+            return computeFamily.has_value() && computeFamily != graphicsFamily;
         }
     };
 
@@ -0,0 +1,188 @@
+#ifndef VGL_QUEUESCHEDULER_H
+#define VGL_QUEUESCHEDULER_H
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/QueueFamilyIndices.h"
+
+namespace vgl {
+
+	//Queues work can be submitted to, each has its own timeline even when the device aliases it to the graphics queue
+	enum class QueueType : uint32_t {
+		Graphics,
+		Compute,
+		Transfer
+	};
+
+	//A value on a queue's timeline, reached once everything submitted up to it has finished
+	//Value 0 is always reached, so a default point can be waited on without checking
+	struct QueuePoint {
+		vgl::QueueType queue = vgl::QueueType::Graphics;
+		uint64_t value = 0;
+	};
+
+	//A point a submission waits for before stage
+	struct QueueWait {
+		vgl::QueuePoint point;
+		VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	};
+
+	//A semaphore the scheduler doesn't own, binary semaphores ignore value
+	struct SemaphoreWait {
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		uint64_t value = 0;
+		VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	};
+
+	struct SemaphoreSignal {
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		uint64_t value = 0;
+		VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	};
+
+	struct QueueSubmission {
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<vgl::QueueWait> waits;
+		//e.g. a swap chain image being acquired, waits on the scheduler's own semaphores are turned into QueueWaits
+		std::vector<vgl::SemaphoreWait> semaphoreWaits;
+		//e.g. rendering finishing before a present
+		std::vector<vgl::SemaphoreSignal> semaphoreSignals;
+		//Stages that have to finish before the submission's point is reached
+		VkPipelineStageFlags2 signalStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	};
+
+	/*
+	Submits work to the graphics, compute and transfer queues and tracks it with one timeline semaphore per queue.
+	Every submission is given the next value of its queue's timeline, returned as a QueuePoint, which other submissions can wait on
+	at a pipeline stage and the CPU can poll or wait for. This replaces a fence per submit, so the CPU can run as far ahead as the
+	resources it recycles allow and only blocks on the exact point it needs.
+
+	Submissions are batched per queue and reach the GPU in one vkQueueSubmit2 per queue when flushed (FrameRenderer flushes at the
+	end of every frame), or when the CPU waits on one of them. Flushing a queue first submits whatever it depends on from the others,
+	splitting the batch where needed, so a batch never waits on work that hasn't been submitted yet.
+	Without synchronization2 the batches go through vkQueueSubmit with VkTimelineSemaphoreSubmitInfo instead.
+
+	Thread safe. Code submitting to or presenting on a VkQueue directly has to hold getQueueMutex for it, since queues are
+	aliased when the device has no dedicated compute or transfer family.
+	*/
+	class QueueScheduler {
+
+	public:
+
+		struct Stats {
+			uint64_t submissions = 0;
+			//vkQueueSubmit2 calls the submissions were batched into
+			uint64_t batches = 0;
+			//Times the CPU blocked in wait
+			uint64_t cpuWaits = 0;
+			double cpuWaitMs = 0.0;
+		};
+
+		static constexpr uint32_t queueTypeCount = 3;
+
+		//presentQueue can be VK_NULL_HANDLE when headless, it is only used to share the queue mutexes
+		QueueScheduler(VkDevice _device, const vgl::QueueFamilyIndices& _indices, VkQueue _graphicsQueue, VkQueue _computeQueue, VkQueue _transferQueue,
+			VkQueue _presentQueue, bool _synchronization2);
+		//Flushes and waits for everything submitted
+		~QueueScheduler();
+
+		//Owns Vulkan handles so can not be copied
+		QueueScheduler(const QueueScheduler&) = delete;
+		QueueScheduler& operator=(const QueueScheduler&) = delete;
+
+		//Queue a submission, it reaches the GPU at the next flush of its queue
+		//Throws if it waits on a point that hasn't been handed out yet
+		vgl::QueuePoint submit(vgl::QueueType queue, const vgl::QueueSubmission& submission);
+		vgl::QueuePoint submit(vgl::QueueType queue, VkCommandBuffer commandBuffer, const std::vector<vgl::QueueWait>& waits = {});
+
+		//Submit everything queued, for one queue or all of them
+		void flush(vgl::QueueType queue);
+		void flush();
+
+		//Doesn't flush, a point that is still queued is not complete
+		bool isComplete(const vgl::QueuePoint& point) const;
+
+		//Flush what the points need and block until all of them are reached
+		//Returns false if timeoutNs passed first
+		bool wait(const vgl::QueuePoint& point, uint64_t timeoutNs = UINT64_MAX);
+		bool wait(const std::vector<vgl::QueuePoint>& points, uint64_t timeoutNs = UINT64_MAX);
+
+		//Flush and wait for everything submitted to every queue
+		void waitIdle();
+
+		//Flush, then vkDeviceWaitIdle with every queue mutex held, so work submitted outside the scheduler (e.g. UploadEngine) is
+		//waited for too and no other thread can submit during the wait, which Vulkan requires
+		void deviceWaitIdle();
+
+		//Highest value the GPU has reached on the queue's timeline
+		uint64_t getCompletedValue(vgl::QueueType queue) const;
+		//Point of the most recent submission to the queue, flushed or not
+		vgl::QueuePoint getLastPoint(vgl::QueueType queue) const;
+
+		//Timeline semaphore of the queue, for waits in submits the scheduler doesn't make
+		VkSemaphore getSemaphore(vgl::QueueType queue) const;
+		VkQueue getQueue(vgl::QueueType queue) const;
+		uint32_t getQueueFamily(vgl::QueueType queue) const;
+
+		//Has to be held around any vkQueueSubmit or vkQueuePresentKHR on queue made outside the scheduler
+		//Queues that are aliased share a mutex
+		std::mutex& getQueueMutex(VkQueue queue);
+
+		Stats getStats() const;
+
+		//Log how well submissions were batched and how long the CPU waited on the GPU
+		void printStats() const;
+
+	private:
+
+		//A submission waiting for its queue to be flushed, with its semaphores already resolved
+		struct Pending {
+			uint64_t value = 0;
+			std::vector<VkCommandBufferSubmitInfo> commandBuffers;
+			std::vector<VkSemaphoreSubmitInfo> waits;
+			std::vector<VkSemaphoreSubmitInfo> signals;
+			//Points on other queues that have to be submitted before this one
+			std::vector<vgl::QueuePoint> dependencies;
+		};
+
+		struct Lane {
+			VkQueue queue = VK_NULL_HANDLE;
+			uint32_t family = 0;
+			VkSemaphore timeline = VK_NULL_HANDLE;
+			std::mutex* queueMutex = nullptr;
+			//Last value handed out and last value submitted to the GPU
+			uint64_t assignedValue = 0;
+			uint64_t submittedValue = 0;
+			std::deque<Pending> pending;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		bool synchronization2 = false;
+
+		std::array<Lane, queueTypeCount> lanes;
+
+		//One per distinct VkQueue, built by the constructor and not changed after
+		std::vector<std::pair<VkQueue, std::unique_ptr<std::mutex>>> queueMutexes;
+
+		//Guards the lanes and stats, taken before a queue mutex
+		mutable std::mutex mutex;
+
+		Stats stats;
+
+		//Submit the lane's queued work up to and including value, dependencies first, caller holds mutex
+		void flushLane(uint32_t lane, uint64_t value);
+		void submitBatch(uint32_t lane, std::vector<Pending>& batch);
+		//vkQueueSubmit fallback when synchronization2 isn't enabled
+		VkResult submitLegacy(VkQueue queue, const std::vector<Pending>& batch);
+
+	};
+
+}
+
+#endif // !VGL_QUEUESCHEDULER_H
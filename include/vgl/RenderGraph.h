@@ -0,0 +1,248 @@
+#ifndef VGL_RENDERGRAPH_H
+#define VGL_RENDERGRAPH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/FrameRenderer.h"
+#include "vgl/RenderGraphSolver.h"
+
+namespace vgl {
+
+	//Handle to a resource declared in a RenderGraph, only valid until the graph is reset
+	struct RenderGraphResource {
+		uint32_t index = vgl::RenderGraphSolver::invalidIndex;
+
+		bool isValid() const { return index != vgl::RenderGraphSolver::invalidIndex; }
+	};
+
+	/*
+	Declarative frame graph.
+	Every frame the graph is reset, resources and passes are declared, then it is executed into the frame's command buffer.
+	Passes declare what they read and write instead of recording barriers, RenderGraphSolver works out the order, drops passes
+	whose results are never used, places barriers and lets transient resources whose lifetimes don't overlap share memory.
+
+	Transient images and buffers only exist for the duration of the graph and start each frame with undefined contents.
+	Their memory is kept across frames and only reallocated when the declared resources change.
+	Imported resources (e.g. the frame's colour target) are owned elsewhere and are left in the state given when importing.
+	*/
+	class RenderGraph {
+
+	public:
+
+		struct TextureDesc {
+			VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+			VkExtent2D extent{};
+			uint32_t mipLevels = 1;
+			VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+			//Added to the usage worked out from how passes use the image
+			VkImageUsageFlags extraUsage = 0;
+		};
+
+		struct BufferDesc {
+			VkDeviceSize size = 0;
+			//Added to the usage worked out from how passes use the buffer
+			VkBufferUsageFlags extraUsage = 0;
+		};
+
+		//State an imported image is in before the graph and has to be left in afterwards
+		struct ImportedImage {
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent{};
+
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkAccessFlags initialAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+
+			//VK_IMAGE_LAYOUT_UNDEFINED leaves the image in whatever layout the last pass used
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags finalStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkAccessFlags finalAccess = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		};
+
+		//Given to a pass's setup function to declare what it uses
+		class PassBuilder {
+
+		public:
+
+			void read(vgl::RenderGraphResource resource, vgl::RenderGraphAccess access);
+			void write(vgl::RenderGraphResource resource, vgl::RenderGraphAccess access);
+
+			//Keep the pass even if nothing reads what it writes, e.g. it writes to the host or another queue
+			void setSideEffects();
+
+		private:
+
+			friend class RenderGraph;
+
+			PassBuilder(RenderGraph* _graph, uint32_t _pass);
+
+			RenderGraph* graph = nullptr;
+			uint32_t pass = 0;
+
+		};
+
+		//Given to a pass's execute function while it is recorded
+		class PassContext {
+
+		public:
+
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+			VkImage getImage(vgl::RenderGraphResource resource) const;
+			VkImageView getImageView(vgl::RenderGraphResource resource) const;
+			VkExtent2D getExtent(vgl::RenderGraphResource resource) const;
+			VkBuffer getBuffer(vgl::RenderGraphResource resource) const;
+
+		private:
+
+			friend class RenderGraph;
+
+			const RenderGraph* graph = nullptr;
+
+		};
+
+		using SetupFunction = std::function<void(PassBuilder&)>;
+		using ExecuteFunction = std::function<void(PassContext&)>;
+
+		struct Stats {
+			uint32_t passes = 0;
+			uint32_t culledPasses = 0;
+			uint32_t barriers = 0;
+			//Memory the transient resources would need without aliasing, and what is actually allocated
+			VkDeviceSize transientBytes = 0;
+			VkDeviceSize allocatedBytes = 0;
+			//Times the transient resources had to be recreated because the declared resources changed
+			uint32_t reallocations = 0;
+		};
+
+		//_framesInFlight is how long replaced transient resources are kept before being destroyed
+		RenderGraph(vgl::LogicalDevice* _logicalDevice, uint32_t _framesInFlight);
+		~RenderGraph();
+
+		//Owns Vulkan handles so can not be copied
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		//Destroy transient resources that were replaced long enough ago that the GPU is done with them
+		//Must be called once per frame after the frame's fence has signalled
+		void beginFrame();
+
+		//Forget every resource and pass declared, transient memory is kept for the next declaration
+		void reset();
+
+		vgl::RenderGraphResource createTexture(const std::string& name, const TextureDesc& desc);
+		vgl::RenderGraphResource createBuffer(const std::string& name, const BufferDesc& desc);
+		vgl::RenderGraphResource importImage(const std::string& name, const ImportedImage& image);
+		//Imported buffers are assumed to have been written by anything before the graph and read by anything after it
+		vgl::RenderGraphResource importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size);
+
+		//Import the image a FrameRenderer frame renders to, it is handed back in the state FrameRenderer expects
+		vgl::RenderGraphResource importFrame(const vgl::FrameContext& frame);
+
+		//Keep every pass contributing to the resource, imported images that are presented or read back should be outputs
+		void markOutput(vgl::RenderGraphResource resource);
+
+		void addPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+		//Solve the graph and create any transient resources that are missing, execute does this if it hasn't been done
+		void compile();
+
+		//Record every pass that wasn't culled with its barriers
+		void execute(VkCommandBuffer commandBuffer);
+
+		const vgl::RenderGraphSolver::Result& getSolution() const;
+		const Stats& getStats() const;
+
+		//Names of the passes in the order they were recorded
+		std::vector<std::string> getExecutionOrder() const;
+
+	private:
+
+		struct ResourceEntry {
+			std::string name;
+			bool image = true;
+			bool imported = false;
+			bool output = false;
+
+			TextureDesc texture;
+			BufferDesc buffer;
+			ImportedImage importedImage;
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+			//Usage worked out from the passes
+			VkImageUsageFlags imageUsage = 0;
+			VkBufferUsageFlags bufferUsage = 0;
+
+			VkImage vkImage = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer vkBuffer = VK_NULL_HANDLE;
+			VkDeviceSize bufferSize = 0;
+		};
+
+		struct PassEntry {
+			std::string name;
+			vgl::RenderGraphSolver::Pass pass;
+			ExecuteFunction execute;
+		};
+
+		//Transient resources created for a particular set of declarations, kept until the declarations change
+		struct Physical {
+			std::vector<VkImage> images;
+			std::vector<VkImageView> views;
+			std::vector<VkBuffer> buffers;
+			std::vector<vgl::MemoryAllocation> heaps;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		uint32_t framesInFlight = 0;
+
+		std::vector<ResourceEntry> resources;
+		std::vector<PassEntry> passes;
+
+		bool compiled = false;
+		vgl::RenderGraphSolver::Result solution;
+
+		//Declarations the memory requirements were last queried for, and the requirements in resource order
+		std::vector<uint64_t> requirementsKey;
+		std::vector<VkMemoryRequirements> requirements;
+
+		//Key describing the transient resources and their placement, physical resources are reused while it stays the same
+		std::vector<uint64_t> physicalKey;
+		Physical physical;
+		//Resource index to its slot in physical.images/views or physical.buffers
+		std::vector<uint32_t> physicalSlots;
+
+		//Physical resources that were replaced and the frame they were replaced in
+		std::vector<std::pair<uint64_t, Physical>> retired;
+		uint64_t frameNumber = 0;
+
+		Stats stats;
+
+		vgl::RenderGraphResource addResource(ResourceEntry entry);
+		void addUse(uint32_t pass, vgl::RenderGraphResource resource, vgl::RenderGraphAccess access);
+
+		//Create the transient resources for the current declarations, returns their memory requirements in resource order
+		std::vector<VkMemoryRequirements> createTransients(Physical& target, std::vector<uint32_t>& slots);
+		void bindTransients(Physical& target, const std::vector<uint32_t>& slots);
+		void destroyPhysical(Physical& target);
+
+		std::vector<uint64_t> buildKey() const;
+
+		void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<vgl::RenderGraphSolver::Barrier>& barriers) const;
+
+		static VkImageUsageFlags imageUsageFor(vgl::RenderGraphAccess access);
+		static VkBufferUsageFlags bufferUsageFor(vgl::RenderGraphAccess access);
+		static VkImageAspectFlags aspectFor(VkFormat format);
+
+	};
+
+}
+
+#endif // !VGL_RENDERGRAPH_H
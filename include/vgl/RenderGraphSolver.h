@@ -0,0 +1,158 @@
+#ifndef VGL_RENDERGRAPHSOLVER_H
+#define VGL_RENDERGRAPHSOLVER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+namespace vgl {
+
+	//How a render graph pass uses a resource
+	enum class RenderGraphAccess {
+		ColorAttachmentWrite,
+		//Read and write, e.g. blending onto existing contents
+		ColorAttachmentReadWrite,
+		DepthAttachmentWrite,
+		//Depth testing without writes
+		DepthAttachmentRead,
+		FragmentSampled,
+		ComputeSampled,
+		ComputeStorageRead,
+		ComputeStorageWrite,
+		TransferSrc,
+		TransferDst,
+		VertexBuffer,
+		IndexBuffer,
+		IndirectBuffer,
+		UniformBuffer,
+	};
+
+	/*
+	Scheduling, barrier placement and memory aliasing for a render graph.
+	Works purely on the declared resources and passes without touching a device, so it can be run and checked on the CPU alone.
+
+	solve does four things:
+		Culls passes whose writes are never read by a pass that is kept, by an output resource or by a pass with side effects
+		Orders the remaining passes topologically, picking the pass that consumes the most recent output first to keep transient lifetimes short
+		Places transient resources in shared heaps, resources whose lifetimes don't overlap share memory
+		Computes the barriers needed before each pass, only where there is a hazard or a layout change, merged into one batch per pass
+	*/
+	class RenderGraphSolver {
+
+	public:
+
+		static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+		struct Resource {
+			bool image = true;
+
+			//Imported resources are owned outside the graph and are never aliased
+			bool imported = false;
+			//Contents are used after the graph, passes writing it are never culled
+			bool output = false;
+
+			//Imported only, state the resource is in when the graph starts
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkAccessFlags initialAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+
+			//Imported only, state the resource has to be left in, VK_IMAGE_LAYOUT_UNDEFINED leaves the layout as the graph left it
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags finalStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkAccessFlags finalAccess = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+			//Transient only, the memory the resource needs
+			VkMemoryRequirements requirements{};
+		};
+
+		struct Use {
+			uint32_t resource = invalidIndex;
+			RenderGraphAccess access = RenderGraphAccess::FragmentSampled;
+		};
+
+		struct Pass {
+			std::vector<Use> uses;
+			//Passes with side effects are never culled and keep their order relative to each other
+			bool sideEffects = false;
+		};
+
+		//Stage, access and layout a RenderGraphAccess maps to
+		struct AccessInfo {
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags access = 0;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool write = false;
+		};
+
+		//Layouts are VK_IMAGE_LAYOUT_UNDEFINED for buffers
+		struct Barrier {
+			uint32_t resource = invalidIndex;
+			VkPipelineStageFlags srcStages = 0;
+			VkAccessFlags srcAccess = 0;
+			VkPipelineStageFlags dstStages = 0;
+			VkAccessFlags dstAccess = 0;
+			VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		};
+
+		//Block of memory shared by transient resources, images and buffers never share a heap
+		struct Heap {
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			uint32_t memoryTypeBits = 0;
+			bool image = true;
+		};
+
+		struct Placement {
+			uint32_t heap = invalidIndex;
+			VkDeviceSize offset = 0;
+		};
+
+		struct Result {
+			//Indices of the passes to run, in order, culled passes are left out
+			std::vector<uint32_t> order;
+			//Barriers to record before each pass in order
+			std::vector<std::vector<Barrier>> barriers;
+			//Barriers to record after the last pass to leave imported resources in their final state
+			std::vector<Barrier> finalBarriers;
+
+			//Per resource, positions in order of the first and last pass using it, invalidIndex if nothing uses it
+			std::vector<uint32_t> firstUse;
+			std::vector<uint32_t> lastUse;
+
+			//Per resource, where transient resources live, heap is invalidIndex for imported or unused resources
+			std::vector<Placement> placements;
+			std::vector<Heap> heaps;
+
+			uint32_t culledPasses = 0;
+			uint32_t barrierCount = 0;
+			//Memory the transient resources would need without aliasing, and what they need with it
+			VkDeviceSize transientBytes = 0;
+			VkDeviceSize heapBytes = 0;
+		};
+
+		//Throws if the passes can not be ordered
+		static Result solve(const std::vector<Resource>& resources, const std::vector<Pass>& passes);
+
+		static AccessInfo getAccessInfo(RenderGraphAccess access);
+
+	private:
+
+		//Which passes are needed, walking backwards from outputs and side effects
+		static std::vector<bool> cull(const std::vector<Resource>& resources, const std::vector<Pass>& passes);
+
+		//Topological order of the needed passes
+		static std::vector<uint32_t> schedule(const std::vector<Resource>& resources, const std::vector<Pass>& passes, const std::vector<bool>& needed);
+
+		static void placeTransients(const std::vector<Resource>& resources, Result& result);
+
+		static void placeBarriers(const std::vector<Resource>& resources, const std::vector<Pass>& passes, Result& result);
+
+		static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment);
+
+	};
+
+}
+
+#endif // !VGL_RENDERGRAPHSOLVER_H
@@ -0,0 +1,181 @@
+#ifndef VGL_SHADERCACHE_H
+#define VGL_SHADERCACHE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/ShaderReflection.h"
+
+namespace vgl {
+
+	//A shader module owned by the ShaderCache, shared by everything that loaded the same SPIR-V
+	class Shader {
+
+	public:
+
+		VkShaderModule getModule() const;
+		const vgl::ShaderReflection& getReflection() const;
+		VkShaderStageFlagBits getStage() const;
+
+		//Hash of the SPIR-V, identical code always has the same hash
+		uint64_t getHash() const;
+		//Path or name the code was first loaded with
+		const std::string& getName() const;
+
+	private:
+
+		friend class ShaderCache;
+
+		VkShaderModule module = VK_NULL_HANDLE;
+		vgl::ShaderReflection reflection;
+		uint64_t hash = 0;
+		size_t codeSize = 0;
+		std::string name;
+
+	};
+
+	//Layouts built from the reflection of the shaders in one pipeline
+	struct ShaderLayout {
+		//One per set up to the highest set used, sets in between that no shader uses are empty
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+
+		//Bindings of every stage merged, sorted by set then binding
+		std::vector<vgl::ShaderBinding> bindings;
+	};
+
+	/*
+	Loads SPIR-V and hands out one VkShaderModule per unique module.
+	Files are memory mapped and hashed, loading code that is already in the cache (from any path) returns the existing module,
+	so pipelines that share shaders don't each create their own.
+
+	Every module is reflected for its descriptors and push constants, and getLayout builds descriptor set layouts and a
+	pipeline layout from them. Layouts are shared between every set of shaders with the same interface.
+	Reflection results are persisted in <directory>/shader_reflection.bin keyed by the hash of the code, so later runs
+	only hash the SPIR-V instead of parsing it. The file uses the same header, checksum and atomic save as the PipelineCache.
+
+	Modules, set layouts and pipeline layouts are owned by the cache and destroyed with it. All functions are thread safe.
+	*/
+	class ShaderCache {
+
+	public:
+
+		struct Stats {
+			//Whether a valid reflection cache was loaded from disk
+			bool warm = false;
+			uint32_t loadedEntries = 0;
+			//Why the file on disk was not used, empty if it was loaded or there was no file
+			std::string rejectReason;
+			double loadMs = 0.0;
+
+			uint32_t modulesCreated = 0;
+			//Loads that returned a module that already existed
+			uint32_t deduplicated = 0;
+
+			uint32_t reflectionsParsed = 0;
+			uint32_t reflectionCacheHits = 0;
+			double hashMs = 0.0;
+			double reflectMs = 0.0;
+
+			uint32_t setLayoutsCreated = 0;
+			uint32_t pipelineLayoutsCreated = 0;
+		};
+
+		static constexpr const char* fileName = "shader_reflection.bin";
+		//Most reflections kept in the file, the ones used least recently are dropped first
+		static constexpr uint32_t maxFileEntries = 4096;
+
+		//An empty _directory keeps reflections in memory only
+		ShaderCache(VkDevice _device, const std::string& _directory);
+		//Saves the reflection cache if anything was added to it
+		~ShaderCache();
+
+		//Owns Vulkan handles so can not be copied
+		ShaderCache(const ShaderCache&) = delete;
+		ShaderCache& operator=(const ShaderCache&) = delete;
+
+		//Map a compiled SPIR-V file, throws if it can't be read or isn't valid SPIR-V
+		std::shared_ptr<const vgl::Shader> load(const std::string& _path);
+		//Same for code already in memory, _name is only used for messages
+		std::shared_ptr<const vgl::Shader> create(const void* _code, size_t _size, const std::string& _name);
+
+		//Set layouts and pipeline layout for the shaders of one pipeline, stages that use the same binding are merged
+		//Throws if stages disagree on a binding or a binding is a runtime sized array, those need an explicit set layout
+		const vgl::ShaderLayout& getLayout(const std::vector<std::shared_ptr<const vgl::Shader>>& _shaders);
+
+		//Destroy the modules nothing outside the cache holds any more, returns how many were destroyed
+		//Pipelines don't need their modules once they are created
+		uint32_t trim();
+
+		//Write the reflection cache to disk, returns false if it could not be written
+		bool save();
+
+		Stats getStats() const;
+		const std::string& getPath() const;
+
+		//Log whether reflections came from disk and how many modules were shared
+		void printStats() const;
+
+		//64 bit hash of SPIR-V, a word at a time
+		static uint64_t hash(const void* data, size_t size);
+
+	private:
+
+		//Written in front of the serialised reflections
+		struct FileHeader {
+			uint32_t magic = 0;
+			uint32_t version = 0;
+			uint32_t entryCount = 0;
+			uint32_t padding = 0;
+			uint64_t dataSize = 0;
+			uint64_t checksum = 0;
+		};
+
+		struct CachedReflection {
+			size_t codeSize = 0;
+			vgl::ShaderReflection reflection;
+			//Bumped every time the reflection is used, the most recent are kept when the file is full
+			uint64_t lastUsed = 0;
+		};
+
+		static constexpr uint32_t fileMagic = 0x52534756; //"VGSR"
+		static constexpr uint32_t fileVersion = 2;
+
+		VkDevice device = VK_NULL_HANDLE;
+		std::string path;
+
+		std::unordered_map<uint64_t, std::shared_ptr<vgl::Shader>> shaders;
+		std::unordered_map<uint64_t, CachedReflection> reflections;
+		uint64_t useCounter = 0;
+		bool dirty = false;
+
+		//Keyed by the bindings they were built from
+		std::unordered_map<std::string, VkDescriptorSetLayout> setLayouts;
+		std::unordered_map<std::string, std::unique_ptr<vgl::ShaderLayout>> layouts;
+
+		Stats stats;
+		mutable std::mutex mutex;
+
+		//Read the reflection cache, sets rejectReason if it can't be used
+		void load();
+
+		//Reflection for the code, from the cache when it has been seen before
+		vgl::ShaderReflection reflect(const uint32_t* code, size_t size, uint64_t codeHash);
+
+		VkDescriptorSetLayout getSetLayout(const std::vector<vgl::ShaderBinding>& bindings);
+
+		static std::vector<char> serialise(uint64_t codeHash, const CachedReflection& cached);
+		//Reads one entry and moves _offset past it, returns false if the data runs out
+		static bool deserialise(const uint8_t* data, size_t size, size_t& offset, uint64_t& codeHash, CachedReflection& cached);
+
+	};
+
+}
+
+#endif // !VGL_SHADERCACHE_H
@@ -0,0 +1,46 @@
+#ifndef VGL_SHADERREFLECTION_H
+#define VGL_SHADERREFLECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+namespace vgl {
+
+	//One descriptor binding a shader declares
+	struct ShaderBinding {
+		uint32_t set = 0;
+		uint32_t binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		//Product of the array dimensions, 0 for a runtime sized array
+		uint32_t count = 1;
+		VkShaderStageFlags stages = 0;
+	};
+
+	/*
+	Interface of a SPIR-V module read straight from its instructions: the entry point, the descriptors it uses and its push constant block.
+	Only what is needed to build pipeline layouts is read, so a module is parsed in a single pass without any external tools.
+	*/
+	struct ShaderReflection {
+		VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+		std::string entryPoint = "main";
+		//Workgroup size of compute shaders, 0 when set with specialization constants or not a compute shader
+		uint32_t localSize[3] = { 0, 0, 0 };
+
+		//Sorted by set then binding
+		std::vector<vgl::ShaderBinding> bindings;
+
+		//Byte range of the push constant block, a size of 0 when the shader has none
+		uint32_t pushConstantOffset = 0;
+		uint32_t pushConstantSize = 0;
+
+		//Throws if the code isn't valid SPIR-V or declares something that can't be reflected
+		static vgl::ShaderReflection reflect(const uint32_t* code, size_t wordCount);
+	};
+
+}
+
+#endif // !VGL_SHADERREFLECTION_H
@@ -0,0 +1,72 @@
+#ifndef VGL_SWAPCHAIN_H
+#define VGL_SWAPCHAIN_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/PhysicalDevice.h"
+#include "vgl/SwapChainSupportDetails.h"
+
+namespace vgl {
+
+	/*
+	The swap chain is a queue of images that are waiting to be presented to the screen.
+	Images are acquired from it, drawn to and then returned to it to be presented.
+	It is built from the formats, present modes and capabilities queried into SwapChainSupportDetails.
+	*/
+	class SwapChain {
+
+	public:
+
+		VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+
+		std::vector<VkImage> images;
+		std::vector<VkImageView> imageViews;
+
+		VkFormat imageFormat = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+		//_framebufferExtent is the size of the window in pixels, only used if the surface lets the swap chain pick its own size
+		//_preferredPresentMode is used if supported, otherwise falls back to FIFO which is always available
+		SwapChain(vgl::PhysicalDevice* _physicalDevice, VkDevice _device, VkSurfaceKHR _surface, VkExtent2D _framebufferExtent,
+			VkPresentModeKHR _preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR);
+		~SwapChain();
+
+		//Owns Vulkan handles so can not be copied
+		SwapChain(const SwapChain&) = delete;
+		SwapChain& operator=(const SwapChain&) = delete;
+
+		//Rebuild the swap chain for a new framebuffer size
+		//The caller has to make sure none of the old images are still in use by the GPU
+		void recreate(VkExtent2D _framebufferExtent);
+
+	private:
+
+		vgl::PhysicalDevice* physicalDevice = nullptr;
+		VkDevice device = VK_NULL_HANDLE;
+		VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+		VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+		void create(VkExtent2D _framebufferExtent, VkSwapchainKHR oldSwapChain);
+		void createImageViews();
+		void destroyImageViews();
+
+		//Prefer 8 bit BGRA in the SRGB colour space, otherwise use the first format available
+		VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
+
+		//Use the preferred present mode if available, FIFO is guaranteed to be available
+		VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+
+		//Resolution of the swap chain images, almost always the resolution of the window
+		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, VkExtent2D _framebufferExtent);
+
+	};
+
+}
+
+#endif // !VGL_SWAPCHAIN_H
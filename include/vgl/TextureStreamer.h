@@ -0,0 +1,241 @@
+#ifndef VGL_TEXTURESTREAMER_H
+#define VGL_TEXTURESTREAMER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+#include "vgl/UploadEngine.h"
+#include "vgl/BindlessHeap.h"
+#include "vgl/MappedFile.h"
+
+namespace vgl {
+
+	//Identifies a texture loaded into a TextureStreamer
+	using StreamedTexture = uint32_t;
+
+	struct TextureStreamerSettings {
+		//Most device memory the streamed textures may use, 0 to only be limited by the device's budget
+		VkDeviceSize memoryCap = 0;
+		//Share of the device local budget left over by everything else that textures may use
+		double budgetFraction = 0.9;
+		//Bytes uploaded per frame when raising residency, so a new area loading spreads over several frames instead of stalling one
+		//At least one level is always started per frame
+		VkDeviceSize uploadBytesPerFrame = 16ull * 1024 * 1024;
+		//Levels this size or smaller make up the mip tail, which is uploaded first and never evicted
+		VkDeviceSize mipTailBytes = 64ull * 1024;
+	};
+
+	/*
+	Streams mip levels of textures into device memory progressively while keeping the textures within a memory budget.
+
+	Textures are read from KTX2 files (uncompressed or block compressed, 2D, one layer and face, no supercompression).
+	Files are memory mapped and only the header is read by load, the level data is read from disk by a job on the
+	job system, coarsest level first, so the thread loading a new area never waits on the disk.
+
+	Each update the mip tail of a new texture is uploaded, then textures gain one finer level at a time, most recently used first.
+	A level that doesn't fit in the budget is made room for by dropping the finest level of textures used less recently (LRU),
+	and if the budget shrinks below what is resident the least recently used textures drop levels until they fit again.
+	The mip tail is never evicted, so every loaded texture can always be sampled at some resolution.
+	The budget is the smaller of the configured cap and the share of the device local heaps' budget (VK_EXT_memory_budget,
+	or an estimate without it) that isn't used by anything else.
+
+	Changing residency creates a new image with the new level range and uploads it through the UploadEngine,
+	the old image keeps being used until the new one is ready and is destroyed once no frame in flight can read it.
+	The view, and the bindless handle if there is a heap, change whenever that happens so they must be fetched every frame.
+
+	All functions are thread safe, update must be called once per frame after the frame's fence has signalled.
+	*/
+	class TextureStreamer {
+
+	public:
+
+		struct Stats {
+			uint32_t textureCount = 0;
+			//Textures with every level they asked for resident
+			uint32_t fullyResident = 0;
+
+			//Device memory used by the textures' images, including ones waiting for their upload
+			VkDeviceSize residentBytes = 0;
+			VkDeviceSize budgetBytes = 0;
+			//Whether the budget came from VK_EXT_memory_budget
+			bool deviceBudget = false;
+
+			uint64_t levelsRaised = 0;
+			uint64_t levelsEvicted = 0;
+			VkDeviceSize bytesUploaded = 0;
+
+			//Times a texture could not gain a level because of the budget, the upload limit or its data not being read yet
+			uint64_t deferredForBudget = 0;
+			uint64_t deferredForBandwidth = 0;
+			uint64_t deferredForDisk = 0;
+		};
+
+		static constexpr vgl::StreamedTexture invalidTexture = UINT32_MAX;
+
+		//_bindlessHeap can be nullptr, otherwise every resident texture is added to it
+		//_framesInFlight is how many frames replaced images are kept alive for
+		TextureStreamer(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, vgl::BindlessHeap* _bindlessHeap, uint32_t _framesInFlight,
+			const vgl::TextureStreamerSettings& _settings = {});
+		//The GPU must be idle, waits for uploads that haven't finished
+		~TextureStreamer();
+
+		//Owns Vulkan handles so can not be copied
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		//Map a KTX2 file and start reading it in the background, nothing is resident until a later update
+		//Throws if the file can't be mapped, isn't a KTX2 file that can be streamed or its format can't be sampled on the device
+		vgl::StreamedTexture load(const std::string& _path);
+		//The texture's images are destroyed once no frame in flight can use them
+		void release(vgl::StreamedTexture texture);
+
+		//Mark the texture as used this frame, used textures gain levels first and are evicted last
+		//_finestLevel is the finest level worth having resident, e.g. from the texture's screen size
+		void markUsed(vgl::StreamedTexture texture, uint32_t _finestLevel = 0);
+
+		//Finish residency changes whose uploads are done, evict levels if over budget and start new uploads if under
+		void update();
+
+		//View of the resident levels, VK_NULL_HANDLE until the mip tail is resident
+		VkImageView getView(vgl::StreamedTexture texture) const;
+		//Handle in the bindless heap, BindlessHeap::invalidHandle until the mip tail is resident or when there is no heap
+		uint32_t getBindlessHandle(vgl::StreamedTexture texture) const;
+		//Finest level that is resident as a level of the file, getLevelCount when nothing is resident
+		//Level 0 of the view is this level
+		uint32_t getResidentLevel(vgl::StreamedTexture texture) const;
+		uint32_t getLevelCount(vgl::StreamedTexture texture) const;
+
+		void setSettings(const vgl::TextureStreamerSettings& _settings);
+		vgl::TextureStreamerSettings getSettings() const;
+
+		Stats getStats() const;
+
+		//Log residency, budget and how often streaming had to wait
+		void printStats() const;
+
+	private:
+
+		//Where a level is in the file and its size once uploaded
+		struct Level {
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			VkExtent3D extent{ 1, 1, 1 };
+		};
+
+		//Shared with the job reading the file, so it stays mapped if the texture is released while a read is running
+		struct Source {
+			vgl::MappedFile file;
+			//Finest level whose data has been read from disk, the level count until anything has been read
+			std::atomic<uint32_t> readLevel{ 0 };
+			std::atomic<bool> reading{ false };
+		};
+
+		//An image holding a range of levels, from baseLevel to the coarsest
+		struct Residency {
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			vgl::MemoryAllocation allocation;
+			uint32_t baseLevel = 0;
+			//Last upload into the image
+			vgl::UploadTicket ticket = 0;
+		};
+
+		struct Texture {
+			bool live = false;
+			std::shared_ptr<Source> source;
+
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			uint32_t blockBytes = 0;
+			std::vector<Level> levels;
+			//First level of the mip tail
+			uint32_t tailLevel = 0;
+
+			Residency current;
+			//Image being uploaded that replaces current once it is ready
+			Residency pending;
+			bool hasPending = false;
+
+			//Finest level asked for by markUsed, the first level of the tail until then
+			uint32_t wantedLevel = 0;
+			uint64_t lastUsed = 0;
+			uint32_t bindlessHandle = vgl::BindlessHeap::invalidHandle;
+		};
+
+		//Level upload queued by beginResidency, made by update once it has released the mutex
+		struct QueuedUpload {
+			VkImage image = VK_NULL_HANDLE;
+			//Keeps the file mapped if the texture is released before the upload is made
+			std::shared_ptr<Source> source;
+			vgl::ImageUploadInfo info;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+		};
+
+		//Ticket of a residency whose uploads are queued but not made yet, never ready
+		static constexpr vgl::UploadTicket queuedTicket = UINT64_MAX;
+
+		//Image that is no longer used, destroyed framesInFlight frames after its upload was ready
+		struct RetiredImage {
+			Residency residency;
+			//Frame its upload was seen to be ready, 0 until then
+			uint64_t readyFrame = 0;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::MemoryAllocator* allocator = nullptr;
+		vgl::UploadEngine* uploadEngine = nullptr;
+		vgl::BindlessHeap* bindlessHeap = nullptr;
+		uint32_t framesInFlight = 0;
+
+		vgl::TextureStreamerSettings settings;
+
+		std::vector<Texture> textures;
+		std::vector<vgl::StreamedTexture> freeTextures;
+		std::vector<RetiredImage> retired;
+		//Only touched by update
+		std::vector<QueuedUpload> queuedUploads;
+
+		uint64_t frameNumber = 1;
+
+		Stats stats;
+		mutable std::mutex mutex;
+
+		const Texture& getTexture(vgl::StreamedTexture texture) const;
+
+		//Budget for this frame, sets the budget fields of stats
+		VkDeviceSize computeBudget(VkDeviceSize residentBytes);
+
+		//Create an image for the levels from baseLevel on and queue their uploads, coarsest first
+		//The uploads are made by update after it releases the mutex, since the upload engine can block on staging space
+		void beginResidency(Texture& texture, uint32_t baseLevel);
+		//Drop the finest level of textures last used before usedBefore, least recently used first, until residentBytes is at most targetBytes
+		//Returns whether enough was evicted
+		bool evict(const std::vector<Texture*>& evictionOrder, uint64_t usedBefore, VkDeviceSize targetBytes, VkDeviceSize& residentBytes);
+		//Swap in the pending image once its upload is ready, returns whether it did
+		bool finishResidency(Texture& texture);
+
+		//Start a job reading the levels from the texture's wanted level on if one isn't running already
+		void readAhead(Texture& texture);
+
+		void retire(Residency& residency);
+		void destroy(Residency& residency);
+
+		//Bytes of device memory the texture will hold once its pending upload is done
+		static VkDeviceSize getTargetBytes(const Texture& texture);
+		//Sum of the level sizes from baseLevel on
+		static VkDeviceSize getLevelBytes(const Texture& texture, uint32_t baseLevel);
+
+		//Size of one texel block and the texels it covers, false if the format isn't supported
+		static bool getBlockInfo(VkFormat format, uint32_t& bytes, uint32_t& width, uint32_t& height);
+
+	};
+
+}
+
+#endif // !VGL_TEXTURESTREAMER_H
@@ -0,0 +1,121 @@
+#ifndef VGL_TLSFALLOCATOR_H
+#define VGL_TLSFALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace vgl {
+
+	/*
+	Two-Level Segregated Fit allocator.
+	Only manages offsets into a range [0, size), it never touches memory itself, so it can sub-allocate a VkDeviceMemory block
+	(or anything else) and be benchmarked without a device.
+
+	Free blocks are kept in lists bucketed by size.
+	The first level splits sizes by powers of two, the second level splits each power of two into slCount linear ranges.
+	Two bitmaps record which buckets are non-empty so finding a free block, allocating and freeing are all O(1).
+	Neighbouring free blocks are merged on free.
+	*/
+	class TlsfAllocator {
+
+	public:
+
+		static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+		struct Allocation {
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			//Identifies the block so it can be freed, invalidIndex if the allocation failed
+			uint32_t blockIndex = invalidIndex;
+
+			bool isValid() const { return blockIndex != invalidIndex; }
+		};
+
+		struct Stats {
+			uint64_t totalSize = 0;
+			uint64_t usedSize = 0;
+			uint32_t allocationCount = 0;
+			uint32_t freeBlockCount = 0;
+			uint64_t largestFreeBlock = 0;
+
+			//0 when all free space is one contiguous block, approaches 1 as free space gets split into small pieces
+			double fragmentation() const {
+				uint64_t freeSize = totalSize - usedSize;
+				return freeSize == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeBlock) / static_cast<double>(freeSize);
+			}
+		};
+
+		TlsfAllocator() : TlsfAllocator(0) {};
+		TlsfAllocator(uint64_t _size);
+
+		//Returns an invalid allocation if there is no free block large enough
+		//_alignment has to be a power of two
+		Allocation allocate(uint64_t _size, uint64_t _alignment = 1);
+		void free(uint32_t _blockIndex);
+
+		Stats getStats() const;
+		uint64_t getSize() const;
+		bool isEmpty() const;
+
+	private:
+
+		//Each first level is split into 2^slLog2 second level buckets
+		static constexpr uint32_t slLog2 = 4;
+		static constexpr uint32_t slCount = 1 << slLog2;
+		//Sizes below slCount all go into first level 0
+		static constexpr uint32_t flCount = 64 - slLog2 + 1;
+
+		struct Block {
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			//Neighbours in address order
+			uint32_t prevPhysical = invalidIndex;
+			uint32_t nextPhysical = invalidIndex;
+			//Neighbours in the free list, only used when the block is free
+			uint32_t prevFree = invalidIndex;
+			uint32_t nextFree = invalidIndex;
+			bool free = false;
+		};
+
+		uint64_t size = 0;
+		uint64_t usedSize = 0;
+		uint32_t allocationCount = 0;
+		uint32_t freeBlockCount = 0;
+
+		//Block storage, indices are used as handles so blocks are never moved once handed out
+		std::vector<Block> blocks;
+		//Indices of unused entries in blocks that can be recycled
+		std::vector<uint32_t> unusedBlocks;
+
+		//Head of the free list for every (first level, second level) bucket
+		uint32_t freeLists[flCount][slCount];
+		//Bit set for every first level that has a non empty second level
+		uint64_t flBitmap = 0;
+		//Bit set for every non empty second level bucket
+		uint32_t slBitmap[flCount] = {};
+
+		//Bucket a free block of this size is stored in
+		static void mapping(uint64_t _size, uint32_t& fl, uint32_t& sl);
+		//Smallest bucket where every block is guaranteed to be at least this size
+		static void mappingSearch(uint64_t _size, uint32_t& fl, uint32_t& sl);
+
+		uint32_t findFreeBlock(uint32_t fl, uint32_t sl) const;
+
+		uint32_t createBlock();
+		void releaseBlock(uint32_t index);
+
+		void insertFreeBlock(uint32_t index);
+		void removeFreeBlock(uint32_t index);
+
+		//Split the block so it is exactly _size, the remainder becomes a new free block after it
+		void splitBlock(uint32_t index, uint64_t _size);
+		//Merge the block with the next physical block, which has to be free
+		void mergeWithNext(uint32_t index);
+
+	};
+
+}
+
+#endif // !VGL_TLSFALLOCATOR_H
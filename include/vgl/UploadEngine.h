@@ -0,0 +1,184 @@
+#ifndef VGL_UPLOADENGINE_H
+#define VGL_UPLOADENGINE_H
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+#include "vgl/LogicalDevice.h"
+
+namespace vgl {
+
+	//Returned by every upload, the upload has finished once the engine's timeline semaphore reaches this value
+	using UploadTicket = uint64_t;
+
+	//Where an image upload is written to
+	struct ImageUploadInfo {
+		VkExtent3D extent{ 1, 1, 1 };
+		uint32_t mipLevel = 0;
+		uint32_t baseArrayLayer = 0;
+		uint32_t layerCount = 1;
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+		//Layout the subresource is left in, previous contents of the subresource are discarded
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		//Required offset alignment of the data in the staging buffer, at least the texel block size of the format
+		VkDeviceSize texelBlockSize = 4;
+	};
+
+	/*
+	Streams buffer and image data to device local memory without stalling the graphics queue.
+	Uploads are copied into a ring buffered staging buffer and recorded into a batch, batches are submitted to the
+	dedicated transfer queue (or the graphics queue if the device doesn't have one) and signal a timeline semaphore on completion.
+	Staging space is reclaimed once the semaphore shows the batch has finished, the CPU only waits if the ring is full.
+	Uploads larger than half the ring get their own temporary staging buffer.
+
+	With a dedicated transfer queue, ownership of the destination is released on the transfer queue and acquired on the graphics queue
+	by recordAcquireBarriers, which only ever acquires finished batches so the graphics queue never waits on the transfer queue.
+
+	All functions are thread safe. Batches are submitted while holding the QueueScheduler's mutex for the transfer queue,
+	which is shared with the graphics queue when there is no dedicated transfer family, so flush can be called from any thread.
+	*/
+	class UploadEngine {
+
+	public:
+
+		struct Stats {
+			VkDeviceSize bytesUploaded = 0;
+			uint64_t uploadCount = 0;
+			uint64_t batchesSubmitted = 0;
+			//Times the CPU had to wait for the GPU to free staging space
+			uint64_t stagingStalls = 0;
+		};
+
+		static constexpr VkDeviceSize defaultStagingSize = 64ull * 1024 * 1024;
+		//Batches are submitted automatically once this much data has been queued
+		static constexpr VkDeviceSize defaultBatchSize = 16ull * 1024 * 1024;
+
+		UploadEngine(vgl::LogicalDevice* _logicalDevice, VkDeviceSize _stagingSize = defaultStagingSize, VkDeviceSize _batchSize = defaultBatchSize);
+		~UploadEngine();
+
+		//Owns Vulkan handles so can not be copied
+		UploadEngine(const UploadEngine&) = delete;
+		UploadEngine& operator=(const UploadEngine&) = delete;
+
+		//Copy data into dst, dst must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+		//data is copied before returning so it can be freed straight away
+		UploadTicket uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+		//Copy tightly packed texel data into one mip level of dst, dst must have been created with VK_IMAGE_USAGE_TRANSFER_DST_BIT
+		UploadTicket uploadImage(VkImage dst, const vgl::ImageUploadInfo& info, const void* data, VkDeviceSize size);
+
+		//Submit everything queued so far, returns the ticket of the submitted batch
+		UploadTicket flush();
+
+		//Whether the copy for ticket has finished on the GPU
+		bool isComplete(UploadTicket ticket);
+		//Whether the destination can be used by frames recorded from now on
+		//With a dedicated transfer queue this is only true once the graphics queue has acquired it
+		bool isReady(UploadTicket ticket);
+		//Submit if needed and block until the copy for ticket has finished
+		void wait(UploadTicket ticket);
+
+		//Called at the start of every frame's command buffer on the graphics queue
+		//Records ownership acquire barriers for finished uploads, returns the semaphore value the frame has to wait on or 0 if none
+		uint64_t recordAcquireBarriers(VkCommandBuffer graphicsCommandBuffer);
+
+		VkSemaphore getSemaphore() const;
+		Stats getStats() const;
+
+	private:
+
+		//Staging buffer used for an upload that doesn't fit in the ring, freed when its batch finishes
+		struct TemporaryBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			vgl::MemoryAllocation allocation;
+		};
+
+		struct Batch {
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			//Timeline value signalled when the batch finishes
+			uint64_t value = 0;
+			//Ring head when the batch was submitted, everything before it can be reused once the batch finishes
+			uint64_t ringEnd = 0;
+			VkDeviceSize bytes = 0;
+			std::vector<TemporaryBuffer> temporaryBuffers;
+
+			//Ownership acquires the graphics queue has to perform, only used with a dedicated transfer queue
+			std::vector<VkBufferMemoryBarrier> bufferAcquires;
+			std::vector<VkImageMemoryBarrier> imageAcquires;
+		};
+
+		//Space reserved for an upload, either in the ring or in a temporary buffer
+		struct StagingRegion {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			void* mapped = nullptr;
+		};
+
+		vgl::LogicalDevice* logicalDevice = nullptr;
+		vgl::MemoryAllocator* allocator = nullptr;
+
+		VkQueue queue = VK_NULL_HANDLE;
+		uint32_t transferFamily = 0;
+		uint32_t graphicsFamily = 0;
+		bool dedicatedQueue = false;
+
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> freeCommandBuffers;
+
+		VkSemaphore timeline = VK_NULL_HANDLE;
+		//Value the batch being recorded will signal
+		uint64_t nextValue = 1;
+		//Highest value the graphics queue has acquired ownership up to
+		uint64_t acquiredValue = 0;
+
+		//Ring buffer, head and tail only ever increase, the offset in the buffer is tracked separately since wrapping skips the end of the buffer
+		VkBuffer ringBuffer = VK_NULL_HANDLE;
+		vgl::MemoryAllocation ringAllocation;
+		VkDeviceSize ringSize = 0;
+		uint64_t ringHead = 0;
+		uint64_t ringTail = 0;
+		VkDeviceSize ringOffset = 0;
+
+		VkDeviceSize batchSize = defaultBatchSize;
+		VkDeviceSize copyAlignment = 16;
+
+		Batch recording;
+		bool recordingStarted = false;
+		std::deque<Batch> inFlight;
+
+		//Acquires from finished batches that haven't been recorded on the graphics queue yet
+		std::vector<VkBufferMemoryBarrier> pendingBufferAcquires;
+		std::vector<VkImageMemoryBarrier> pendingImageAcquires;
+		uint64_t pendingAcquireValue = 0;
+
+		Stats stats;
+
+		mutable std::mutex mutex;
+
+		//Begin the recording batch's command buffer if it hasn't been already
+		void beginBatch();
+		//Submit the recording batch, must hold the mutex
+		void submitBatch();
+		//Release everything used by batches the GPU has finished, must hold the mutex
+		//Blocks until the semaphore reaches waitValue first if it isn't 0
+		void retireBatches(uint64_t waitValue);
+
+		//Reserve staging space, submitting and waiting for batches to finish if the ring is full
+		StagingRegion reserveStaging(VkDeviceSize size, VkDeviceSize alignment);
+		bool tryReserveRing(VkDeviceSize size, VkDeviceSize alignment, StagingRegion& region);
+
+		//Submit the batch if enough data has been queued, returns the ticket for the upload just recorded
+		UploadTicket finishUpload(VkDeviceSize size);
+
+		uint64_t getCompletedValue() const;
+
+	};
+
+}
+
+#endif // !VGL_UPLOADENGINE_H
@@ -6,8 +6,23 @@
 #include <iostream>
 
 #include "vgl/Window.h"
+#include "vgl/HeadlessSettings.h"
+#include "vgl/OffscreenTarget.h"
 #include "vgl/PhysicalDevice.h"
 #include "vgl/LogicalDevice.h"
+#include "vgl/FrameRenderer.h"
+#include "vgl/LinearArena.h"
+#include "vgl/UploadEngine.h"
+#include "vgl/AsyncCompute.h"
+#include "vgl/ComputePipeline.h"
+#include "vgl/CommandRecorder.h"
+#include "vgl/RenderGraph.h"
+#include "vgl/BindlessHeap.h"
+#include "vgl/DescriptorAllocator.h"
+#include "vgl/GpuProfiler.h"
+#include "vgl/TextureStreamer.h"
+#include "vgl/Mesh.h"
+#include "vgl/DrawBatcher.h"
 
 namespace vgl {
 
@@ -17,14 +32,92 @@ namespace vgl {
 
 		
 
-		VulkanCore(vgl::Window* _window);
+		//_deviceFilter restricts which GPU is picked, the VGL_DEVICE environment variable overrides it
+		VulkanCore(vgl::Window* _window, const vgl::DeviceFilter& _deviceFilter = {});
+        //Create the core without a window or GLFW, rendering into an offscreen target instead
+        VulkanCore(const vgl::HeadlessSettings& _settings);
         ~VulkanCore();
 
+        bool isHeadless() const;
+
+        //Offscreen colour target, only exists when headless
+        vgl::OffscreenTarget* getOffscreenTarget() const;
+
+        vgl::PhysicalDevice* getPhysicalDevice() const;
+        vgl::LogicalDevice* getLogicalDevice() const;
+
+        //Frame loop rendering to the window's swap chain, the headless surface or the offscreen target
+        vgl::FrameRenderer* getRenderer() const;
+
+        //Record and submit a single frame, returns false if the frame was skipped
+        bool drawFrame(const vgl::FrameRenderer::RecordFunction& record = nullptr);
+
+        const vgl::FrameStats& getFrameStats() const;
+
+        //Per-frame bump allocator for transient uniform/vertex/staging data, reset automatically at the start of each frame
+        vgl::LinearArena* getFrameArena() const;
+
+        //Size of each frame's region in the frame arena
+        static constexpr VkDeviceSize frameArenaSize = 8ull * 1024 * 1024;
+
+        //Streams buffer and image data to the GPU on the transfer queue
+        //Queued uploads are submitted at the start of every frame and finished uploads are acquired by the frame's command buffer
+        vgl::UploadEngine* getUploadEngine() const;
+
+        //Records secondary command buffers for the frame across the job system's threads
+        //Its pools are reset automatically at the start of each frame
+        vgl::CommandRecorder* getCommandRecorder() const;
+
+        //Frame graph to declare passes into, reset it and import the frame at the start of each frame's record function
+        vgl::RenderGraph* getRenderGraph() const;
+
+        //Global descriptor set for bindless textures and buffers, nullptr if the device doesn't support descriptor indexing
+        vgl::BindlessHeap* getBindlessHeap() const;
+
+        //Pooled descriptor sets for pipelines that don't use the bindless heap
+        //Transient sets are reset automatically at the start of each frame
+        vgl::DescriptorAllocator* getDescriptorAllocator() const;
+
+        //Submits compute work to the async compute queue so it overlaps with rendering
+        vgl::AsyncCompute* getAsyncCompute() const;
+
+        //Timestamp scopes around command ranges, results arrive once the frame's fence has signalled
+        //nullptr if the graphics queue doesn't support timestamps
+        vgl::GpuProfiler* getGpuProfiler() const;
+
+        //Streams KTX2 textures in within the device memory budget, updated automatically at the start of each frame
+        //Resident textures are added to the bindless heap when there is one
+        vgl::TextureStreamer* getTextureStreamer() const;
+
+        //Sorts and instances the frame's draw requests, its requests and instance data are reset automatically at the start of each frame
+        vgl::DrawBatcher* getDrawBatcher() const;
+
+        //Block until the GPU has finished all submitted work
+        void waitIdle();
+
 
 	private:
 
 		VkInstance instance = NULL;
 
+        //Whether the core was created without a window
+        bool headless = false;
+        vgl::HeadlessSettings headlessSettings;
+
+        //Name passed to the driver in VkApplicationInfo
+        std::string applicationName = "Vulkan App";
+
+        //Where the pipeline cache is persisted
+        std::string pipelineCacheDirectory = vgl::PipelineCache::defaultDirectory;
+
+        //Restricts which GPU the physical device is picked from
+        vgl::DeviceFilter deviceFilter;
+
+        //Surface to present to
+        //Owned by the window when there is one, otherwise owned by the core if a headless surface was created
+        //VK_NULL_HANDLE when headless without VK_EXT_headless_surface
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+
         VkDebugUtilsMessengerEXT debugMessenger;
 
 
@@ -43,23 +136,95 @@ namespace vgl {
 
         
         //Device extensions
-        const std::vector<const char*> deviceExtensions = {
-            "VK_KHR_swapchain"
-        };
+        //VK_KHR_swapchain is only required when there is a surface to present to
+        std::vector<const char*> deviceExtensions;
 
         //Window
         std::unique_ptr<vgl::Window> window;
 
         //Physical device
-        vgl::PhysicalDevice physicalDevice;
+        std::unique_ptr<vgl::PhysicalDevice> physicalDevice;
 
         //Logical Device
-        vgl::LogicalDevice logicalDevice;
+        std::unique_ptr<vgl::LogicalDevice> logicalDevice;
+
+        //Render target used instead of a swap chain when headless
+        std::unique_ptr<vgl::OffscreenTarget> offscreenTarget;
+
+        //Frame loop
+        std::unique_ptr<vgl::FrameRenderer> renderer;
+
+        //Transient per-frame data
+        std::unique_ptr<vgl::LinearArena> frameArena;
+
+        //Asynchronous uploads
+        std::unique_ptr<vgl::UploadEngine> uploadEngine;
+
+        //Async compute
+        std::unique_ptr<vgl::AsyncCompute> asyncCompute;
+
+        //Parallel secondary command buffer recording
+        std::unique_ptr<vgl::CommandRecorder> commandRecorder;
+
+        //Frame graph, owns the transient attachments and buffers
+        std::unique_ptr<vgl::RenderGraph> renderGraph;
+
+        //Bindless descriptors, only created when descriptor indexing is enabled
+        std::unique_ptr<vgl::BindlessHeap> bindlessHeap;
+
+        //Per-frame descriptor pools and cached layouts and sets
+        std::unique_ptr<vgl::DescriptorAllocator> descriptorAllocator;
+
+        //GPU timestamp profiling, only created when the graphics queue supports timestamps
+        std::unique_ptr<vgl::GpuProfiler> gpuProfiler;
+
+        //Streamed textures, destroyed before the bindless heap and upload engine it uses
+        std::unique_ptr<vgl::TextureStreamer> textureStreamer;
+
+        //Draw request sorting and instancing
+        std::unique_ptr<vgl::DrawBatcher> drawBatcher;
+
+        //Create the frame arena and hook it up to the renderer
+        void createFrameArena();
+
+        //Create the upload engine and hook it up to the renderer
+        void createUploadEngine();
+
+        //Create the command recorder and hook it up to the renderer
+        void createCommandRecorder();
+
+        //Create the render graph and hook it up to the renderer
+        void createRenderGraph();
+
+        //Create the bindless heap if the device supports it and hook it up to the renderer
+        void createBindlessHeap();
+
+        //Create the descriptor allocator and hook it up to the renderer
+        void createDescriptorAllocator();
+
+        //Create the GPU profiler if timestamps are supported and hook it up to the renderer
+        void createGpuProfiler();
+
+        //Create the texture streamer and hook it up to the renderer, after the upload engine and bindless heap
+        void createTextureStreamer();
+
+        //Create the draw batcher and hook it up to the renderer
+        void createDrawBatcher();
+
+        //Collect the CPU profiler's samples at the start of every frame, does nothing unless built with VGL_ENABLE_PROFILING
+        void connectCpuProfiler();
 
 
 		void createInstance();
         bool checkValidationLayerSupport();
+        bool checkInstanceExtensionSupport(const char* extensionName);
         std::vector<const char*> getRequiredExtensions();
+
+        //Create a surface using VK_EXT_headless_surface
+        void createHeadlessSurface();
+
+        //Pick the physical device and create the logical device for the current surface
+        void createDevices();
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 
         static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -19,6 +19,9 @@ namespace vgl {
 
 		bool resizable = true;
 
+		//Set by GLFW when the framebuffer changes size, cleared once the swap chain has been recreated
+		bool framebufferResized = false;
+
 		GLFWwindow *window;
 
 		//Surface
@@ -46,6 +49,11 @@ namespace vgl {
 
 		bool isOpen();
 		void pollEvents();
+		//Block until there is an event, used to wait while the window is minimised
+		void waitEvents();
+
+		//Size of the framebuffer in pixels, can differ from the window size on high DPI displays
+		VkExtent2D getFramebufferSize();
 		
 		//Create surface for Vulkan
 		void createVulkanSurface(VkInstance& instance);
@@ -56,6 +64,9 @@ namespace vgl {
 
 		void initGLFWWindow();
 
+		//Called by GLFW when the framebuffer is resized
+		static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+
 	};
 
 }
@@ -0,0 +1,143 @@
+#include "vgl/AsyncCompute.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::AsyncCompute::AsyncCompute(vgl::LogicalDevice* _logicalDevice, uint32_t _slotCount)
+    : logicalDevice(_logicalDevice),
+    scheduler(_logicalDevice->getQueueScheduler())
+{
+    VkDevice device = this->logicalDevice->device;
+    const vgl::QueueFamilyIndices& indices = this->logicalDevice->queueFamilyIndices;
+
+    this->dedicated = indices.hasDedicatedCompute();
+    this->queue = this->logicalDevice->computeQueue;
+    this->queueFamily = this->dedicated ? indices.computeFamily.value() : indices.graphicsFamily.value();
+
+    this->slots.resize(_slotCount);
+    for (auto& slot : this->slots) {
+        //Transient pool reset as a whole once the slot's submission has finished
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = this->queueFamily;
+
+        if (vkCreateCommandPool(device, &poolInfo, vgl::HostAllocator::callbacks(), &slot.commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE COMPUTE COMMAND POOL");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = slot.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO ALLOCATE COMPUTE COMMAND BUFFER");
+        }
+    }
+}
+
+vgl::AsyncCompute::~AsyncCompute() {
+    VkDevice device = this->logicalDevice->device;
+
+    this->wait(this->submittedValue);
+
+    for (auto& slot : this->slots) {
+        vkDestroyCommandPool(device, slot.commandPool, vgl::HostAllocator::callbacks());
+    }
+}
+
+VkCommandBuffer vgl::AsyncCompute::begin() {
+    if (this->recording) {
+        throw std::runtime_error("AsyncCompute::begin CALLED TWICE WITHOUT submit");
+    }
+
+    Slot& slot = this->slots[this->currentSlot];
+
+    //Only blocks if slotCount submissions are still running on the GPU
+    this->wait(slot.value);
+    vkResetCommandPool(this->logicalDevice->device, slot.commandPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO BEGIN RECORDING COMPUTE COMMAND BUFFER");
+    }
+
+    this->recording = true;
+    return slot.commandBuffer;
+}
+
+uint64_t vgl::AsyncCompute::submit(const std::vector<vgl::SemaphoreWait>& waits) {
+    if (!this->recording) {
+        throw std::runtime_error("AsyncCompute::submit CALLED WITHOUT A MATCHING begin");
+    }
+    this->recording = false;
+
+    Slot& slot = this->slots[this->currentSlot];
+
+    if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO RECORD COMPUTE COMMAND BUFFER");
+    }
+
+    vgl::QueueSubmission submission;
+    submission.commandBuffers.push_back(slot.commandBuffer);
+    submission.semaphoreWaits = waits;
+
+    uint64_t signalValue = this->scheduler->submit(vgl::QueueType::Compute, submission).value;
+
+    this->submittedValue = signalValue;
+    slot.value = signalValue;
+    this->currentSlot = (this->currentSlot + 1) % static_cast<uint32_t>(this->slots.size());
+    return signalValue;
+}
+
+vgl::QueuePoint vgl::AsyncCompute::getPoint(uint64_t value) const {
+    return { vgl::QueueType::Compute, value };
+}
+
+bool vgl::AsyncCompute::isComplete(uint64_t value) const {
+    return this->scheduler->isComplete(this->getPoint(value));
+}
+
+void vgl::AsyncCompute::wait(uint64_t value) const {
+    this->scheduler->wait(this->getPoint(value));
+}
+
+VkSemaphore vgl::AsyncCompute::getSemaphore() const {
+    return this->scheduler->getSemaphore(vgl::QueueType::Compute);
+}
+
+uint64_t vgl::AsyncCompute::getSubmittedValue() const {
+    return this->submittedValue;
+}
+
+VkQueue vgl::AsyncCompute::getQueue() const {
+    return this->queue;
+}
+
+uint32_t vgl::AsyncCompute::getQueueFamily() const {
+    return this->queueFamily;
+}
+
+bool vgl::AsyncCompute::isDedicated() const {
+    return this->dedicated;
+}
+
+std::vector<uint32_t> vgl::AsyncCompute::getSharingFamilies() const {
+    if (!this->dedicated) { return {}; }
+    return { this->logicalDevice->queueFamilyIndices.graphicsFamily.value(), this->queueFamily };
+}
+
+void vgl::AsyncCompute::setSharing(VkBufferCreateInfo& bufferInfo, const std::vector<uint32_t>& sharingFamilies) const {
+    if (sharingFamilies.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharingFamilies.size());
+        bufferInfo.pQueueFamilyIndices = sharingFamilies.data();
+    }
+    else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+}
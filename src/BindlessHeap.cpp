@@ -0,0 +1,294 @@
+#include "vgl/BindlessHeap.h"
+
+#include <algorithm>
+
+#include "vgl/HostAllocator.h"
+
+vgl::BindlessHeap::BindlessHeap(vgl::LogicalDevice* _logicalDevice, uint32_t _framesInFlight, const vgl::BindlessCapacity& _capacity)
+    : logicalDevice(_logicalDevice),
+    framesInFlight(_framesInFlight)
+{
+    if (!this->logicalDevice->isBindlessEnabled()) {
+        throw std::runtime_error("BINDLESS HEAP REQUIRES DESCRIPTOR INDEXING");
+    }
+
+    VkDevice device = this->logicalDevice->device;
+    const vgl::DeviceCapabilities& capabilities = this->logicalDevice->getCapabilities();
+    const VkPhysicalDeviceVulkan12Properties& limits = capabilities.properties12;
+
+    //Every binding is visible to every stage so the per stage and per set limits both apply
+    this->slots[Textures].capacity = std::min({ _capacity.textures, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSamplers });
+    this->slots[StorageImages].capacity = std::min({ _capacity.storageImages, limits.maxDescriptorSetUpdateAfterBindStorageImages,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageImages });
+    this->slots[StorageBuffers].capacity = std::min({ _capacity.storageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    //The pool limit covers all three arrays together, shrink them evenly if they don't fit
+    uint64_t total = static_cast<uint64_t>(this->slots[Textures].capacity) + this->slots[StorageImages].capacity + this->slots[StorageBuffers].capacity;
+    if (total > limits.maxUpdateAfterBindDescriptorsInAllPools) {
+        for (auto& binding : this->slots) {
+            binding.capacity = static_cast<uint32_t>(binding.capacity * limits.maxUpdateAfterBindDescriptorsInAllPools / total);
+        }
+    }
+    for (const auto& binding : this->slots) {
+        if (binding.capacity == 0) {
+            throw std::runtime_error("DEVICE LIMITS ARE TOO LOW FOR A BINDLESS HEAP");
+        }
+    }
+
+    const VkDescriptorType types[BindingCount] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+
+    VkDescriptorSetLayoutBinding bindings[BindingCount]{};
+    VkDescriptorBindingFlags bindingFlags[BindingCount]{};
+    VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    if (capabilities.features12.descriptorBindingUpdateUnusedWhilePending) {
+        flags |= VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    }
+    for (uint32_t i = 0; i < BindingCount; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = this->slots[i].capacity;
+        bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+        bindingFlags[i] = flags;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = BindingCount;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = BindingCount;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, vgl::HostAllocator::callbacks(), &this->setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE BINDLESS DESCRIPTOR SET LAYOUT");
+    }
+
+    VkDescriptorPoolSize poolSizes[BindingCount]{};
+    for (uint32_t i = 0; i < BindingCount; i++) {
+        poolSizes[i].type = types[i];
+        poolSizes[i].descriptorCount = this->slots[i].capacity;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = BindingCount;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, vgl::HostAllocator::callbacks(), &this->pool) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE BINDLESS DESCRIPTOR POOL");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = this->pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &this->setLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &this->set) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO ALLOCATE BINDLESS DESCRIPTOR SET");
+    }
+
+    VkPushConstantRange pushConstantRange = this->getPushConstantRange();
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &this->setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, vgl::HostAllocator::callbacks(), &this->pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE BINDLESS PIPELINE LAYOUT");
+    }
+
+    //Trilinear repeat sampler for textures added without one
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.anisotropyEnable = VK_TRUE;
+    samplerInfo.maxAnisotropy = capabilities.properties.limits.maxSamplerAnisotropy;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device, &samplerInfo, vgl::HostAllocator::callbacks(), &this->defaultSampler) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE BINDLESS DEFAULT SAMPLER");
+    }
+}
+
+vgl::BindlessHeap::~BindlessHeap() {
+    VkDevice device = this->logicalDevice->device;
+
+    vkDestroySampler(device, this->defaultSampler, vgl::HostAllocator::callbacks());
+    vkDestroyPipelineLayout(device, this->pipelineLayout, vgl::HostAllocator::callbacks());
+    //Destroying the pool frees the set
+    vkDestroyDescriptorPool(device, this->pool, vgl::HostAllocator::callbacks());
+    vkDestroyDescriptorSetLayout(device, this->setLayout, vgl::HostAllocator::callbacks());
+}
+
+void vgl::BindlessHeap::beginFrame() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->frameNumber++;
+    for (auto& binding : this->slots) {
+        //Retired in order, so everything old enough is at the front
+        auto firstInFlight = std::find_if(binding.retired.begin(), binding.retired.end(),
+            [this](const std::pair<uint64_t, uint32_t>& retired) { return retired.first + this->framesInFlight > this->frameNumber; });
+        for (auto it = binding.retired.begin(); it != firstInFlight; ++it) {
+            binding.free.push_back(it->second);
+        }
+        binding.retired.erase(binding.retired.begin(), firstInFlight);
+    }
+}
+
+uint32_t vgl::BindlessHeap::addTexture(VkImageView view, VkSampler sampler, VkImageLayout layout) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    uint32_t handle = this->allocate(Textures);
+    this->writeImage(Textures, handle, { sampler != VK_NULL_HANDLE ? sampler : this->defaultSampler, view, layout });
+    return handle;
+}
+
+uint32_t vgl::BindlessHeap::addStorageImage(VkImageView view) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    uint32_t handle = this->allocate(StorageImages);
+    this->writeImage(StorageImages, handle, { VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL });
+    return handle;
+}
+
+uint32_t vgl::BindlessHeap::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    uint32_t handle = this->allocate(StorageBuffers);
+
+    VkDescriptorBufferInfo bufferInfo{ buffer, offset, range };
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = this->set;
+    write.dstBinding = StorageBuffers;
+    write.dstArrayElement = handle;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(this->logicalDevice->device, 1, &write, 0, nullptr);
+    this->writes++;
+    return handle;
+}
+
+void vgl::BindlessHeap::updateTexture(uint32_t handle, VkImageView view, VkSampler sampler, VkImageLayout layout) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (handle >= this->slots[Textures].next) {
+        throw std::runtime_error("INVALID BINDLESS TEXTURE HANDLE");
+    }
+    this->writeImage(Textures, handle, { sampler != VK_NULL_HANDLE ? sampler : this->defaultSampler, view, layout });
+}
+
+void vgl::BindlessHeap::removeTexture(uint32_t handle) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->release(Textures, handle);
+}
+
+void vgl::BindlessHeap::removeStorageImage(uint32_t handle) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->release(StorageImages, handle);
+}
+
+void vgl::BindlessHeap::removeStorageBuffer(uint32_t handle) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->release(StorageBuffers, handle);
+}
+
+void vgl::BindlessHeap::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const {
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, this->pipelineLayout, 0, 1, &this->set, 0, nullptr);
+}
+
+void vgl::BindlessHeap::pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset) const {
+    vkCmdPushConstants(commandBuffer, this->pipelineLayout, VK_SHADER_STAGE_ALL, offset, size, data);
+}
+
+VkDescriptorSetLayout vgl::BindlessHeap::getSetLayout() const {
+    return this->setLayout;
+}
+
+VkDescriptorSet vgl::BindlessHeap::getSet() const {
+    return this->set;
+}
+
+VkPipelineLayout vgl::BindlessHeap::getPipelineLayout() const {
+    return this->pipelineLayout;
+}
+
+VkPushConstantRange vgl::BindlessHeap::getPushConstantRange() const {
+    return { VK_SHADER_STAGE_ALL, 0, pushConstantSize };
+}
+
+VkSampler vgl::BindlessHeap::getDefaultSampler() const {
+    return this->defaultSampler;
+}
+
+vgl::BindlessHeap::Stats vgl::BindlessHeap::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Stats stats;
+    for (uint32_t i = 0; i < BindingCount; i++) {
+        const Slots& binding = this->slots[i];
+        stats.used[i] = binding.next - static_cast<uint32_t>(binding.free.size() + binding.retired.size());
+        stats.capacity[i] = binding.capacity;
+    }
+    stats.writes = this->writes;
+    return stats;
+}
+
+uint32_t vgl::BindlessHeap::allocate(Binding binding) {
+    Slots& slots = this->slots[binding];
+
+    //Reuse freed handles first to keep the highest index in use low
+    if (!slots.free.empty()) {
+        uint32_t handle = slots.free.back();
+        slots.free.pop_back();
+        return handle;
+    }
+    if (slots.next == slots.capacity) {
+        throw std::runtime_error("BINDLESS HEAP IS FULL");
+    }
+    return slots.next++;
+}
+
+void vgl::BindlessHeap::release(Binding binding, uint32_t handle) {
+    if (handle == invalidHandle) {
+        return;
+    }
+    Slots& slots = this->slots[binding];
+    if (handle >= slots.next) {
+        throw std::runtime_error("INVALID BINDLESS HANDLE");
+    }
+    slots.retired.emplace_back(this->frameNumber, handle);
+}
+
+void vgl::BindlessHeap::writeImage(Binding binding, uint32_t handle, const VkDescriptorImageInfo& imageInfo) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = this->set;
+    write.dstBinding = binding;
+    write.dstArrayElement = handle;
+    write.descriptorCount = 1;
+    write.descriptorType = binding == Textures ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(this->logicalDevice->device, 1, &write, 0, nullptr);
+    this->writes++;
+}
@@ -0,0 +1,465 @@
+#include "vgl/BoundingVolumes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#define VGL_CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVC allows AVX intrinsics in any function
+#define VGL_TARGET_AVX2
+#else
+//Only the AVX2 kernels are compiled for AVX2, so the library still runs on CPUs without it
+#define VGL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+    //Pointers to the structure of arrays the kernels read
+    struct Streams {
+        const float* x;
+        const float* y;
+        const float* z;
+        const float* radius;
+        const float* boxX;
+        const float* boxY;
+        const float* boxZ;
+        const float* extentX;
+        const float* extentY;
+        const float* extentZ;
+    };
+
+    //Query split into per component plane arrays so kernels can broadcast them
+    struct PreparedQuery {
+        float normalX[vgl::Frustum::PlaneCount];
+        float normalY[vgl::Frustum::PlaneCount];
+        float normalZ[vgl::Frustum::PlaneCount];
+        float distance[vgl::Frustum::PlaneCount];
+        //Absolute normal components, projecting a box's extents onto the normal
+        float absX[vgl::Frustum::PlaneCount];
+        float absY[vgl::Frustum::PlaneCount];
+        float absZ[vgl::Frustum::PlaneCount];
+        float pointX;
+        float pointY;
+        float pointZ;
+        float maxDistance;
+        bool testDistance;
+        bool useAabbs;
+    };
+
+    PreparedQuery prepare(const vgl::CullQuery& query) {
+        PreparedQuery prepared{};
+        for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+            const glm::vec4& plane = query.frustum.planes[p];
+            prepared.normalX[p] = plane.x;
+            prepared.normalY[p] = plane.y;
+            prepared.normalZ[p] = plane.z;
+            prepared.distance[p] = plane.w;
+            prepared.absX[p] = std::fabs(plane.x);
+            prepared.absY[p] = std::fabs(plane.y);
+            prepared.absZ[p] = std::fabs(plane.z);
+        }
+        prepared.pointX = query.viewPoint.x;
+        prepared.pointY = query.viewPoint.y;
+        prepared.pointZ = query.viewPoint.z;
+        prepared.maxDistance = query.maxDistance;
+        prepared.testDistance = std::isfinite(query.maxDistance);
+        prepared.useAabbs = query.useAabbs;
+        return prepared;
+    }
+
+    //Reference kernel, also runs the objects left over after the last full vector
+    //Every kernel evaluates (a * x + b * y) + (c * z + d) in that order so all levels round identically
+    uint32_t scalarKernel(const Streams& s, const PreparedQuery& q, uint32_t begin, uint32_t end, uint32_t* visible, uint32_t count) {
+        for (uint32_t i = begin; i < end; i++) {
+            bool inside = true;
+            if (q.useAabbs) {
+                for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+                    float distance = (q.normalX[p] * s.boxX[i] + q.normalY[p] * s.boxY[i]) + (q.normalZ[p] * s.boxZ[i] + q.distance[p]);
+                    float extent = (q.absX[p] * s.extentX[i] + q.absY[p] * s.extentY[i]) + q.absZ[p] * s.extentZ[i];
+                    inside = inside && distance >= -extent;
+                }
+                if (q.testDistance) {
+                    //Distance from the point to the closest point of the box
+                    float dx = std::max(std::fabs(s.boxX[i] - q.pointX) - s.extentX[i], 0.0f);
+                    float dy = std::max(std::fabs(s.boxY[i] - q.pointY) - s.extentY[i], 0.0f);
+                    float dz = std::max(std::fabs(s.boxZ[i] - q.pointZ) - s.extentZ[i], 0.0f);
+                    inside = inside && (dx * dx + dy * dy) + dz * dz <= q.maxDistance * q.maxDistance;
+                }
+            }
+            else {
+                for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+                    float distance = (q.normalX[p] * s.x[i] + q.normalY[p] * s.y[i]) + (q.normalZ[p] * s.z[i] + q.distance[p]);
+                    inside = inside && distance >= -s.radius[i];
+                }
+                if (q.testDistance) {
+                    float dx = s.x[i] - q.pointX;
+                    float dy = s.y[i] - q.pointY;
+                    float dz = s.z[i] - q.pointZ;
+                    float limit = q.maxDistance + s.radius[i];
+                    inside = inside && (dx * dx + dy * dy) + dz * dz <= limit * limit;
+                }
+            }
+            if (inside) {
+                visible[count++] = i;
+            }
+        }
+        return count;
+    }
+
+#ifdef VGL_CULL_X86
+
+    //Write every lane's index and only advance past the visible ones, avoids a branch per object
+    inline uint32_t compact(int mask, uint32_t first, uint32_t lanes, uint32_t* visible, uint32_t count) {
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            visible[count] = first + lane;
+            count += (mask >> lane) & 1;
+        }
+        return count;
+    }
+
+    uint32_t sse2Kernel(const Streams& s, const PreparedQuery& q, uint32_t& i, uint32_t end, uint32_t* visible, uint32_t count) {
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 pointX = _mm_set1_ps(q.pointX);
+        const __m128 pointY = _mm_set1_ps(q.pointY);
+        const __m128 pointZ = _mm_set1_ps(q.pointZ);
+        const __m128 maxDistance = _mm_set1_ps(q.maxDistance);
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            if (q.useAabbs) {
+                __m128 x = _mm_loadu_ps(s.boxX + i);
+                __m128 y = _mm_loadu_ps(s.boxY + i);
+                __m128 z = _mm_loadu_ps(s.boxZ + i);
+                __m128 ex = _mm_loadu_ps(s.extentX + i);
+                __m128 ey = _mm_loadu_ps(s.extentY + i);
+                __m128 ez = _mm_loadu_ps(s.extentZ + i);
+                for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(q.normalX[p]), x), _mm_mul_ps(_mm_set1_ps(q.normalY[p]), y)),
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(q.normalZ[p]), z), _mm_set1_ps(q.distance[p])));
+                    __m128 extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(q.absX[p]), ex), _mm_mul_ps(_mm_set1_ps(q.absY[p]), ey)),
+                        _mm_mul_ps(_mm_set1_ps(q.absZ[p]), ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(extent, signBit)));
+                }
+                if (q.testDistance) {
+                    __m128 dx = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(signBit, _mm_sub_ps(x, pointX)), ex), zero);
+                    __m128 dy = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(signBit, _mm_sub_ps(y, pointY)), ey), zero);
+                    __m128 dz = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(signBit, _mm_sub_ps(z, pointZ)), ez), zero);
+                    __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                    inside = _mm_and_ps(inside, _mm_cmple_ps(squared, _mm_mul_ps(maxDistance, maxDistance)));
+                }
+            }
+            else {
+                __m128 x = _mm_loadu_ps(s.x + i);
+                __m128 y = _mm_loadu_ps(s.y + i);
+                __m128 z = _mm_loadu_ps(s.z + i);
+                __m128 radius = _mm_loadu_ps(s.radius + i);
+                __m128 negativeRadius = _mm_xor_ps(radius, signBit);
+                for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(q.normalX[p]), x), _mm_mul_ps(_mm_set1_ps(q.normalY[p]), y)),
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(q.normalZ[p]), z), _mm_set1_ps(q.distance[p])));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+                }
+                if (q.testDistance) {
+                    __m128 dx = _mm_sub_ps(x, pointX);
+                    __m128 dy = _mm_sub_ps(y, pointY);
+                    __m128 dz = _mm_sub_ps(z, pointZ);
+                    __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                    __m128 limit = _mm_add_ps(maxDistance, radius);
+                    inside = _mm_and_ps(inside, _mm_cmple_ps(squared, _mm_mul_ps(limit, limit)));
+                }
+            }
+            count = compact(_mm_movemask_ps(inside), i, 4, visible, count);
+        }
+        return count;
+    }
+
+    VGL_TARGET_AVX2 uint32_t avx2Kernel(const Streams& s, const PreparedQuery& q, uint32_t& i, uint32_t end, uint32_t* visible, uint32_t count) {
+        const __m256 signBit = _mm256_set1_ps(-0.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 pointX = _mm256_set1_ps(q.pointX);
+        const __m256 pointY = _mm256_set1_ps(q.pointY);
+        const __m256 pointZ = _mm256_set1_ps(q.pointZ);
+        const __m256 maxDistance = _mm256_set1_ps(q.maxDistance);
+
+        for (; i + 8 <= end; i += 8) {
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            if (q.useAabbs) {
+                __m256 x = _mm256_loadu_ps(s.boxX + i);
+                __m256 y = _mm256_loadu_ps(s.boxY + i);
+                __m256 z = _mm256_loadu_ps(s.boxZ + i);
+                __m256 ex = _mm256_loadu_ps(s.extentX + i);
+                __m256 ey = _mm256_loadu_ps(s.extentY + i);
+                __m256 ez = _mm256_loadu_ps(s.extentZ + i);
+                for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(q.normalX[p]), x), _mm256_mul_ps(_mm256_set1_ps(q.normalY[p]), y)),
+                        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(q.normalZ[p]), z), _mm256_set1_ps(q.distance[p])));
+                    __m256 extent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(q.absX[p]), ex), _mm256_mul_ps(_mm256_set1_ps(q.absY[p]), ey)),
+                        _mm256_mul_ps(_mm256_set1_ps(q.absZ[p]), ez));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(extent, signBit), _CMP_GE_OQ));
+                }
+                if (q.testDistance) {
+                    __m256 dx = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(signBit, _mm256_sub_ps(x, pointX)), ex), zero);
+                    __m256 dy = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(signBit, _mm256_sub_ps(y, pointY)), ey), zero);
+                    __m256 dz = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(signBit, _mm256_sub_ps(z, pointZ)), ez), zero);
+                    __m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(squared, _mm256_mul_ps(maxDistance, maxDistance), _CMP_LE_OQ));
+                }
+            }
+            else {
+                __m256 x = _mm256_loadu_ps(s.x + i);
+                __m256 y = _mm256_loadu_ps(s.y + i);
+                __m256 z = _mm256_loadu_ps(s.z + i);
+                __m256 radius = _mm256_loadu_ps(s.radius + i);
+                __m256 negativeRadius = _mm256_xor_ps(radius, signBit);
+                for (uint32_t p = 0; p < vgl::Frustum::PlaneCount; p++) {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(q.normalX[p]), x), _mm256_mul_ps(_mm256_set1_ps(q.normalY[p]), y)),
+                        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(q.normalZ[p]), z), _mm256_set1_ps(q.distance[p])));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+                }
+                if (q.testDistance) {
+                    __m256 dx = _mm256_sub_ps(x, pointX);
+                    __m256 dy = _mm256_sub_ps(y, pointY);
+                    __m256 dz = _mm256_sub_ps(z, pointZ);
+                    __m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+                    __m256 limit = _mm256_add_ps(maxDistance, radius);
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(squared, _mm256_mul_ps(limit, limit), _CMP_LE_OQ));
+                }
+            }
+            count = compact(_mm256_movemask_ps(inside), i, 8, visible, count);
+        }
+        return count;
+    }
+
+    bool cpuHasAvx2() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) { return false; }
+        __cpuid(info, 1);
+        //The OS has to save the YMM registers as well
+        bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+#endif
+
+}
+
+glm::vec3 vgl::Aabb::getCenter() const {
+    return (this->min + this->max) * 0.5f;
+}
+
+glm::vec3 vgl::Aabb::getExtents() const {
+    return (this->max - this->min) * 0.5f;
+}
+
+vgl::Sphere vgl::Aabb::getBoundingSphere() const {
+    return { this->getCenter(), glm::length(this->getExtents()) };
+}
+
+vgl::Frustum vgl::Frustum::fromViewProjection(const glm::mat4& m) {
+    //m[column][row], so the rows of the matrix are gathered across columns
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++) {
+        rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+    }
+
+    //Clip space is -w <= x <= w, -w <= y <= w, 0 <= z <= w
+    Frustum frustum;
+    frustum.planes[Left] = rows[3] + rows[0];
+    frustum.planes[Right] = rows[3] - rows[0];
+    frustum.planes[Bottom] = rows[3] + rows[1];
+    frustum.planes[Top] = rows[3] - rows[1];
+    frustum.planes[Near] = rows[2];
+    frustum.planes[Far] = rows[3] - rows[2];
+
+    //Normalise so plane distances are in world units and can be compared with radii
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        if (length > 0.0f) {
+            plane = plane / length;
+        }
+    }
+    return frustum;
+}
+
+vgl::Frustum vgl::Frustum::fromViewProjection(const float* viewProjection) {
+    glm::mat4 m(1.0f);
+    std::copy(viewProjection, viewProjection + 16, glm::value_ptr(m));
+    return fromViewProjection(m);
+}
+
+bool vgl::Frustum::intersects(const vgl::Sphere& sphere) const {
+    for (const auto& plane : this->planes) {
+        if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), sphere.center) + plane.w < -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool vgl::Frustum::intersects(const vgl::Aabb& box) const {
+    glm::vec3 center = box.getCenter();
+    glm::vec3 extents = box.getExtents();
+    for (const auto& plane : this->planes) {
+        glm::vec3 normal(plane.x, plane.y, plane.z);
+        if (glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extents)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void vgl::BoundingVolumeSet::clear() {
+    for (auto* stream : { &this->centerX, &this->centerY, &this->centerZ, &this->radius, &this->boxX, &this->boxY, &this->boxZ,
+        &this->extentX, &this->extentY, &this->extentZ }) {
+        stream->clear();
+    }
+}
+
+void vgl::BoundingVolumeSet::reserve(uint32_t count) {
+    for (auto* stream : { &this->centerX, &this->centerY, &this->centerZ, &this->radius, &this->boxX, &this->boxY, &this->boxZ,
+        &this->extentX, &this->extentY, &this->extentZ }) {
+        stream->reserve(count);
+    }
+}
+
+uint32_t vgl::BoundingVolumeSet::add(const vgl::Sphere& sphere) {
+    uint32_t index = this->size();
+    for (auto* stream : { &this->centerX, &this->centerY, &this->centerZ, &this->radius, &this->boxX, &this->boxY, &this->boxZ,
+        &this->extentX, &this->extentY, &this->extentZ }) {
+        stream->push_back(0.0f);
+    }
+    this->set(index, sphere);
+    return index;
+}
+
+uint32_t vgl::BoundingVolumeSet::add(const vgl::Aabb& box) {
+    uint32_t index = this->add(vgl::Sphere{});
+    this->set(index, box);
+    return index;
+}
+
+void vgl::BoundingVolumeSet::set(uint32_t index, const vgl::Sphere& sphere) {
+    this->centerX[index] = sphere.center.x;
+    this->centerY[index] = sphere.center.y;
+    this->centerZ[index] = sphere.center.z;
+    this->radius[index] = sphere.radius;
+
+    //Cube around the sphere
+    this->boxX[index] = sphere.center.x;
+    this->boxY[index] = sphere.center.y;
+    this->boxZ[index] = sphere.center.z;
+    this->extentX[index] = sphere.radius;
+    this->extentY[index] = sphere.radius;
+    this->extentZ[index] = sphere.radius;
+}
+
+void vgl::BoundingVolumeSet::set(uint32_t index, const vgl::Aabb& box) {
+    glm::vec3 center = box.getCenter();
+    glm::vec3 extents = box.getExtents();
+    this->boxX[index] = center.x;
+    this->boxY[index] = center.y;
+    this->boxZ[index] = center.z;
+    this->extentX[index] = extents.x;
+    this->extentY[index] = extents.y;
+    this->extentZ[index] = extents.z;
+
+    this->centerX[index] = center.x;
+    this->centerY[index] = center.y;
+    this->centerZ[index] = center.z;
+    this->radius[index] = glm::length(extents);
+}
+
+vgl::Sphere vgl::BoundingVolumeSet::getSphere(uint32_t index) const {
+    return { glm::vec3(this->centerX[index], this->centerY[index], this->centerZ[index]), this->radius[index] };
+}
+
+vgl::Aabb vgl::BoundingVolumeSet::getAabb(uint32_t index) const {
+    glm::vec3 center(this->boxX[index], this->boxY[index], this->boxZ[index]);
+    glm::vec3 extents(this->extentX[index], this->extentY[index], this->extentZ[index]);
+    return { center - extents, center + extents };
+}
+
+uint32_t vgl::BoundingVolumeSet::size() const {
+    return static_cast<uint32_t>(this->radius.size());
+}
+
+uint32_t vgl::BoundingVolumeSet::cull(const vgl::CullQuery& query, std::vector<uint32_t>& visible) const {
+    return this->cull(query, visible, getSimdLevel());
+}
+
+uint32_t vgl::BoundingVolumeSet::cull(const vgl::CullQuery& query, std::vector<uint32_t>& visible, vgl::SimdLevel level) const {
+    if (!isSupported(level)) {
+        throw std::runtime_error("SIMD LEVEL NOT SUPPORTED BY THIS CPU");
+    }
+
+    Streams streams{ this->centerX.data(), this->centerY.data(), this->centerZ.data(), this->radius.data(), this->boxX.data(), this->boxY.data(),
+        this->boxZ.data(), this->extentX.data(), this->extentY.data(), this->extentZ.data() };
+    PreparedQuery prepared = prepare(query);
+
+    uint32_t count = this->size();
+    visible.resize(count);
+    uint32_t visibleCount = 0;
+    uint32_t i = 0;
+
+#ifdef VGL_CULL_X86
+    if (level == SimdLevel::Avx2) {
+        visibleCount = avx2Kernel(streams, prepared, i, count, visible.data(), visibleCount);
+    }
+    //Also picks up a remainder of 4 to 7 after the AVX2 kernel
+    if (level != SimdLevel::Scalar) {
+        visibleCount = sse2Kernel(streams, prepared, i, count, visible.data(), visibleCount);
+    }
+#endif
+
+    visibleCount = scalarKernel(streams, prepared, i, count, visible.data(), visibleCount);
+    visible.resize(visibleCount);
+    return visibleCount;
+}
+
+uint32_t vgl::BoundingVolumeSet::cull(const vgl::Frustum& frustum, std::vector<uint32_t>& visible) const {
+    vgl::CullQuery query;
+    query.frustum = frustum;
+    return this->cull(query, visible, getSimdLevel());
+}
+
+uint32_t vgl::BoundingVolumeSet::cullScalar(const vgl::Frustum& frustum, std::vector<uint32_t>& visible) const {
+    vgl::CullQuery query;
+    query.frustum = frustum;
+    return this->cull(query, visible, SimdLevel::Scalar);
+}
+
+vgl::SimdLevel vgl::BoundingVolumeSet::getSimdLevel() {
+#ifdef VGL_CULL_X86
+    static const SimdLevel level = cpuHasAvx2() ? SimdLevel::Avx2 : SimdLevel::Sse2;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+bool vgl::BoundingVolumeSet::isSupported(vgl::SimdLevel level) {
+    return static_cast<uint32_t>(level) <= static_cast<uint32_t>(getSimdLevel());
+}
+
+const char* vgl::BoundingVolumeSet::getSimdLevelName(vgl::SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Sse2: return "SSE2";
+    case SimdLevel::Avx2: return "AVX2";
+    default: return "Scalar";
+    }
+}
@@ -0,0 +1,141 @@
+#include "vgl/ChromeTrace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+    std::chrono::steady_clock::time_point getEpoch() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return epoch;
+    }
+
+    //Names can contain anything, the JSON only allows some of it unescaped
+    void writeString(std::ostream& out, const std::string& value) {
+        out << '"';
+        for (char c : value) {
+            switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                    out << escaped;
+                }
+                else {
+                    out << c;
+                }
+            }
+        }
+        out << '"';
+    }
+
+}
+
+double vgl::ChromeTrace::now() {
+    return toTraceTime(std::chrono::steady_clock::now());
+}
+
+double vgl::ChromeTrace::toTraceTime(std::chrono::steady_clock::time_point _time) {
+    return std::chrono::duration<double, std::micro>(_time - getEpoch()).count();
+}
+
+uint32_t vgl::ChromeTrace::getThreadId() {
+    static std::atomic<uint32_t> nextId{ 1 };
+    thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void vgl::ChromeTrace::addEvent(const vgl::TraceEvent& _event) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->events.push_back(_event);
+}
+
+void vgl::ChromeTrace::addEvents(const std::vector<vgl::TraceEvent>& _events) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->events.insert(this->events.end(), _events.begin(), _events.end());
+}
+
+void vgl::ChromeTrace::addCpuScope(const std::string& _name, double _beginUs, double _endUs) {
+    vgl::TraceEvent event;
+    event.name = _name;
+    event.category = "cpu";
+    event.processId = cpuProcess;
+    event.threadId = getThreadId();
+    event.beginUs = _beginUs;
+    event.durationUs = _endUs - _beginUs;
+    this->addEvent(event);
+}
+
+void vgl::ChromeTrace::setThreadName(uint32_t _processId, uint32_t _threadId, const std::string& _name) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (ThreadName& threadName : this->threadNames) {
+        if (threadName.processId == _processId && threadName.threadId == _threadId) {
+            threadName.name = _name;
+            return;
+        }
+    }
+    this->threadNames.push_back({ _processId, _threadId, _name });
+}
+
+size_t vgl::ChromeTrace::getEventCount() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->events.size();
+}
+
+void vgl::ChromeTrace::clear() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->events.clear();
+}
+
+bool vgl::ChromeTrace::write(const std::string& _path) const {
+    std::ofstream file(_path, std::ios::trunc);
+    if (!file.is_open()) { return false; }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << cpuProcess << ",\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << gpuProcess << ",\"args\":{\"name\":\"GPU\"}}";
+
+    for (const ThreadName& threadName : this->threadNames) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << threadName.processId << ",\"tid\":" << threadName.threadId << ",\"args\":{\"name\":";
+        writeString(file, threadName.name);
+        file << "}}";
+    }
+
+    //Microseconds with nanosecond precision, more digits than that is noise
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    for (const vgl::TraceEvent& event : this->events) {
+        file << ",\n{\"name\":";
+        writeString(file, event.name);
+        file << ",\"cat\":";
+        writeString(file, event.category.empty() ? std::string("default") : event.category);
+        file << ",\"ph\":\"X\",\"pid\":" << event.processId << ",\"tid\":" << event.threadId
+            << ",\"ts\":" << event.beginUs << ",\"dur\":" << event.durationUs << "}";
+    }
+    file << "\n]}\n";
+
+    file.flush();
+    return file.good();
+}
+
+vgl::CpuTraceScope::CpuTraceScope(vgl::ChromeTrace* _trace, const char* _name)
+    : trace(_trace), name(_name)
+{
+    if (this->trace) {
+        this->beginUs = vgl::ChromeTrace::now();
+    }
+}
+
+vgl::CpuTraceScope::~CpuTraceScope() {
+    if (this->trace) {
+        this->trace->addCpuScope(this->name, this->beginUs, vgl::ChromeTrace::now());
+    }
+}
@@ -0,0 +1,141 @@
+#include "vgl/CommandRecorder.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::CommandRecorder::CommandRecorder(vgl::LogicalDevice* _logicalDevice, vgl::JobSystem* _jobSystem, uint32_t _queueFamily, uint32_t _frameCount)
+    : logicalDevice(_logicalDevice),
+    jobSystem(_jobSystem)
+{
+    VkDevice device = this->logicalDevice->device;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    //Buffers are re-recorded every frame and only ever reset through the pool
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = _queueFamily;
+
+    this->frames.resize(_frameCount);
+    for (auto& threadPools : this->frames) {
+        threadPools.resize(this->jobSystem->getThreadCount());
+        for (auto& threadPool : threadPools) {
+            if (vkCreateCommandPool(device, &poolInfo, vgl::HostAllocator::callbacks(), &threadPool.pool) != VK_SUCCESS) {
+                throw std::runtime_error("FAILED TO CREATE SECONDARY COMMAND POOL");
+            }
+        }
+    }
+}
+
+vgl::CommandRecorder::~CommandRecorder() {
+    VkDevice device = this->logicalDevice->device;
+
+    //Destroying a pool frees its command buffers
+    for (auto& threadPools : this->frames) {
+        for (auto& threadPool : threadPools) {
+            if (threadPool.pool) { vkDestroyCommandPool(device, threadPool.pool, vgl::HostAllocator::callbacks()); }
+        }
+    }
+}
+
+void vgl::CommandRecorder::beginFrame(uint32_t frameIndex) {
+    std::lock_guard<std::mutex> lock(this->recordMutex);
+    this->currentFrame = frameIndex % static_cast<uint32_t>(this->frames.size());
+
+    for (auto& threadPool : this->frames[this->currentFrame]) {
+        //Pools nobody recorded into have nothing to reset
+        if (threadPool.used == 0) { continue; }
+        vkResetCommandPool(this->logicalDevice->device, threadPool.pool, 0);
+        threadPool.used = 0;
+    }
+    this->stats.recordedThisFrame = 0;
+}
+
+std::vector<VkCommandBuffer> vgl::CommandRecorder::recordSecondaries(uint32_t count, uint32_t batchSize, const vgl::SecondaryInheritance& inheritance, const RecordFunction& record) {
+    std::lock_guard<std::mutex> lock(this->recordMutex);
+
+    if (count == 0) { return {}; }
+    if (batchSize == 0) { batchSize = 1; }
+    uint32_t batchCount = (count + batchSize - 1) / batchSize;
+
+    VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(inheritance.colorFormats.size());
+    renderingInfo.pColorAttachmentFormats = inheritance.colorFormats.data();
+    renderingInfo.depthAttachmentFormat = inheritance.depthFormat;
+    renderingInfo.rasterizationSamples = inheritance.samples;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = inheritance.renderPass;
+    inheritanceInfo.subpass = inheritance.subpass;
+    inheritanceInfo.framebuffer = inheritance.framebuffer;
+    //Dynamic rendering formats are only chained in when there's no render pass to inherit from
+    if (inheritance.renderPass == VK_NULL_HANDLE && inheritance.continuesRendering()) {
+        inheritanceInfo.pNext = &renderingInfo;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (inheritance.continuesRendering()) {
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    std::vector<VkCommandBuffer> secondaries(batchCount, VK_NULL_HANDLE);
+    std::vector<ThreadPool>& threadPools = this->frames[this->currentFrame];
+
+    this->jobSystem->parallelFor(count, batchSize, [&](uint32_t begin, uint32_t end) {
+        //Each thread index only ever runs one batch at a time, so its pool is never shared
+        ThreadPool& threadPool = threadPools[vgl::JobSystem::getThreadIndex()];
+        VkCommandBuffer commandBuffer = this->acquireSecondary(threadPool);
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO BEGIN SECONDARY COMMAND BUFFER");
+        }
+        record(commandBuffer, begin, end);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO RECORD SECONDARY COMMAND BUFFER");
+        }
+
+        secondaries[begin / batchSize] = commandBuffer;
+    });
+
+    this->stats.recordedThisFrame += batchCount;
+    return secondaries;
+}
+
+void vgl::CommandRecorder::recordParallel(VkCommandBuffer primary, uint32_t count, uint32_t batchSize, const vgl::SecondaryInheritance& inheritance, const RecordFunction& record) {
+    execute(primary, this->recordSecondaries(count, batchSize, inheritance, record));
+}
+
+void vgl::CommandRecorder::execute(VkCommandBuffer primary, const std::vector<VkCommandBuffer>& secondaries) {
+    if (secondaries.empty()) { return; }
+    vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+vgl::CommandRecorder::Stats vgl::CommandRecorder::getStats() const {
+    Stats current = this->stats;
+    current.allocated = this->allocatedCount.load();
+    return current;
+}
+
+VkCommandBuffer vgl::CommandRecorder::acquireSecondary(ThreadPool& threadPool) {
+    if (threadPool.used == threadPool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = threadPool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = allocationChunk;
+
+        size_t first = threadPool.buffers.size();
+        threadPool.buffers.resize(first + allocationChunk);
+        if (vkAllocateCommandBuffers(this->logicalDevice->device, &allocInfo, threadPool.buffers.data() + first) != VK_SUCCESS) {
+            threadPool.buffers.resize(first);
+            throw std::runtime_error("FAILED TO ALLOCATE SECONDARY COMMAND BUFFERS");
+        }
+
+        //Several threads can grow their pools at once
+        this->allocatedCount.fetch_add(allocationChunk);
+    }
+    return threadPool.buffers[threadPool.used++];
+}
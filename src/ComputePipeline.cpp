@@ -0,0 +1,112 @@
+#include "vgl/ComputePipeline.h"
+
+#include "vgl/HostAllocator.h"
+#include "vgl/ShaderReflection.h"
+
+vgl::ComputePipeline::ComputePipeline(vgl::LogicalDevice* _logicalDevice, const std::vector<char>& _spirv, const std::vector<VkDescriptorSetLayout>& _setLayouts,
+    uint32_t _pushConstantSize, const VkSpecializationInfo* _specialization)
+    : logicalDevice(_logicalDevice)
+{
+    VkDevice device = this->logicalDevice->device;
+
+    //SPIR-V is made of 32 bit words
+    if (_spirv.empty() || _spirv.size() % 4 != 0) {
+        throw std::runtime_error("INVALID COMPUTE SHADER CODE");
+    }
+
+    //The entry point is whatever the module declares, it isn't always called main
+    vgl::ShaderReflection reflection = vgl::ShaderReflection::reflect(reinterpret_cast<const uint32_t*>(_spirv.data()), _spirv.size() / 4);
+    if (reflection.stage != VK_SHADER_STAGE_COMPUTE_BIT) {
+        throw std::runtime_error("SHADER IS NOT A COMPUTE SHADER");
+    }
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = _spirv.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(_spirv.data());
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(device, &moduleInfo, vgl::HostAllocator::callbacks(), &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE COMPUTE SHADER MODULE");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = _pushConstantSize;
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = static_cast<uint32_t>(_setLayouts.size());
+    layoutInfo.pSetLayouts = _setLayouts.data();
+    layoutInfo.pushConstantRangeCount = _pushConstantSize > 0 ? 1 : 0;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &layoutInfo, vgl::HostAllocator::callbacks(), &this->layout) != VK_SUCCESS) {
+        vkDestroyShaderModule(device, shaderModule, vgl::HostAllocator::callbacks());
+        throw std::runtime_error("FAILED TO CREATE COMPUTE PIPELINE LAYOUT");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = reflection.entryPoint.c_str();
+    pipelineInfo.stage.pSpecializationInfo = _specialization;
+    pipelineInfo.layout = this->layout;
+
+    vgl::PipelineCache* cache = this->logicalDevice->getPipelineCache();
+    auto createStart = std::chrono::steady_clock::now();
+    VkResult result = vkCreateComputePipelines(device, cache->getCache(), 1, &pipelineInfo, vgl::HostAllocator::callbacks(), &this->pipeline);
+    cache->recordCreation(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - createStart).count());
+
+    //The module is only needed while the pipeline is created
+    vkDestroyShaderModule(device, shaderModule, vgl::HostAllocator::callbacks());
+
+    if (result != VK_SUCCESS) {
+        vkDestroyPipelineLayout(device, this->layout, vgl::HostAllocator::callbacks());
+        throw std::runtime_error("FAILED TO CREATE COMPUTE PIPELINE");
+    }
+}
+
+vgl::ComputePipeline::~ComputePipeline() {
+    VkDevice device = this->logicalDevice->device;
+    if (this->pipeline) { vkDestroyPipeline(device, this->pipeline, vgl::HostAllocator::callbacks()); }
+    if (this->layout) { vkDestroyPipelineLayout(device, this->layout, vgl::HostAllocator::callbacks()); }
+}
+
+void vgl::ComputePipeline::bind(VkCommandBuffer commandBuffer) const {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->pipeline);
+}
+
+void vgl::ComputePipeline::bindDescriptorSets(VkCommandBuffer commandBuffer, const std::vector<VkDescriptorSet>& sets, uint32_t firstSet) const {
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->layout, firstSet, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+}
+
+void vgl::ComputePipeline::pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset) const {
+    vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_COMPUTE_BIT, offset, size, data);
+}
+
+void vgl::ComputePipeline::dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) const {
+    vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+uint32_t vgl::ComputePipeline::groupCount(uint32_t invocations, uint32_t groupSize) {
+    return (invocations + groupSize - 1) / groupSize;
+}
+
+std::vector<char> vgl::ComputePipeline::readFile(const std::string& filename) {
+    //Start reading at the end of the file so the size is known
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("FAILED TO OPEN FILE " + filename);
+    }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    return buffer;
+}
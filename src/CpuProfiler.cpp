@@ -0,0 +1,238 @@
+#include "vgl/CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+    int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //Nearest rank percentile of sorted durations
+    double percentile(const std::vector<double>& _sorted, double _fraction) {
+        if (_sorted.empty()) { return 0.0; }
+        size_t rank = static_cast<size_t>(_fraction * static_cast<double>(_sorted.size() - 1) + 0.5);
+        return _sorted[std::min(rank, _sorted.size() - 1)];
+    }
+
+}
+
+vgl::CpuProfiler& vgl::CpuProfiler::get() {
+    //Leaked on purpose, worker threads can still be recording while static destructors run
+    static vgl::CpuProfiler* profiler = new vgl::CpuProfiler();
+    return *profiler;
+}
+
+void vgl::CpuProfiler::setEnabled(bool _enabled) {
+    this->enabled.store(_enabled, std::memory_order_relaxed);
+}
+
+bool vgl::CpuProfiler::isEnabled() const {
+    return this->enabled.load(std::memory_order_relaxed);
+}
+
+vgl::CpuProfiler::ThreadRing* vgl::CpuProfiler::getThreadRing() {
+    //Drains and frees the ring when the thread exits, so short lived threads don't leave a ring behind each
+    struct RingOwner {
+        ThreadRing* ring = nullptr;
+        bool exited = false;
+
+        ~RingOwner() {
+            if (this->ring) { vgl::CpuProfiler::get().releaseThreadRing(this->ring); }
+            this->ring = nullptr;
+            this->exited = true;
+        }
+    };
+
+    thread_local RingOwner owner;
+    //Scopes ending in other thread_local destructors after the ring was released are not recorded
+    if (!owner.ring && !owner.exited) {
+        auto newRing = std::make_unique<ThreadRing>();
+        newRing->threadId = vgl::ChromeTrace::getThreadId();
+        newRing->samples = std::make_unique<Sample[]>(ringCapacity);
+        owner.ring = newRing.get();
+
+        std::lock_guard<std::mutex> lock(this->ringMutex);
+        this->rings.push_back(std::move(newRing));
+    }
+    return owner.ring;
+}
+
+void vgl::CpuProfiler::releaseThreadRing(ThreadRing* _ring) {
+    std::lock_guard<std::mutex> collectLock(this->collectMutex);
+    std::lock_guard<std::mutex> ringLock(this->ringMutex);
+
+    auto it = std::find_if(this->rings.begin(), this->rings.end(), [_ring](const std::unique_ptr<ThreadRing>& ring) { return ring.get() == _ring; });
+    if (it == this->rings.end()) { return; }
+
+    //Samples the thread recorded since the last collect would be lost otherwise
+    this->drain(**it);
+    this->rings.erase(it);
+}
+
+void vgl::CpuProfiler::record(const char* _name, int64_t _beginNs, int64_t _endNs) {
+    if (!this->isEnabled()) { return; }
+
+    ThreadRing* ring = this->getThreadRing();
+    if (!ring) { return; }
+
+    //Only this thread moves head, collect only moves tail
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= ringCapacity) {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Sample& sample = ring->samples[head % ringCapacity];
+    sample.name = _name;
+    sample.beginNs = _beginNs;
+    sample.endNs = _endNs;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void vgl::CpuProfiler::collect() {
+    std::lock_guard<std::mutex> collectLock(this->collectMutex);
+    std::lock_guard<std::mutex> ringLock(this->ringMutex);
+
+    for (auto& ring : this->rings) {
+        this->drain(*ring);
+    }
+}
+
+void vgl::CpuProfiler::drain(ThreadRing& _ring) {
+    uint64_t tail = _ring.tail.load(std::memory_order_relaxed);
+    uint64_t head = _ring.head.load(std::memory_order_acquire);
+
+    for (; tail < head; tail++) {
+        const Sample& sample = _ring.samples[tail % ringCapacity];
+        double durationMs = static_cast<double>(sample.endNs - sample.beginNs) / 1e6;
+
+        //Most names are the same literal every time, so avoid building a string per sample
+        ScopeSamples*& cached = this->scopesByName[sample.name];
+        if (!cached) {
+            cached = &this->scopes[sample.name];
+        }
+        ScopeSamples& scope = *cached;
+        if (scope.durationsMs.size() < maxSamplesPerScope) {
+            scope.durationsMs.push_back(durationMs);
+        }
+        else {
+            scope.durationsMs[scope.next] = durationMs;
+            scope.next = (scope.next + 1) % maxSamplesPerScope;
+        }
+        scope.count++;
+        scope.totalMs += durationMs;
+        scope.maxMs = std::max(scope.maxMs, durationMs);
+
+        if (this->trace.size() < maxTraceEvents) {
+            this->trace.push_back({ sample.name, _ring.threadId, sample.beginNs, sample.endNs });
+        }
+    }
+
+    //Hand the slots back to the thread only once they have been read
+    _ring.tail.store(tail, std::memory_order_release);
+}
+
+std::vector<vgl::CpuScopeStats> vgl::CpuProfiler::getReport() {
+    this->collect();
+
+    std::vector<vgl::CpuScopeStats> report;
+    {
+        std::lock_guard<std::mutex> lock(this->collectMutex);
+        report.reserve(this->scopes.size());
+
+        std::vector<double> sorted;
+        for (const auto& [name, scope] : this->scopes) {
+            sorted = scope.durationsMs;
+            std::sort(sorted.begin(), sorted.end());
+
+            vgl::CpuScopeStats stats;
+            stats.name = name;
+            stats.count = scope.count;
+            stats.totalMs = scope.totalMs;
+            stats.meanMs = scope.count > 0 ? scope.totalMs / static_cast<double>(scope.count) : 0.0;
+            stats.p50Ms = percentile(sorted, 0.50);
+            stats.p99Ms = percentile(sorted, 0.99);
+            stats.maxMs = scope.maxMs;
+            report.push_back(std::move(stats));
+        }
+    }
+
+    std::sort(report.begin(), report.end(), [](const vgl::CpuScopeStats& a, const vgl::CpuScopeStats& b) { return a.totalMs > b.totalMs; });
+    return report;
+}
+
+void vgl::CpuProfiler::printReport(std::ostream& _out) {
+    std::vector<vgl::CpuScopeStats> report = this->getReport();
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-48s %10s %12s %10s %10s %10s %10s\n", "Scope", "Count", "Total ms", "Mean ms", "p50 ms", "p99 ms", "Max ms");
+    _out << line;
+    for (const vgl::CpuScopeStats& stats : report) {
+        std::snprintf(line, sizeof(line), "%-48s %10llu %12.3f %10.3f %10.3f %10.3f %10.3f\n", stats.name.c_str(),
+            static_cast<unsigned long long>(stats.count), stats.totalMs, stats.meanMs, stats.p50Ms, stats.p99Ms, stats.maxMs);
+        _out << line;
+    }
+
+    uint64_t droppedCount = this->getDroppedCount();
+    if (droppedCount > 0) {
+        _out << droppedCount << " samples dropped, collect more often\n";
+    }
+}
+
+uint64_t vgl::CpuProfiler::getDroppedCount() const {
+    return this->dropped.load(std::memory_order_relaxed);
+}
+
+void vgl::CpuProfiler::exportTo(vgl::ChromeTrace& _trace) {
+    this->collect();
+
+    std::vector<vgl::TraceEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(this->collectMutex);
+        events.reserve(this->trace.size());
+        for (const TraceSample& sample : this->trace) {
+            std::chrono::steady_clock::time_point begin{ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(sample.beginNs)) };
+
+            vgl::TraceEvent event;
+            event.name = sample.name;
+            event.category = "cpu";
+            event.processId = vgl::ChromeTrace::cpuProcess;
+            event.threadId = sample.threadId;
+            event.beginUs = vgl::ChromeTrace::toTraceTime(begin);
+            event.durationUs = static_cast<double>(sample.endNs - sample.beginNs) / 1000.0;
+            events.push_back(std::move(event));
+        }
+    }
+    _trace.addEvents(events);
+}
+
+bool vgl::CpuProfiler::writeChromeTrace(const std::string& _path) {
+    vgl::ChromeTrace trace;
+    this->exportTo(trace);
+    return trace.write(_path);
+}
+
+void vgl::CpuProfiler::reset() {
+    std::lock_guard<std::mutex> collectLock(this->collectMutex);
+    std::lock_guard<std::mutex> ringLock(this->ringMutex);
+
+    for (auto& ring : this->rings) {
+        ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+    this->scopes.clear();
+    this->scopesByName.clear();
+    this->trace.clear();
+    this->dropped.store(0, std::memory_order_relaxed);
+}
+
+vgl::CpuProfileScope::CpuProfileScope(const char* _name)
+    : name(_name), beginNs(nowNs())
+{
+}
+
+vgl::CpuProfileScope::~CpuProfileScope() {
+    vgl::CpuProfiler::get().record(this->name, this->beginNs, nowNs());
+}
@@ -0,0 +1,369 @@
+#include "vgl/DescriptorAllocator.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#include "vgl/FileUtils.h"
+#include "vgl/HostAllocator.h"
+
+namespace {
+
+    //Covers the mix of descriptors a typical non-bindless set uses, types a pool has no room for fall through to the next pool
+    const vgl::DescriptorAllocator::PoolRatio poolRatios[] = {
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f },
+    };
+
+    //Only ever compared within one run so the byte order of value doesn't matter
+    void hashValue(uint64_t& hash, uint64_t value) {
+        hash = vgl::fnv1a64(&value, sizeof(value), hash);
+    }
+
+    template <typename T>
+    uint64_t handleValue(T handle) {
+        //Non-dispatchable handles are integers on 32 bit platforms and pointers on 64 bit ones
+        if constexpr (std::is_pointer<T>::value) {
+            return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+        }
+        else {
+            return static_cast<uint64_t>(handle);
+        }
+    }
+
+}
+
+vgl::DescriptorWriter& vgl::DescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range,
+    uint32_t arrayElement)
+{
+    Entry entry;
+    entry.binding = binding;
+    entry.arrayElement = arrayElement;
+    entry.type = type;
+    entry.bufferInfo = { buffer, offset, range };
+    this->entries.push_back(entry);
+    return *this;
+}
+
+vgl::DescriptorWriter& vgl::DescriptorWriter::writeImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout,
+    uint32_t arrayElement)
+{
+    Entry entry;
+    entry.binding = binding;
+    entry.arrayElement = arrayElement;
+    entry.type = type;
+    entry.image = true;
+    entry.imageInfo = { sampler, view, layout };
+    this->entries.push_back(entry);
+    return *this;
+}
+
+void vgl::DescriptorWriter::update(VkDevice device, VkDescriptorSet set) const {
+    if (this->entries.empty()) { return; }
+
+    //Entries own their infos so the writes can point straight at them
+    std::vector<VkWriteDescriptorSet> writes(this->entries.size());
+    for (size_t i = 0; i < this->entries.size(); i++) {
+        const Entry& entry = this->entries[i];
+        VkWriteDescriptorSet& write = writes[i];
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = entry.binding;
+        write.dstArrayElement = entry.arrayElement;
+        write.descriptorCount = 1;
+        write.descriptorType = entry.type;
+        if (entry.image) {
+            write.pImageInfo = &entry.imageInfo;
+        }
+        else {
+            write.pBufferInfo = &entry.bufferInfo;
+        }
+    }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+uint64_t vgl::DescriptorWriter::hash() const {
+    uint64_t hash = vgl::fnv1aOffset;
+    for (const Entry& entry : this->entries) {
+        hashValue(hash, (static_cast<uint64_t>(entry.binding) << 32) | entry.arrayElement);
+        hashValue(hash, (static_cast<uint64_t>(entry.type) << 1) | (entry.image ? 1 : 0));
+        if (entry.image) {
+            hashValue(hash, handleValue(entry.imageInfo.sampler));
+            hashValue(hash, handleValue(entry.imageInfo.imageView));
+            hashValue(hash, static_cast<uint64_t>(entry.imageInfo.imageLayout));
+        }
+        else {
+            hashValue(hash, handleValue(entry.bufferInfo.buffer));
+            hashValue(hash, entry.bufferInfo.offset);
+            hashValue(hash, entry.bufferInfo.range);
+        }
+    }
+    return hash;
+}
+
+bool vgl::DescriptorWriter::operator==(const DescriptorWriter& other) const {
+    if (this->entries.size() != other.entries.size()) { return false; }
+    for (size_t i = 0; i < this->entries.size(); i++) {
+        const Entry& a = this->entries[i];
+        const Entry& b = other.entries[i];
+        if (a.binding != b.binding || a.arrayElement != b.arrayElement || a.type != b.type || a.image != b.image) { return false; }
+        if (a.image) {
+            if (a.imageInfo.sampler != b.imageInfo.sampler || a.imageInfo.imageView != b.imageInfo.imageView || a.imageInfo.imageLayout != b.imageInfo.imageLayout) {
+                return false;
+            }
+        }
+        else if (a.bufferInfo.buffer != b.bufferInfo.buffer || a.bufferInfo.offset != b.bufferInfo.offset || a.bufferInfo.range != b.bufferInfo.range) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void vgl::DescriptorWriter::clear() {
+    this->entries.clear();
+}
+
+size_t vgl::DescriptorLayoutCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = vgl::fnv1aOffset;
+    for (uint64_t value : key) {
+        hashValue(hash, value);
+    }
+    return static_cast<size_t>(hash);
+}
+
+vgl::DescriptorLayoutCache::DescriptorLayoutCache(VkDevice _device)
+    : device(_device)
+{
+}
+
+vgl::DescriptorLayoutCache::~DescriptorLayoutCache() {
+    for (auto& layout : this->layouts) {
+        vkDestroyDescriptorSetLayout(this->device, layout.second, vgl::HostAllocator::callbacks());
+    }
+}
+
+VkDescriptorSetLayout vgl::DescriptorLayoutCache::getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags,
+    const std::vector<VkDescriptorBindingFlags>& bindingFlags)
+{
+    if (!bindingFlags.empty() && bindingFlags.size() != bindings.size()) {
+        throw std::runtime_error("DESCRIPTOR BINDING FLAGS DO NOT MATCH BINDINGS");
+    }
+
+    //Binding order doesn't change the layout, so sort before building the key
+    std::vector<uint32_t> order(bindings.size());
+    for (uint32_t i = 0; i < order.size(); i++) { order[i] = i; }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return bindings[a].binding < bindings[b].binding; });
+
+    Key key;
+    key.reserve(1 + bindings.size() * 3);
+    key.push_back(flags);
+    for (uint32_t i : order) {
+        const VkDescriptorSetLayoutBinding& binding = bindings[i];
+        key.push_back((static_cast<uint64_t>(binding.binding) << 32) | binding.descriptorType);
+        key.push_back((static_cast<uint64_t>(binding.descriptorCount) << 32) | binding.stageFlags);
+        key.push_back(bindingFlags.empty() ? 0 : bindingFlags[i]);
+        //Immutable samplers are baked into the layout
+        if (binding.pImmutableSamplers) {
+            for (uint32_t j = 0; j < binding.descriptorCount; j++) {
+                key.push_back(handleValue(binding.pImmutableSamplers[j]));
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto found = this->layouts.find(key);
+    if (found != this->layouts.end()) {
+        return found->second;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+    layoutInfo.flags = flags;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(this->device, &layoutInfo, vgl::HostAllocator::callbacks(), &layout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE DESCRIPTOR SET LAYOUT");
+    }
+    this->layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+uint32_t vgl::DescriptorLayoutCache::getLayoutCount() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return static_cast<uint32_t>(this->layouts.size());
+}
+
+vgl::DescriptorAllocator::DescriptorAllocator(vgl::LogicalDevice* _logicalDevice, vgl::JobSystem* _jobSystem, uint32_t _frameCount)
+    : logicalDevice(_logicalDevice),
+    jobSystem(_jobSystem),
+    layoutCache(_logicalDevice->device)
+{
+    //Pools are created on first use, devices that only use the bindless heap never create any
+    this->frames.resize(_frameCount);
+    for (auto& threadPools : this->frames) {
+        threadPools.resize(this->jobSystem->getThreadCount());
+    }
+}
+
+vgl::DescriptorAllocator::~DescriptorAllocator() {
+    VkDevice device = this->logicalDevice->device;
+
+    //Destroying a pool frees its sets
+    for (auto& threadPools : this->frames) {
+        for (auto& threadPool : threadPools) {
+            for (VkDescriptorPool pool : threadPool.pools) {
+                vkDestroyDescriptorPool(device, pool, vgl::HostAllocator::callbacks());
+            }
+        }
+    }
+    for (VkDescriptorPool pool : this->persistentPools) {
+        vkDestroyDescriptorPool(device, pool, vgl::HostAllocator::callbacks());
+    }
+}
+
+void vgl::DescriptorAllocator::beginFrame(uint32_t frameIndex) {
+    std::lock_guard<std::mutex> lock(this->sharedThreadMutex);
+    this->currentFrame = frameIndex % static_cast<uint32_t>(this->frames.size());
+
+    for (auto& threadPool : this->frames[this->currentFrame]) {
+        //Pools nobody allocated from have nothing to reset
+        if (!threadPool.used) { continue; }
+        for (uint32_t i = 0; i <= threadPool.current && i < threadPool.pools.size(); i++) {
+            vkResetDescriptorPool(this->logicalDevice->device, threadPool.pools[i], 0);
+        }
+        threadPool.current = 0;
+        threadPool.used = false;
+    }
+    this->transientCount = 0;
+}
+
+VkDescriptorSet vgl::DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    uint32_t threadIndex = vgl::JobSystem::getThreadIndex();
+
+    //Workers each have their own pools, every other thread shares index 0
+    std::unique_lock<std::mutex> lock(this->sharedThreadMutex, std::defer_lock);
+    if (threadIndex == 0) { lock.lock(); }
+
+    ThreadPools& threadPool = this->frames[this->currentFrame][threadIndex];
+    threadPool.used = true;
+    VkDescriptorSet set = this->allocateFrom(threadPool.pools, threadPool.current, layout);
+    this->transientCount++;
+    return set;
+}
+
+VkDescriptorSet vgl::DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const vgl::DescriptorWriter& writer) {
+    VkDescriptorSet set = this->allocate(layout);
+    writer.update(this->logicalDevice->device, set);
+    return set;
+}
+
+VkDescriptorSet vgl::DescriptorAllocator::getPersistent(VkDescriptorSetLayout layout, const vgl::DescriptorWriter& writer) {
+    uint64_t hash = writer.hash();
+    hashValue(hash, handleValue(layout));
+
+    std::lock_guard<std::mutex> lock(this->persistentMutex);
+    auto range = this->persistent.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.layout == layout && it->second.writer == writer) {
+            this->persistentHits++;
+            return it->second.set;
+        }
+    }
+
+    //Persistent pools are never reset, so the current pool is always the last one
+    uint32_t current = this->persistentPools.empty() ? 0 : static_cast<uint32_t>(this->persistentPools.size() - 1);
+    PersistentSet entry;
+    entry.layout = layout;
+    entry.writer = writer;
+    entry.set = this->allocateFrom(this->persistentPools, current, layout);
+    writer.update(this->logicalDevice->device, entry.set);
+
+    VkDescriptorSet set = entry.set;
+    this->persistent.emplace(hash, std::move(entry));
+    return set;
+}
+
+vgl::DescriptorLayoutCache* vgl::DescriptorAllocator::getLayoutCache() {
+    return &this->layoutCache;
+}
+
+vgl::DescriptorAllocator::Stats vgl::DescriptorAllocator::getStats() const {
+    Stats stats;
+    stats.transientSetsThisFrame = this->transientCount.load();
+    stats.poolsCreated = this->poolCount.load();
+    stats.persistentHits = this->persistentHits.load();
+    {
+        std::lock_guard<std::mutex> lock(this->persistentMutex);
+        stats.persistentSets = static_cast<uint32_t>(this->persistent.size());
+    }
+    return stats;
+}
+
+VkDescriptorPool vgl::DescriptorAllocator::createPool() {
+    std::vector<VkDescriptorPoolSize> sizes;
+    sizes.reserve(sizeof(poolRatios) / sizeof(poolRatios[0]));
+    for (const PoolRatio& ratio : poolRatios) {
+        sizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.perSet * setsPerPool)) });
+    }
+
+    //No free bit, sets only go back to the pool when the whole pool is reset
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = setsPerPool;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    poolInfo.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(this->logicalDevice->device, &poolInfo, vgl::HostAllocator::callbacks(), &pool) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE DESCRIPTOR POOL");
+    }
+    this->poolCount++;
+    return pool;
+}
+
+VkDescriptorSet vgl::DescriptorAllocator::allocateFrom(std::vector<VkDescriptorPool>& pools, uint32_t& current, VkDescriptorSetLayout layout) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    //A fresh pool that still can't fit the set means the layout needs more than a whole pool has
+    bool freshPool = false;
+    while (true) {
+        if (current >= pools.size()) {
+            pools.push_back(this->createPool());
+            current = static_cast<uint32_t>(pools.size() - 1);
+            freshPool = true;
+        }
+
+        allocInfo.descriptorPool = pools[current];
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkResult result = vkAllocateDescriptorSets(this->logicalDevice->device, &allocInfo, &set);
+        if (result == VK_SUCCESS) {
+            return set;
+        }
+        if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || freshPool) {
+            throw std::runtime_error("FAILED TO ALLOCATE DESCRIPTOR SET");
+        }
+
+        //Full, move on to the next pool, reusing ones from earlier frames before creating more
+        current++;
+        freshPool = false;
+    }
+}
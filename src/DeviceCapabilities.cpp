@@ -0,0 +1,360 @@
+#include "vgl/DeviceCapabilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "vgl/FileUtils.h"
+
+std::shared_ptr<const vgl::DeviceCapabilities> vgl::DeviceCapabilities::query(VkPhysicalDevice _physicalDevice, const std::string& _directory) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto capabilities = std::make_shared<vgl::DeviceCapabilities>();
+    capabilities->physicalDevice = _physicalDevice;
+
+    //Properties and the UUID are needed to know which snapshot on disk belongs to this device and driver
+    //The UUID is always read live, two identical GPUs share vendor and device IDs but must not share a snapshot
+    vkGetPhysicalDeviceProperties(_physicalDevice, &capabilities->properties);
+    capabilities->queryUuid();
+
+    std::string path;
+    if (!_directory.empty()) {
+        std::string name = capabilities->uuid.empty() ?
+            std::to_string(capabilities->properties.vendorID) + "_" + std::to_string(capabilities->properties.deviceID) : capabilities->uuid;
+        path = (std::filesystem::path(_directory) / ("device_caps_" + name + ".bin")).string();
+    }
+
+    if (path.empty() || !capabilities->load(path)) {
+        capabilities->queryDevice();
+        if (!path.empty()) {
+            capabilities->save(path);
+        }
+    }
+
+    capabilities->queryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return capabilities;
+}
+
+bool vgl::DeviceCapabilities::hasExtension(const char* name) const {
+    return std::binary_search(this->extensions.begin(), this->extensions.end(), name,
+        [](const std::string& a, const std::string& b) { return a < b; });
+}
+
+bool vgl::DeviceCapabilities::hasExtensions(const std::vector<const char*>& names) const {
+    for (const char* name : names) {
+        if (!this->hasExtension(name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<std::string>& vgl::DeviceCapabilities::getExtensions() const {
+    return this->extensions;
+}
+
+VkDeviceSize vgl::DeviceCapabilities::getDeviceLocalBytes() const {
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < this->memoryProperties.memoryHeapCount; i++) {
+        if (this->memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            bytes += this->memoryProperties.memoryHeaps[i].size;
+        }
+    }
+    return bytes;
+}
+
+VkSampleCountFlagBits vgl::DeviceCapabilities::getMaxUsableSampleCount() const {
+    //Get max number of samples for frame buffer colour and depth buffer
+    VkSampleCountFlags counts = this->properties.limits.framebufferColorSampleCounts & this->properties.limits.framebufferDepthSampleCounts;
+
+    //Find maximum number of samples supported by both colour and depth buffer
+    if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
+    if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
+    if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
+    if (counts & VK_SAMPLE_COUNT_8_BIT) { return VK_SAMPLE_COUNT_8_BIT; }
+    if (counts & VK_SAMPLE_COUNT_4_BIT) { return VK_SAMPLE_COUNT_4_BIT; }
+    if (counts & VK_SAMPLE_COUNT_2_BIT) { return VK_SAMPLE_COUNT_2_BIT; }
+
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+vgl::QueueFamilyIndices vgl::DeviceCapabilities::findQueueFamilies(VkSurfaceKHR _surface) const {
+    vgl::QueueFamilyIndices indices;
+    bool hasSurface = _surface != VK_NULL_HANDLE;
+
+    //Find queue family that supports VK_QUEUE_GRAPHICS_BIT
+    //Every family is checked since the best transfer family is often the last one
+    uint32_t i = 0;
+    bool pureTransfer = false;
+    for (const auto& queueFamily : this->queueFamilies) {
+        //Check if can do graphics
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
+            indices.graphicsFamily = i;
+        }
+
+        //Look for a family that can do transfers but not graphics, these map to the GPU's copy engines
+        //A family with only VK_QUEUE_TRANSFER_BIT is preferred over an async compute family
+        if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !pureTransfer) {
+            indices.transferFamily = i;
+            pureTransfer = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+        }
+
+        //Async compute family, compute without graphics
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value()) {
+            indices.computeFamily = i;
+        }
+
+        //Check if can render to surface
+        //Skipped when headless since there is no surface to present to
+        if (hasSurface) {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(this->physicalDevice, i, _surface, &presentSupport);
+            //Prefer presenting from the graphics family so the swap chain images don't need sharing
+            if (presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == i)) {
+                indices.presentFamily = i;
+            }
+        }
+
+        //Early exit if all queue families required have been found
+        if (indices.isComplete(hasSurface) && pureTransfer && indices.computeFamily.has_value()) {
+            break;
+        }
+
+        i++;
+    }
+
+    return indices;
+}
+
+bool vgl::DeviceCapabilities::isFromDisk() const {
+    return this->fromDisk;
+}
+
+double vgl::DeviceCapabilities::getQueryMs() const {
+    return this->queryMs;
+}
+
+void vgl::DeviceCapabilities::queryUuid() {
+    //UUIDs are the only identifier that is stable across driver updates and enumeration order
+    this->uuid.clear();
+    if (this->properties.apiVersion < VK_API_VERSION_1_1) { return; }
+
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(this->physicalDevice, &properties2);
+
+    const char* digits = "0123456789abcdef";
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        this->uuid += digits[idProperties.deviceUUID[i] >> 4];
+        this->uuid += digits[idProperties.deviceUUID[i] & 0xF];
+    }
+}
+
+void vgl::DeviceCapabilities::queryDevice() {
+    this->properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    if (this->properties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &this->properties12;
+        vkGetPhysicalDeviceProperties2(this->physicalDevice, &properties2);
+        this->properties12.pNext = nullptr;
+    }
+
+    //Core features and the 1.2/1.3 feature structures in one call
+    this->features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    this->features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    if (this->properties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &this->features12;
+        if (this->properties.apiVersion >= VK_API_VERSION_1_3) {
+            this->features12.pNext = &this->features13;
+        }
+        vkGetPhysicalDeviceFeatures2(this->physicalDevice, &features2);
+        this->features = features2.features;
+        this->features12.pNext = nullptr;
+        this->features13.pNext = nullptr;
+    }
+    else {
+        vkGetPhysicalDeviceFeatures(this->physicalDevice, &this->features);
+    }
+
+    vkGetPhysicalDeviceMemoryProperties(this->physicalDevice, &this->memoryProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, nullptr);
+    this->queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, this->queueFamilies.data());
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(this->physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(this->physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    this->extensions.clear();
+    for (const auto& extension : availableExtensions) {
+        this->extensions.push_back(extension.extensionName);
+    }
+    std::sort(this->extensions.begin(), this->extensions.end());
+    this->extensions.erase(std::unique(this->extensions.begin(), this->extensions.end()), this->extensions.end());
+}
+
+std::vector<char> vgl::DeviceCapabilities::serialize() const {
+    std::vector<char> data;
+    auto write = [&data](const void* value, size_t size) {
+        const char* bytes = static_cast<const char*>(value);
+        data.insert(data.end(), bytes, bytes + size);
+    };
+    auto writeString = [&write](const std::string& text) {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        write(&length, sizeof(length));
+        write(text.data(), length);
+    };
+
+    //Pointers in the feature structures are meaningless on disk, they are null anyway but are cleared again on load
+    write(&this->properties, sizeof(this->properties));
+    write(&this->properties12, sizeof(this->properties12));
+    write(&this->features, sizeof(this->features));
+    write(&this->features12, sizeof(this->features12));
+    write(&this->features13, sizeof(this->features13));
+    write(&this->memoryProperties, sizeof(this->memoryProperties));
+
+    uint32_t queueFamilyCount = static_cast<uint32_t>(this->queueFamilies.size());
+    write(&queueFamilyCount, sizeof(queueFamilyCount));
+    write(this->queueFamilies.data(), queueFamilyCount * sizeof(VkQueueFamilyProperties));
+
+    uint32_t extensionCount = static_cast<uint32_t>(this->extensions.size());
+    write(&extensionCount, sizeof(extensionCount));
+    for (const auto& extension : this->extensions) {
+        writeString(extension);
+    }
+
+    return data;
+}
+
+bool vgl::DeviceCapabilities::deserialize(const std::vector<char>& data) {
+    size_t offset = 0;
+    auto read = [&data, &offset](void* value, size_t size) {
+        if (offset + size > data.size()) {
+            return false;
+        }
+        memcpy(value, data.data() + offset, size);
+        offset += size;
+        return true;
+    };
+    auto readString = [&read, &data, &offset](std::string& text) {
+        uint32_t length = 0;
+        if (!read(&length, sizeof(length)) || offset + length > data.size()) {
+            return false;
+        }
+        text.assign(data.data() + offset, length);
+        offset += length;
+        return true;
+    };
+
+    //Properties were already queried from the driver and matched against the header, the copy on disk only has to be skipped
+    VkPhysicalDeviceProperties storedProperties;
+    if (!read(&storedProperties, sizeof(storedProperties)) || !read(&this->properties12, sizeof(this->properties12)) || !read(&this->features, sizeof(this->features)) ||
+        !read(&this->features12, sizeof(this->features12)) || !read(&this->features13, sizeof(this->features13)) ||
+        !read(&this->memoryProperties, sizeof(this->memoryProperties))) {
+        return false;
+    }
+    this->properties12.pNext = nullptr;
+    this->features12.pNext = nullptr;
+    this->features13.pNext = nullptr;
+
+    uint32_t queueFamilyCount = 0;
+    if (!read(&queueFamilyCount, sizeof(queueFamilyCount)) || queueFamilyCount > 64) {
+        return false;
+    }
+    this->queueFamilies.resize(queueFamilyCount);
+    if (!read(this->queueFamilies.data(), queueFamilyCount * sizeof(VkQueueFamilyProperties))) {
+        return false;
+    }
+
+    uint32_t extensionCount = 0;
+    if (!read(&extensionCount, sizeof(extensionCount)) || extensionCount > 4096) {
+        return false;
+    }
+    this->extensions.resize(extensionCount);
+    for (auto& extension : this->extensions) {
+        if (!readString(extension)) {
+            return false;
+        }
+    }
+
+    return offset == data.size() && std::is_sorted(this->extensions.begin(), this->extensions.end());
+}
+
+bool vgl::DeviceCapabilities::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    //No file is a normal cold start
+    if (!file.is_open()) { return false; }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+    if (fileSize < sizeof(FileHeader)) { return false; }
+
+    FileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    //A driver update can add extensions or features, in which case the driver version changes
+    if (header.magic != fileMagic || header.version != fileVersion || header.layoutSize != layoutSize() ||
+        header.vendorID != this->properties.vendorID || header.deviceID != this->properties.deviceID ||
+        header.driverVersion != this->properties.driverVersion || header.apiVersion != this->properties.apiVersion ||
+        memcmp(header.pipelineCacheUUID, this->properties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+        header.dataSize != fileSize - sizeof(FileHeader)) {
+        return false;
+    }
+
+    std::vector<char> data(static_cast<size_t>(header.dataSize));
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file.good() || header.checksum != vgl::fnv1a64(data.data(), data.size())) {
+        return false;
+    }
+
+    //Start from a clean state so a half read file never leaves mixed data behind
+    vgl::DeviceCapabilities loaded;
+    loaded.physicalDevice = this->physicalDevice;
+    loaded.properties = this->properties;
+    loaded.uuid = this->uuid;
+    if (!loaded.deserialize(data)) {
+        return false;
+    }
+
+    *this = loaded;
+    this->fromDisk = true;
+    return true;
+}
+
+bool vgl::DeviceCapabilities::save(const std::string& path) const {
+    std::vector<char> data = this->serialize();
+
+    FileHeader header;
+    header.magic = fileMagic;
+    header.version = fileVersion;
+    header.vendorID = this->properties.vendorID;
+    header.deviceID = this->properties.deviceID;
+    header.driverVersion = this->properties.driverVersion;
+    header.apiVersion = this->properties.apiVersion;
+    memcpy(header.pipelineCacheUUID, this->properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.layoutSize = layoutSize();
+    header.dataSize = data.size();
+    header.checksum = vgl::fnv1a64(data.data(), data.size());
+
+    //Written to a temporary file then renamed over the old snapshot in one step
+    if (!vgl::writeFileAtomically(path, { { &header, sizeof(header) }, { data.data(), data.size() } })) {
+        return false;
+    }
+    return true;
+}
+
+uint32_t vgl::DeviceCapabilities::layoutSize() {
+    return static_cast<uint32_t>(sizeof(VkPhysicalDeviceProperties) + sizeof(VkPhysicalDeviceVulkan12Properties) + sizeof(VkPhysicalDeviceFeatures) + sizeof(VkPhysicalDeviceVulkan12Features) +
+        sizeof(VkPhysicalDeviceVulkan13Features) + sizeof(VkPhysicalDeviceMemoryProperties) + sizeof(VkQueueFamilyProperties));
+}
@@ -0,0 +1,359 @@
+#include "vgl/DrawBatcher.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "vgl/CpuProfiler.h"
+#include "vgl/Logger.h"
+
+namespace {
+
+    //Bits below the pass holding pipeline, material, mesh and lod
+    const uint32_t stateBits = 44;
+    const uint64_t stateMask = (1ull << stateBits) - 1;
+    const uint32_t depthBits = 16;
+    const uint32_t passShift = 60;
+
+    //Each job of the parallel sort handles at least this many keys
+    const uint32_t minKeysPerSortJob = 4096;
+    //Instances copied per job when writing the instance data in parallel
+    const uint32_t instanceCopyBatch = 4096;
+
+}
+
+vgl::DrawBatcher::DrawBatcher(vgl::LogicalDevice* _logicalDevice, vgl::JobSystem* _jobSystem, uint32_t _framesInFlight, const vgl::DrawBatcherSettings& _settings)
+    : logicalDevice(_logicalDevice),
+    jobSystem(_jobSystem),
+    settings(_settings)
+{
+    if (this->settings.instanceStride == 0) {
+        throw std::runtime_error("INSTANCE STRIDE MUST NOT BE 0");
+    }
+
+    this->instanceArena = std::make_unique<vgl::LinearArena>(this->logicalDevice->getAllocator(), this->settings.instanceBytesPerFrame, _framesInFlight,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    this->threadRequests.resize(this->jobSystem ? this->jobSystem->getThreadCount() : 1);
+    this->passBatches.resize(maxPasses);
+}
+
+vgl::BatchedMesh vgl::DrawBatcher::addMesh(const vgl::Mesh* mesh) {
+    if (!this->freeMeshes.empty()) {
+        vgl::BatchedMesh handle = this->freeMeshes.back();
+        this->freeMeshes.pop_back();
+        this->meshes[handle] = mesh;
+        return handle;
+    }
+    if (this->meshes.size() >= maxMeshes) {
+        throw std::runtime_error("TOO MANY MESHES IN DRAW BATCHER");
+    }
+    this->meshes.push_back(mesh);
+    return static_cast<vgl::BatchedMesh>(this->meshes.size() - 1);
+}
+
+void vgl::DrawBatcher::removeMesh(vgl::BatchedMesh mesh) {
+    if (mesh >= this->meshes.size() || !this->meshes[mesh]) { return; }
+    this->meshes[mesh] = nullptr;
+    this->freeMeshes.push_back(mesh);
+}
+
+void vgl::DrawBatcher::beginFrame(uint32_t frameIndex) {
+    this->instanceArena->beginFrame(frameIndex);
+    this->instances = vgl::LinearArena::Allocation{};
+
+    for (ThreadRequests& requests : this->threadRequests) {
+        requests.keys.clear();
+        requests.instanceData.clear();
+    }
+    for (auto& batches : this->passBatches) {
+        batches.clear();
+    }
+}
+
+void vgl::DrawBatcher::submit(const vgl::DrawRequest& request, const void* instanceData) {
+    if (request.mesh >= this->meshes.size() || !this->meshes[request.mesh]) {
+        throw std::runtime_error("DRAW REQUEST MESH NOT IN BATCHER");
+    }
+
+    //Only the calling thread and the workers of the batcher's own job system have a list
+    uint32_t threadIndex = vgl::JobSystem::getThreadIndex();
+    if (threadIndex >= this->threadRequests.size()) {
+        throw std::runtime_error("DRAW REQUEST SUBMITTED FROM A THREAD OUTSIDE THE BATCHER'S JOB SYSTEM");
+    }
+    ThreadRequests& requests = this->threadRequests[threadIndex];
+    requests.keys.push_back(this->makeSortKey(request));
+    const uint8_t* bytes = static_cast<const uint8_t*>(instanceData);
+    requests.instanceData.insert(requests.instanceData.end(), bytes, bytes + this->settings.instanceStride);
+}
+
+void vgl::DrawBatcher::build() {
+    VGL_PROFILE_SCOPE("DrawBatcher::build");
+    auto start = std::chrono::steady_clock::now();
+
+    //Gather every thread's keys, the value of each key is its index across the threads in submission order
+    std::vector<uint32_t> threadOffsets(this->threadRequests.size() + 1, 0);
+    for (size_t t = 0; t < this->threadRequests.size(); t++) {
+        threadOffsets[t + 1] = threadOffsets[t] + static_cast<uint32_t>(this->threadRequests[t].keys.size());
+    }
+    uint32_t requestCount = threadOffsets.back();
+
+    this->keys.resize(requestCount);
+    this->order.resize(requestCount);
+    for (size_t t = 0; t < this->threadRequests.size(); t++) {
+        const std::vector<uint64_t>& threadKeys = this->threadRequests[t].keys;
+        std::copy(threadKeys.begin(), threadKeys.end(), this->keys.begin() + threadOffsets[t]);
+    }
+    for (uint32_t i = 0; i < requestCount; i++) {
+        this->order[i] = i;
+    }
+
+    bool parallel = this->jobSystem && requestCount >= this->settings.parallelSortThreshold;
+    auto sortStart = std::chrono::steady_clock::now();
+    radixSort(this->keys, this->order, this->keyScratch, this->orderScratch, parallel ? this->jobSystem : nullptr);
+    double sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+
+    //Requests at the end of the sort order are dropped when the frame's region is full
+    uint32_t stride = this->settings.instanceStride;
+    uint32_t instanceCount = static_cast<uint32_t>(std::min<VkDeviceSize>(requestCount, this->instanceArena->getSizePerFrame() / stride));
+    if (instanceCount > 0) {
+        this->instances = this->instanceArena->allocate(static_cast<VkDeviceSize>(instanceCount) * stride);
+        if (!this->instances.isValid()) { instanceCount = 0; }
+    }
+    if (instanceCount < requestCount) {
+        VGL_LOG_WARNING("DrawBatcher", "INSTANCE BUFFER FULL, DROPPED " + std::to_string(requestCount - instanceCount) + " OF " + std::to_string(requestCount) + " DRAWS");
+    }
+
+    //Copy each request's instance data to its sorted position, so every batch's instances are contiguous
+    auto copyInstances = [&](uint32_t begin, uint32_t end) {
+        uint8_t* destination = static_cast<uint8_t*>(this->instances.mapped);
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t request = this->order[i];
+            size_t thread = static_cast<size_t>(std::upper_bound(threadOffsets.begin(), threadOffsets.end(), request) - threadOffsets.begin() - 1);
+            const uint8_t* source = this->threadRequests[thread].instanceData.data() + static_cast<size_t>(request - threadOffsets[thread]) * stride;
+            memcpy(destination + static_cast<size_t>(i) * stride, source, stride);
+        }
+    };
+    if (parallel) {
+        this->jobSystem->parallelFor(instanceCount, instanceCopyBatch, copyInstances);
+    }
+    else {
+        copyInstances(0, instanceCount);
+    }
+    this->instanceArena->flush();
+
+    //Merge runs of the same pass and state into instanced draws
+    Stats current;
+    current.requests = requestCount;
+    current.dropped = requestCount - instanceCount;
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        uint64_t key = this->keys[i];
+        uint32_t pass = static_cast<uint32_t>(key >> passShift);
+        uint64_t state = (this->settings.backToFrontPasses >> pass) & 1u ? key & stateMask : (key >> depthBits) & stateMask;
+
+        vgl::DrawBatch batch;
+        batch.pass = pass;
+        batch.pipeline = static_cast<uint32_t>(state >> 32);
+        batch.material = static_cast<uint32_t>((state >> 16) & 0xFFFF);
+        batch.mesh = static_cast<vgl::BatchedMesh>((state >> 3) & (maxMeshes - 1));
+        batch.lod = static_cast<uint32_t>(state & (maxLods - 1));
+
+        std::vector<vgl::DrawBatch>& batches = this->passBatches[pass];
+        if (!batches.empty()) {
+            vgl::DrawBatch& previous = batches.back();
+            if (previous.pipeline == batch.pipeline && previous.material == batch.material && previous.mesh == batch.mesh && previous.lod == batch.lod) {
+                previous.instanceCount++;
+                continue;
+            }
+            current.pipelineChanges += previous.pipeline != batch.pipeline ? 1 : 0;
+            current.materialChanges += previous.material != batch.material ? 1 : 0;
+        }
+        else {
+            current.pipelineChanges++;
+            current.materialChanges++;
+        }
+
+        batch.firstInstance = i;
+        batch.instanceCount = 1;
+        batches.push_back(batch);
+        current.batches++;
+    }
+
+    current.sortMs = sortMs;
+    current.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    this->stats = current;
+}
+
+const std::vector<vgl::DrawBatch>& vgl::DrawBatcher::getBatches(uint32_t pass) const {
+    return this->passBatches.at(pass);
+}
+
+void vgl::DrawBatcher::record(VkCommandBuffer commandBuffer, uint32_t pass, const BindFunction& bind) const {
+    const std::vector<vgl::DrawBatch>& batches = this->passBatches.at(pass);
+    if (batches.empty() || !this->instances.isValid()) { return; }
+
+    //firstInstance of every batch is relative to this frame's instance data
+    VkDeviceSize offset = this->instances.offset;
+    vkCmdBindVertexBuffers(commandBuffer, instanceBinding, 1, &this->instances.buffer, &offset);
+
+    bool bound = false;
+    uint32_t pipeline = 0;
+    uint32_t material = 0;
+    const vgl::Mesh* boundMesh = nullptr;
+    for (const vgl::DrawBatch& batch : batches) {
+        const vgl::Mesh* mesh = this->meshes[batch.mesh];
+        if (!mesh || !mesh->isReady() || mesh->getLods().empty()) { continue; }
+
+        if (!bound || batch.pipeline != pipeline || batch.material != material) {
+            bind(commandBuffer, batch.pipeline, batch.material, !bound || batch.pipeline != pipeline);
+            bound = true;
+            pipeline = batch.pipeline;
+            material = batch.material;
+        }
+        if (mesh != boundMesh) {
+            mesh->bind(commandBuffer);
+            boundMesh = mesh;
+        }
+
+        uint32_t lod = std::min(batch.lod, static_cast<uint32_t>(mesh->getLods().size()) - 1);
+        mesh->draw(commandBuffer, lod, batch.instanceCount, batch.firstInstance);
+    }
+}
+
+VkBuffer vgl::DrawBatcher::getInstanceBuffer() const {
+    return this->instanceArena->getBuffer();
+}
+
+VkDeviceSize vgl::DrawBatcher::getInstanceOffset() const {
+    return this->instances.offset;
+}
+
+std::vector<VkVertexInputBindingDescription> vgl::DrawBatcher::getInstanceBindings() const {
+    VkVertexInputBindingDescription binding{};
+    binding.binding = instanceBinding;
+    binding.stride = this->settings.instanceStride;
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return { binding };
+}
+
+const vgl::DrawBatcherSettings& vgl::DrawBatcher::getSettings() const {
+    return this->settings;
+}
+
+vgl::DrawBatcher::Stats vgl::DrawBatcher::getStats() const {
+    return this->stats;
+}
+
+void vgl::DrawBatcher::printStats() const {
+    std::ostringstream line;
+    line << "Draw batcher: " << this->stats.requests << " requests in " << this->stats.batches << " draws, "
+        << this->stats.pipelineChanges << " pipeline and " << this->stats.materialChanges << " material changes, "
+        << this->stats.dropped << " dropped, sort " << this->stats.sortMs << "ms, build " << this->stats.buildMs << "ms";
+    vgl::Logger::get().log(vgl::LogLevel::Info, "DrawBatcher", line.str());
+}
+
+uint64_t vgl::DrawBatcher::makeSortKey(const vgl::DrawRequest& request) const {
+    if (request.pass >= maxPasses || request.pipeline >= maxPipelines || request.material >= maxMaterials ||
+        request.mesh >= maxMeshes || request.lod >= maxLods) {
+        throw std::runtime_error("DRAW REQUEST ID OUT OF RANGE");
+    }
+
+    uint64_t depth = static_cast<uint64_t>(std::lround(std::clamp(request.depth, 0.0f, 1.0f) * 65535.0f));
+    uint64_t state = (static_cast<uint64_t>(request.pipeline) << 32) | (static_cast<uint64_t>(request.material) << 16) |
+        (static_cast<uint64_t>(request.mesh) << 3) | request.lod;
+    uint64_t pass = static_cast<uint64_t>(request.pass) << passShift;
+
+    //Farthest first, state only decides the order at equal depth
+    if ((this->settings.backToFrontPasses >> request.pass) & 1u) {
+        return pass | ((0xFFFFull - depth) << stateBits) | state;
+    }
+    return pass | (state << depthBits) | depth;
+}
+
+void vgl::DrawBatcher::radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch,
+    vgl::JobSystem* jobSystem)
+{
+    VGL_PROFILE_SCOPE("DrawBatcher::radixSort");
+    size_t count = keys.size();
+    if (count < 2) { return; }
+    keyScratch.resize(count);
+    valueScratch.resize(count);
+
+    //Digits every key shares don't change the order, frames often use only a few passes and pipelines
+    uint64_t anyBits = 0;
+    uint64_t allBits = ~0ull;
+    for (uint64_t key : keys) {
+        anyBits |= key;
+        allBits &= key;
+    }
+    uint64_t varyingBits = anyBits ^ allBits;
+
+    //The keys are split into contiguous chunks, each with its own histogram, so a chunk's scatter keeps its keys in order
+    uint32_t chunkCount = 1;
+    if (jobSystem) {
+        chunkCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(jobSystem->getThreadCount(), count / minKeysPerSortJob)));
+    }
+    std::vector<std::array<uint32_t, 256>> histograms(chunkCount);
+    auto forEachChunk = [&](const std::function<void(uint32_t chunk, size_t begin, size_t end)>& function) {
+        auto run = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t chunk = begin; chunk < end; chunk++) {
+                function(chunk, count * chunk / chunkCount, count * (chunk + 1) / chunkCount);
+            }
+        };
+        if (chunkCount > 1) {
+            jobSystem->parallelFor(chunkCount, 1, run);
+        }
+        else {
+            run(0, 1);
+        }
+    };
+
+    uint64_t* sourceKeys = keys.data();
+    uint32_t* sourceValues = values.data();
+    uint64_t* destinationKeys = keyScratch.data();
+    uint32_t* destinationValues = valueScratch.data();
+    bool inScratch = false;
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        if (((varyingBits >> shift) & 0xFF) == 0) { continue; }
+
+        forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+            std::array<uint32_t, 256>& histogram = histograms[chunk];
+            histogram.fill(0);
+            for (size_t i = begin; i < end; i++) {
+                histogram[(sourceKeys[i] >> shift) & 0xFF]++;
+            }
+        });
+
+        //Turn the counts into where each chunk writes each digit, digit by digit then chunk by chunk
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < 256; digit++) {
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                uint32_t digitCount = histograms[chunk][digit];
+                histograms[chunk][digit] = offset;
+                offset += digitCount;
+            }
+        }
+
+        forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+            std::array<uint32_t, 256>& offsets = histograms[chunk];
+            for (size_t i = begin; i < end; i++) {
+                uint32_t position = offsets[(sourceKeys[i] >> shift) & 0xFF]++;
+                destinationKeys[position] = sourceKeys[i];
+                destinationValues[position] = sourceValues[i];
+            }
+        });
+
+        std::swap(sourceKeys, destinationKeys);
+        std::swap(sourceValues, destinationValues);
+        inScratch = !inScratch;
+    }
+
+    if (inScratch) {
+        keys.swap(keyScratch);
+        values.swap(valueScratch);
+    }
+}
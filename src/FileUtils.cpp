@@ -0,0 +1,43 @@
+#include "vgl/FileUtils.h"
+
+#include <filesystem>
+#include <fstream>
+
+uint64_t vgl::fnv1a64(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= fnv1aPrime;
+    }
+    return hash;
+}
+
+bool vgl::writeFileAtomically(const std::string& path, const std::vector<std::pair<const void*, size_t>>& parts) {
+    std::error_code error;
+    std::filesystem::path target(path);
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), error);
+    }
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) { return false; }
+        for (const auto& part : parts) {
+            file.write(static_cast<const char*>(part.first), static_cast<std::streamsize>(part.second));
+        }
+        file.flush();
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, target, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,399 @@
+#include "vgl/FrameRenderer.h"
+
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+
+vgl::FrameRenderer::FrameRenderer(vgl::PhysicalDevice* _physicalDevice, vgl::LogicalDevice* _logicalDevice, VkSurfaceKHR _surface, vgl::Window* _window,
+    VkExtent2D _initialExtent, uint32_t _framesInFlight)
+    : physicalDevice(_physicalDevice),
+    logicalDevice(_logicalDevice),
+    window(_window),
+    framesInFlight(_framesInFlight)
+{
+    this->swapChain = std::make_unique<vgl::SwapChain>(this->physicalDevice, this->logicalDevice->device, _surface, _initialExtent);
+
+    this->createFrameData();
+    this->createRenderFinishedSemaphores();
+
+    this->lastFrameStart = std::chrono::steady_clock::now();
+}
+
+vgl::FrameRenderer::FrameRenderer(vgl::LogicalDevice* _logicalDevice, vgl::OffscreenTarget* _target, uint32_t _framesInFlight)
+    : logicalDevice(_logicalDevice),
+    offscreenTarget(_target),
+    framesInFlight(_framesInFlight)
+{
+    this->createFrameData();
+
+    this->lastFrameStart = std::chrono::steady_clock::now();
+}
+
+vgl::FrameRenderer::~FrameRenderer() {
+    VkDevice device = this->logicalDevice->device;
+
+    //Make sure nothing is still using the per-frame resources, including work queued in the scheduler but not yet flushed
+    this->logicalDevice->getQueueScheduler()->deviceWaitIdle();
+
+    this->destroyRenderFinishedSemaphores();
+
+    for (auto& frame : this->frames) {
+        vkDestroySemaphore(device, frame.imageAvailable, vgl::HostAllocator::callbacks());
+        //Destroying the pool frees its command buffers
+        vkDestroyCommandPool(device, frame.commandPool, vgl::HostAllocator::callbacks());
+    }
+
+    this->swapChain.reset();
+}
+
+void vgl::FrameRenderer::createFrameData() {
+    VkDevice device = this->logicalDevice->device;
+
+    this->frames.resize(this->framesInFlight);
+
+    for (auto& frame : this->frames) {
+        //Each frame has its own transient pool that is reset as a whole once the frame's previous submission has finished
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = this->logicalDevice->queueFamilyIndices.graphicsFamily.value();
+
+        if (vkCreateCommandPool(device, &poolInfo, vgl::HostAllocator::callbacks(), &frame.commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE FRAME COMMAND POOL");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = frame.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &frame.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO ALLOCATE FRAME COMMAND BUFFER");
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        //The frame's point starts at 0, which is always reached, so the first wait doesn't block
+        if (vkCreateSemaphore(device, &semaphoreInfo, vgl::HostAllocator::callbacks(), &frame.imageAvailable) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE FRAME SYNCHRONISATION OBJECTS");
+        }
+    }
+}
+
+void vgl::FrameRenderer::createRenderFinishedSemaphores() {
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    this->renderFinished.resize(this->swapChain->images.size());
+    for (auto& semaphore : this->renderFinished) {
+        if (vkCreateSemaphore(this->logicalDevice->device, &semaphoreInfo, vgl::HostAllocator::callbacks(), &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE FRAME SYNCHRONISATION OBJECTS");
+        }
+    }
+}
+
+void vgl::FrameRenderer::destroyRenderFinishedSemaphores() {
+    for (auto semaphore : this->renderFinished) {
+        vkDestroySemaphore(this->logicalDevice->device, semaphore, vgl::HostAllocator::callbacks());
+    }
+    this->renderFinished.clear();
+}
+
+bool vgl::FrameRenderer::drawFrame(const RecordFunction& record) {
+    VGL_PROFILE_SCOPE("FrameRenderer::drawFrame");
+
+    const vgl::FrameContext* frame = this->beginFrame();
+    if (!frame) { return false; }
+
+    if (record) {
+        VGL_PROFILE_SCOPE("FrameRenderer::record");
+        record(*frame);
+    }
+
+    this->endFrame();
+    return true;
+}
+
+const vgl::FrameContext* vgl::FrameRenderer::beginFrame() {
+    VkDevice device = this->logicalDevice->device;
+    FrameData& frame = this->frames[this->currentFrame];
+
+    auto frameStart = std::chrono::steady_clock::now();
+
+    //Only blocks if the CPU is framesInFlight frames ahead of the GPU
+    {
+        VGL_PROFILE_SCOPE("FrameRenderer::waitForFrame");
+        this->logicalDevice->getQueueScheduler()->wait(frame.submitted);
+    }
+    auto fenceSignalled = std::chrono::steady_clock::now();
+    this->stats.lastFenceWaitMs = std::chrono::duration<double, std::milli>(fenceSignalled - frameStart).count();
+
+    uint32_t imageIndex = 0;
+    if (this->swapChain) {
+        VGL_PROFILE_SCOPE("FrameRenderer::acquireImage");
+        VkResult result = vkAcquireNextImageKHR(device, this->swapChain->swapChain, UINT64_MAX, frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+
+        //Swap chain no longer matches the surface, rebuild it and skip this frame
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            this->recreateSwapChain();
+            return nullptr;
+        }
+        //Suboptimal can still be presented to, it gets recreated after presenting
+        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("FAILED TO ACQUIRE SWAP CHAIN IMAGE");
+        }
+    }
+
+    this->updateFrameTime(frameStart);
+    this->recordStart = fenceSignalled;
+
+    //The GPU is done with this frame index, let per-frame resources be recycled
+    {
+        VGL_PROFILE_SCOPE("FrameRenderer::frameBeginCallbacks");
+        for (const auto& callback : this->frameBeginCallbacks) {
+            callback(this->currentFrame);
+        }
+    }
+
+    //The GPU has finished with everything recorded from this pool, so reset it wholesale rather than per command buffer
+    vkResetCommandPool(device, frame.commandPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(frame.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO BEGIN RECORDING FRAME COMMAND BUFFER");
+    }
+
+    this->context.commandBuffer = frame.commandBuffer;
+    this->context.frameIndex = this->currentFrame;
+    this->context.imageIndex = imageIndex;
+    if (this->swapChain) {
+        this->context.image = this->swapChain->images[imageIndex];
+        this->context.imageView = this->swapChain->imageViews[imageIndex];
+        this->context.format = this->swapChain->imageFormat;
+        this->context.extent = this->swapChain->extent;
+    }
+    else {
+        this->context.image = this->offscreenTarget->image;
+        this->context.imageView = this->offscreenTarget->imageView;
+        this->context.format = this->offscreenTarget->format;
+        this->context.extent = this->offscreenTarget->extent;
+    }
+
+    {
+        VGL_PROFILE_SCOPE("FrameRenderer::recordCallbacks");
+        for (const auto& callback : this->recordCallbacks) {
+            callback(this->context);
+        }
+    }
+
+    this->recordClear(frame.commandBuffer, this->context.image);
+
+    this->frameStarted = true;
+    return &this->context;
+}
+
+void vgl::FrameRenderer::endFrame() {
+    if (!this->frameStarted) {
+        throw std::runtime_error("endFrame CALLED WITHOUT A MATCHING beginFrame");
+    }
+    this->frameStarted = false;
+
+    VGL_PROFILE_SCOPE("FrameRenderer::endFrame");
+
+    FrameData& frame = this->frames[this->currentFrame];
+
+    //Presented images need to be in the present layout, offscreen images are left ready to be copied from
+    VkImageLayout finalLayout = this->swapChain ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    this->transitionImage(frame.commandBuffer, this->context.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalLayout,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO RECORD FRAME COMMAND BUFFER");
+    }
+
+    vgl::QueueScheduler* scheduler = this->logicalDevice->getQueueScheduler();
+
+    vgl::QueueSubmission submission;
+    submission.commandBuffers.push_back(frame.commandBuffer);
+
+    //The image is first written by the clear so wait for it to be acquired before the transfer stage
+    //Render finished is signalled for the present, both are binary so their values are ignored
+    if (this->swapChain) {
+        submission.semaphoreWaits.push_back({ frame.imageAvailable, 0, VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT });
+        submission.semaphoreSignals.push_back({ this->renderFinished[this->context.imageIndex], 0, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT });
+    }
+    submission.semaphoreWaits.insert(submission.semaphoreWaits.end(), this->waitSemaphores.begin(), this->waitSemaphores.end());
+    this->waitSemaphores.clear();
+
+    //Flushing sends whatever other queues were given this frame in the same batch, and the present needs the submit made first
+    frame.submitted = scheduler->submit(vgl::QueueType::Graphics, submission);
+    scheduler->flush();
+    this->submittedPoint = frame.submitted;
+
+    if (this->swapChain) {
+        VGL_PROFILE_SCOPE("FrameRenderer::present");
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &this->renderFinished[this->context.imageIndex];
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &this->swapChain->swapChain;
+        presentInfo.pImageIndices = &this->context.imageIndex;
+
+        VkResult result = VK_SUCCESS;
+        {
+            std::lock_guard<std::mutex> queueLock(scheduler->getQueueMutex(this->logicalDevice->presentQueue));
+            result = vkQueuePresentKHR(this->logicalDevice->presentQueue, &presentInfo);
+        }
+
+        bool resized = this->window && this->window->framebufferResized;
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || resized) {
+            this->recreateSwapChain();
+        }
+        else if (result != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO PRESENT SWAP CHAIN IMAGE");
+        }
+    }
+
+    this->stats.lastRecordMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->recordStart).count();
+    this->stats.frameCount++;
+
+    this->currentFrame = (this->currentFrame + 1) % this->framesInFlight;
+}
+
+void vgl::FrameRenderer::addFrameBeginCallback(const FrameBeginCallback& callback) {
+    this->frameBeginCallbacks.push_back(callback);
+}
+
+void vgl::FrameRenderer::addRecordCallback(const RecordFunction& callback) {
+    this->recordCallbacks.push_back(callback);
+}
+
+void vgl::FrameRenderer::addResizeCallback(const ResizeCallback& callback) {
+    this->resizeCallbacks.push_back(callback);
+}
+
+void vgl::FrameRenderer::addWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage) {
+    this->waitSemaphores.push_back({ semaphore, value, stage });
+}
+
+VkSemaphore vgl::FrameRenderer::getTimelineSemaphore() const {
+    return this->logicalDevice->getQueueScheduler()->getSemaphore(vgl::QueueType::Graphics);
+}
+
+uint64_t vgl::FrameRenderer::getSubmittedValue() const {
+    return this->submittedPoint.value;
+}
+
+vgl::QueuePoint vgl::FrameRenderer::getSubmittedPoint() const {
+    return this->submittedPoint;
+}
+
+const vgl::FrameStats& vgl::FrameRenderer::getStats() const {
+    return this->stats;
+}
+
+uint32_t vgl::FrameRenderer::getFramesInFlight() const {
+    return this->framesInFlight;
+}
+
+uint32_t vgl::FrameRenderer::getCurrentFrame() const {
+    return this->currentFrame;
+}
+
+vgl::SwapChain* vgl::FrameRenderer::getSwapChain() const {
+    return this->swapChain.get();
+}
+
+void vgl::FrameRenderer::recreateSwapChain() {
+    VkExtent2D extent = this->swapChain->extent;
+
+    if (this->window) {
+        //A minimised window has a framebuffer size of 0, wait until it is visible again
+        extent = this->window->getFramebufferSize();
+        while (extent.width == 0 || extent.height == 0) {
+            this->window->waitEvents();
+            extent = this->window->getFramebufferSize();
+        }
+        this->window->framebufferResized = false;
+    }
+
+    //Old images may still be in use by frames in flight
+    this->logicalDevice->getQueueScheduler()->deviceWaitIdle();
+
+    this->swapChain->recreate(extent);
+
+    //Image count can change when the swap chain is rebuilt
+    this->destroyRenderFinishedSemaphores();
+    this->createRenderFinishedSemaphores();
+
+    for (const auto& callback : this->resizeCallbacks) {
+        callback(this->swapChain->extent);
+    }
+}
+
+void vgl::FrameRenderer::updateFrameTime(std::chrono::steady_clock::time_point frameStart) {
+    double frameMs = std::chrono::duration<double, std::milli>(frameStart - this->lastFrameStart).count();
+    this->lastFrameStart = frameStart;
+
+    this->stats.lastFrameMs = frameMs;
+    this->frameTimes[this->stats.frameCount % vgl::FrameStats::windowSize] = frameMs;
+
+    //Only average over the samples that have been filled in so far
+    size_t sampleCount = std::min<uint64_t>(this->stats.frameCount + 1, vgl::FrameStats::windowSize);
+    double total = 0.0;
+    double minMs = frameMs;
+    double maxMs = frameMs;
+    for (size_t i = 0; i < sampleCount; i++) {
+        total += this->frameTimes[i];
+        minMs = std::min(minMs, this->frameTimes[i]);
+        maxMs = std::max(maxMs, this->frameTimes[i]);
+    }
+
+    this->stats.averageFrameMs = total / static_cast<double>(sampleCount);
+    this->stats.minFrameMs = minMs;
+    this->stats.maxFrameMs = maxMs;
+}
+
+void vgl::FrameRenderer::recordClear(VkCommandBuffer commandBuffer, VkImage image) {
+    //Previous contents are discarded, but the previous frame's writes to the same image still have to finish first
+    this->transitionImage(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+    vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &this->clearColour, 1, &range);
+
+    this->transitionImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+}
+
+void vgl::FrameRenderer::transitionImage(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,420 @@
+#include "vgl/GpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "vgl/HostAllocator.h"
+
+namespace {
+
+    //Value of the host time domain from LogicalDevice::getHostTimeDomain on the trace clock
+    double hostTimeToTraceUs(uint64_t _hostTime) {
+#ifdef _WIN32
+        //Converted to nanoseconds the same way steady_clock does, split to avoid overflow
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+        uint64_t nanoseconds = (_hostTime / ticksPerSecond) * 1000000000ull + (_hostTime % ticksPerSecond) * 1000000000ull / ticksPerSecond;
+#else
+        uint64_t nanoseconds = _hostTime;
+#endif
+        std::chrono::steady_clock::time_point time(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(nanoseconds)));
+        return vgl::ChromeTrace::toTraceTime(time);
+    }
+
+    //Scope read back from the queries, before it is made relative to the frame
+    struct ResolvedScope {
+        const std::string* name = nullptr;
+        double beginUs = 0.0;
+        double durationUs = 0.0;
+    };
+
+    //The graphics queue's family, timestamps are only written to command buffers submitted there
+    const VkQueueFamilyProperties& getGraphicsFamily(const vgl::LogicalDevice* _logicalDevice) {
+        return _logicalDevice->getCapabilities().queueFamilies[_logicalDevice->queueFamilyIndices.graphicsFamily.value()];
+    }
+
+}
+
+vgl::GpuProfiler::GpuProfiler(vgl::LogicalDevice* _logicalDevice, uint32_t _framesInFlight, uint32_t _maxScopes, uint32_t _historySize)
+    : logicalDevice(_logicalDevice), maxScopes(_maxScopes), historySize(_historySize)
+{
+    if (!isSupported(this->logicalDevice)) {
+        throw std::runtime_error("TIMESTAMP QUERIES ARE NOT SUPPORTED ON THE GRAPHICS QUEUE");
+    }
+
+    this->timestampPeriod = static_cast<double>(this->logicalDevice->getCapabilities().properties.limits.timestampPeriod);
+    uint32_t validBits = getGraphicsFamily(this->logicalDevice).timestampValidBits;
+    this->timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    //Every scope takes a query for its start and one for its end
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = this->maxScopes * 2;
+
+    this->frames.resize(_framesInFlight);
+    for (FrameQueries& frame : this->frames) {
+        if (vkCreateQueryPool(this->logicalDevice->device, &poolInfo, vgl::HostAllocator::callbacks(), &frame.pool) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE TIMESTAMP QUERY POOL");
+        }
+        frame.scopes.reserve(this->maxScopes);
+    }
+    this->queryResults.resize(static_cast<size_t>(this->maxScopes) * 2 * 2);
+
+    //Without calibrated timestamps a single timestamp is submitted and timed instead, the pool and command buffer are kept for recalibrating
+    if (this->logicalDevice->isCalibratedTimestampsEnabled()) {
+        this->getCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(this->logicalDevice->device, "vkGetCalibratedTimestampsEXT");
+    }
+    if (!this->getCalibratedTimestamps) {
+        poolInfo.queryCount = 1;
+        if (vkCreateQueryPool(this->logicalDevice->device, &poolInfo, vgl::HostAllocator::callbacks(), &this->calibrationPool) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE TIMESTAMP QUERY POOL");
+        }
+
+        VkCommandPoolCreateInfo commandPoolInfo{};
+        commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        commandPoolInfo.queueFamilyIndex = this->logicalDevice->queueFamilyIndices.graphicsFamily.value();
+        if (vkCreateCommandPool(this->logicalDevice->device, &commandPoolInfo, vgl::HostAllocator::callbacks(), &this->calibrationCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE PROFILER COMMAND POOL");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = this->calibrationCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(this->logicalDevice->device, &allocInfo, &this->calibrationCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO ALLOCATE PROFILER COMMAND BUFFER");
+        }
+    }
+
+    this->calibrate();
+}
+
+vgl::GpuProfiler::~GpuProfiler() {
+    if (this->calibrationCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(this->logicalDevice->device, this->calibrationCommandPool, vgl::HostAllocator::callbacks());
+    }
+    if (this->calibrationPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(this->logicalDevice->device, this->calibrationPool, vgl::HostAllocator::callbacks());
+    }
+    for (FrameQueries& frame : this->frames) {
+        vkDestroyQueryPool(this->logicalDevice->device, frame.pool, vgl::HostAllocator::callbacks());
+    }
+}
+
+bool vgl::GpuProfiler::isSupported(const vgl::LogicalDevice* _logicalDevice) {
+    return getGraphicsFamily(_logicalDevice).timestampValidBits > 0 && _logicalDevice->getCapabilities().properties.limits.timestampPeriod > 0.0f;
+}
+
+void vgl::GpuProfiler::calibrate() {
+    if (this->getCalibratedTimestamps) {
+        this->calibrateWithHostClock();
+    }
+    else {
+        this->calibrateWithSubmit();
+    }
+}
+
+void vgl::GpuProfiler::calibrateWithHostClock() {
+    VkCalibratedTimestampInfoEXT infos[2]{};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].timeDomain = vgl::LogicalDevice::getHostTimeDomain();
+
+    uint64_t timestamps[2] = { 0, 0 };
+    uint64_t maxDeviation = 0;
+    if (this->getCalibratedTimestamps(this->logicalDevice->device, 2, infos, timestamps, &maxDeviation) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CALIBRATE GPU TIMESTAMPS");
+    }
+
+    this->calibrationTicks = timestamps[0] & this->timestampMask;
+    this->calibrationUs = hostTimeToTraceUs(timestamps[1]);
+}
+
+void vgl::GpuProfiler::calibrateWithSubmit() {
+    VkDevice device = this->logicalDevice->device;
+    VkQueryPool pool = this->calibrationPool;
+
+    if (vkResetCommandPool(device, this->calibrationCommandPool, 0) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO RESET PROFILER COMMAND POOL");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(this->calibrationCommandBuffer, &beginInfo);
+    vkCmdResetQueryPool(this->calibrationCommandBuffer, pool, 0, 1);
+    vkCmdWriteTimestamp(this->calibrationCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, 0);
+    vkEndCommandBuffer(this->calibrationCommandBuffer);
+
+    //The timestamp was written somewhere between the submit and the point being reached, the middle is the best guess
+    //That is only close when nothing else is queued ahead of it, so this only runs while the device is idle
+    //Waiting on the point flushes the submit straight away
+    vgl::QueueScheduler* scheduler = this->logicalDevice->getQueueScheduler();
+    double submitUs = vgl::ChromeTrace::now();
+    scheduler->wait(scheduler->submit(vgl::QueueType::Graphics, this->calibrationCommandBuffer));
+    double signalledUs = vgl::ChromeTrace::now();
+
+    uint64_t ticks = 0;
+    if (vkGetQueryPoolResults(device, pool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CALIBRATE GPU TIMESTAMPS");
+    }
+
+    this->calibrationTicks = ticks & this->timestampMask;
+    this->calibrationUs = (submitUs + signalledUs) * 0.5;
+}
+
+double vgl::GpuProfiler::toTraceUs(uint64_t _ticks) const {
+    //Ticks only have timestampValidBits, so a difference past half the range means the counter wrapped
+    uint64_t delta = (_ticks - this->calibrationTicks) & this->timestampMask;
+    int64_t signedDelta = static_cast<int64_t>(delta);
+    if (this->timestampMask != ~0ull && delta > (this->timestampMask >> 1)) {
+        signedDelta -= static_cast<int64_t>(this->timestampMask) + 1;
+    }
+    return this->calibrationUs + static_cast<double>(signedDelta) * this->timestampPeriod / 1000.0;
+}
+
+void vgl::GpuProfiler::beginFrame(uint32_t _frameIndex) {
+    FrameQueries& frame = this->frames[_frameIndex];
+
+    //Sampling both clocks doesn't touch the queue, so it can run mid frame, timing a submit would wait behind every frame in flight
+    //Frames resolved from here on use the new calibration, earlier ones in the history keep the old one
+    if (this->getCalibratedTimestamps && ++this->framesSinceCalibration >= calibrationInterval) {
+        this->framesSinceCalibration = 0;
+        this->calibrate();
+    }
+
+    std::vector<Scope> scopes;
+    uint64_t frameNumber = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->scopeMutex);
+        bool recorded = frame.recorded;
+        frame.recorded = false;
+        if (!recorded || frame.scopes.empty()) {
+            frame.scopes.clear();
+            return;
+        }
+        scopes.swap(frame.scopes);
+        frame.scopes.reserve(this->maxScopes);
+        frameNumber = frame.frameNumber;
+    }
+
+    //The fence has signalled so every query that was written is available, nothing waits
+    uint32_t queryCount = static_cast<uint32_t>(scopes.size()) * 2;
+    VkResult result = vkGetQueryPoolResults(this->logicalDevice->device, frame.pool, 0, queryCount, queryCount * 2 * sizeof(uint64_t),
+        this->queryResults.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        throw std::runtime_error("FAILED TO READ TIMESTAMP QUERIES");
+    }
+
+    std::vector<ResolvedScope> resolved;
+    resolved.reserve(scopes.size());
+    for (const Scope& scope : scopes) {
+        const uint64_t* begin = &this->queryResults[static_cast<size_t>(scope.query) * 2];
+        const uint64_t* end = begin + 2;
+        //Scopes that were never closed or never executed
+        if (!scope.ended || begin[1] == 0 || end[1] == 0) {
+            continue;
+        }
+
+        uint64_t beginTicks = begin[0] & this->timestampMask;
+        uint64_t durationTicks = ((end[0] & this->timestampMask) - beginTicks) & this->timestampMask;
+        resolved.push_back({ &scope.name, this->toTraceUs(beginTicks), static_cast<double>(durationTicks) * this->timestampPeriod / 1000.0 });
+    }
+    if (resolved.empty()) {
+        return;
+    }
+
+    //Outer scopes first when two start together
+    std::sort(resolved.begin(), resolved.end(), [](const ResolvedScope& a, const ResolvedScope& b) {
+        return a.beginUs != b.beginUs ? a.beginUs < b.beginUs : a.durationUs > b.durationUs;
+    });
+
+    vgl::GpuFrameResult frameResult;
+    frameResult.frameNumber = frameNumber;
+    frameResult.beginUs = resolved.front().beginUs;
+    frameResult.scopes.reserve(resolved.size());
+
+    double frameEndUs = frameResult.beginUs;
+    //Ends of the scopes enclosing the current one
+    std::vector<double> openEnds;
+    for (const ResolvedScope& scope : resolved) {
+        double endUs = scope.beginUs + scope.durationUs;
+        while (!openEnds.empty() && openEnds.back() <= scope.beginUs) {
+            openEnds.pop_back();
+        }
+
+        vgl::GpuScopeResult scopeResult;
+        scopeResult.name = *scope.name;
+        scopeResult.depth = static_cast<uint32_t>(openEnds.size());
+        scopeResult.beginMs = (scope.beginUs - frameResult.beginUs) / 1000.0;
+        scopeResult.durationMs = scope.durationUs / 1000.0;
+        frameResult.scopes.push_back(std::move(scopeResult));
+
+        openEnds.push_back(endUs);
+        frameEndUs = std::max(frameEndUs, endUs);
+    }
+    frameResult.durationMs = (frameEndUs - frameResult.beginUs) / 1000.0;
+
+    std::lock_guard<std::mutex> lock(this->historyMutex);
+    this->history.push_back(std::move(frameResult));
+    while (this->history.size() > this->historySize) {
+        this->history.pop_front();
+    }
+}
+
+void vgl::GpuProfiler::beginCommandBuffer(VkCommandBuffer _commandBuffer, uint32_t _frameIndex) {
+    FrameQueries& frame = this->frames[_frameIndex];
+    {
+        std::lock_guard<std::mutex> lock(this->scopeMutex);
+        this->currentFrame = _frameIndex;
+        frame.frameNumber = ++this->frameCount;
+        frame.scopes.clear();
+        frame.recorded = true;
+    }
+
+    vkCmdResetQueryPool(_commandBuffer, frame.pool, 0, this->maxScopes * 2);
+}
+
+uint32_t vgl::GpuProfiler::beginScope(VkCommandBuffer _commandBuffer, const char* _name) {
+    VkQueryPool pool = VK_NULL_HANDLE;
+    uint32_t scope = invalidScope;
+    {
+        std::lock_guard<std::mutex> lock(this->scopeMutex);
+        FrameQueries& frame = this->frames[this->currentFrame];
+        if (!frame.recorded || frame.scopes.size() >= this->maxScopes) {
+            return invalidScope;
+        }
+        scope = static_cast<uint32_t>(frame.scopes.size());
+        frame.scopes.push_back({ _name, scope * 2, false });
+        pool = frame.pool;
+    }
+
+    vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, scope * 2);
+    return scope;
+}
+
+void vgl::GpuProfiler::endScope(VkCommandBuffer _commandBuffer, uint32_t _scope) {
+    VkQueryPool pool = VK_NULL_HANDLE;
+    {
+        std::lock_guard<std::mutex> lock(this->scopeMutex);
+        FrameQueries& frame = this->frames[this->currentFrame];
+        if (_scope >= frame.scopes.size() || frame.scopes[_scope].ended) {
+            return;
+        }
+        frame.scopes[_scope].ended = true;
+        pool = frame.pool;
+    }
+
+    vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, _scope * 2 + 1);
+}
+
+vgl::GpuFrameResult vgl::GpuProfiler::getLatestFrame() const {
+    std::lock_guard<std::mutex> lock(this->historyMutex);
+    return this->history.empty() ? vgl::GpuFrameResult{} : this->history.back();
+}
+
+std::vector<vgl::GpuFrameResult> vgl::GpuProfiler::getHistory() const {
+    std::lock_guard<std::mutex> lock(this->historyMutex);
+    return std::vector<vgl::GpuFrameResult>(this->history.begin(), this->history.end());
+}
+
+double vgl::GpuProfiler::getAverageMs(const std::string& _name) const {
+    std::lock_guard<std::mutex> lock(this->historyMutex);
+
+    double total = 0.0;
+    uint32_t count = 0;
+    for (const vgl::GpuFrameResult& frame : this->history) {
+        for (const vgl::GpuScopeResult& scope : frame.scopes) {
+            if (scope.name == _name) {
+                total += scope.durationMs;
+                count++;
+            }
+        }
+    }
+    return count > 0 ? total / count : 0.0;
+}
+
+void vgl::GpuProfiler::exportTo(vgl::ChromeTrace& _trace) const {
+    const uint32_t graphicsTrack = 1;
+
+    std::vector<vgl::TraceEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(this->historyMutex);
+        for (const vgl::GpuFrameResult& frame : this->history) {
+            for (const vgl::GpuScopeResult& scope : frame.scopes) {
+                vgl::TraceEvent event;
+                event.name = scope.name;
+                event.category = "gpu";
+                event.processId = vgl::ChromeTrace::gpuProcess;
+                event.threadId = graphicsTrack;
+                event.beginUs = frame.beginUs + scope.beginMs * 1000.0;
+                event.durationUs = scope.durationMs * 1000.0;
+                events.push_back(std::move(event));
+            }
+        }
+    }
+
+    _trace.setThreadName(vgl::ChromeTrace::gpuProcess, graphicsTrack, "Graphics queue");
+    _trace.addEvents(events);
+}
+
+bool vgl::GpuProfiler::writeChromeTrace(const std::string& _path) const {
+    vgl::ChromeTrace trace;
+    this->exportTo(trace);
+    return trace.write(_path);
+}
+
+bool vgl::GpuProfiler::writeCsv(const std::string& _path) const {
+    std::ofstream file(_path, std::ios::trunc);
+    if (!file.is_open()) { return false; }
+
+    file << "frame,scope,depth,begin_ms,duration_ms\n";
+    file.setf(std::ios::fixed);
+    file.precision(6);
+
+    std::lock_guard<std::mutex> lock(this->historyMutex);
+    for (const vgl::GpuFrameResult& frame : this->history) {
+        for (const vgl::GpuScopeResult& scope : frame.scopes) {
+            //Quote the name so commas in it don't add columns
+            std::string name = scope.name;
+            for (size_t i = name.find('"'); i != std::string::npos; i = name.find('"', i + 2)) {
+                name.insert(i, 1, '"');
+            }
+            file << frame.frameNumber << ",\"" << name << "\"," << scope.depth << "," << scope.beginMs << "," << scope.durationMs << "\n";
+        }
+    }
+
+    file.flush();
+    return file.good();
+}
+
+double vgl::GpuProfiler::getTimestampPeriod() const {
+    return this->timestampPeriod;
+}
+
+vgl::GpuProfileScope::GpuProfileScope(vgl::GpuProfiler* _profiler, VkCommandBuffer _commandBuffer, const char* _name)
+    : profiler(_profiler), commandBuffer(_commandBuffer)
+{
+    if (this->profiler) {
+        this->scope = this->profiler->beginScope(this->commandBuffer, _name);
+    }
+}
+
+vgl::GpuProfileScope::~GpuProfileScope() {
+    if (this->profiler && this->scope != vgl::GpuProfiler::invalidScope) {
+        this->profiler->endScope(this->commandBuffer, this->scope);
+    }
+}
@@ -0,0 +1,322 @@
+#include "vgl/HostAllocator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "vgl/Logger.h"
+
+namespace {
+
+    void* alignedAllocate(size_t _alignment, size_t _size) {
+#ifdef _WIN32
+        return _aligned_malloc(_size, _alignment);
+#else
+        void* memory = nullptr;
+        if (posix_memalign(&memory, _alignment, _size) != 0) {
+            return nullptr;
+        }
+        return memory;
+#endif
+    }
+
+    void alignedFree(void* _memory) {
+#ifdef _WIN32
+        _aligned_free(_memory);
+#else
+        std::free(_memory);
+#endif
+    }
+
+    bool isDisabledValue(const char* _value) {
+        std::string value(_value);
+        for (char& c : value) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return value == "0" || value == "off" || value == "false";
+    }
+
+}
+
+vgl::HostAllocator& vgl::HostAllocator::get() {
+    //Leaked on purpose, the driver may still free memory from static destructors
+    static vgl::HostAllocator* allocator = new vgl::HostAllocator();
+    return *allocator;
+}
+
+const VkAllocationCallbacks* vgl::HostAllocator::callbacks() {
+    vgl::HostAllocator& allocator = get();
+    return allocator.enabled ? &allocator.vkCallbacks : nullptr;
+}
+
+vgl::HostAllocator::HostAllocator() {
+    const char* value = std::getenv(environmentVariable);
+    if (value != nullptr && isDisabledValue(value)) {
+        this->enabled = false;
+    }
+
+    this->vkCallbacks.pUserData = this;
+    this->vkCallbacks.pfnAllocation = &HostAllocator::allocationCallback;
+    this->vkCallbacks.pfnReallocation = &HostAllocator::reallocationCallback;
+    this->vkCallbacks.pfnFree = &HostAllocator::freeCallback;
+    this->vkCallbacks.pfnInternalAllocation = &HostAllocator::internalAllocationCallback;
+    this->vkCallbacks.pfnInternalFree = &HostAllocator::internalFreeCallback;
+}
+
+bool vgl::HostAllocator::isEnabled() const {
+    return this->enabled;
+}
+
+vgl::HostAllocator::Stats vgl::HostAllocator::getStats() const {
+    Stats stats;
+
+    for (uint32_t i = 0; i < scopeCount; i++) {
+        const ScopeCounters& counters = this->scopes[i];
+        ScopeStats& scope = stats.scopes[i];
+        scope.bytesInUse = counters.bytesInUse.load(std::memory_order_relaxed);
+        scope.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+        scope.allocationsInUse = counters.allocationsInUse.load(std::memory_order_relaxed);
+        scope.allocationCount = counters.allocationCount.load(std::memory_order_relaxed);
+        scope.reallocationCount = counters.reallocationCount.load(std::memory_order_relaxed);
+        scope.freeCount = counters.freeCount.load(std::memory_order_relaxed);
+        scope.internalBytesInUse = counters.internalBytesInUse.load(std::memory_order_relaxed);
+        scope.internalAllocationCount = counters.internalAllocationCount.load(std::memory_order_relaxed);
+    }
+
+    stats.bytesInUse = this->bytesInUse.load(std::memory_order_relaxed);
+    stats.peakBytes = this->peakBytes.load(std::memory_order_relaxed);
+    stats.largeAllocationsInUse = this->largeAllocationsInUse.load(std::memory_order_relaxed);
+    stats.failedCount = this->failedCount.load(std::memory_order_relaxed);
+    stats.bytesReserved = this->largeBytesReserved.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < classCount; i++) {
+        SizeClass& sizeClass = this->classes[i];
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+
+        uint64_t slabBytes = sizeClass.slabs.size() * slabSize;
+        stats.slabCount += static_cast<uint32_t>(sizeClass.slabs.size());
+        stats.bytesReserved += slabBytes;
+        stats.idleSlabBytes += slabBytes - sizeClass.blocksInUse * (minClassSize << i);
+    }
+
+    return stats;
+}
+
+void vgl::HostAllocator::resetPeaks() {
+    for (ScopeCounters& counters : this->scopes) {
+        counters.peakBytes.store(counters.bytesInUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    this->peakBytes.store(this->bytesInUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void vgl::HostAllocator::logStats() const {
+    if (!this->enabled) {
+        VGL_LOG_INFO("HostAllocator", "DISABLED, THE DRIVER ALLOCATES HOST MEMORY ITSELF");
+        return;
+    }
+
+    Stats stats = this->getStats();
+    VGL_LOG_INFO("HostAllocator", stats.bytesInUse / 1024 << "KiB in use (peak " << stats.peakBytes / 1024 << "KiB), "
+        << stats.bytesReserved / 1024 << "KiB reserved in " << stats.slabCount << " slabs and " << stats.largeAllocationsInUse
+        << " large allocations, " << stats.idleSlabBytes / 1024 << "KiB idle in slabs, " << stats.failedCount << " failed");
+
+    for (uint32_t i = 0; i < scopeCount; i++) {
+        const ScopeStats& scope = stats.scopes[i];
+        if (scope.allocationCount == 0 && scope.internalAllocationCount == 0) { continue; }
+
+        VGL_LOG_INFO("HostAllocator", getScopeName(static_cast<VkSystemAllocationScope>(i)) << ": " << scope.bytesInUse / 1024
+            << "KiB in " << scope.allocationsInUse << " allocations (peak " << scope.peakBytes / 1024 << "KiB), "
+            << scope.allocationCount << " allocations, " << scope.reallocationCount << " reallocations, " << scope.freeCount << " frees, "
+            << scope.internalBytesInUse / 1024 << "KiB internal");
+    }
+}
+
+const char* vgl::HostAllocator::getScopeName(VkSystemAllocationScope _scope) {
+    switch (_scope) {
+    case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "COMMAND";
+    case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "OBJECT";
+    case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "CACHE";
+    case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "DEVICE";
+    case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "INSTANCE";
+    default: return "UNKNOWN";
+    }
+}
+
+void* vgl::HostAllocator::allocate(size_t _size, size_t _alignment, VkSystemAllocationScope _scope) {
+    if (_size == 0) { return nullptr; }
+
+    //The header sits in the first offset bytes, padded so the pointer after it keeps the requested alignment
+    size_t offset = std::max(_alignment, sizeof(Header));
+    size_t total = offset + _size;
+
+    uint8_t sizeClass = largeClass;
+    void* block = nullptr;
+    if (total <= maxClassSize) {
+        //Blocks are aligned to their class size, which is at least offset and so at least the alignment
+        sizeClass = 0;
+        while ((minClassSize << sizeClass) < total) {
+            sizeClass++;
+        }
+        block = this->allocateBlock(sizeClass);
+    }
+    else {
+        block = alignedAllocate(offset, total);
+        if (block) {
+            this->largeBytesReserved.fetch_add(total, std::memory_order_relaxed);
+            this->largeAllocationsInUse.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!block) {
+        this->failedCount.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    char* memory = static_cast<char*>(block) + offset;
+    Header* header = reinterpret_cast<Header*>(memory) - 1;
+    header->size = _size;
+    header->offset = static_cast<uint32_t>(offset);
+    header->sizeClass = sizeClass;
+    header->scope = static_cast<uint8_t>(toScopeIndex(_scope));
+    header->padding = 0;
+
+    ScopeCounters& counters = this->scopes[header->scope];
+    counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+    this->track(header->scope, static_cast<int64_t>(_size), 1);
+    return memory;
+}
+
+void* vgl::HostAllocator::reallocate(void* _original, size_t _size, size_t _alignment, VkSystemAllocationScope _scope) {
+    if (!_original) {
+        return this->allocate(_size, _alignment, _scope);
+    }
+    if (_size == 0) {
+        this->free(_original);
+        return nullptr;
+    }
+
+    Header* header = static_cast<Header*>(_original) - 1;
+    this->scopes[header->scope].reallocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    //Grow or shrink in place while it still fits in the block, the alignment is always the same as the original's
+    if (header->sizeClass != largeClass && header->offset + _size <= (minClassSize << header->sizeClass)) {
+        this->track(header->scope, static_cast<int64_t>(_size) - static_cast<int64_t>(header->size), 0);
+        header->size = _size;
+        return _original;
+    }
+
+    void* memory = this->allocate(_size, _alignment, _scope);
+    if (!memory) {
+        //The original is left untouched when reallocation fails
+        return nullptr;
+    }
+    std::memcpy(memory, _original, std::min<size_t>(_size, header->size));
+    this->free(_original);
+    return memory;
+}
+
+void vgl::HostAllocator::free(void* _memory) {
+    if (!_memory) { return; }
+
+    Header* header = static_cast<Header*>(_memory) - 1;
+    uint32_t scope = header->scope;
+    void* block = static_cast<char*>(_memory) - header->offset;
+
+    this->scopes[scope].freeCount.fetch_add(1, std::memory_order_relaxed);
+    this->track(scope, -static_cast<int64_t>(header->size), -1);
+
+    if (header->sizeClass == largeClass) {
+        this->largeBytesReserved.fetch_sub(header->offset + header->size, std::memory_order_relaxed);
+        this->largeAllocationsInUse.fetch_sub(1, std::memory_order_relaxed);
+        alignedFree(block);
+    }
+    else {
+        this->freeBlock(header->sizeClass, block);
+    }
+}
+
+void* vgl::HostAllocator::allocateBlock(uint32_t _sizeClass) {
+    SizeClass& sizeClass = this->classes[_sizeClass];
+    size_t blockSize = minClassSize << _sizeClass;
+
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+    if (!sizeClass.freeList) {
+        //Slabs are aligned to the largest class so every block in them is aligned to its own size
+        void* slab = alignedAllocate(maxClassSize, slabSize);
+        if (!slab) { return nullptr; }
+        sizeClass.slabs.push_back(slab);
+
+        //Link the new blocks in address order
+        char* first = static_cast<char*>(slab);
+        for (size_t offset = slabSize; offset >= blockSize; offset -= blockSize) {
+            void* block = first + offset - blockSize;
+            *static_cast<void**>(block) = sizeClass.freeList;
+            sizeClass.freeList = block;
+        }
+    }
+
+    void* block = sizeClass.freeList;
+    sizeClass.freeList = *static_cast<void**>(block);
+    sizeClass.blocksInUse++;
+    return block;
+}
+
+void vgl::HostAllocator::freeBlock(uint32_t _sizeClass, void* _block) {
+    SizeClass& sizeClass = this->classes[_sizeClass];
+
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+    *static_cast<void**>(_block) = sizeClass.freeList;
+    sizeClass.freeList = _block;
+    sizeClass.blocksInUse--;
+}
+
+void vgl::HostAllocator::track(uint32_t _scope, int64_t _bytes, int64_t _allocations) {
+    ScopeCounters& counters = this->scopes[_scope];
+
+    //Unsigned wrap around makes adding a negative delta a subtraction
+    uint64_t scopeBytes = counters.bytesInUse.fetch_add(static_cast<uint64_t>(_bytes), std::memory_order_relaxed) + static_cast<uint64_t>(_bytes);
+    uint64_t totalBytes = this->bytesInUse.fetch_add(static_cast<uint64_t>(_bytes), std::memory_order_relaxed) + static_cast<uint64_t>(_bytes);
+    counters.allocationsInUse.fetch_add(static_cast<uint64_t>(_allocations), std::memory_order_relaxed);
+
+    if (_bytes > 0) {
+        updatePeak(counters.peakBytes, scopeBytes);
+        updatePeak(this->peakBytes, totalBytes);
+    }
+}
+
+void vgl::HostAllocator::updatePeak(std::atomic<uint64_t>& _peak, uint64_t _value) {
+    uint64_t peak = _peak.load(std::memory_order_relaxed);
+    while (_value > peak && !_peak.compare_exchange_weak(peak, _value, std::memory_order_relaxed)) {
+    }
+}
+
+uint32_t vgl::HostAllocator::toScopeIndex(VkSystemAllocationScope _scope) {
+    uint32_t index = static_cast<uint32_t>(_scope);
+    //Unknown scopes from newer drivers are counted as object scope
+    return index < scopeCount ? index : static_cast<uint32_t>(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+}
+
+VKAPI_ATTR void* VKAPI_CALL vgl::HostAllocator::allocationCallback(void* _userData, size_t _size, size_t _alignment, VkSystemAllocationScope _scope) {
+    return static_cast<vgl::HostAllocator*>(_userData)->allocate(_size, _alignment, _scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL vgl::HostAllocator::reallocationCallback(void* _userData, void* _original, size_t _size, size_t _alignment, VkSystemAllocationScope _scope) {
+    return static_cast<vgl::HostAllocator*>(_userData)->reallocate(_original, _size, _alignment, _scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL vgl::HostAllocator::freeCallback(void* _userData, void* _memory) {
+    static_cast<vgl::HostAllocator*>(_userData)->free(_memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL vgl::HostAllocator::internalAllocationCallback(void* _userData, size_t _size, VkInternalAllocationType, VkSystemAllocationScope _scope) {
+    ScopeCounters& counters = static_cast<vgl::HostAllocator*>(_userData)->scopes[toScopeIndex(_scope)];
+    counters.internalBytesInUse.fetch_add(_size, std::memory_order_relaxed);
+    counters.internalAllocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL vgl::HostAllocator::internalFreeCallback(void* _userData, size_t _size, VkInternalAllocationType, VkSystemAllocationScope _scope) {
+    ScopeCounters& counters = static_cast<vgl::HostAllocator*>(_userData)->scopes[toScopeIndex(_scope)];
+    counters.internalBytesInUse.fetch_sub(_size, std::memory_order_relaxed);
+}
@@ -0,0 +1,337 @@
+#include "vgl/IndirectRenderer.h"
+
+#include <cstring>
+
+#include "vgl/HostAllocator.h"
+
+namespace {
+
+    //Matches the Cull uniform block of the culling shader (std140)
+    struct CullUniforms {
+        float planes[vgl::Frustum::PlaneCount][4];
+        float viewProjection[16];
+        float pyramid[4];
+        uint32_t objectCount;
+        uint32_t flags;
+        uint32_t padding[2];
+    };
+
+    static_assert(sizeof(vgl::IndirectObject) == 32, "IndirectObject must match the std430 layout of the culling shader");
+    static_assert(sizeof(CullUniforms) == 192, "CullUniforms must match the std140 layout of the culling shader");
+
+}
+
+vgl::IndirectRenderer::IndirectRenderer(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, vgl::DescriptorAllocator* _descriptorAllocator,
+    const std::vector<char>& _cullSpirv, uint32_t _maxObjects, uint32_t _framesInFlight)
+    : logicalDevice(_logicalDevice),
+    uploadEngine(_uploadEngine),
+    descriptorAllocator(_descriptorAllocator),
+    maxObjects(_maxObjects)
+{
+    if (this->maxObjects == 0) {
+        throw std::runtime_error("INDIRECT RENDERER NEEDS AT LEAST ONE OBJECT");
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings(5);
+    const VkDescriptorType types[5] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER };
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    this->setLayout = this->descriptorAllocator->getLayoutCache()->getLayout(bindings);
+    this->pipeline = std::make_unique<vgl::ComputePipeline>(this->logicalDevice, _cullSpirv, std::vector<VkDescriptorSetLayout>{ this->setLayout });
+
+    VkDeviceSize drawBytes = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(this->maxObjects);
+    this->createBuffer(this->objects, sizeof(vgl::IndirectObject) * static_cast<VkDeviceSize>(this->maxObjects),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    this->frames.resize(_framesInFlight);
+    for (auto& frame : this->frames) {
+        this->createBuffer(frame.uniforms, sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        this->createBuffer(frame.draws, drawBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        this->createBuffer(frame.count, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        //Read back without an invalidate, so it has to be coherent
+        this->createBuffer(frame.readback, sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        std::memset(frame.readback.memory.mapped, 0, sizeof(uint32_t));
+        this->createBuffer(frame.cpuDraws, drawBytes, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    }
+
+    this->createDefaultPyramid();
+}
+
+vgl::IndirectRenderer::~IndirectRenderer() {
+    VkDevice device = this->logicalDevice->device;
+
+    //Descriptor sets and the layout belong to the descriptor allocator
+    for (auto& frame : this->frames) {
+        this->destroyBuffer(frame.uniforms);
+        this->destroyBuffer(frame.draws);
+        this->destroyBuffer(frame.count);
+        this->destroyBuffer(frame.readback);
+        this->destroyBuffer(frame.cpuDraws);
+    }
+    this->destroyBuffer(this->objects);
+
+    vkDestroySampler(device, this->pyramidSampler, vgl::HostAllocator::callbacks());
+    vkDestroyImageView(device, this->defaultPyramidView, vgl::HostAllocator::callbacks());
+    this->logicalDevice->getAllocator()->destroyImage(this->defaultPyramid, this->defaultPyramidMemory);
+}
+
+vgl::UploadTicket vgl::IndirectRenderer::setObjects(const std::vector<vgl::IndirectObject>& _objects) {
+    if (_objects.size() > this->maxObjects) {
+        throw std::runtime_error("TOO MANY INDIRECT OBJECTS");
+    }
+
+    this->objectCount = static_cast<uint32_t>(_objects.size());
+    this->cpuObjects = _objects;
+    this->boundingVolumes.clear();
+    this->boundingVolumes.reserve(this->objectCount);
+    for (const auto& object : _objects) {
+        this->boundingVolumes.add(vgl::Sphere{ glm::vec3(object.center[0], object.center[1], object.center[2]), object.radius });
+    }
+
+    if (_objects.empty()) {
+        return 0;
+    }
+    return this->uploadEngine->uploadBuffer(this->objects.buffer, 0, _objects.data(), sizeof(vgl::IndirectObject) * _objects.size());
+}
+
+void vgl::IndirectRenderer::setDepthPyramid(VkImageView view, uint32_t width, uint32_t height, uint32_t mipCount) {
+    this->pyramidView = view;
+    this->pyramidSize[0] = static_cast<float>(width);
+    this->pyramidSize[1] = static_cast<float>(height);
+    this->pyramidSize[2] = static_cast<float>(mipCount);
+    for (auto& frame : this->frames) {
+        frame.setDirty = true;
+    }
+}
+
+void vgl::IndirectRenderer::clearDepthPyramid() {
+    this->setDepthPyramid(VK_NULL_HANDLE, 0, 0, 0);
+}
+
+void vgl::IndirectRenderer::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const float* viewProjection) {
+    FrameResources& frame = this->frames[frameIndex];
+    frame.culledOnCpu = false;
+
+    if (!this->defaultPyramidCleared) {
+        this->clearDefaultPyramid(commandBuffer);
+    }
+
+    CullUniforms uniforms{};
+    vgl::Frustum frustum = vgl::Frustum::fromViewProjection(viewProjection);
+    std::memcpy(uniforms.planes, frustum.planes, sizeof(uniforms.planes));
+    std::memcpy(uniforms.viewProjection, viewProjection, sizeof(uniforms.viewProjection));
+    uniforms.pyramid[0] = this->pyramidSize[0];
+    uniforms.pyramid[1] = this->pyramidSize[1];
+    uniforms.pyramid[2] = this->pyramidSize[2];
+    uniforms.objectCount = this->objectCount;
+    uniforms.flags = (this->logicalDevice->isDrawIndirectCountEnabled() ? compactBit : 0) | (this->pyramidView != VK_NULL_HANDLE ? occlusionBit : 0);
+    std::memcpy(frame.uniforms.memory.mapped, &uniforms, sizeof(CullUniforms));
+    this->logicalDevice->getAllocator()->flush(frame.uniforms.memory);
+
+    //The count is appended to with atomics so it has to start at zero
+    vkCmdFillBuffer(commandBuffer, frame.count.buffer, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    if (this->objectCount > 0) {
+        VkDescriptorSet set = this->getSet(frame);
+        this->pipeline->bind(commandBuffer);
+        this->pipeline->bindDescriptorSets(commandBuffer, { set });
+        this->pipeline->dispatch(commandBuffer, vgl::ComputePipeline::groupCount(this->objectCount, workgroupSize));
+    }
+
+    //Commands and count are consumed by the indirect draw, the count is also copied back for getVisibleCount
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copy{ 0, 0, sizeof(uint32_t) };
+    vkCmdCopyBuffer(commandBuffer, frame.count.buffer, frame.readback.buffer, 1, &copy);
+
+    VkMemoryBarrier readbackBarrier{};
+    readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &readbackBarrier, 0, nullptr, 0, nullptr);
+}
+
+void vgl::IndirectRenderer::cullOnCpu(uint32_t frameIndex, const float* viewProjection) {
+    FrameResources& frame = this->frames[frameIndex];
+    frame.culledOnCpu = true;
+
+    vgl::Frustum frustum = vgl::Frustum::fromViewProjection(viewProjection);
+    frame.cpuDrawCount = this->boundingVolumes.cull(frustum, this->cpuVisible);
+
+    VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(frame.cpuDraws.memory.mapped);
+    for (uint32_t i = 0; i < frame.cpuDrawCount; i++) {
+        const vgl::IndirectObject& object = this->cpuObjects[this->cpuVisible[i]];
+        commands[i] = { object.indexCount, 1, object.firstIndex, object.vertexOffset, object.firstInstance };
+    }
+    this->logicalDevice->getAllocator()->flush(frame.cpuDraws.memory, 0, sizeof(VkDrawIndexedIndirectCommand) * frame.cpuDrawCount);
+}
+
+void vgl::IndirectRenderer::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+    const FrameResources& frame = this->frames[frameIndex];
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    //Without drawIndirectCount the GPU pass writes every object's slot and culled ones draw nothing
+    VkBuffer buffer = frame.draws.buffer;
+    uint32_t drawCount = this->objectCount;
+    if (frame.culledOnCpu) {
+        buffer = frame.cpuDraws.buffer;
+        drawCount = frame.cpuDrawCount;
+    }
+    else if (this->logicalDevice->isDrawIndirectCountEnabled()) {
+        vkCmdDrawIndexedIndirectCount(commandBuffer, frame.draws.buffer, 0, frame.count.buffer, 0, this->objectCount, stride);
+        return;
+    }
+
+    if (drawCount == 0) { return; }
+    if (this->logicalDevice->isMultiDrawIndirectEnabled()) {
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, 0, drawCount, stride);
+        return;
+    }
+    for (uint32_t i = 0; i < drawCount; i++) {
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, static_cast<VkDeviceSize>(i) * stride, 1, stride);
+    }
+}
+
+uint32_t vgl::IndirectRenderer::getVisibleCount(uint32_t frameIndex) const {
+    const FrameResources& frame = this->frames[frameIndex];
+    if (frame.culledOnCpu) {
+        return frame.cpuDrawCount;
+    }
+    uint32_t count = 0;
+    std::memcpy(&count, frame.readback.memory.mapped, sizeof(uint32_t));
+    return count;
+}
+
+uint32_t vgl::IndirectRenderer::getObjectCount() const {
+    return this->objectCount;
+}
+
+uint32_t vgl::IndirectRenderer::getMaxObjects() const {
+    return this->maxObjects;
+}
+
+const vgl::BoundingVolumeSet& vgl::IndirectRenderer::getBoundingVolumes() const {
+    return this->boundingVolumes;
+}
+
+vgl::ComputePipeline* vgl::IndirectRenderer::getPipeline() const {
+    return this->pipeline.get();
+}
+
+void vgl::IndirectRenderer::createBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    VkMemoryPropertyFlags preferred = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0;
+    this->logicalDevice->getAllocator()->createBuffer(size, usage, properties, buffer.buffer, buffer.memory, preferred);
+}
+
+void vgl::IndirectRenderer::destroyBuffer(Buffer& buffer) {
+    if (buffer.buffer) {
+        this->logicalDevice->getAllocator()->destroyBuffer(buffer.buffer, buffer.memory);
+    }
+}
+
+void vgl::IndirectRenderer::createDefaultPyramid() {
+    VkDevice device = this->logicalDevice->device;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = { 1, 1, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    this->logicalDevice->getAllocator()->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->defaultPyramid, this->defaultPyramidMemory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = this->defaultPyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    if (vkCreateImageView(device, &viewInfo, vgl::HostAllocator::callbacks(), &this->defaultPyramidView) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE DEPTH PYRAMID IMAGE VIEW");
+    }
+
+    //Pyramid texels are read individually, never filtered
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, vgl::HostAllocator::callbacks(), &this->pyramidSampler) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE DEPTH PYRAMID SAMPLER");
+    }
+}
+
+void vgl::IndirectRenderer::clearDefaultPyramid(VkCommandBuffer commandBuffer) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = this->defaultPyramid;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    //Far plane everywhere, nothing is ever occluded by it
+    VkClearColorValue farDepth{};
+    farDepth.float32[0] = 1.0f;
+    vkCmdClearColorImage(commandBuffer, this->defaultPyramid, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &farDepth, 1, &barrier.subresourceRange);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    this->defaultPyramidCleared = true;
+}
+
+VkDescriptorSet vgl::IndirectRenderer::getSet(FrameResources& frame) {
+    if (!frame.setDirty) {
+        return frame.set;
+    }
+
+    //Persistent sets are cached by contents, so switching back to an earlier pyramid reuses its set
+    vgl::DescriptorWriter writer;
+    writer.writeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frame.uniforms.buffer);
+    writer.writeBuffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, this->objects.buffer);
+    writer.writeBuffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.draws.buffer);
+    writer.writeBuffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.count.buffer);
+    writer.writeImage(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, this->pyramidView != VK_NULL_HANDLE ? this->pyramidView : this->defaultPyramidView,
+        this->pyramidSampler);
+
+    frame.set = this->descriptorAllocator->getPersistent(this->setLayout, writer);
+    frame.setDirty = false;
+    return frame.set;
+}
@@ -0,0 +1,127 @@
+#include "vgl/JobSystem.h"
+
+namespace {
+    //Index of the current thread, set once when a worker starts
+    thread_local uint32_t threadIndex = 0;
+}
+
+vgl::JobSystem::JobSystem(uint32_t _workerCount) {
+    if (_workerCount == 0) {
+        uint32_t cores = std::thread::hardware_concurrency();
+        _workerCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    this->workers.reserve(_workerCount);
+    for (uint32_t i = 0; i < _workerCount; i++) {
+        this->workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+    }
+}
+
+vgl::JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->condition.notify_all();
+
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+void vgl::JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function) {
+    if (count == 0) { return; }
+    if (batchSize == 0) { batchSize = 1; }
+
+    uint32_t batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount == 1) {
+        function(0, count);
+        return;
+    }
+
+    //Shared between the caller and helpers, helpers that start after everything is done find nothing left and exit
+    struct State {
+        std::atomic<uint32_t> nextBatch{ 0 };
+        std::atomic<uint32_t> finishedBatches{ 0 };
+        std::mutex mutex;
+        std::condition_variable condition;
+        //First exception thrown by a batch, rethrown on the calling thread
+        std::exception_ptr exception;
+    };
+    auto state = std::make_shared<State>();
+
+    //The function is only guaranteed to live until this call returns, which is after every batch has run
+    const auto* functionPtr = &function;
+    auto runBatches = [state, functionPtr, count, batchSize, batchCount]() {
+        uint32_t batch;
+        while ((batch = state->nextBatch.fetch_add(1)) < batchCount) {
+            uint32_t begin = batch * batchSize;
+            uint32_t end = std::min(begin + batchSize, count);
+            try {
+                (*functionPtr)(begin, end);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->exception) { state->exception = std::current_exception(); }
+            }
+
+            if (state->finishedBatches.fetch_add(1) + 1 == batchCount) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    uint32_t helperCount = std::min<uint32_t>(static_cast<uint32_t>(this->workers.size()), batchCount - 1);
+    for (uint32_t i = 0; i < helperCount; i++) {
+        this->enqueue(runBatches);
+    }
+
+    runBatches();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&state, batchCount]() { return state->finishedBatches.load() == batchCount; });
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+uint32_t vgl::JobSystem::getWorkerCount() const {
+    return static_cast<uint32_t>(this->workers.size());
+}
+
+uint32_t vgl::JobSystem::getThreadCount() const {
+    return static_cast<uint32_t>(this->workers.size()) + 1;
+}
+
+uint32_t vgl::JobSystem::getThreadIndex() {
+    return threadIndex;
+}
+
+void vgl::JobSystem::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queue.push_back(std::move(job));
+    }
+    this->condition.notify_one();
+}
+
+void vgl::JobSystem::workerLoop(uint32_t index) {
+    threadIndex = index;
+
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+
+            //Drain the queue before stopping so no submitted future is left without a value
+            if (this->queue.empty()) { return; }
+
+            job = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+        job();
+    }
+}
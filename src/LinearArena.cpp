@@ -0,0 +1,76 @@
+#include "vgl/LinearArena.h"
+
+vgl::LinearArena::LinearArena(vgl::MemoryAllocator* _allocator, VkDeviceSize _sizePerFrame, uint32_t _frameCount, VkBufferUsageFlags _usage)
+    : allocator(_allocator),
+    sizePerFrame(_sizePerFrame),
+    frameCount(_frameCount)
+{
+    const VkPhysicalDeviceLimits& limits = this->allocator->getLimits();
+    this->defaultAlignment = std::max<VkDeviceSize>({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16 });
+
+    //Keep each frame's region aligned so offsets inside it only need aligning relative to the region start
+    this->sizePerFrame = ((this->sizePerFrame + this->defaultAlignment - 1) / this->defaultAlignment) * this->defaultAlignment;
+
+    //Written by the CPU every frame and read once by the GPU, so host visible memory is used directly rather than staging
+    this->allocator->createBuffer(this->sizePerFrame * this->frameCount, _usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, this->buffer, this->allocation, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+vgl::LinearArena::~LinearArena() {
+    this->allocator->destroyBuffer(this->buffer, this->allocation);
+}
+
+void vgl::LinearArena::beginFrame(uint32_t frameIndex) {
+    this->currentFrame = frameIndex % this->frameCount;
+    this->head = 0;
+}
+
+vgl::LinearArena::Allocation vgl::LinearArena::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    if (alignment == 0) { alignment = this->defaultAlignment; }
+
+    VkDeviceSize offset = ((this->head + alignment - 1) / alignment) * alignment;
+    if (offset + size > this->sizePerFrame) {
+        return Allocation{};
+    }
+
+    this->head = offset + size;
+    this->peakUsed = std::max(this->peakUsed, this->head);
+
+    VkDeviceSize bufferOffset = this->currentFrame * this->sizePerFrame + offset;
+
+    Allocation result;
+    result.buffer = this->buffer;
+    result.offset = bufferOffset;
+    result.size = size;
+    result.mapped = static_cast<char*>(this->allocation.mapped) + bufferOffset;
+    return result;
+}
+
+vgl::LinearArena::Allocation vgl::LinearArena::push(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+    Allocation result = this->allocate(size, alignment);
+    if (result.isValid()) {
+        memcpy(result.mapped, data, static_cast<size_t>(size));
+    }
+    return result;
+}
+
+void vgl::LinearArena::flush() {
+    if (this->head == 0) { return; }
+    this->allocator->flush(this->allocation, this->currentFrame * this->sizePerFrame, this->head);
+}
+
+VkBuffer vgl::LinearArena::getBuffer() const {
+    return this->buffer;
+}
+
+VkDeviceSize vgl::LinearArena::getSizePerFrame() const {
+    return this->sizePerFrame;
+}
+
+VkDeviceSize vgl::LinearArena::getUsedBytes() const {
+    return this->head;
+}
+
+VkDeviceSize vgl::LinearArena::getPeakUsedBytes() const {
+    return this->peakUsed;
+}
@@ -0,0 +1,392 @@
+#include "vgl/Logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#include "vgl/ChromeTrace.h"
+
+namespace {
+
+    bool parseLevel(const char* _value, vgl::LogLevel& _level) {
+        std::string value(_value);
+        for (char& c : value) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        if (value == "verbose") { _level = vgl::LogLevel::Verbose; }
+        else if (value == "info") { _level = vgl::LogLevel::Info; }
+        else if (value == "warning") { _level = vgl::LogLevel::Warning; }
+        else if (value == "error") { _level = vgl::LogLevel::Error; }
+        else if (value == "off") { _level = vgl::LogLevel::Off; }
+        else { return false; }
+        return true;
+    }
+
+}
+
+std::string vgl::LogSink::format(const vgl::LogMessage& _message) {
+    std::time_t seconds = std::chrono::system_clock::to_time_t(_message.time);
+    long long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(_message.time.time_since_epoch()).count() % 1000;
+
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "[%02d:%02d:%02d.%03lld] [%s] ", local.tm_hour, local.tm_min, local.tm_sec, milliseconds, getLevelName(_message.level));
+
+    std::string line = prefix;
+    if (!_message.category.empty()) {
+        line += "[" + _message.category + "] ";
+    }
+    line += _message.text;
+    return line;
+}
+
+const char* vgl::LogSink::getLevelName(vgl::LogLevel _level) {
+    switch (_level) {
+    case vgl::LogLevel::Verbose: return "VERBOSE";
+    case vgl::LogLevel::Info: return "INFO";
+    case vgl::LogLevel::Warning: return "WARNING";
+    case vgl::LogLevel::Error: return "ERROR";
+    default: return "OFF";
+    }
+}
+
+void vgl::ConsoleSink::write(const vgl::LogMessage& _message) {
+    std::ostream& out = _message.level >= vgl::LogLevel::Warning ? std::cerr : std::cout;
+    out << format(_message) << '\n';
+}
+
+void vgl::ConsoleSink::flush() {
+    std::cout.flush();
+    std::cerr.flush();
+}
+
+vgl::FileSink::FileSink(const std::string& _path)
+    : file(_path, std::ios::trunc)
+{
+}
+
+void vgl::FileSink::write(const vgl::LogMessage& _message) {
+    if (this->file.is_open()) {
+        this->file << format(_message) << '\n';
+    }
+}
+
+void vgl::FileSink::flush() {
+    this->file.flush();
+}
+
+bool vgl::FileSink::isOpen() const {
+    return this->file.is_open();
+}
+
+vgl::CallbackSink::CallbackSink(Callback _callback)
+    : callback(std::move(_callback))
+{
+}
+
+void vgl::CallbackSink::write(const vgl::LogMessage& _message) {
+    if (this->callback) {
+        this->callback(_message);
+    }
+}
+
+vgl::Logger& vgl::Logger::get() {
+    //Leaked on purpose, anything can log from a static destructor, the thread is stopped and the queue drained from an exit hook instead
+    static vgl::Logger* logger = []() {
+        vgl::Logger* created = new vgl::Logger();
+        std::atexit([]() { vgl::Logger::get().shutdown(); });
+        return created;
+    }();
+    return *logger;
+}
+
+vgl::Logger::Logger() {
+    vgl::LogLevel environmentLevel = vgl::LogLevel::Info;
+    const char* value = std::getenv(environmentVariable);
+    if (value != nullptr && parseLevel(value, environmentLevel)) {
+        this->level.store(static_cast<uint32_t>(environmentLevel), std::memory_order_relaxed);
+    }
+
+    this->sinks.push_back(std::make_shared<vgl::ConsoleSink>());
+
+    //The queue always holds one consumed node for producers to link onto
+    this->tail = new Node();
+    this->head.store(this->tail, std::memory_order_relaxed);
+
+    this->running.store(true, std::memory_order_release);
+    this->thread = std::thread(&Logger::threadLoop, this);
+}
+
+void vgl::Logger::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(this->wakeMutex);
+        this->stopping = true;
+    }
+    this->wake.notify_one();
+    this->thread.join();
+    this->running.store(false, std::memory_order_release);
+
+    //Anything logged while the thread was stopping
+    std::lock_guard<std::mutex> lock(this->drainMutex);
+    this->drain();
+    this->reportRepeats(true);
+    {
+        std::lock_guard<std::mutex> sinkLock(this->sinkMutex);
+        for (auto& sink : this->sinks) {
+            sink->flush();
+        }
+    }
+}
+
+void vgl::Logger::setLevel(vgl::LogLevel _level) {
+    this->level.store(static_cast<uint32_t>(_level), std::memory_order_relaxed);
+}
+
+vgl::LogLevel vgl::Logger::getLevel() const {
+    return static_cast<vgl::LogLevel>(this->level.load(std::memory_order_relaxed));
+}
+
+bool vgl::Logger::isEnabled(vgl::LogLevel _level) const {
+    return _level != vgl::LogLevel::Off && static_cast<uint32_t>(_level) >= this->level.load(std::memory_order_relaxed);
+}
+
+void vgl::Logger::log(vgl::LogLevel _level, const std::string& _category, std::string _text) {
+    this->log(_level, _category, std::move(_text), 0);
+}
+
+void vgl::Logger::log(vgl::LogLevel _level, const std::string& _category, std::string _text, uint64_t _repeatKey) {
+    if (!this->isEnabled(_level)) { return; }
+
+    //Don't let a flood grow the queue without bound, the logger thread reports how many were lost
+    //enqueued is counted before a node is linked and processed after it is consumed, so reading processed first keeps it at or below
+    //enqueued, the check guards against wrapping anyway
+    uint64_t processedCount = this->processed.load(std::memory_order_acquire);
+    uint64_t enqueuedCount = this->enqueued.load(std::memory_order_acquire);
+    if (enqueuedCount > processedCount && enqueuedCount - processedCount >= maxQueued) {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Node* node = new Node();
+    node->message.level = _level;
+    node->message.category = _category;
+    node->message.text = std::move(_text);
+    node->message.time = std::chrono::system_clock::now();
+    node->message.threadId = vgl::ChromeTrace::getThreadId();
+    node->repeatKey = _repeatKey;
+
+    //Once the logger has shut down there is no thread to drain the queue, so write it here
+    if (!this->running.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(this->drainMutex);
+        if (this->tail) {
+            this->enqueued.fetch_add(1, std::memory_order_acq_rel);
+            Node* previous = this->head.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+            this->drain();
+        }
+        else {
+            delete node;
+        }
+        return;
+    }
+
+    //Counted before the node is linked, so the logger thread can never have processed more than has been enqueued
+    this->enqueued.fetch_add(1, std::memory_order_acq_rel);
+
+    //The only synchronisation between producers is this exchange
+    Node* previous = this->head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+
+    //Errors are written straight away, the rest are picked up by the thread's next wake up
+    if (_level >= vgl::LogLevel::Error) {
+        this->wake.notify_one();
+    }
+}
+
+void vgl::Logger::addSink(std::shared_ptr<vgl::LogSink> _sink) {
+    std::lock_guard<std::mutex> lock(this->sinkMutex);
+    this->sinks.push_back(std::move(_sink));
+}
+
+void vgl::Logger::removeSink(const std::shared_ptr<vgl::LogSink>& _sink) {
+    std::lock_guard<std::mutex> lock(this->sinkMutex);
+    this->sinks.erase(std::remove(this->sinks.begin(), this->sinks.end(), _sink), this->sinks.end());
+}
+
+void vgl::Logger::clearSinks() {
+    std::lock_guard<std::mutex> lock(this->sinkMutex);
+    this->sinks.clear();
+}
+
+void vgl::Logger::flush() {
+    uint64_t target = this->enqueued.load(std::memory_order_acquire);
+
+    if (this->running.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(this->wakeMutex);
+        this->wake.notify_one();
+        this->drained.wait(lock, [this, target]() {
+            return this->processed.load(std::memory_order_acquire) >= target || !this->running.load(std::memory_order_acquire);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(this->drainMutex);
+    if (this->tail) {
+        this->drain();
+    }
+    this->reportRepeats(true);
+
+    std::lock_guard<std::mutex> sinkLock(this->sinkMutex);
+    for (auto& sink : this->sinks) {
+        sink->flush();
+    }
+}
+
+uint64_t vgl::Logger::getDroppedCount() const {
+    return this->dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t vgl::Logger::getSuppressedCount() const {
+    return this->suppressed.load(std::memory_order_relaxed);
+}
+
+void vgl::Logger::threadLoop() {
+    //Wakes up at least this often even if nothing notified it
+    const std::chrono::milliseconds interval(20);
+
+    std::unique_lock<std::mutex> lock(this->wakeMutex);
+    while (true) {
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> drainLock(this->drainMutex);
+            uint64_t count = this->drain();
+            this->reportRepeats(false);
+
+            if (count > 0) {
+                std::lock_guard<std::mutex> sinkLock(this->sinkMutex);
+                for (auto& sink : this->sinks) {
+                    sink->flush();
+                }
+            }
+        }
+        lock.lock();
+
+        //Holding wakeMutex so a flush that is about to wait can't miss this
+        this->drained.notify_all();
+
+        if (this->stopping) {
+            break;
+        }
+        this->wake.wait_for(lock, interval, [this]() {
+            return this->stopping || this->enqueued.load(std::memory_order_acquire) > this->processed.load(std::memory_order_acquire);
+        });
+    }
+}
+
+uint64_t vgl::Logger::drain() {
+    uint64_t count = 0;
+    auto now = std::chrono::steady_clock::now();
+
+    while (true) {
+        Node* next = this->tail->next.load(std::memory_order_acquire);
+        if (!next) { break; }
+
+        bool write = true;
+        if (next->repeatKey != 0) {
+            RepeatState& state = this->repeats[next->repeatKey];
+            if (now - state.windowStart >= repeatWindow) {
+                this->reportRepeat(next->repeatKey, state);
+                state.windowStart = now;
+                state.written = 0;
+                state.level = next->message.level;
+                state.category = next->message.category;
+            }
+
+            if (state.written >= repeatLimit) {
+                state.suppressed++;
+                state.level = std::max(state.level, next->message.level);
+                this->suppressed.fetch_add(1, std::memory_order_relaxed);
+                write = false;
+            }
+            else {
+                state.written++;
+            }
+        }
+        if (write) {
+            this->write(next->message);
+        }
+
+        //next becomes the consumed node producers link onto
+        delete this->tail;
+        this->tail = next;
+        count++;
+    }
+
+    this->processed.fetch_add(count, std::memory_order_release);
+
+    uint64_t droppedCount = this->dropped.load(std::memory_order_relaxed);
+    if (droppedCount > this->droppedReported) {
+        vgl::LogMessage message;
+        message.level = vgl::LogLevel::Warning;
+        message.category = "Logger";
+        message.text = std::to_string(droppedCount - this->droppedReported) + " messages dropped, the log queue was full";
+        message.time = std::chrono::system_clock::now();
+        this->write(message);
+        this->droppedReported = droppedCount;
+    }
+
+    return count;
+}
+
+void vgl::Logger::write(const vgl::LogMessage& _message) {
+    std::lock_guard<std::mutex> lock(this->sinkMutex);
+    for (auto& sink : this->sinks) {
+        sink->write(_message);
+    }
+}
+
+void vgl::Logger::reportRepeats(bool _all) {
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto it = this->repeats.begin(); it != this->repeats.end();) {
+        RepeatState& state = it->second;
+        bool ended = now - state.windowStart >= repeatWindow;
+
+        if (ended || _all) {
+            this->reportRepeat(it->first, state);
+        }
+
+        //Keys that have gone quiet are forgotten so the table doesn't grow forever
+        if (ended && state.suppressed == 0) {
+            it = this->repeats.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void vgl::Logger::reportRepeat(uint64_t _repeatKey, RepeatState& _state) {
+    if (_state.suppressed == 0) { return; }
+
+    char text[128];
+    std::snprintf(text, sizeof(text), "Message 0x%llx repeated %llu more times", static_cast<unsigned long long>(_repeatKey),
+        static_cast<unsigned long long>(_state.suppressed));
+
+    vgl::LogMessage message;
+    message.level = _state.level;
+    message.category = _state.category;
+    message.text = text;
+    message.time = std::chrono::system_clock::now();
+    this->write(message);
+    _state.suppressed = 0;
+}
@@ -1,25 +1,76 @@
 #include "vgl/LogicalDevice.h"
 
-vgl::LogicalDevice::LogicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, std::shared_ptr<VkSurfaceKHR> _surface, std::unique_ptr<VkPhysicalDevice> _physicalDevice)
-    : instance(_instance),
-    deviceExtensions(_deviceExtensions),
+#include <algorithm>
+#include <cstring>
+
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+
+namespace {
+
+    //Whether GPU timestamps can be sampled together with the host clock, both domains have to be calibrateable
+    bool supportsCalibratedTimestamps(VkInstance instance, VkPhysicalDevice physicalDevice) {
+        auto getTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+        if (!getTimeDomains) { return false; }
+
+        uint32_t count = 0;
+        if (getTimeDomains(physicalDevice, &count, nullptr) != VK_SUCCESS || count == 0) { return false; }
+        std::vector<VkTimeDomainEXT> domains(count);
+        if (getTimeDomains(physicalDevice, &count, domains.data()) != VK_SUCCESS) { return false; }
+        domains.resize(count);
+
+        return std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end()
+            && std::find(domains.begin(), domains.end(), vgl::LogicalDevice::getHostTimeDomain()) != domains.end();
+    }
+
+}
+
+vgl::LogicalDevice::LogicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, const std::vector<const char*>& _validationLayers, std::shared_ptr<VkSurfaceKHR> _surface,
+    std::shared_ptr<const vgl::DeviceCapabilities> _capabilities, const std::string& _pipelineCacheDirectory)
+    : deviceExtensions(_deviceExtensions),
+    validationLayers(_validationLayers),
+    instance(_instance),
     surface(_surface),
-    physicalDevice(_physicalDevice)
+    physicalDevice(_capabilities->physicalDevice),
+    capabilities(_capabilities)
 {
-    QueueFamilyIndices indices = this->findQueueFamilies(*this->physicalDevice);
+    VGL_PROFILE_SCOPE("LogicalDevice::LogicalDevice");
 
+    QueueFamilyIndices indices = this->capabilities->findQueueFamilies(this->hasSurface() ? *this->surface : VK_NULL_HANDLE);
+    if (!indices.isComplete(this->hasSurface())) {
+        throw std::runtime_error("FAILED TO FIND REQUIRED QUEUE FAMILIES");
+    }
+    this->queueFamilyIndices = indices;
+
+    //Number of queues wanted from each family
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    std::map<uint32_t, uint32_t> familyQueueCounts = { { indices.graphicsFamily.value(), 1 } };
+    if (indices.presentFamily.has_value()) {
+        familyQueueCounts.emplace(indices.presentFamily.value(), 1);
+    }
+    if (indices.computeFamily.has_value()) {
+        familyQueueCounts.emplace(indices.computeFamily.value(), 1);
+    }
+    //Devices without a pure transfer family fall back to the compute family for transfers
+    //Use a second queue from it when possible so uploads and compute don't share a queue
+    uint32_t transferQueueIndex = 0;
+    if (indices.transferFamily.has_value()) {
+        uint32_t family = indices.transferFamily.value();
+        if (indices.computeFamily == family && this->capabilities->queueFamilies[family].queueCount > 1) {
+            transferQueueIndex = 1;
+        }
+        familyQueueCounts[family] = std::max(familyQueueCounts[family], transferQueueIndex + 1);
+    }
 
-    float queuePriority = 1.0f;
-    for (uint32_t queueFamily : uniqueQueueFamilies) {
+    const std::vector<float> queuePriorities(2, 1.0f);
+    for (const auto& [queueFamily, queueCount] : familyQueueCounts) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
+        queueCreateInfo.queueCount = queueCount;
         //Vulkan lets you assign priorities to queues to influence the scheduling of command buffer execution using floating point numbers between 0.0 and 1.0. 
         //This is required even if there is only a single queue
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
@@ -32,20 +83,91 @@ vgl::LogicalDevice::LogicalDevice(std::shared_ptr<const VkInstance> _instance, c
     //Enables multisampling of shaders at a performance cost
     deviceFeatures.sampleRateShading = VK_TRUE;
 
+    //Indirect draws are optional, IndirectRenderer falls back to one draw per command without them
+    //First instance lets each indirect command carry the index of its object
+    deviceFeatures.multiDrawIndirect = this->capabilities->features.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = this->capabilities->features.drawIndirectFirstInstance;
+    this->multiDrawIndirectEnabled = deviceFeatures.multiDrawIndirect == VK_TRUE;
+
+    //Vulkan 1.2 features are enabled through a pNext chain, so the core features go in VkPhysicalDeviceFeatures2 as well
+    //Timeline semaphores are used to track work across queues (e.g. uploads on the transfer queue)
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+
+    //Lets the GPU culling pass decide how many indirect draws are executed
+    vulkan12Features.drawIndirectCount = this->capabilities->features12.drawIndirectCount;
+    this->drawIndirectCountEnabled = vulkan12Features.drawIndirectCount == VK_TRUE;
+
+    //Descriptor indexing is optional, only enabled when the device supports everything the bindless heap needs
+    //Textures and buffers live in one large set that is updated while bound and indexed with handles from push constants
+    const VkPhysicalDeviceVulkan12Features& supported12 = this->capabilities->features12;
+    this->bindlessEnabled = supported12.descriptorIndexing && supported12.runtimeDescriptorArray && supported12.descriptorBindingPartiallyBound &&
+        supported12.descriptorBindingSampledImageUpdateAfterBind && supported12.descriptorBindingStorageImageUpdateAfterBind &&
+        supported12.descriptorBindingStorageBufferUpdateAfterBind && supported12.shaderSampledImageArrayNonUniformIndexing;
+    if (this->bindlessEnabled) {
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = supported12.descriptorBindingUpdateUnusedWhilePending;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        vulkan12Features.shaderStorageImageArrayNonUniformIndexing = supported12.shaderStorageImageArrayNonUniformIndexing;
+        vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = supported12.shaderStorageBufferArrayNonUniformIndexing;
+    }
+
+    //Vulkan 1.3 features are optional, only enabled when the device reports them
+    //Dynamic rendering lets pipelines be compiled without creating a VkRenderPass first
+    //Synchronization2 lets the queue scheduler batch submits with vkQueueSubmit2 and signal at a specific stage
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+    if (this->capabilities->properties.apiVersion >= VK_API_VERSION_1_3) {
+        vulkan13Features.dynamicRendering = this->capabilities->features13.dynamicRendering;
+        vulkan13Features.synchronization2 = this->capabilities->features13.synchronization2;
+        vulkan12Features.pNext = &vulkan13Features;
+    }
+    this->dynamicRenderingEnabled = vulkan13Features.dynamicRendering == VK_TRUE;
+    this->synchronization2Enabled = vulkan13Features.synchronization2 == VK_TRUE;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures2{};
+    deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures2.pNext = &vulkan12Features;
+    deviceFeatures2.features = deviceFeatures;
+
     //Create the logical device using the two structures above
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &deviceFeatures2;
     //Pointer to queue creation struct
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    //Pointer to device features struct
-    createInfo.pEnabledFeatures = &deviceFeatures;
+    //Device features are passed through pNext, pEnabledFeatures has to be null when VkPhysicalDeviceFeatures2 is used
+    createInfo.pEnabledFeatures = nullptr;
 
     //Specify extensions and validation layers
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(this->deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = this->deviceExtensions.data();
+    //VK_EXT_memory_budget is optional, it lets the allocator report how much device memory can be used before the driver starts paging
+    std::vector<const char*> enabledExtensions = this->deviceExtensions;
+    bool budgetRequested = std::any_of(enabledExtensions.begin(), enabledExtensions.end(),
+        [](const char* name) { return strcmp(name, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; });
+    if (budgetRequested || this->capabilities->hasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        if (!budgetRequested) { enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME); }
+        this->memoryBudgetEnabled = true;
+    }
+    //VK_EXT_calibrated_timestamps is optional, it lets GpuProfiler line GPU timestamps up with the trace clock without waiting on the GPU
+    if (this->capabilities->hasExtension(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) && supportsCalibratedTimestamps(*this->instance, this->physicalDevice)) {
+        if (std::none_of(enabledExtensions.begin(), enabledExtensions.end(),
+            [](const char* name) { return strcmp(name, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0; })) {
+            enabledExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+        }
+        this->calibratedTimestampsEnabled = true;
+    }
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
-    if (this->enableValidationLayers) {
+    if (!this->validationLayers.empty()) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(this->validationLayers.size());
         createInfo.ppEnabledLayerNames = this->validationLayers.data();
     }
@@ -54,46 +176,132 @@ vgl::LogicalDevice::LogicalDevice(std::shared_ptr<const VkInstance> _instance, c
     }
 
     //Create logical device
-    if (vkCreateDevice(this->physicalDevice, &createInfo, nullptr, &this->device) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO CREATE LOGICAL DEVICE");
+    {
+        VGL_PROFILE_SCOPE("vkCreateDevice");
+        if (vkCreateDevice(this->physicalDevice, &createInfo, vgl::HostAllocator::callbacks(), &this->device) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE LOGICAL DEVICE");
+        }
     }
 
     vkGetDeviceQueue(this->device, indices.graphicsFamily.value(), 0, &this->graphicsQueue);
-    vkGetDeviceQueue(this->device, indices.presentFamily.value(), 0, &presentQueue);
-	
-}
+    if (indices.presentFamily.has_value()) {
+        vkGetDeviceQueue(this->device, indices.presentFamily.value(), 0, &this->presentQueue);
+    }
+    this->transferQueue = this->graphicsQueue;
+    if (indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(this->device, indices.transferFamily.value(), transferQueueIndex, &this->transferQueue);
+    }
+    this->computeQueue = this->graphicsQueue;
+    if (indices.computeFamily.has_value()) {
+        vkGetDeviceQueue(this->device, indices.computeFamily.value(), 0, &this->computeQueue);
+    }
 
-QueueFamilyIndices vgl::LogicalDevice::findQueueFamilies(VkPhysicalDevice device){
-    QueueFamilyIndices indices;
+    this->queueScheduler = std::make_unique<vgl::QueueScheduler>(this->device, indices, this->graphicsQueue, this->computeQueue, this->transferQueue,
+        this->presentQueue, this->synchronization2Enabled);
 
-    //Retrieve the list of queue families
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    this->allocator = std::make_unique<vgl::MemoryAllocator>(*this->capabilities, this->device, vgl::MemoryAllocator::defaultBlockSize, this->memoryBudgetEnabled);
+    {
+        VGL_PROFILE_SCOPE("PipelineCache::load");
+        this->pipelineCache = std::make_unique<vgl::PipelineCache>(*this->capabilities, this->device, _pipelineCacheDirectory);
+    }
 
-    //Find queue family that supports VK_QUEUE_GRAPHICS_BIT
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) {
-        //Check if can do graphcis
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
+    {
+        VGL_PROFILE_SCOPE("ShaderCache::load");
+        this->shaderCache = std::make_unique<vgl::ShaderCache>(this->device, _pipelineCacheDirectory);
+    }
 
-        //Check if can render to surface
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, this->surface, &presentSupport);
-        if (presentSupport) {
-            indices.presentFamily = i;
-        }
+    this->jobSystem = std::make_unique<vgl::JobSystem>();
+    this->pipelineCompiler = std::make_unique<vgl::PipelineCompiler>(this->device, this->pipelineCache.get(), this->shaderCache.get(), this->jobSystem.get(),
+        this->dynamicRenderingEnabled);
+}
 
-        //Early exit if all queue families requires have been found
-        if (indices.isComplete()) {
-            break;
-        }
+vgl::LogicalDevice::~LogicalDevice() {
+    //Waits for everything submitted through it, so nothing below is destroyed while the GPU still uses it
+    this->queueScheduler.reset();
+
+    //Pipelines still compiling finish before the cache they are written to is saved
+    this->pipelineCompiler.reset();
+    this->jobSystem.reset();
+    this->shaderCache.reset();
+
+    //All memory has to be freed before the device is destroyed
+    this->allocator.reset();
+    this->pipelineCache.reset();
 
-        i++;
+    if (this->device) {
+        vkDestroyDevice(this->device, vgl::HostAllocator::callbacks());
     }
+}
+
+vgl::MemoryAllocator* vgl::LogicalDevice::getAllocator() const {
+    return this->allocator.get();
+}
+
+vgl::PipelineCache* vgl::LogicalDevice::getPipelineCache() const {
+    return this->pipelineCache.get();
+}
+
+vgl::ShaderCache* vgl::LogicalDevice::getShaderCache() const {
+    return this->shaderCache.get();
+}
+
+vgl::JobSystem* vgl::LogicalDevice::getJobSystem() const {
+    return this->jobSystem.get();
+}
+
+vgl::PipelineCompiler* vgl::LogicalDevice::getPipelineCompiler() const {
+    return this->pipelineCompiler.get();
+}
+
+vgl::QueueScheduler* vgl::LogicalDevice::getQueueScheduler() const {
+    return this->queueScheduler.get();
+}
+
+bool vgl::LogicalDevice::isDynamicRenderingEnabled() const {
+    return this->dynamicRenderingEnabled;
+}
+
+bool vgl::LogicalDevice::isBindlessEnabled() const {
+    return this->bindlessEnabled;
+}
+
+bool vgl::LogicalDevice::isDrawIndirectCountEnabled() const {
+    return this->drawIndirectCountEnabled;
+}
+
+bool vgl::LogicalDevice::isMultiDrawIndirectEnabled() const {
+    return this->multiDrawIndirectEnabled;
+}
+
+bool vgl::LogicalDevice::isMemoryBudgetEnabled() const {
+    return this->memoryBudgetEnabled;
+}
+
+bool vgl::LogicalDevice::isCalibratedTimestampsEnabled() const {
+    return this->calibratedTimestampsEnabled;
+}
+
+VkTimeDomainEXT vgl::LogicalDevice::getHostTimeDomain() {
+    //std::chrono::steady_clock is QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere
+#ifdef _WIN32
+    return VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+    return VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+}
+
+bool vgl::LogicalDevice::isSynchronization2Enabled() const {
+    return this->synchronization2Enabled;
+}
+
+const vgl::DeviceCapabilities& vgl::LogicalDevice::getCapabilities() const {
+    return *this->capabilities;
+}
+
+VkPhysicalDevice vgl::LogicalDevice::getPhysicalDevice() const {
+    return this->physicalDevice;
+}
 
-    return indices;
+bool vgl::LogicalDevice::hasSurface() const {
+    return this->surface && *this->surface != VK_NULL_HANDLE;
 }
@@ -0,0 +1,135 @@
+#include "vgl/MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+vgl::MappedFile::MappedFile(const std::string& _path)
+    : path(_path)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("FAILED TO OPEN FILE " + _path);
+    }
+    this->file = handle;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(handle, &size)) {
+        this->close();
+        throw std::runtime_error("FAILED TO READ FILE SIZE " + _path);
+    }
+    this->fileSize = static_cast<size_t>(size.QuadPart);
+    this->open = true;
+
+    //Mapping an empty file fails, there is nothing to read anyway
+    if (this->fileSize == 0) { return; }
+
+    this->mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->mapping) {
+        this->close();
+        throw std::runtime_error("FAILED TO MAP FILE " + _path);
+    }
+    this->memory = static_cast<const uint8_t*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!this->memory) {
+        this->close();
+        throw std::runtime_error("FAILED TO MAP FILE " + _path);
+    }
+#else
+    int descriptor = ::open(_path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("FAILED TO OPEN FILE " + _path);
+    }
+
+    struct stat status {};
+    if (fstat(descriptor, &status) != 0) {
+        ::close(descriptor);
+        throw std::runtime_error("FAILED TO READ FILE SIZE " + _path);
+    }
+    this->fileSize = static_cast<size_t>(status.st_size);
+    this->open = true;
+
+    //Mapping an empty file fails, there is nothing to read anyway
+    if (this->fileSize == 0) {
+        ::close(descriptor);
+        return;
+    }
+
+    void* mapped = mmap(nullptr, this->fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    //The mapping keeps the file alive, the descriptor isn't needed any more
+    ::close(descriptor);
+    if (mapped == MAP_FAILED) {
+        this->open = false;
+        throw std::runtime_error("FAILED TO MAP FILE " + _path);
+    }
+    this->memory = static_cast<const uint8_t*>(mapped);
+#endif
+}
+
+vgl::MappedFile::~MappedFile() {
+    this->close();
+}
+
+vgl::MappedFile::MappedFile(MappedFile&& other) noexcept {
+    this->swap(other);
+}
+
+vgl::MappedFile& vgl::MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        this->close();
+        this->swap(other);
+    }
+    return *this;
+}
+
+bool vgl::MappedFile::isOpen() const {
+    return this->open;
+}
+
+void vgl::MappedFile::close() {
+#ifdef _WIN32
+    if (this->memory) { UnmapViewOfFile(this->memory); }
+    if (this->mapping) { CloseHandle(this->mapping); }
+    if (this->file) { CloseHandle(this->file); }
+    this->mapping = nullptr;
+    this->file = nullptr;
+#else
+    if (this->memory) { munmap(const_cast<uint8_t*>(this->memory), this->fileSize); }
+#endif
+    this->memory = nullptr;
+    this->fileSize = 0;
+    this->open = false;
+}
+
+const uint8_t* vgl::MappedFile::data() const {
+    return this->memory;
+}
+
+size_t vgl::MappedFile::size() const {
+    return this->fileSize;
+}
+
+const std::string& vgl::MappedFile::getPath() const {
+    return this->path;
+}
+
+void vgl::MappedFile::swap(MappedFile& other) noexcept {
+    std::swap(this->memory, other.memory);
+    std::swap(this->fileSize, other.fileSize);
+    std::swap(this->open, other.open);
+    std::swap(this->path, other.path);
+#ifdef _WIN32
+    std::swap(this->file, other.file);
+    std::swap(this->mapping, other.mapping);
+#endif
+}
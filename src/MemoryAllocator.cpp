@@ -0,0 +1,398 @@
+#include "vgl/MemoryAllocator.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::MemoryAllocator::MemoryAllocator(const vgl::DeviceCapabilities& _capabilities, VkDevice _device, VkDeviceSize _blockSize, bool _memoryBudgetEnabled)
+    : physicalDevice(_capabilities.physicalDevice),
+    device(_device),
+    memoryProperties(_capabilities.memoryProperties),
+    limits(_capabilities.properties.limits),
+    blockSize(_blockSize),
+    memoryBudgetEnabled(_memoryBudgetEnabled)
+{
+}
+
+vgl::MemoryAllocator::~MemoryAllocator() {
+    for (auto& typeBlocks : this->blocks) {
+        for (auto& block : typeBlocks) {
+            if (block->mapped) { vkUnmapMemory(this->device, block->memory); }
+            vkFreeMemory(this->device, block->memory, vgl::HostAllocator::callbacks());
+        }
+        typeBlocks.clear();
+    }
+}
+
+vgl::MemoryAllocation vgl::MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags requiredProperties,
+    VkMemoryPropertyFlags preferredProperties, bool _linear)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    //Try the memory types with the preferred properties first, then any type with the required properties
+    //If a heap is full the next matching type is tried
+    VkMemoryPropertyFlags passes[] = { requiredProperties | preferredProperties, requiredProperties };
+    for (VkMemoryPropertyFlags properties : passes) {
+        for (uint32_t i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+            if (!(requirements.memoryTypeBits & (1u << i))) { continue; }
+            if ((this->memoryProperties.memoryTypes[i].propertyFlags & properties) != properties) { continue; }
+
+            vgl::MemoryAllocation allocation = this->allocateFromType(i, requirements.size, requirements.alignment, _linear);
+            if (allocation.isValid()) {
+                return allocation;
+            }
+        }
+    }
+
+    throw std::runtime_error("FAILED TO ALLOCATE DEVICE MEMORY");
+}
+
+void vgl::MemoryAllocator::free(vgl::MemoryAllocation& allocation) {
+    if (!allocation.isValid()) { return; }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    MemoryBlock* block = static_cast<MemoryBlock*>(allocation.block);
+    block->tlsf.free(allocation.blockIndex);
+
+    //Dedicated blocks are always released, otherwise keep one empty block per memory type around to avoid
+    //allocating and freeing a block every frame when usage hovers around a block boundary
+    if (block->tlsf.isEmpty()) {
+        size_t emptyBlocks = 0;
+        for (const auto& other : this->blocks[block->memoryTypeIndex]) {
+            if (!other->dedicated && other->linear == block->linear && other->tlsf.isEmpty()) { emptyBlocks++; }
+        }
+        if (block->dedicated || emptyBlocks > 1) {
+            this->destroyBlock(block);
+        }
+    }
+
+    allocation = vgl::MemoryAllocation{};
+}
+
+void vgl::MemoryAllocator::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, vgl::MemoryAllocation& allocation,
+    VkMemoryPropertyFlags preferredProperties)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    this->createBuffer(bufferInfo, properties, buffer, allocation, preferredProperties);
+}
+
+void vgl::MemoryAllocator::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, vgl::MemoryAllocation& allocation,
+    VkMemoryPropertyFlags preferredProperties)
+{
+    if (vkCreateBuffer(this->device, &bufferInfo, vgl::HostAllocator::callbacks(), &buffer) != VK_SUCCESS) {
+        buffer = VK_NULL_HANDLE;
+        throw std::runtime_error("FAILED TO CREATE BUFFER");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(this->device, buffer, &memRequirements);
+
+    //Running out of memory is expected under a budget, the buffer must not outlive the failed allocation
+    try {
+        allocation = this->allocate(memRequirements, properties, preferredProperties, true);
+    }
+    catch (...) {
+        vkDestroyBuffer(this->device, buffer, vgl::HostAllocator::callbacks());
+        buffer = VK_NULL_HANDLE;
+        throw;
+    }
+    if (vkBindBufferMemory(this->device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        this->destroyBuffer(buffer, allocation);
+        throw std::runtime_error("FAILED TO BIND BUFFER MEMORY");
+    }
+}
+
+void vgl::MemoryAllocator::destroyBuffer(VkBuffer& buffer, vgl::MemoryAllocation& allocation) {
+    if (buffer) {
+        vkDestroyBuffer(this->device, buffer, vgl::HostAllocator::callbacks());
+        buffer = VK_NULL_HANDLE;
+    }
+    this->free(allocation);
+}
+
+void vgl::MemoryAllocator::createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, vgl::MemoryAllocation& allocation,
+    VkMemoryPropertyFlags preferredProperties)
+{
+    if (vkCreateImage(this->device, &imageInfo, vgl::HostAllocator::callbacks(), &image) != VK_SUCCESS) {
+        image = VK_NULL_HANDLE;
+        throw std::runtime_error("FAILED TO CREATE IMAGE");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(this->device, image, &memRequirements);
+
+    try {
+        allocation = this->allocate(memRequirements, properties, preferredProperties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+    }
+    catch (...) {
+        vkDestroyImage(this->device, image, vgl::HostAllocator::callbacks());
+        image = VK_NULL_HANDLE;
+        throw;
+    }
+    if (vkBindImageMemory(this->device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        this->destroyImage(image, allocation);
+        throw std::runtime_error("FAILED TO BIND IMAGE MEMORY");
+    }
+}
+
+void vgl::MemoryAllocator::destroyImage(VkImage& image, vgl::MemoryAllocation& allocation) {
+    if (image) {
+        vkDestroyImage(this->device, image, vgl::HostAllocator::callbacks());
+        image = VK_NULL_HANDLE;
+    }
+    this->free(allocation);
+}
+
+void vgl::MemoryAllocator::flush(const vgl::MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (!allocation.isValid() || this->isHostCoherent(allocation.memoryTypeIndex)) { return; }
+
+    if (size == VK_WHOLE_SIZE) {
+        size = allocation.size - offset;
+    }
+
+    //Flushed ranges have to be aligned to nonCoherentAtomSize
+    //Non coherent allocations are aligned to it so this never touches a neighbouring allocation
+    VkDeviceSize atom = this->limits.nonCoherentAtomSize;
+    VkDeviceSize start = allocation.offset + offset;
+    VkDeviceSize alignedStart = start - (start % atom);
+    VkDeviceSize alignedEnd = ((start + size + atom - 1) / atom) * atom;
+
+    MemoryBlock* block = static_cast<MemoryBlock*>(allocation.block);
+    alignedEnd = std::min(alignedEnd, block->size);
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = alignedStart;
+    range.size = alignedEnd - alignedStart;
+    vkFlushMappedMemoryRanges(this->device, 1, &range);
+}
+
+uint32_t vgl::MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) && (this->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("FAILED TO FIND SUITABLE MEMORY TYPE");
+}
+
+vgl::MemoryAllocator::Stats vgl::MemoryAllocator::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Stats stats;
+    double weightedFragmentation = 0.0;
+    for (const auto& typeBlocks : this->blocks) {
+        for (const auto& block : typeBlocks) {
+            addStats(stats, weightedFragmentation, *block);
+        }
+    }
+
+    VkDeviceSize freeBytes = stats.bytesReserved - stats.bytesUsed;
+    stats.fragmentation = freeBytes > 0 ? weightedFragmentation / static_cast<double>(freeBytes) : 0.0;
+    return stats;
+}
+
+vgl::MemoryAllocator::Stats vgl::MemoryAllocator::getStats(uint32_t memoryTypeIndex) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Stats stats;
+    double weightedFragmentation = 0.0;
+    for (const auto& block : this->blocks[memoryTypeIndex]) {
+        addStats(stats, weightedFragmentation, *block);
+    }
+
+    VkDeviceSize freeBytes = stats.bytesReserved - stats.bytesUsed;
+    stats.fragmentation = freeBytes > 0 ? weightedFragmentation / static_cast<double>(freeBytes) : 0.0;
+    return stats;
+}
+
+vgl::MemoryBudget vgl::MemoryAllocator::queryBudget() const {
+    vgl::MemoryBudget budget;
+    budget.heapCount = this->memoryProperties.memoryHeapCount;
+    for (uint32_t i = 0; i < budget.heapCount; i++) {
+        budget.heaps[i].size = this->memoryProperties.memoryHeaps[i].size;
+        budget.heaps[i].flags = this->memoryProperties.memoryHeaps[i].flags;
+    }
+
+    if (this->memoryBudgetEnabled) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties2.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(this->physicalDevice, &properties2);
+
+        for (uint32_t i = 0; i < budget.heapCount; i++) {
+            budget.heaps[i].budget = budgetProperties.heapBudget[i];
+            budget.heaps[i].usage = budgetProperties.heapUsage[i];
+        }
+        budget.fromExtension = true;
+        return budget;
+    }
+
+    //Without the extension the best guess is a share of the heap minus what this allocator has reserved from it
+    for (uint32_t i = 0; i < budget.heapCount; i++) {
+        budget.heaps[i].budget = static_cast<VkDeviceSize>(static_cast<double>(budget.heaps[i].size) * fallbackBudgetFraction);
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (uint32_t type = 0; type < this->memoryProperties.memoryTypeCount; type++) {
+        for (const auto& block : this->blocks[type]) {
+            budget.heaps[this->memoryProperties.memoryTypes[type].heapIndex].usage += block->size;
+        }
+    }
+    return budget;
+}
+
+uint32_t vgl::MemoryAllocator::getHeapIndex(uint32_t memoryTypeIndex) const {
+    return this->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+}
+
+VkDeviceSize vgl::MemoryBudget::getDeviceLocalBudget() const {
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < this->heapCount; i++) {
+        if (this->heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) { bytes += this->heaps[i].budget; }
+    }
+    return bytes;
+}
+
+VkDeviceSize vgl::MemoryBudget::getDeviceLocalUsage() const {
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < this->heapCount; i++) {
+        if (this->heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) { bytes += this->heaps[i].usage; }
+    }
+    return bytes;
+}
+
+const VkPhysicalDeviceMemoryProperties& vgl::MemoryAllocator::getMemoryProperties() const {
+    return this->memoryProperties;
+}
+
+const VkPhysicalDeviceLimits& vgl::MemoryAllocator::getLimits() const {
+    return this->limits;
+}
+
+VkDevice vgl::MemoryAllocator::getDevice() const {
+    return this->device;
+}
+
+VkDeviceSize vgl::MemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const {
+    uint32_t heapIndex = this->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapSize = this->memoryProperties.memoryHeaps[heapIndex].size;
+
+    //Don't let a single block take more than an eighth of a small heap
+    return std::min(this->blockSize, heapSize / 8);
+}
+
+vgl::MemoryAllocation vgl::MemoryAllocator::allocateFromType(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceSize alignment, bool _linear) {
+    //Keep non coherent allocations on separate atoms so flushing one never affects another
+    if (!this->isHostCoherent(memoryTypeIndex)) {
+        alignment = std::max(alignment, this->limits.nonCoherentAtomSize);
+    }
+
+    VkDeviceSize typeBlockSize = this->getBlockSize(memoryTypeIndex);
+
+    MemoryBlock* block = nullptr;
+    vgl::TlsfAllocator::Allocation tlsfAllocation;
+
+    //Large resources would waste most of a block so give them their own allocation
+    if (size > typeBlockSize / 2) {
+        block = this->createBlock(memoryTypeIndex, size, _linear, true);
+        if (!block) { return vgl::MemoryAllocation{}; }
+        tlsfAllocation = block->tlsf.allocate(size, 1);
+    }
+    else {
+        for (auto& existing : this->blocks[memoryTypeIndex]) {
+            if (existing->dedicated || existing->linear != _linear) { continue; }
+
+            tlsfAllocation = existing->tlsf.allocate(size, alignment);
+            if (tlsfAllocation.isValid()) {
+                block = existing.get();
+                break;
+            }
+        }
+
+        //No existing block has room, allocate a new one
+        if (!block) {
+            block = this->createBlock(memoryTypeIndex, typeBlockSize, _linear, false);
+            if (!block) { return vgl::MemoryAllocation{}; }
+            tlsfAllocation = block->tlsf.allocate(size, alignment);
+        }
+    }
+
+    vgl::MemoryAllocation allocation;
+    allocation.memory = block->memory;
+    allocation.offset = tlsfAllocation.offset;
+    allocation.size = tlsfAllocation.size;
+    allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + tlsfAllocation.offset : nullptr;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.block = block;
+    allocation.blockIndex = tlsfAllocation.blockIndex;
+    return allocation;
+}
+
+vgl::MemoryAllocator::MemoryBlock* vgl::MemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool _linear, bool _dedicated) {
+    auto block = std::make_unique<MemoryBlock>();
+    block->size = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->linear = _linear;
+    block->dedicated = _dedicated;
+    block->tlsf = vgl::TlsfAllocator(size);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    //Failing here is not an error, the caller tries the next memory type
+    if (vkAllocateMemory(this->device, &allocInfo, vgl::HostAllocator::callbacks(), &block->memory) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    //Map host visible memory once and keep it mapped for the lifetime of the block
+    if (this->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(this->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+            vkFreeMemory(this->device, block->memory, vgl::HostAllocator::callbacks());
+            throw std::runtime_error("FAILED TO MAP MEMORY BLOCK");
+        }
+    }
+
+    this->blocks[memoryTypeIndex].push_back(std::move(block));
+    return this->blocks[memoryTypeIndex].back().get();
+}
+
+void vgl::MemoryAllocator::destroyBlock(MemoryBlock* block) {
+    auto& typeBlocks = this->blocks[block->memoryTypeIndex];
+    for (auto it = typeBlocks.begin(); it != typeBlocks.end(); ++it) {
+        if (it->get() == block) {
+            if (block->mapped) { vkUnmapMemory(this->device, block->memory); }
+            vkFreeMemory(this->device, block->memory, vgl::HostAllocator::callbacks());
+            typeBlocks.erase(it);
+            return;
+        }
+    }
+}
+
+bool vgl::MemoryAllocator::isHostCoherent(uint32_t memoryTypeIndex) const {
+    VkMemoryPropertyFlags flags = this->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    //Memory that can't be mapped never needs flushing
+    return !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void vgl::MemoryAllocator::addStats(Stats& stats, double& weightedFragmentation, const MemoryBlock& block) {
+    vgl::TlsfAllocator::Stats blockStats = block.tlsf.getStats();
+
+    stats.bytesReserved += block.size;
+    stats.bytesUsed += blockStats.usedSize;
+    stats.blockCount++;
+    stats.allocationCount += blockStats.allocationCount;
+    if (block.dedicated) { stats.dedicatedAllocationCount++; }
+
+    weightedFragmentation += blockStats.fragmentation() * static_cast<double>(blockStats.totalSize - blockStats.usedSize);
+}
@@ -0,0 +1,157 @@
+#include "vgl/Mesh.h"
+
+#include <cstddef>
+#include <stdexcept>
+
+vgl::Mesh::Mesh(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, const vgl::MeshFile& _file)
+    : logicalDevice(_logicalDevice),
+    uploadEngine(_uploadEngine),
+    indexType(_file.getIndexType()),
+    vertexCount(_file.getVertexCount()),
+    lods(_file.getLods(), _file.getLods() + _file.getLodCount()),
+    bounds(_file.getBounds())
+{
+    this->upload(_file.getVertexData(), _file.getVertexDataSize(), _file.getIndexData(), _file.getIndexDataSize());
+}
+
+vgl::Mesh::Mesh(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, const vgl::MeshData& _mesh)
+    : logicalDevice(_logicalDevice),
+    uploadEngine(_uploadEngine),
+    vertexCount(static_cast<uint32_t>(_mesh.vertices.size())),
+    lods(_mesh.lods),
+    bounds(_mesh.bounds)
+{
+    //Same index size choice as MeshFile::save
+    if (_mesh.vertices.size() < 0xFFFF) {
+        std::vector<uint16_t> indices(_mesh.indices.begin(), _mesh.indices.end());
+        this->indexType = VK_INDEX_TYPE_UINT16;
+        this->upload(_mesh.vertices.data(), _mesh.vertices.size() * sizeof(vgl::PackedVertex), indices.data(), indices.size() * sizeof(uint16_t));
+    }
+    else {
+        this->indexType = VK_INDEX_TYPE_UINT32;
+        this->upload(_mesh.vertices.data(), _mesh.vertices.size() * sizeof(vgl::PackedVertex), _mesh.indices.data(), _mesh.indices.size() * sizeof(uint32_t));
+    }
+}
+
+vgl::Mesh::~Mesh() {
+    if (this->ticket != 0) {
+        this->uploadEngine->wait(this->ticket);
+    }
+
+    vgl::MemoryAllocator* allocator = this->logicalDevice->getAllocator();
+    if (this->vertexBuffer) {
+        allocator->destroyBuffer(this->vertexBuffer, this->vertexAllocation);
+    }
+    if (this->indexBuffer) {
+        allocator->destroyBuffer(this->indexBuffer, this->indexAllocation);
+    }
+}
+
+bool vgl::Mesh::isReady() const {
+    return this->uploadEngine->isReady(this->ticket);
+}
+
+vgl::UploadTicket vgl::Mesh::getUploadTicket() const {
+    return this->ticket;
+}
+
+void vgl::Mesh::bind(VkCommandBuffer commandBuffer) const {
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &this->vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, this->indexBuffer, 0, this->indexType);
+}
+
+void vgl::Mesh::draw(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance) const {
+    const vgl::MeshLod& level = this->lods.at(lod);
+    vkCmdDrawIndexed(commandBuffer, level.indexCount, instanceCount, level.indexOffset, 0, firstInstance);
+}
+
+uint32_t vgl::Mesh::selectLod(float maxError) const {
+    //Errors grow with the level, so the last level within the limit is the cheapest acceptable one
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < this->lods.size(); i++) {
+        if (this->lods[i].error > maxError) { break; }
+        selected = i;
+    }
+    return selected;
+}
+
+const std::vector<vgl::MeshLod>& vgl::Mesh::getLods() const {
+    return this->lods;
+}
+
+const vgl::Aabb& vgl::Mesh::getBounds() const {
+    return this->bounds;
+}
+
+uint32_t vgl::Mesh::getVertexCount() const {
+    return this->vertexCount;
+}
+
+glm::vec3 vgl::Mesh::getPositionScale() const {
+    return vgl::MeshProcessor::getPositionScale(this->bounds);
+}
+
+glm::vec3 vgl::Mesh::getPositionOffset() const {
+    return this->bounds.min;
+}
+
+VkBuffer vgl::Mesh::getVertexBuffer() const {
+    return this->vertexBuffer;
+}
+
+VkBuffer vgl::Mesh::getIndexBuffer() const {
+    return this->indexBuffer;
+}
+
+VkIndexType vgl::Mesh::getIndexType() const {
+    return this->indexType;
+}
+
+std::vector<VkVertexInputBindingDescription> vgl::Mesh::getVertexBindings() {
+    VkVertexInputBindingDescription binding{};
+    binding.binding = 0;
+    binding.stride = sizeof(vgl::PackedVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return { binding };
+}
+
+std::vector<VkVertexInputAttributeDescription> vgl::Mesh::getVertexAttributes() {
+    std::vector<VkVertexInputAttributeDescription> attributes(3);
+    attributes[0] = { 0, 0, VK_FORMAT_R16G16B16A16_UNORM, static_cast<uint32_t>(offsetof(vgl::PackedVertex, position)) };
+    attributes[1] = { 1, 0, VK_FORMAT_R8G8_SNORM, static_cast<uint32_t>(offsetof(vgl::PackedVertex, normal)) };
+    attributes[2] = { 2, 0, VK_FORMAT_R16G16_SFLOAT, static_cast<uint32_t>(offsetof(vgl::PackedVertex, uv)) };
+    return attributes;
+}
+
+void vgl::Mesh::upload(const void* vertices, VkDeviceSize vertexBytes, const void* indices, VkDeviceSize indexBytes) {
+    if (vertexBytes == 0 || indexBytes == 0) {
+        throw std::runtime_error("MESH HAS NO TRIANGLES");
+    }
+
+    vgl::MemoryAllocator* allocator = this->logicalDevice->getAllocator();
+    allocator->createBuffer(vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->vertexBuffer, this->vertexAllocation);
+
+    //Called from the constructors, so the destructor won't clean up if anything here throws
+    vgl::UploadTicket vertexTicket = 0;
+    try {
+        allocator->createBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->indexBuffer, this->indexAllocation);
+
+        //Tickets only increase, so the index upload's ticket covers the vertices as well
+        vertexTicket = this->uploadEngine->uploadBuffer(this->vertexBuffer, 0, vertices, vertexBytes);
+        this->ticket = this->uploadEngine->uploadBuffer(this->indexBuffer, 0, indices, indexBytes);
+    }
+    catch (...) {
+        //A queued vertex upload still writes to the buffer
+        if (vertexTicket != 0) {
+            this->uploadEngine->wait(vertexTicket);
+        }
+        if (this->indexBuffer) {
+            allocator->destroyBuffer(this->indexBuffer, this->indexAllocation);
+        }
+        allocator->destroyBuffer(this->vertexBuffer, this->vertexAllocation);
+        throw;
+    }
+}
@@ -0,0 +1,152 @@
+#include "vgl/MeshFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "vgl/FileUtils.h"
+
+namespace {
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+}
+
+vgl::MeshFile::MeshFile(const std::string& _path)
+    : file(_path)
+{
+    if (this->file.size() < sizeof(FileHeader)) {
+        throw std::runtime_error("INVALID MESH FILE " + _path);
+    }
+    memcpy(&this->header, this->file.data(), sizeof(FileHeader));
+
+    const FileHeader& h = this->header;
+    if (h.magic != fileMagic || h.version != fileVersion || h.vertexStride != sizeof(vgl::PackedVertex) ||
+        (h.indexSize != 2 && h.indexSize != 4) || h.fileSize != this->file.size()) {
+        throw std::runtime_error("INVALID MESH FILE " + _path);
+    }
+
+    //Every section has to lie inside the file before anything points into it
+    uint64_t lodSize = static_cast<uint64_t>(h.lodCount) * sizeof(vgl::MeshLod);
+    uint64_t vertexSize = static_cast<uint64_t>(h.vertexCount) * h.vertexStride;
+    uint64_t indexSize = static_cast<uint64_t>(h.indexCount) * h.indexSize;
+    if (h.lodCount == 0 || h.lodOffset < sizeof(FileHeader) || h.lodOffset + lodSize > h.vertexOffset ||
+        h.vertexOffset + vertexSize > h.indexOffset || h.indexOffset + indexSize > h.fileSize ||
+        h.vertexOffset % sectionAlignment != 0 || h.indexOffset % sectionAlignment != 0) {
+        throw std::runtime_error("INVALID MESH FILE " + _path);
+    }
+
+    if (checksum(h, this->file.data() + h.lodOffset, static_cast<size_t>(lodSize)) != h.checksum) {
+        throw std::runtime_error("INVALID MESH FILE " + _path);
+    }
+
+    const vgl::MeshLod* lods = this->getLods();
+    for (uint32_t i = 0; i < h.lodCount; i++) {
+        if (static_cast<uint64_t>(lods[i].indexOffset) + lods[i].indexCount > h.indexCount) {
+            throw std::runtime_error("INVALID MESH FILE " + _path);
+        }
+    }
+
+    this->bounds.min = { h.boundsMin[0], h.boundsMin[1], h.boundsMin[2] };
+    this->bounds.max = { h.boundsMax[0], h.boundsMax[1], h.boundsMax[2] };
+}
+
+const vgl::MeshLod* vgl::MeshFile::getLods() const {
+    if (!this->file.data()) { return nullptr; }
+    return reinterpret_cast<const vgl::MeshLod*>(this->file.data() + this->header.lodOffset);
+}
+
+uint32_t vgl::MeshFile::getLodCount() const {
+    return this->header.lodCount;
+}
+
+const vgl::Aabb& vgl::MeshFile::getBounds() const {
+    return this->bounds;
+}
+
+const void* vgl::MeshFile::getVertexData() const {
+    if (!this->file.data()) { return nullptr; }
+    return this->file.data() + this->header.vertexOffset;
+}
+
+VkDeviceSize vgl::MeshFile::getVertexDataSize() const {
+    return static_cast<VkDeviceSize>(this->header.vertexCount) * this->header.vertexStride;
+}
+
+uint32_t vgl::MeshFile::getVertexCount() const {
+    return this->header.vertexCount;
+}
+
+const void* vgl::MeshFile::getIndexData() const {
+    if (!this->file.data()) { return nullptr; }
+    return this->file.data() + this->header.indexOffset;
+}
+
+VkDeviceSize vgl::MeshFile::getIndexDataSize() const {
+    return static_cast<VkDeviceSize>(this->header.indexCount) * this->header.indexSize;
+}
+
+uint32_t vgl::MeshFile::getIndexCount() const {
+    return this->header.indexCount;
+}
+
+VkIndexType vgl::MeshFile::getIndexType() const {
+    return this->header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+bool vgl::MeshFile::save(const std::string& _path, const vgl::MeshData& mesh) {
+    if (mesh.lods.empty()) { return false; }
+
+    //16 bit indices halve the index section, 0xFFFF is left out since it is the primitive restart value
+    bool shortIndices = mesh.vertices.size() < 0xFFFF;
+
+    FileHeader fileHeader;
+    fileHeader.magic = fileMagic;
+    fileHeader.version = fileVersion;
+    fileHeader.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    fileHeader.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    fileHeader.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    fileHeader.vertexStride = sizeof(vgl::PackedVertex);
+    fileHeader.indexSize = shortIndices ? 2 : 4;
+    for (int i = 0; i < 3; i++) {
+        fileHeader.boundsMin[i] = mesh.bounds.min[i];
+        fileHeader.boundsMax[i] = mesh.bounds.max[i];
+    }
+    fileHeader.lodOffset = alignUp(sizeof(FileHeader), sectionAlignment);
+    fileHeader.vertexOffset = alignUp(fileHeader.lodOffset + mesh.lods.size() * sizeof(vgl::MeshLod), sectionAlignment);
+    fileHeader.indexOffset = alignUp(fileHeader.vertexOffset + mesh.vertices.size() * sizeof(vgl::PackedVertex), sectionAlignment);
+    fileHeader.fileSize = fileHeader.indexOffset + mesh.indices.size() * fileHeader.indexSize;
+    fileHeader.checksum = checksum(fileHeader, mesh.lods.data(), mesh.lods.size() * sizeof(vgl::MeshLod));
+
+    std::vector<char> data(static_cast<size_t>(fileHeader.fileSize), 0);
+    memcpy(data.data(), &fileHeader, sizeof(fileHeader));
+    memcpy(data.data() + fileHeader.lodOffset, mesh.lods.data(), mesh.lods.size() * sizeof(vgl::MeshLod));
+    if (!mesh.vertices.empty()) {
+        memcpy(data.data() + fileHeader.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(vgl::PackedVertex));
+    }
+    if (shortIndices) {
+        uint16_t* indices = reinterpret_cast<uint16_t*>(data.data() + fileHeader.indexOffset);
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            indices[i] = static_cast<uint16_t>(mesh.indices[i]);
+        }
+    }
+    else if (!mesh.indices.empty()) {
+        memcpy(data.data() + fileHeader.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+
+    //Written to a temporary file then renamed over the old mesh in one step
+    if (!vgl::writeFileAtomically(_path, { { data.data(), data.size() } })) {
+        return false;
+    }
+    return true;
+}
+
+uint64_t vgl::MeshFile::checksum(const FileHeader& header, const void* lods, size_t lodsSize) {
+    FileHeader copy = header;
+    copy.checksum = 0;
+
+    uint64_t hash = vgl::fnv1a64(&copy, sizeof(copy));
+    hash = vgl::fnv1a64(lods, lodsSize, hash);
+    return hash;
+}
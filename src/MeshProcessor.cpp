@@ -0,0 +1,678 @@
+#include "vgl/MeshProcessor.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+    //Simulated cache size and weights from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    const uint32_t forsythCacheSize = 32;
+    const float lastTriangleScore = 0.75f;
+    const float cacheDecayPower = 1.5f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+    //Valence scores are tabulated up to this many remaining triangles
+    const uint32_t maxTabulatedValence = 64;
+
+    //Higher scores are emitted sooner, vertices used by the last triangle score the same so the strip doesn't snake back on itself
+    float getVertexScore(int32_t cachePosition, uint32_t remaining) {
+        static const auto tables = []() {
+            std::pair<std::array<float, forsythCacheSize>, std::array<float, maxTabulatedValence>> values;
+            for (uint32_t i = 0; i < forsythCacheSize; i++) {
+                values.first[i] = i < 3 ? lastTriangleScore : std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(forsythCacheSize - 3), cacheDecayPower);
+            }
+            for (uint32_t i = 1; i < maxTabulatedValence; i++) {
+                values.second[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+            }
+            values.second[0] = 0.0f;
+            return values;
+        }();
+
+        //Vertices with nothing left to draw never affect the order again
+        if (remaining == 0) { return -1.0f; }
+
+        float score = cachePosition >= 0 ? tables.first[cachePosition] : 0.0f;
+        score += remaining < maxTabulatedValence ? tables.second[remaining] : valenceBoostScale * std::pow(static_cast<float>(remaining), -valenceBoostPower);
+        return score;
+    }
+
+    //Plane quadric of the faces around a vertex, the symmetric 4x4 matrix stored as its upper triangle
+    struct Quadric {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+
+        void addPlane(const glm::vec3& n, float d, float weight) {
+            a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z;
+            a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a22 += weight * n.z * n.z;
+            b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+            c += weight * d * d;
+        }
+
+        void add(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+        }
+
+        //Sum of squared distances from p to the planes
+        double evaluate(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+                + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        }
+    };
+
+    uint16_t floatToHalf(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = (bits >> 16) & 0x8000u;
+        uint32_t mantissa = bits & 0x7FFFFFu;
+        int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFFu);
+
+        //Infinity and NaN
+        if (exponent == 0xFF) {
+            return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+        }
+
+        exponent = exponent - 127 + 15;
+        if (exponent >= 31) {
+            return static_cast<uint16_t>(sign | 0x7C00u);
+        }
+        //Subnormal halves, rounded to nearest
+        if (exponent <= 0) {
+            if (exponent < -10) { return static_cast<uint16_t>(sign); }
+            mantissa |= 0x800000u;
+            uint32_t shift = static_cast<uint32_t>(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1u) { half++; }
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        //A carry out of the mantissa correctly bumps the exponent
+        uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000u) { half++; }
+        return static_cast<uint16_t>(half);
+    }
+
+    float halfToFloat(uint16_t value) {
+        uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+        uint32_t exponent = (value >> 10) & 0x1Fu;
+        uint32_t mantissa = value & 0x3FFu;
+
+        uint32_t bits;
+        if (exponent == 0) {
+            if (mantissa == 0) {
+                bits = sign;
+            }
+            else {
+                //Normalise the subnormal
+                exponent = 127 - 15 + 1;
+                while (!(mantissa & 0x400u)) {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+            }
+        }
+        else if (exponent == 31) {
+            bits = sign | 0x7F800000u | (mantissa << 13);
+        }
+        else {
+            bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    float signNotZero(float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    vgl::Aabb computeBounds(const std::vector<vgl::MeshVertex>& vertices) {
+        vgl::Aabb bounds;
+        if (vertices.empty()) { return bounds; }
+
+        bounds.min = vertices[0].position;
+        bounds.max = vertices[0].position;
+        for (const vgl::MeshVertex& vertex : vertices) {
+            bounds.min = glm::min(bounds.min, vertex.position);
+            bounds.max = glm::max(bounds.max, vertex.position);
+        }
+        return bounds;
+    }
+
+}
+
+glm::vec3 vgl::MeshData::getPositionScale() const {
+    return vgl::MeshProcessor::getPositionScale(this->bounds);
+}
+
+glm::vec3 vgl::MeshData::getPositionOffset() const {
+    return this->bounds.min;
+}
+
+vgl::MeshData vgl::MeshProcessor::build(const std::vector<vgl::MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+    const vgl::MeshBuildSettings& settings, vgl::MeshBuildStats* stats)
+{
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error("MESH INDEX COUNT IS NOT A MULTIPLE OF 3");
+    }
+    for (uint32_t index : indices) {
+        if (index >= vertices.size()) {
+            throw std::runtime_error("MESH INDEX OUT OF RANGE");
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+    std::vector<std::vector<uint32_t>> levels;
+    std::vector<float> errors;
+    levels.push_back(settings.optimizeVertexCache ? optimizeVertexCache(indices, vertexCount) : indices);
+    errors.push_back(0.0f);
+
+    //Every level is simplified from the full detail level rather than the previous one, so errors don't accumulate
+    for (uint32_t lod = 1; lod < settings.maxLods; lod++) {
+        size_t previousTriangles = levels.back().size() / 3;
+        size_t targetTriangles = static_cast<size_t>(static_cast<float>(previousTriangles) * settings.lodReduction);
+        if (targetTriangles < settings.minLodTriangles) { break; }
+
+        float error = 0.0f;
+        std::vector<uint32_t> level = simplify(vertices, levels[0], targetTriangles * 3, &error);
+        if (level.size() / 3 < settings.minLodTriangles) { break; }
+
+        if (settings.optimizeVertexCache) {
+            level = optimizeVertexCache(level, vertexCount);
+        }
+        levels.push_back(std::move(level));
+        errors.push_back(error);
+    }
+
+    vgl::MeshData mesh;
+    for (size_t i = 0; i < levels.size(); i++) {
+        vgl::MeshLod lod;
+        lod.indexOffset = static_cast<uint32_t>(mesh.indices.size());
+        lod.indexCount = static_cast<uint32_t>(levels[i].size());
+        lod.error = errors[i];
+        mesh.lods.push_back(lod);
+        mesh.indices.insert(mesh.indices.end(), levels[i].begin(), levels[i].end());
+    }
+
+    //The full detail level comes first so its order decides the vertex order, the coarser levels use a subset of the same vertices
+    std::vector<vgl::MeshVertex> ordered = vertices;
+    if (settings.optimizeVertexFetch) {
+        optimizeVertexFetch(ordered, mesh.indices);
+    }
+
+    mesh.bounds = computeBounds(ordered);
+    mesh.vertices.resize(ordered.size());
+    for (size_t i = 0; i < ordered.size(); i++) {
+        mesh.vertices[i] = quantize(ordered[i], mesh.bounds);
+    }
+
+    if (stats) {
+        stats->inputVertices = vertexCount;
+        stats->inputTriangles = static_cast<uint32_t>(indices.size() / 3);
+        stats->acmrBefore = computeAcmr(indices, vertexCount);
+        stats->acmrAfter = computeAcmr(levels[0], vertexCount);
+        stats->buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return mesh;
+}
+
+std::vector<uint32_t> vgl::MeshProcessor::optimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    if (triangleCount == 0) { return result; }
+
+    //Triangles around each vertex, the first remaining[v] entries are the ones not drawn yet
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        remaining[indices[i]]++;
+    }
+    std::vector<uint32_t> offsets(static_cast<size_t>(vertexCount) + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = getVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    uint32_t best = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[best]) { best = static_cast<uint32_t>(t); }
+    }
+    std::vector<bool> emitted(triangleCount, false);
+
+    //Room for the whole cache plus the three vertices of the new triangle before the oldest are pushed out
+    uint32_t cache[forsythCacheSize + 3];
+    uint32_t cacheCount = 0;
+    size_t cursor = 0;
+
+    for (size_t drawn = 0; drawn < triangleCount; drawn++) {
+        //Nothing in the cache has triangles left, continue with the next triangle in the input order
+        if (best == UINT32_MAX) {
+            while (emitted[cursor]) { cursor++; }
+            best = static_cast<uint32_t>(cursor);
+        }
+
+        const uint32_t* triangle = &indices[static_cast<size_t>(best) * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        for (uint32_t k = 0; k < 3; k++) {
+            uint32_t v = triangle[k];
+            uint32_t* list = &adjacency[offsets[v]];
+            uint32_t count = remaining[v];
+            for (uint32_t i = 0; i < count; i++) {
+                if (list[i] == best) {
+                    std::swap(list[i], list[count - 1]);
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        //The triangle's vertices move to the front, degenerate triangles only add each vertex once
+        uint32_t newCache[forsythCacheSize + 3];
+        uint32_t newCount = 0;
+        for (uint32_t k = 0; k < 3; k++) {
+            if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount) {
+                newCache[newCount++] = triangle[k];
+            }
+        }
+        for (uint32_t i = 0; i < cacheCount; i++) {
+            if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount) {
+                newCache[newCount++] = cache[i];
+            }
+        }
+
+        //Rescore everything that moved in the cache or fell out of it, then pick the best triangle touching the cache
+        for (uint32_t i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            cachePosition[v] = i < forsythCacheSize ? static_cast<int32_t>(i) : -1;
+            float score = getVertexScore(cachePosition[v], remaining[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                triangleScores[adjacency[offsets[v] + j]] += delta;
+            }
+        }
+
+        best = UINT32_MAX;
+        float bestScore = -1.0f;
+        cacheCount = std::min(newCount, forsythCacheSize);
+        for (uint32_t i = 0; i < cacheCount; i++) {
+            uint32_t v = newCache[i];
+            cache[i] = v;
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                uint32_t t = adjacency[offsets[v] + j];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void vgl::MeshProcessor::optimizeVertexFetch(std::vector<vgl::MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<vgl::MeshVertex> ordered;
+    ordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(ordered);
+}
+
+std::vector<uint32_t> vgl::MeshProcessor::simplify(const std::vector<vgl::MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+    size_t targetIndexCount, float* error)
+{
+    if (error) { *error = 0.0f; }
+    if (indices.size() <= targetIndexCount) { return indices; }
+
+    vgl::Aabb bounds = computeBounds(vertices);
+    glm::vec3 extent = bounds.max - bounds.min;
+    float size = std::max(extent.x, std::max(extent.y, extent.z));
+    if (size <= 0.0f) { return {}; }
+
+    //Area weighted planes of the faces around each vertex
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].position;
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float doubleArea = glm::length(normal);
+        if (doubleArea <= 0.0f) { continue; }
+
+        normal = normal * (1.0f / doubleArea);
+        float distance = -glm::dot(normal, p0);
+        for (uint32_t k = 0; k < 3; k++) {
+            quadrics[indices[i + k]].addPlane(normal, distance, doubleArea * 0.5f);
+        }
+    }
+
+    //Only vertices the triangles use are clustered
+    std::vector<uint32_t> used;
+    {
+        std::vector<bool> isUsed(vertices.size(), false);
+        for (uint32_t index : indices) {
+            if (!isUsed[index]) {
+                isUsed[index] = true;
+                used.push_back(index);
+            }
+        }
+    }
+
+    auto getCell = [&](uint32_t vertex, uint32_t grid) -> uint64_t {
+        glm::vec3 cell = (vertices[vertex].position - bounds.min) * (static_cast<float>(grid) / size);
+        uint64_t x = std::min(static_cast<uint64_t>(cell.x), static_cast<uint64_t>(grid - 1));
+        uint64_t y = std::min(static_cast<uint64_t>(cell.y), static_cast<uint64_t>(grid - 1));
+        uint64_t z = std::min(static_cast<uint64_t>(cell.z), static_cast<uint64_t>(grid - 1));
+        return (x * grid + y) * grid + z;
+    };
+
+    //Finest grid that gets under the target, the triangle count grows with the grid resolution
+    //A triangle survives exactly when its corners are in three different cells, so the search only has to count those
+    //Duplicates are removed afterwards, which can only bring the count further under the target
+    std::vector<uint64_t> vertexCells(vertices.size(), 0);
+    uint32_t bestGrid = 0;
+    uint32_t low = 1;
+    uint32_t high = 1024;
+    while (low <= high) {
+        uint32_t grid = low + (high - low) / 2;
+        for (uint32_t vertex : used) {
+            vertexCells[vertex] = getCell(vertex, grid);
+        }
+        size_t count = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            uint64_t a = vertexCells[indices[i]];
+            uint64_t b = vertexCells[indices[i + 1]];
+            uint64_t c = vertexCells[indices[i + 2]];
+            count += (a != b && b != c && a != c) ? 3 : 0;
+        }
+        if (count <= targetIndexCount) {
+            bestGrid = grid;
+            low = grid + 1;
+        }
+        else {
+            high = grid - 1;
+        }
+    }
+    if (bestGrid == 0) { return {}; }
+
+    //Merge the vertices in each cell into the one that best keeps the surface
+    std::vector<std::pair<uint64_t, uint32_t>> cells(used.size());
+    for (size_t i = 0; i < used.size(); i++) {
+        cells[i] = { getCell(used[i], bestGrid), used[i] };
+    }
+    std::sort(cells.begin(), cells.end());
+
+    std::vector<uint32_t> remap(vertices.size(), 0);
+    for (size_t begin = 0; begin < cells.size();) {
+        size_t end = begin + 1;
+        while (end < cells.size() && cells[end].first == cells[begin].first) { end++; }
+
+        Quadric quadric;
+        for (size_t i = begin; i < end; i++) {
+            quadric.add(quadrics[cells[i].second]);
+        }
+        uint32_t representative = cells[begin].second;
+        double bestError = quadric.evaluate(vertices[representative].position);
+        for (size_t i = begin + 1; i < end; i++) {
+            double candidate = quadric.evaluate(vertices[cells[i].second].position);
+            if (candidate < bestError) {
+                bestError = candidate;
+                representative = cells[i].second;
+            }
+        }
+        for (size_t i = begin; i < end; i++) {
+            remap[cells[i].second] = representative;
+        }
+        begin = end;
+    }
+
+    //Drop triangles that collapsed, the rest are rotated so the smallest index is first, which keeps the winding and makes duplicates compare equal
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = remap[indices[i]];
+        uint32_t b = remap[indices[i + 1]];
+        uint32_t c = remap[indices[i + 2]];
+        if (a == b || b == c || a == c) { continue; }
+        if (b < a && b < c) { triangles.push_back({ b, c, a }); }
+        else if (c < a && c < b) { triangles.push_back({ c, a, b }); }
+        else { triangles.push_back({ a, b, c }); }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    std::vector<uint32_t> result;
+    result.reserve(triangles.size() * 3);
+    for (const auto& triangle : triangles) {
+        result.insert(result.end(), triangle.begin(), triangle.end());
+    }
+
+    //A vertex moves at most across its cell
+    if (error && !result.empty()) {
+        *error = std::sqrt(3.0f) * (size / static_cast<float>(bestGrid)) / glm::length(extent);
+    }
+    return result;
+}
+
+float vgl::MeshProcessor::computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    if (indices.size() < 3) { return 0.0f; }
+
+    //A vertex is in the FIFO while fewer than cacheSize misses have happened since it was loaded
+    std::vector<uint32_t> loadedAt(vertexCount, 0);
+    uint32_t misses = 0;
+    for (uint32_t index : indices) {
+        if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+            misses++;
+            loadedAt[index] = misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+glm::vec3 vgl::MeshProcessor::getPositionScale(const vgl::Aabb& bounds) {
+    //Flat axes still get a non zero scale
+    glm::vec3 extent = bounds.max - bounds.min;
+    return { extent.x > 0.0f ? extent.x : 1.0f, extent.y > 0.0f ? extent.y : 1.0f, extent.z > 0.0f ? extent.z : 1.0f };
+}
+
+vgl::PackedVertex vgl::MeshProcessor::quantize(const vgl::MeshVertex& vertex, const vgl::Aabb& bounds) {
+    vgl::PackedVertex packed{};
+
+    glm::vec3 scale = getPositionScale(bounds);
+    for (int i = 0; i < 3; i++) {
+        float normalized = (vertex.position[i] - bounds.min[i]) / scale[i];
+        packed.position[i] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+    }
+    packed.position[3] = 0;
+
+    //Project onto the octahedron and fold the lower half over the diagonals
+    glm::vec3 n = vertex.normal;
+    float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (sum <= 0.0f) { n = { 0.0f, 0.0f, 1.0f }; sum = 1.0f; }
+    float x = n.x / sum;
+    float y = n.y / sum;
+    if (n.z < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+        float foldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    packed.normal[0] = static_cast<int8_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 127.0f));
+    packed.normal[1] = static_cast<int8_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * 127.0f));
+
+    packed.uv[0] = floatToHalf(vertex.uv.x);
+    packed.uv[1] = floatToHalf(vertex.uv.y);
+    return packed;
+}
+
+vgl::MeshVertex vgl::MeshProcessor::dequantize(const vgl::PackedVertex& vertex, const vgl::Aabb& bounds) {
+    vgl::MeshVertex unpacked;
+
+    glm::vec3 scale = getPositionScale(bounds);
+    for (int i = 0; i < 3; i++) {
+        unpacked.position[i] = bounds.min[i] + static_cast<float>(vertex.position[i]) / 65535.0f * scale[i];
+    }
+
+    //SNORM8 maps -128 and -127 both to -1
+    float x = std::max(static_cast<float>(vertex.normal[0]) / 127.0f, -1.0f);
+    float y = std::max(static_cast<float>(vertex.normal[1]) / 127.0f, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        float unfoldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+        float unfoldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+    unpacked.normal = glm::normalize(glm::vec3(x, y, z));
+
+    unpacked.uv = { halfToFloat(vertex.uv[0]), halfToFloat(vertex.uv[1]) };
+    return unpacked;
+}
+
+void vgl::MeshProcessor::loadObj(const std::string& path, std::vector<vgl::MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("FAILED TO OPEN FILE " + path);
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+
+    //Index of the vertex for each position/uv/normal combination, -1 where a corner has no uv or normal
+    struct CornerKey {
+        int64_t position, uv, normal;
+        bool operator==(const CornerKey& other) const { return position == other.position && uv == other.uv && normal == other.normal; }
+    };
+    struct CornerHash {
+        size_t operator()(const CornerKey& key) const {
+            return std::hash<int64_t>()(key.position) ^ (std::hash<int64_t>()(key.uv) * 31) ^ (std::hash<int64_t>()(key.normal) * 131);
+        }
+    };
+    std::unordered_map<CornerKey, uint32_t, CornerHash> corners;
+    //Vertices whose normal came from the file, the rest get one generated from their faces
+    std::vector<bool> hasNormal;
+
+    //OBJ indices are 1 based, negative ones count back from the latest element
+    auto resolve = [&path](int64_t index, size_t count) -> int64_t {
+        int64_t resolved = index < 0 ? static_cast<int64_t>(count) + index : index - 1;
+        if (resolved < 0 || resolved >= static_cast<int64_t>(count)) {
+            throw std::runtime_error("OBJ INDEX OUT OF RANGE IN " + path);
+        }
+        return resolved;
+    };
+
+    std::string line;
+    std::vector<uint32_t> face;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+
+        if (type == "v") {
+            glm::vec3 position;
+            stream >> position.x >> position.y >> position.z;
+            positions.push_back(position);
+        }
+        else if (type == "vn") {
+            glm::vec3 normal;
+            stream >> normal.x >> normal.y >> normal.z;
+            normals.push_back(normal);
+        }
+        else if (type == "vt") {
+            glm::vec2 uv;
+            stream >> uv.x >> uv.y;
+            //OBJ puts the origin at the bottom left, Vulkan samples from the top left
+            uv.y = 1.0f - uv.y;
+            uvs.push_back(uv);
+        }
+        else if (type == "f") {
+            face.clear();
+            std::string token;
+            while (stream >> token) {
+                //v, v/vt, v//vn or v/vt/vn
+                CornerKey key{ -1, -1, -1 };
+                size_t firstSlash = token.find('/');
+                key.position = resolve(std::stoll(token.substr(0, firstSlash)), positions.size());
+                if (firstSlash != std::string::npos) {
+                    size_t secondSlash = token.find('/', firstSlash + 1);
+                    std::string uv = token.substr(firstSlash + 1, secondSlash == std::string::npos ? std::string::npos : secondSlash - firstSlash - 1);
+                    if (!uv.empty()) { key.uv = resolve(std::stoll(uv), uvs.size()); }
+                    if (secondSlash != std::string::npos) { key.normal = resolve(std::stoll(token.substr(secondSlash + 1)), normals.size()); }
+                }
+
+                auto found = corners.find(key);
+                if (found == corners.end()) {
+                    vgl::MeshVertex vertex;
+                    vertex.position = positions[key.position];
+                    if (key.uv >= 0) { vertex.uv = uvs[key.uv]; }
+                    if (key.normal >= 0) { vertex.normal = normals[key.normal]; }
+                    found = corners.emplace(key, static_cast<uint32_t>(vertices.size())).first;
+                    vertices.push_back(vertex);
+                    hasNormal.push_back(key.normal >= 0);
+                }
+                face.push_back(found->second);
+            }
+
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                indices.push_back(face[0]);
+                indices.push_back(face[i]);
+                indices.push_back(face[i + 1]);
+            }
+        }
+    }
+
+    //Area weighted face normals for vertices the file gave none
+    if (std::find(hasNormal.begin(), hasNormal.end(), false) == hasNormal.end()) { return; }
+    std::vector<glm::vec3> generated(vertices.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - vertices[indices[i]].position,
+            vertices[indices[i + 2]].position - vertices[indices[i]].position);
+        for (uint32_t k = 0; k < 3; k++) {
+            generated[indices[i + k]] = generated[indices[i + k]] + normal;
+        }
+    }
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (!hasNormal[i] && glm::length(generated[i]) > 0.0f) {
+            vertices[i].normal = glm::normalize(generated[i]);
+        }
+    }
+}
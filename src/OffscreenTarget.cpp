@@ -0,0 +1,48 @@
+#include "vgl/OffscreenTarget.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::OffscreenTarget::OffscreenTarget(vgl::LogicalDevice* _logicalDevice, VkExtent2D _extent, VkFormat _format)
+    : format(_format),
+    extent(_extent),
+    logicalDevice(_logicalDevice)
+{
+    //Image is used as a colour attachment and can be copied from so results can be read back to the CPU
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = this->extent.width;
+    imageInfo.extent.height = this->extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = this->format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    //Device local memory is sub-allocated from the device's allocator
+    this->logicalDevice->getAllocator()->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->image, this->imageMemory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = this->image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = this->format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(this->logicalDevice->device, &viewInfo, vgl::HostAllocator::callbacks(), &this->imageView) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE OFFSCREEN IMAGE VIEW");
+    }
+}
+
+vgl::OffscreenTarget::~OffscreenTarget() {
+    if (this->imageView) { vkDestroyImageView(this->logicalDevice->device, this->imageView, vgl::HostAllocator::callbacks()); }
+    this->logicalDevice->getAllocator()->destroyImage(this->image, this->imageMemory);
+}
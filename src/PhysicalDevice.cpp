@@ -1,13 +1,23 @@
 #include "vgl/PhysicalDevice.h"
-#include "vgl/PhysicalDevice.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+#include "vgl/CpuProfiler.h"
+#include "vgl/Logger.h"
 
-vgl::PhysicalDevice::PhysicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, std::shared_ptr<VkSurfaceKHR> _surface)
+
+vgl::PhysicalDevice::PhysicalDevice(std::shared_ptr<const VkInstance> _instance, const std::vector<const char*>& _deviceExtensions, std::shared_ptr<VkSurfaceKHR> _surface,
+    const vgl::DeviceFilter& _filter, const std::string& _cacheDirectory)
     : instance(_instance),
     deviceExtensions(_deviceExtensions),
-    surface(_surface)
+    surface(_surface),
+    filter(applyEnvironment(_filter))
 {
-    std::cout << "CREATING PHYSICAL DEVICE\n";
+    VGL_PROFILE_SCOPE("PhysicalDevice::PhysicalDevice");
+    VGL_LOG_INFO("Device", "CREATING PHYSICAL DEVICE");
 
     //Count all possible physical devices
     uint32_t deviceCount = 0;
@@ -22,21 +32,65 @@ vgl::PhysicalDevice::PhysicalDevice(std::shared_ptr<const VkInstance> _instance,
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(*this->instance, &deviceCount, devices.data());
 
-    //Loop over devices and check if they are suitable
-    for (const auto& device : devices) {
-        if (this->isDeviceSuitable(device)) {
-            this->physicalDevice = device;
-            this->msaaSamples = this->getMaxUsableSampleCount();
-            break;
+    //Score every device rather than taking the first suitable one
+    for (uint32_t i = 0; i < deviceCount; i++) {
+        Candidate candidate = this->evaluateDevice(vgl::DeviceCapabilities::query(devices[i], _cacheDirectory), i);
+        candidate.matchesFilter = this->matchesFilter(candidate);
+        this->rankedDevices.push_back(candidate);
+    }
+
+    //Usable devices first, then by score, then by UUID and IDs so the order doesn't depend on enumeration order
+    std::sort(this->rankedDevices.begin(), this->rankedDevices.end(), [](const Candidate& a, const Candidate& b) {
+        bool usableA = a.suitable && a.matchesFilter;
+        bool usableB = b.suitable && b.matchesFilter;
+        if (usableA != usableB) {
+            return usableA;
+        }
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (a.uuid != b.uuid) {
+            return a.uuid < b.uuid;
+        }
+        if (a.name != b.name) {
+            return a.name < b.name;
         }
+        return a.index < b.index;
+    });
+
+    VGL_LOG_INFO("Device", "PHYSICAL DEVICES RANKED:");
+    for (const auto& candidate : this->rankedDevices) {
+        std::ostringstream line;
+        line << "    [" << candidate.index << "] " << candidate.name << " score " << candidate.score;
+        if (candidate.capabilities->isFromDisk()) {
+            line << " (capabilities cached)";
+        }
+        if (!candidate.suitable) {
+            line << " (unsuitable: " << candidate.rejectReason << ")";
+        }
+        else if (!candidate.matchesFilter) {
+            line << " (filtered out)";
+        }
+        vgl::Logger::get().log(vgl::LogLevel::Info, "Device", line.str());
     }
 
     //Check if a suitable device was found
-    if (this->physicalDevice == VK_NULL_HANDLE) {
+    const Candidate& best = this->rankedDevices.front();
+    if (!best.suitable || !best.matchesFilter) {
+        bool anySuitable = std::any_of(this->rankedDevices.begin(), this->rankedDevices.end(), [](const Candidate& candidate) { return candidate.suitable; });
+        if (anySuitable) {
+            throw std::runtime_error("NO SUITABLE GPU MATCHES THE DEVICE FILTER");
+        }
         throw std::runtime_error("UNABLE TO FIND A SUITABLE GPU");
     }
 
-    std::cout << "CREATED PHYSICAL DEVICE\n";
+    this->physicalDevice = best.device;
+    this->capabilities = best.capabilities;
+    this->queueFamilyIndices = best.queueFamilyIndices;
+    this->msaaSamples = this->capabilities->getMaxUsableSampleCount();
+
+    VGL_LOG_INFO("Device", "SELECTED " << best.name);
+    VGL_LOG_INFO("Device", "CREATED PHYSICAL DEVICE");
 }
 
 void vgl::PhysicalDevice::setInstance(std::shared_ptr<const VkInstance> _instance) {
@@ -47,89 +101,186 @@ void vgl::PhysicalDevice::setSurface(std::shared_ptr<VkSurfaceKHR> _surface) {
     this->surface = _surface;
 }
 
-bool vgl::PhysicalDevice::isDeviceSuitable(const VkPhysicalDevice& device){
-    //Get basic device properties
-    //e.g. name, type, supported vulkan version
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+bool vgl::PhysicalDevice::hasSurface() const {
+    return this->surface && *this->surface != VK_NULL_HANDLE;
+}
 
-    //Support for optional features
-    //e.g. texture compression, 64 bit floats, multi viewport rendering (useful for VR)
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+const std::vector<vgl::PhysicalDevice::Candidate>& vgl::PhysicalDevice::getRankedDevices() const {
+    return this->rankedDevices;
+}
 
-    //Example check for dedicated graphics cards that support geometry shaders
-    //return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
-    //        && deviceFeatures.geometryShader;
+const vgl::DeviceFilter& vgl::PhysicalDevice::getFilter() const {
+    return this->filter;
+}
 
-    //Get whether deivce supports the queue families required
-    QueueFamilyIndices indices = this->findQueueFamilies(device);
+std::shared_ptr<const vgl::DeviceCapabilities> vgl::PhysicalDevice::getCapabilities() const {
+    return this->capabilities;
+}
 
-    //Check whether the device supports extensions
-    bool extensionsSupported = this->checkDeviceExtensionSupport(device);
+vgl::PhysicalDevice::Candidate vgl::PhysicalDevice::evaluateDevice(std::shared_ptr<const vgl::DeviceCapabilities> _capabilities, uint32_t index) {
+    const vgl::DeviceCapabilities& caps = *_capabilities;
+
+    Candidate candidate;
+    candidate.device = caps.physicalDevice;
+    candidate.index = index;
+    candidate.capabilities = _capabilities;
+    candidate.name = caps.properties.deviceName;
+    candidate.uuid = caps.uuid;
+    candidate.type = caps.properties.deviceType;
+    candidate.apiVersion = caps.properties.apiVersion;
+    candidate.deviceLocalBytes = caps.getDeviceLocalBytes();
+
+    candidate.queueFamilyIndices = caps.findQueueFamilies(this->hasSurface() ? *this->surface : VK_NULL_HANDLE);
+    candidate.suitable = this->isDeviceSuitable(caps, candidate.queueFamilyIndices, candidate.rejectReason);
+    if (candidate.suitable && this->filter.rejectCpu && candidate.type == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+        candidate.suitable = false;
+        candidate.rejectReason = "CPU implementation";
+    }
 
-    //Check swap chain availabilities
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
-        vgl::SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+    //Device type dominates, then memory, then queues, then features
+    uint64_t typeRank = 0;
+    switch (candidate.type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: typeRank = 4; break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeRank = 3; break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: typeRank = 2; break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: typeRank = 0; break;
+    default: typeRank = 1; break;
     }
 
-    VkPhysicalDeviceFeatures supportedFeatures;
-    vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+    //Device local memory in MiB, 40 bits is more than any heap will reach
+    uint64_t memoryMiB = std::min<uint64_t>(candidate.deviceLocalBytes >> 20, (1ull << 40) - 1);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    //Separate transfer and compute families let uploads and async compute overlap with rendering
+    const vgl::QueueFamilyIndices& queues = candidate.queueFamilyIndices;
+    uint64_t queueScore = 0;
+    if (queues.transferFamily.has_value()) {
+        queueScore += 2;
+    }
+    if (queues.computeFamily.has_value() && queues.computeFamily != queues.transferFamily) {
+        queueScore += 1;
+    }
+
+    //Features and limits the library makes use of when present
+    uint64_t featureScore = 0;
+    featureScore += caps.features.multiDrawIndirect ? 1 : 0;
+    featureScore += caps.features.drawIndirectFirstInstance ? 1 : 0;
+    featureScore += caps.features.textureCompressionBC ? 1 : 0;
+    featureScore += caps.features12.descriptorIndexing ? 1 : 0;
+    featureScore += caps.features12.drawIndirectCount ? 1 : 0;
+    featureScore += caps.features12.bufferDeviceAddress ? 1 : 0;
+    featureScore += caps.features13.dynamicRendering ? 1 : 0;
+    featureScore += caps.features13.synchronization2 ? 1 : 0;
+    //Larger limits usually mean a more capable device, counted in powers of two
+    const VkPhysicalDeviceLimits& limitValues = caps.properties.limits;
+    uint32_t limits[] = { limitValues.maxImageDimension2D, limitValues.maxComputeSharedMemorySize, limitValues.maxStorageBufferRange };
+    for (uint32_t limit : limits) {
+        while (limit > 1) {
+            featureScore++;
+            limit >>= 1;
+        }
+    }
+
+    candidate.score = (typeRank << 60) | (memoryMiB << 20) | (queueScore << 16) | std::min<uint64_t>(featureScore, 0xFFFF);
+    return candidate;
 }
 
-bool vgl::PhysicalDevice::checkDeviceExtensionSupport(const VkPhysicalDevice& device){
-    uint32_t extensionCount;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+bool vgl::PhysicalDevice::matchesFilter(const Candidate& candidate) const {
+    if (this->filter.index >= 0 && candidate.index != static_cast<uint32_t>(this->filter.index)) {
+        return false;
+    }
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+    if (!this->filter.uuid.empty()) {
+        std::string uuid;
+        for (char c : this->filter.uuid) {
+            if (c != '-') {
+                uuid += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+        }
+        if (uuid != candidate.uuid) {
+            return false;
+        }
+    }
+
+    if (!this->filter.name.empty()) {
+        auto lower = [](std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return text;
+        };
+        if (lower(candidate.name).find(lower(this->filter.name)) == std::string::npos) {
+            return false;
+        }
+    }
 
-    std::set<std::string> requiredExtensions(this->deviceExtensions.begin(), this->deviceExtensions.end());
+    return true;
+}
 
-    for (const auto& extension : availableExtensions) {
-        requiredExtensions.erase(extension.extensionName);
+vgl::DeviceFilter vgl::PhysicalDevice::applyEnvironment(vgl::DeviceFilter filter) {
+    const char* value = std::getenv(vgl::DeviceFilter::environmentVariable);
+    if (value == nullptr || value[0] == '\0') {
+        return filter;
     }
 
-    return requiredExtensions.empty();
+    std::string text = value;
+    filter.name.clear();
+    filter.uuid.clear();
+    filter.index = -1;
+
+    bool digits = std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); });
+    size_t hexCount = std::count_if(text.begin(), text.end(), [](unsigned char c) { return std::isxdigit(c); });
+    bool uuidLike = hexCount == VK_UUID_SIZE * 2 && std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isxdigit(c) || c == '-'; });
+
+    if (digits && text.size() < 6) {
+        filter.index = std::stoi(text);
+    }
+    else if (uuidLike) {
+        filter.uuid = text;
+    }
+    else {
+        filter.name = text;
+    }
+    return filter;
 }
 
-vgl::QueueFamilyIndices vgl::PhysicalDevice::findQueueFamilies(const VkPhysicalDevice& device){
-    vgl::QueueFamilyIndices indices;
-
-    //Retrieve the list of queue families
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
-
-    //Find queue family that supports VK_QUEUE_GRAPHICS_BIT
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) {
-        //Check if can do graphics
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
+bool vgl::PhysicalDevice::isDeviceSuitable(const vgl::DeviceCapabilities& caps, const vgl::QueueFamilyIndices& indices, std::string& reason){
+    //Example check for dedicated graphics cards that support geometry shaders
+    //return caps.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
+    //        && caps.features.geometryShader;
 
-        //Check if can render to surface
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, *this->surface, &presentSupport);
-        if (presentSupport) {
-            indices.presentFamily = i;
-        }
+    //Check whether the device supports extensions
+    bool extensionsSupported = caps.hasExtensions(this->deviceExtensions);
 
-        //Early exit if all queue families requires have been found
-        if (indices.isComplete()) {
-            break;
-        }
+    //Check swap chain availabilities
+    //Headless devices never create a swap chain so there is nothing to check
+    bool swapChainAdequate = !this->hasSurface();
+    if (extensionsSupported && this->hasSurface()) {
+        vgl::SwapChainSupportDetails swapChainSupport = querySwapChainSupport(caps.physicalDevice);
+        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+    }
+
+    //Timeline semaphores are core in Vulkan 1.2 and required by the upload engine
+    bool timelineSupported = caps.features12.timelineSemaphore == VK_TRUE;
 
-        i++;
+    if (!indices.isComplete(this->hasSurface())) {
+        reason = "missing graphics or present queue";
+    }
+    else if (!extensionsSupported) {
+        reason = "missing device extensions";
+    }
+    else if (!swapChainAdequate) {
+        reason = "no surface formats or present modes";
+    }
+    else if (!caps.features.samplerAnisotropy) {
+        reason = "no sampler anisotropy";
+    }
+    else if (!timelineSupported) {
+        reason = "no timeline semaphores";
     }
 
-    return indices;
+    return indices.isComplete(this->hasSurface()) && extensionsSupported && swapChainAdequate && caps.features.samplerAnisotropy && timelineSupported;
+}
+
+vgl::SwapChainSupportDetails vgl::PhysicalDevice::querySwapChainSupport() {
+    return this->querySwapChainSupport(this->physicalDevice);
 }
 
 vgl::SwapChainSupportDetails vgl::PhysicalDevice::querySwapChainSupport(const VkPhysicalDevice& device){
@@ -156,21 +307,3 @@ vgl::SwapChainSupportDetails vgl::PhysicalDevice::querySwapChainSupport(const Vk
 
     return details;
 }
-
-VkSampleCountFlagBits vgl::PhysicalDevice::getMaxUsableSampleCount(){
-    VkPhysicalDeviceProperties physicalDeviceProperties;
-    vkGetPhysicalDeviceProperties(this->physicalDevice, &physicalDeviceProperties);
-
-    //Get max number of samples for frame buffer colour and depth buffer
-    VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
-
-    //Find maximum number of samples supported by both colour and depth buffer
-    if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
-    if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
-    if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
-    if (counts & VK_SAMPLE_COUNT_8_BIT) { return VK_SAMPLE_COUNT_8_BIT; }
-    if (counts & VK_SAMPLE_COUNT_4_BIT) { return VK_SAMPLE_COUNT_4_BIT; }
-    if (counts & VK_SAMPLE_COUNT_2_BIT) { return VK_SAMPLE_COUNT_2_BIT; }
-
-    return VK_SAMPLE_COUNT_1_BIT;
-}
@@ -0,0 +1,203 @@
+#include "vgl/PipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "vgl/FileUtils.h"
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+
+vgl::PipelineCache::PipelineCache(const vgl::DeviceCapabilities& _capabilities, VkDevice _device, const std::string& _directory)
+    : device(_device),
+    properties(_capabilities.properties)
+{
+
+    //One file per GPU so machines with several GPUs don't keep overwriting each other's cache
+    if (!_directory.empty()) {
+        this->path = (std::filesystem::path(_directory) /
+            ("pipeline_cache_" + std::to_string(this->properties.vendorID) + "_" + std::to_string(this->properties.deviceID) + ".bin")).string();
+    }
+
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<char> data = this->load();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(this->device, &cacheInfo, vgl::HostAllocator::callbacks(), &this->cache);
+
+    //The driver can still refuse data that passed validation, fall back to an empty cache rather than failing
+    if (result != VK_SUCCESS && !data.empty()) {
+        this->stats.warm = false;
+        this->stats.loadedBytes = 0;
+        this->stats.rejectReason = "driver rejected the cache data";
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(this->device, &cacheInfo, vgl::HostAllocator::callbacks(), &this->cache);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE PIPELINE CACHE");
+    }
+
+    this->stats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+}
+
+vgl::PipelineCache::~PipelineCache() {
+    //Nothing new to write if no pipelines were created
+    if (this->stats.pipelinesCreated > 0) {
+        this->save();
+    }
+    vkDestroyPipelineCache(this->device, this->cache, vgl::HostAllocator::callbacks());
+}
+
+VkPipelineCache vgl::PipelineCache::getCache() const {
+    return this->cache;
+}
+
+bool vgl::PipelineCache::save() {
+    if (this->path.empty()) { return false; }
+
+    auto saveStart = std::chrono::steady_clock::now();
+
+    //Size first then data, the size can grow between the calls if another thread creates a pipeline so retry on VK_INCOMPLETE
+    std::vector<char> data;
+    VkResult result = VK_INCOMPLETE;
+    while (result == VK_INCOMPLETE) {
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(this->device, this->cache, &dataSize, nullptr) != VK_SUCCESS) {
+            return false;
+        }
+        data.resize(dataSize);
+        result = vkGetPipelineCacheData(this->device, this->cache, &dataSize, data.data());
+        data.resize(dataSize);
+    }
+    if (result != VK_SUCCESS) { return false; }
+
+    FileHeader header;
+    header.magic = fileMagic;
+    header.version = fileVersion;
+    header.vendorID = this->properties.vendorID;
+    header.deviceID = this->properties.deviceID;
+    header.driverVersion = this->properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, this->properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.checksum = vgl::fnv1a64(data.data(), data.size());
+
+    //Written to a temporary file then renamed over the old cache in one step
+    if (!vgl::writeFileAtomically(this->path, { { &header, sizeof(header) }, { data.data(), data.size() } })) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.saveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - saveStart).count();
+    return true;
+}
+
+void vgl::PipelineCache::recordCreation(double milliseconds) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.pipelinesCreated++;
+    this->stats.totalCreateMs += milliseconds;
+    this->stats.maxCreateMs = std::max(this->stats.maxCreateMs, milliseconds);
+}
+
+vgl::PipelineCache::Stats vgl::PipelineCache::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+const std::string& vgl::PipelineCache::getPath() const {
+    return this->path;
+}
+
+void vgl::PipelineCache::printStats() const {
+    Stats current = this->getStats();
+
+    std::ostringstream line;
+    line << "Pipeline cache: " << (current.warm ? "warm" : "cold") << " start";
+    if (current.warm) {
+        line << " (" << current.loadedBytes << " bytes loaded in " << current.loadMs << "ms)";
+    }
+    else if (!current.rejectReason.empty()) {
+        line << " (" << current.rejectReason << ")";
+    }
+    line << ", " << current.pipelinesCreated << " pipelines created in " << current.totalCreateMs << "ms";
+    if (current.pipelinesCreated > 0) {
+        line << " (average " << current.totalCreateMs / current.pipelinesCreated << "ms, max " << current.maxCreateMs << "ms)";
+    }
+    vgl::Logger::get().log(vgl::LogLevel::Info, "PipelineCache", line.str());
+}
+
+std::vector<char> vgl::PipelineCache::load() {
+    if (this->path.empty()) { return {}; }
+
+    std::ifstream file(this->path, std::ios::binary | std::ios::ate);
+    //No file is a normal cold start, not an error
+    if (!file.is_open()) { return {}; }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    if (fileSize < sizeof(FileHeader)) {
+        this->stats.rejectReason = "file is smaller than the header";
+        return {};
+    }
+
+    FileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (header.dataSize != fileSize - sizeof(FileHeader)) {
+        this->stats.rejectReason = "file is truncated or has trailing data";
+        return {};
+    }
+
+    std::vector<char> data(static_cast<size_t>(header.dataSize));
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file.good()) {
+        this->stats.rejectReason = "failed to read file";
+        return {};
+    }
+
+    std::string reason = this->validate(header, data);
+    if (!reason.empty()) {
+        this->stats.rejectReason = reason;
+        return {};
+    }
+
+    this->stats.warm = true;
+    this->stats.loadedBytes = data.size();
+    return data;
+}
+
+std::string vgl::PipelineCache::validate(const FileHeader& header, const std::vector<char>& data) const {
+    if (header.magic != fileMagic || header.version != fileVersion) {
+        return "unknown file format";
+    }
+    if (header.vendorID != this->properties.vendorID || header.deviceID != this->properties.deviceID) {
+        return "created on a different device";
+    }
+    //A driver update can change the compiled code, in which case the driver changes the UUID or version
+    if (header.driverVersion != this->properties.driverVersion || memcmp(header.pipelineCacheUUID, this->properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return "created by a different driver version";
+    }
+    if (header.checksum != vgl::fnv1a64(data.data(), data.size())) {
+        return "checksum mismatch";
+    }
+
+    //The driver's own header has to agree as well, some drivers crash on mismatched blobs instead of rejecting them
+    if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+        return "cache data is smaller than the Vulkan header";
+    }
+    VkPipelineCacheHeaderVersionOne vulkanHeader;
+    memcpy(&vulkanHeader, data.data(), sizeof(vulkanHeader));
+    if (vulkanHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || vulkanHeader.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) ||
+        vulkanHeader.vendorID != this->properties.vendorID || vulkanHeader.deviceID != this->properties.deviceID ||
+        memcmp(vulkanHeader.pipelineCacheUUID, this->properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return "Vulkan cache header does not match the device";
+    }
+
+    return "";
+}
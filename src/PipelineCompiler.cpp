@@ -0,0 +1,381 @@
+#include "vgl/PipelineCompiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "vgl/HostAllocator.h"
+
+vgl::PipelineHandle::State vgl::PipelineHandle::getState() const {
+    return this->state.load(std::memory_order_acquire);
+}
+
+bool vgl::PipelineHandle::isReady() const {
+    return this->getState() == State::Ready;
+}
+
+bool vgl::PipelineHandle::hasFailed() const {
+    return this->getState() == State::Failed;
+}
+
+VkPipeline vgl::PipelineHandle::get(VkPipeline _placeholder) const {
+    return this->isReady() ? this->pipeline : _placeholder;
+}
+
+VkPipelineLayout vgl::PipelineHandle::getLayout() const {
+    return this->layout;
+}
+
+VkPipelineBindPoint vgl::PipelineHandle::getBindPoint() const {
+    return this->bindPoint;
+}
+
+bool vgl::PipelineHandle::bind(VkCommandBuffer commandBuffer, const PipelineHandle* _placeholder) const {
+    VkPipeline placeholderPipeline = _placeholder ? _placeholder->get() : VK_NULL_HANDLE;
+    VkPipeline bound = this->get(placeholderPipeline);
+    if (bound == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    vkCmdBindPipeline(commandBuffer, this->bindPoint, bound);
+    return true;
+}
+
+void vgl::PipelineHandle::wait() const {
+    if (this->done.valid()) {
+        this->done.wait();
+    }
+}
+
+const std::string& vgl::PipelineHandle::getError() const {
+    return this->error;
+}
+
+double vgl::PipelineHandle::getCompileMs() const {
+    return this->compileMs;
+}
+
+vgl::PipelineCompiler::PipelineCompiler(VkDevice _device, vgl::PipelineCache* _pipelineCache, vgl::ShaderCache* _shaderCache, vgl::JobSystem* _jobSystem,
+    bool _dynamicRendering)
+    : device(_device),
+    pipelineCache(_pipelineCache),
+    shaderCache(_shaderCache),
+    jobSystem(_jobSystem),
+    dynamicRendering(_dynamicRendering)
+{
+}
+
+vgl::PipelineCompiler::~PipelineCompiler() {
+    //Jobs reference the compiler, so they have to finish before anything is destroyed
+    this->waitIdle();
+
+    for (const auto& handle : this->handles) {
+        if (handle->pipeline) { vkDestroyPipeline(this->device, handle->pipeline, vgl::HostAllocator::callbacks()); }
+        if (handle->layout) { vkDestroyPipelineLayout(this->device, handle->layout, vgl::HostAllocator::callbacks()); }
+    }
+}
+
+template <typename Desc>
+void vgl::PipelineCompiler::submit(const std::shared_ptr<vgl::PipelineHandle>& _handle, Desc _desc) {
+    //The compiler keeps the handle alive and waits for every job before it is destroyed, so the job can hold raw pointers
+    vgl::PipelineHandle* handle = _handle.get();
+    std::future<void> future = this->jobSystem->submit([this, handle, desc = std::move(_desc)]() {
+        auto start = std::chrono::steady_clock::now();
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = this->build(desc, handle->layout);
+        }
+        catch (const std::exception& e) {
+            handle->error = e.what();
+        }
+        handle->compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        this->pipelineCache->recordCreation(handle->compileMs);
+
+        handle->pipeline = pipeline;
+        handle->state.store(pipeline ? PipelineHandle::State::Ready : PipelineHandle::State::Failed, std::memory_order_release);
+    });
+    _handle->done = future.share();
+
+    //Only tracked once the future is set, so waitIdle never sees a handle without one
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->handles.push_back(_handle);
+}
+
+std::shared_ptr<vgl::PipelineHandle> vgl::PipelineCompiler::compile(vgl::ComputePipelineDesc _desc) {
+    if (_desc.shader) {
+        if (_desc.shader->getStage() != VK_SHADER_STAGE_COMPUTE_BIT) {
+            throw std::runtime_error("COMPUTE PIPELINE SHADER IS NOT A COMPUTE SHADER");
+        }
+        if (_desc.setLayouts.empty() && _desc.pushConstantRanges.empty() && this->shaderCache) {
+            const vgl::ShaderLayout& layout = this->shaderCache->getLayout({ _desc.shader });
+            _desc.setLayouts = layout.setLayouts;
+            _desc.pushConstantRanges = layout.pushConstantRanges;
+        }
+    }
+    //SPIR-V is made of 32 bit words
+    else if (_desc.spirv.empty() || _desc.spirv.size() % 4 != 0) {
+        throw std::runtime_error("INVALID COMPUTE SHADER CODE");
+    }
+
+    auto handle = this->createHandle(VK_PIPELINE_BIND_POINT_COMPUTE, _desc.setLayouts, _desc.pushConstantRanges);
+    this->submit(handle, std::move(_desc));
+    return handle;
+}
+
+std::shared_ptr<vgl::PipelineHandle> vgl::PipelineCompiler::compile(vgl::GraphicsPipelineDesc _desc) {
+    if (_desc.stages.empty()) {
+        throw std::runtime_error("GRAPHICS PIPELINE HAS NO SHADER STAGES");
+    }
+    std::vector<std::shared_ptr<const vgl::Shader>> shaders;
+    for (auto& stage : _desc.stages) {
+        if (stage.shader) {
+            stage.stage = stage.shader->getStage();
+            stage.entryPoint = stage.shader->getReflection().entryPoint;
+            shaders.push_back(stage.shader);
+        }
+        else if (stage.spirv.empty() || stage.spirv.size() % 4 != 0) {
+            throw std::runtime_error("INVALID GRAPHICS SHADER CODE");
+        }
+    }
+    //Layouts can only be reflected when every stage's interface is known
+    if (shaders.size() == _desc.stages.size() && _desc.setLayouts.empty() && _desc.pushConstantRanges.empty() && this->shaderCache) {
+        const vgl::ShaderLayout& layout = this->shaderCache->getLayout(shaders);
+        _desc.setLayouts = layout.setLayouts;
+        _desc.pushConstantRanges = layout.pushConstantRanges;
+    }
+    if (_desc.renderPass == VK_NULL_HANDLE && !this->dynamicRendering) {
+        throw std::runtime_error("GRAPHICS PIPELINE WITHOUT A RENDER PASS REQUIRES DYNAMIC RENDERING");
+    }
+
+    auto handle = this->createHandle(VK_PIPELINE_BIND_POINT_GRAPHICS, _desc.setLayouts, _desc.pushConstantRanges);
+    this->submit(handle, std::move(_desc));
+    return handle;
+}
+
+void vgl::PipelineCompiler::release(const std::shared_ptr<vgl::PipelineHandle>& _handle) {
+    if (!_handle) { return; }
+    _handle->wait();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = std::find(this->handles.begin(), this->handles.end(), _handle);
+        if (it == this->handles.end()) { return; }
+        this->handles.erase(it);
+    }
+
+    if (_handle->pipeline) { vkDestroyPipeline(this->device, _handle->pipeline, vgl::HostAllocator::callbacks()); }
+    if (_handle->layout) { vkDestroyPipelineLayout(this->device, _handle->layout, vgl::HostAllocator::callbacks()); }
+    _handle->pipeline = VK_NULL_HANDLE;
+    _handle->layout = VK_NULL_HANDLE;
+    _handle->error = "RELEASED";
+    _handle->state.store(PipelineHandle::State::Failed, std::memory_order_release);
+}
+
+void vgl::PipelineCompiler::waitIdle() {
+    std::vector<std::shared_ptr<vgl::PipelineHandle>> pending;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        pending = this->handles;
+    }
+    for (const auto& handle : pending) {
+        handle->wait();
+    }
+}
+
+uint32_t vgl::PipelineCompiler::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return static_cast<uint32_t>(std::count_if(this->handles.begin(), this->handles.end(),
+        [](const std::shared_ptr<vgl::PipelineHandle>& handle) { return handle->getState() == PipelineHandle::State::Pending; }));
+}
+
+std::shared_ptr<vgl::PipelineHandle> vgl::PipelineCompiler::createHandle(VkPipelineBindPoint _bindPoint, const std::vector<VkDescriptorSetLayout>& _setLayouts,
+    const std::vector<VkPushConstantRange>& _pushConstantRanges) {
+    auto handle = std::make_shared<vgl::PipelineHandle>();
+    handle->bindPoint = _bindPoint;
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = static_cast<uint32_t>(_setLayouts.size());
+    layoutInfo.pSetLayouts = _setLayouts.data();
+    layoutInfo.pushConstantRangeCount = static_cast<uint32_t>(_pushConstantRanges.size());
+    layoutInfo.pPushConstantRanges = _pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(this->device, &layoutInfo, vgl::HostAllocator::callbacks(), &handle->layout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE PIPELINE LAYOUT");
+    }
+    return handle;
+}
+
+VkShaderModule vgl::PipelineCompiler::createShaderModule(const std::vector<char>& _spirv) const {
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = _spirv.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(_spirv.data());
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(this->device, &moduleInfo, vgl::HostAllocator::callbacks(), &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE SHADER MODULE");
+    }
+    return shaderModule;
+}
+
+VkPipeline vgl::PipelineCompiler::build(const vgl::ComputePipelineDesc& _desc, VkPipelineLayout _layout) const {
+    //Modules from the shader cache stay owned by it
+    VkShaderModule shaderModule = _desc.shader ? _desc.shader->getModule() : this->createShaderModule(_desc.spirv);
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(_desc.specialization.entries.size());
+    specializationInfo.pMapEntries = _desc.specialization.entries.data();
+    specializationInfo.dataSize = _desc.specialization.data.size();
+    specializationInfo.pData = _desc.specialization.data.data();
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    //SPIR-V given directly is assumed to use main, a cached shader knows its own entry point
+    pipelineInfo.stage.pName = _desc.shader ? _desc.shader->getReflection().entryPoint.c_str() : "main";
+    pipelineInfo.stage.pSpecializationInfo = _desc.specialization.entries.empty() ? nullptr : &specializationInfo;
+    pipelineInfo.layout = _layout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = vkCreateComputePipelines(this->device, this->pipelineCache->getCache(), 1, &pipelineInfo, vgl::HostAllocator::callbacks(), &pipeline);
+
+    //The module is only needed while the pipeline is created
+    if (!_desc.shader) {
+        vkDestroyShaderModule(this->device, shaderModule, vgl::HostAllocator::callbacks());
+    }
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE COMPUTE PIPELINE");
+    }
+    return pipeline;
+}
+
+VkPipeline vgl::PipelineCompiler::build(const vgl::GraphicsPipelineDesc& _desc, VkPipelineLayout _layout) const {
+    size_t stageCount = _desc.stages.size();
+    std::vector<VkShaderModule> modules(stageCount, VK_NULL_HANDLE);
+    std::vector<VkSpecializationInfo> specializationInfos(stageCount);
+    std::vector<VkPipelineShaderStageCreateInfo> stageInfos(stageCount);
+
+    //Modules from the shader cache stay owned by it
+    auto destroyModules = [this, &modules, &_desc]() {
+        for (size_t i = 0; i < modules.size(); i++) {
+            if (modules[i] && !_desc.stages[i].shader) { vkDestroyShaderModule(this->device, modules[i], vgl::HostAllocator::callbacks()); }
+        }
+    };
+
+    for (size_t i = 0; i < stageCount; i++) {
+        const auto& stage = _desc.stages[i];
+        try {
+            modules[i] = stage.shader ? stage.shader->getModule() : this->createShaderModule(stage.spirv);
+        }
+        catch (...) {
+            destroyModules();
+            throw;
+        }
+
+        specializationInfos[i].mapEntryCount = static_cast<uint32_t>(stage.specialization.entries.size());
+        specializationInfos[i].pMapEntries = stage.specialization.entries.data();
+        specializationInfos[i].dataSize = stage.specialization.data.size();
+        specializationInfos[i].pData = stage.specialization.data.data();
+
+        stageInfos[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfos[i].stage = stage.stage;
+        stageInfos[i].module = modules[i];
+        stageInfos[i].pName = stage.entryPoint.c_str();
+        stageInfos[i].pSpecializationInfo = stage.specialization.entries.empty() ? nullptr : &specializationInfos[i];
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(_desc.vertexBindings.size());
+    vertexInput.pVertexBindingDescriptions = _desc.vertexBindings.data();
+    vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(_desc.vertexAttributes.size());
+    vertexInput.pVertexAttributeDescriptions = _desc.vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = _desc.topology;
+
+    //Viewport and scissor are set when recording so one pipeline works for any target size
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = _desc.polygonMode;
+    rasterizer.cullMode = _desc.cullMode;
+    rasterizer.frontFace = _desc.frontFace;
+    rasterizer.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = _desc.samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = _desc.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = _desc.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = _desc.depthCompare;
+
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blendAttachment.blendEnable = _desc.blendEnable ? VK_TRUE : VK_FALSE;
+    blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    //Render passes don't say how many attachments a subpass has here, so assume one when the formats aren't given
+    size_t attachmentCount = std::max<size_t>(_desc.colorFormats.size(), _desc.renderPass ? 1 : 0);
+    std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(attachmentCount, blendAttachment);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+    colorBlending.pAttachments = blendAttachments.data();
+
+    const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(_desc.colorFormats.size());
+    renderingInfo.pColorAttachmentFormats = _desc.colorFormats.data();
+    renderingInfo.depthAttachmentFormat = _desc.depthFormat;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = _desc.renderPass ? nullptr : &renderingInfo;
+    pipelineInfo.stageCount = static_cast<uint32_t>(stageInfos.size());
+    pipelineInfo.pStages = stageInfos.data();
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = _layout;
+    pipelineInfo.renderPass = _desc.renderPass;
+    pipelineInfo.subpass = _desc.subpass;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = vkCreateGraphicsPipelines(this->device, this->pipelineCache->getCache(), 1, &pipelineInfo, vgl::HostAllocator::callbacks(), &pipeline);
+
+    destroyModules();
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE GRAPHICS PIPELINE");
+    }
+    return pipeline;
+}
@@ -0,0 +1,412 @@
+#include "vgl/QueueScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+
+namespace {
+
+    //Synchronization2 stages that exist in VkPipelineStageFlags keep their bit, the rest have no equivalent and wait on everything
+    VkPipelineStageFlags toLegacyStage(VkPipelineStageFlags2 stage) {
+        if (stage == VK_PIPELINE_STAGE_2_NONE || (stage >> 32) != 0) {
+            return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        }
+        return static_cast<VkPipelineStageFlags>(stage);
+    }
+
+    //Arrays vkQueueSubmit needs for one submission, kept alive until the call returns
+    struct LegacySubmit {
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkSemaphore> signalSemaphores;
+        std::vector<uint64_t> signalValues;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    };
+
+}
+
+vgl::QueueScheduler::QueueScheduler(VkDevice _device, const vgl::QueueFamilyIndices& _indices, VkQueue _graphicsQueue, VkQueue _computeQueue,
+    VkQueue _transferQueue, VkQueue _presentQueue, bool _synchronization2)
+    : device(_device),
+    synchronization2(_synchronization2)
+{
+    uint32_t graphicsFamily = _indices.graphicsFamily.value();
+    this->lanes[static_cast<uint32_t>(vgl::QueueType::Graphics)].queue = _graphicsQueue;
+    this->lanes[static_cast<uint32_t>(vgl::QueueType::Graphics)].family = graphicsFamily;
+    this->lanes[static_cast<uint32_t>(vgl::QueueType::Compute)].queue = _computeQueue;
+    this->lanes[static_cast<uint32_t>(vgl::QueueType::Compute)].family = _indices.computeFamily.value_or(graphicsFamily);
+    this->lanes[static_cast<uint32_t>(vgl::QueueType::Transfer)].queue = _transferQueue;
+    this->lanes[static_cast<uint32_t>(vgl::QueueType::Transfer)].family = _indices.transferFamily.value_or(graphicsFamily);
+
+    //Present usually shares the graphics queue, include it so presenting can be serialised with submits
+    for (VkQueue queue : { _graphicsQueue, _computeQueue, _transferQueue, _presentQueue }) {
+        if (queue == VK_NULL_HANDLE) { continue; }
+        bool known = std::any_of(this->queueMutexes.begin(), this->queueMutexes.end(), [queue](const auto& entry) { return entry.first == queue; });
+        if (!known) {
+            this->queueMutexes.emplace_back(queue, std::make_unique<std::mutex>());
+        }
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    for (auto& lane : this->lanes) {
+        lane.queueMutex = &this->getQueueMutex(lane.queue);
+        if (vkCreateSemaphore(this->device, &semaphoreInfo, vgl::HostAllocator::callbacks(), &lane.timeline) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE QUEUE TIMELINE SEMAPHORE");
+        }
+    }
+}
+
+vgl::QueueScheduler::~QueueScheduler() {
+    this->waitIdle();
+
+    for (auto& lane : this->lanes) {
+        vkDestroySemaphore(this->device, lane.timeline, vgl::HostAllocator::callbacks());
+    }
+}
+
+vgl::QueuePoint vgl::QueueScheduler::submit(vgl::QueueType queue, const vgl::QueueSubmission& submission) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    uint32_t laneIndex = static_cast<uint32_t>(queue);
+    Lane& lane = this->lanes[laneIndex];
+
+    Pending pending;
+    pending.value = lane.assignedValue + 1;
+
+    for (VkCommandBuffer commandBuffer : submission.commandBuffers) {
+        VkCommandBufferSubmitInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        info.commandBuffer = commandBuffer;
+        pending.commandBuffers.push_back(info);
+    }
+
+    auto addWait = [&](VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stage) {
+        VkSemaphoreSubmitInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        info.semaphore = semaphore;
+        info.value = value;
+        info.stageMask = stage;
+        pending.waits.push_back(info);
+    };
+
+    auto addQueueWait = [&](const vgl::QueueWait& wait) {
+        //Value 0 is always reached, and earlier points on the same queue are submitted first anyway
+        if (wait.point.value == 0) { return; }
+        uint32_t waitLane = static_cast<uint32_t>(wait.point.queue);
+        if (wait.point.value > this->lanes[waitLane].assignedValue) {
+            throw std::runtime_error("QUEUE SUBMISSION WAITS ON A POINT THAT HAS NOT BEEN SUBMITTED");
+        }
+        addWait(this->lanes[waitLane].timeline, wait.point.value, wait.stage);
+        if (waitLane != laneIndex) {
+            pending.dependencies.push_back(wait.point);
+        }
+    };
+
+    for (const auto& wait : submission.waits) {
+        addQueueWait(wait);
+    }
+    for (const auto& wait : submission.semaphoreWaits) {
+        //Callers holding only the semaphore (e.g. from FrameRenderer::getTimelineSemaphore) still get their dependency flushed first
+        auto owner = std::find_if(this->lanes.begin(), this->lanes.end(), [&wait](const Lane& l) { return l.timeline == wait.semaphore; });
+        if (owner != this->lanes.end()) {
+            addQueueWait({ { static_cast<vgl::QueueType>(owner - this->lanes.begin()), wait.value }, wait.stage });
+        }
+        else {
+            addWait(wait.semaphore, wait.value, wait.stage);
+        }
+    }
+
+    VkSemaphoreSubmitInfo timelineSignal{};
+    timelineSignal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    timelineSignal.semaphore = lane.timeline;
+    timelineSignal.value = pending.value;
+    timelineSignal.stageMask = submission.signalStage;
+    pending.signals.push_back(timelineSignal);
+
+    for (const auto& signal : submission.semaphoreSignals) {
+        VkSemaphoreSubmitInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        info.semaphore = signal.semaphore;
+        info.value = signal.value;
+        info.stageMask = signal.stage;
+        pending.signals.push_back(info);
+    }
+
+    lane.assignedValue = pending.value;
+    lane.pending.push_back(std::move(pending));
+    this->stats.submissions++;
+
+    return { queue, lane.assignedValue };
+}
+
+vgl::QueuePoint vgl::QueueScheduler::submit(vgl::QueueType queue, VkCommandBuffer commandBuffer, const std::vector<vgl::QueueWait>& waits) {
+    vgl::QueueSubmission submission;
+    submission.commandBuffers.push_back(commandBuffer);
+    submission.waits = waits;
+    return this->submit(queue, submission);
+}
+
+void vgl::QueueScheduler::flush(vgl::QueueType queue) {
+    VGL_PROFILE_SCOPE("QueueScheduler::flush");
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->flushLane(static_cast<uint32_t>(queue), UINT64_MAX);
+}
+
+void vgl::QueueScheduler::flush() {
+    VGL_PROFILE_SCOPE("QueueScheduler::flush");
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (uint32_t i = 0; i < queueTypeCount; i++) {
+        this->flushLane(i, UINT64_MAX);
+    }
+}
+
+bool vgl::QueueScheduler::isComplete(const vgl::QueuePoint& point) const {
+    return point.value <= this->getCompletedValue(point.queue);
+}
+
+bool vgl::QueueScheduler::wait(const vgl::QueuePoint& point, uint64_t timeoutNs) {
+    return this->wait(std::vector<vgl::QueuePoint>{ point }, timeoutNs);
+}
+
+bool vgl::QueueScheduler::wait(const std::vector<vgl::QueuePoint>& points, uint64_t timeoutNs) {
+    //Only the furthest point on each queue matters
+    std::array<uint64_t, queueTypeCount> values{};
+    for (const auto& point : points) {
+        uint32_t lane = static_cast<uint32_t>(point.queue);
+        values[lane] = std::max(values[lane], point.value);
+    }
+
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> waitValues;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (uint32_t i = 0; i < queueTypeCount; i++) {
+            if (values[i] == 0) { continue; }
+            if (values[i] > this->lanes[i].assignedValue) {
+                throw std::runtime_error("WAITING ON A QUEUE POINT THAT HAS NOT BEEN SUBMITTED");
+            }
+            //Waiting on work that was never submitted would block forever
+            if (values[i] > this->lanes[i].submittedValue) {
+                this->flushLane(i, values[i]);
+            }
+            semaphores.push_back(this->lanes[i].timeline);
+            waitValues.push_back(values[i]);
+        }
+    }
+    if (semaphores.empty()) { return true; }
+
+    //Polling first keeps the stats to waits that actually blocked
+    bool reached = true;
+    for (size_t i = 0; i < semaphores.size() && reached; i++) {
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(this->device, semaphores[i], &completed);
+        reached = completed >= waitValues[i];
+    }
+    if (reached) { return true; }
+
+    VGL_PROFILE_SCOPE("QueueScheduler::wait");
+    auto start = std::chrono::steady_clock::now();
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+    waitInfo.pSemaphores = semaphores.data();
+    waitInfo.pValues = waitValues.data();
+    VkResult result = vkWaitSemaphores(this->device, &waitInfo, timeoutNs);
+
+    double waitedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stats.cpuWaits++;
+        this->stats.cpuWaitMs += waitedMs;
+    }
+
+    if (result == VK_TIMEOUT) { return false; }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO WAIT FOR QUEUE TIMELINE");
+    }
+    return true;
+}
+
+void vgl::QueueScheduler::waitIdle() {
+    std::vector<vgl::QueuePoint> points;
+    for (uint32_t i = 0; i < queueTypeCount; i++) {
+        points.push_back(this->getLastPoint(static_cast<vgl::QueueType>(i)));
+    }
+    this->wait(points);
+}
+
+void vgl::QueueScheduler::deviceWaitIdle() {
+    this->flush();
+
+    //Queue mutexes are never held while taking another, so taking all of them in a fixed order can't deadlock
+    std::vector<std::unique_lock<std::mutex>> queueLocks;
+    for (auto& entry : this->queueMutexes) {
+        queueLocks.emplace_back(*entry.second);
+    }
+    if (vkDeviceWaitIdle(this->device) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO WAIT FOR THE DEVICE TO BE IDLE");
+    }
+}
+
+uint64_t vgl::QueueScheduler::getCompletedValue(vgl::QueueType queue) const {
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(this->device, this->lanes[static_cast<uint32_t>(queue)].timeline, &completed);
+    return completed;
+}
+
+vgl::QueuePoint vgl::QueueScheduler::getLastPoint(vgl::QueueType queue) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return { queue, this->lanes[static_cast<uint32_t>(queue)].assignedValue };
+}
+
+VkSemaphore vgl::QueueScheduler::getSemaphore(vgl::QueueType queue) const {
+    return this->lanes[static_cast<uint32_t>(queue)].timeline;
+}
+
+VkQueue vgl::QueueScheduler::getQueue(vgl::QueueType queue) const {
+    return this->lanes[static_cast<uint32_t>(queue)].queue;
+}
+
+uint32_t vgl::QueueScheduler::getQueueFamily(vgl::QueueType queue) const {
+    return this->lanes[static_cast<uint32_t>(queue)].family;
+}
+
+std::mutex& vgl::QueueScheduler::getQueueMutex(VkQueue queue) {
+    for (auto& [known, queueMutex] : this->queueMutexes) {
+        if (known == queue) { return *queueMutex; }
+    }
+    throw std::runtime_error("QUEUE WAS NOT CREATED WITH THE DEVICE");
+}
+
+vgl::QueueScheduler::Stats vgl::QueueScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void vgl::QueueScheduler::printStats() const {
+    Stats current = this->getStats();
+    double perBatch = current.batches > 0 ? static_cast<double>(current.submissions) / static_cast<double>(current.batches) : 0.0;
+
+    std::ostringstream line;
+    line << "Queue scheduler: " << current.submissions << " submissions in " << current.batches << " batches (" << perBatch << " per batch), "
+        << current.cpuWaits << " CPU waits totalling " << current.cpuWaitMs << "ms";
+    vgl::Logger::get().log(vgl::LogLevel::Info, "QueueScheduler", line.str());
+}
+
+void vgl::QueueScheduler::flushLane(uint32_t laneIndex, uint64_t value) {
+    Lane& lane = this->lanes[laneIndex];
+
+    std::vector<Pending> batch;
+    while (!lane.pending.empty() && lane.pending.front().value <= value) {
+        std::vector<vgl::QueuePoint> unsubmitted;
+        for (const auto& dependency : lane.pending.front().dependencies) {
+            if (dependency.value > this->lanes[static_cast<uint32_t>(dependency.queue)].submittedValue) {
+                unsubmitted.push_back(dependency);
+            }
+        }
+
+        //Points are handed out in the order submit is called, so the work waited on can only itself wait on what is already in the batch
+        //Send that first, then the dependencies, so no batch waits on work that hasn't been submitted
+        if (!unsubmitted.empty()) {
+            this->submitBatch(laneIndex, batch);
+            for (const auto& dependency : unsubmitted) {
+                this->flushLane(static_cast<uint32_t>(dependency.queue), dependency.value);
+            }
+        }
+
+        batch.push_back(std::move(lane.pending.front()));
+        lane.pending.pop_front();
+    }
+    this->submitBatch(laneIndex, batch);
+}
+
+void vgl::QueueScheduler::submitBatch(uint32_t laneIndex, std::vector<Pending>& batch) {
+    if (batch.empty()) { return; }
+    Lane& lane = this->lanes[laneIndex];
+
+    VkResult result = VK_SUCCESS;
+    {
+        std::lock_guard<std::mutex> queueLock(*lane.queueMutex);
+        if (this->synchronization2) {
+            std::vector<VkSubmitInfo2> submits(batch.size());
+            for (size_t i = 0; i < batch.size(); i++) {
+                submits[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+                submits[i].waitSemaphoreInfoCount = static_cast<uint32_t>(batch[i].waits.size());
+                submits[i].pWaitSemaphoreInfos = batch[i].waits.data();
+                submits[i].commandBufferInfoCount = static_cast<uint32_t>(batch[i].commandBuffers.size());
+                submits[i].pCommandBufferInfos = batch[i].commandBuffers.data();
+                submits[i].signalSemaphoreInfoCount = static_cast<uint32_t>(batch[i].signals.size());
+                submits[i].pSignalSemaphoreInfos = batch[i].signals.data();
+            }
+            result = vkQueueSubmit2(lane.queue, static_cast<uint32_t>(submits.size()), submits.data(), VK_NULL_HANDLE);
+        }
+        else {
+            result = this->submitLegacy(lane.queue, batch);
+        }
+    }
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO SUBMIT QUEUE BATCH");
+    }
+
+    lane.submittedValue = batch.back().value;
+    this->stats.batches++;
+    batch.clear();
+}
+
+VkResult vgl::QueueScheduler::submitLegacy(VkQueue queue, const std::vector<Pending>& batch) {
+    //Sized up front, the submit infos point into the elements
+    std::vector<LegacySubmit> legacy(batch.size());
+    std::vector<VkSubmitInfo> submits(batch.size());
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        LegacySubmit& arrays = legacy[i];
+        for (const auto& commandBuffer : batch[i].commandBuffers) {
+            arrays.commandBuffers.push_back(commandBuffer.commandBuffer);
+        }
+        for (const auto& wait : batch[i].waits) {
+            arrays.waitSemaphores.push_back(wait.semaphore);
+            arrays.waitValues.push_back(wait.value);
+            arrays.waitStages.push_back(toLegacyStage(wait.stageMask));
+        }
+        //Signals can't be limited to a stage without synchronization2, they happen once the whole batch has finished
+        for (const auto& signal : batch[i].signals) {
+            arrays.signalSemaphores.push_back(signal.semaphore);
+            arrays.signalValues.push_back(signal.value);
+        }
+
+        arrays.timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        arrays.timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(arrays.waitValues.size());
+        arrays.timelineInfo.pWaitSemaphoreValues = arrays.waitValues.data();
+        arrays.timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(arrays.signalValues.size());
+        arrays.timelineInfo.pSignalSemaphoreValues = arrays.signalValues.data();
+
+        submits[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submits[i].pNext = &arrays.timelineInfo;
+        submits[i].waitSemaphoreCount = static_cast<uint32_t>(arrays.waitSemaphores.size());
+        submits[i].pWaitSemaphores = arrays.waitSemaphores.data();
+        submits[i].pWaitDstStageMask = arrays.waitStages.data();
+        submits[i].commandBufferCount = static_cast<uint32_t>(arrays.commandBuffers.size());
+        submits[i].pCommandBuffers = arrays.commandBuffers.data();
+        submits[i].signalSemaphoreCount = static_cast<uint32_t>(arrays.signalSemaphores.size());
+        submits[i].pSignalSemaphores = arrays.signalSemaphores.data();
+    }
+
+    return vkQueueSubmit(queue, static_cast<uint32_t>(submits.size()), submits.data(), VK_NULL_HANDLE);
+}
@@ -0,0 +1,570 @@
+#include "vgl/RenderGraph.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::RenderGraph::PassBuilder::PassBuilder(RenderGraph* _graph, uint32_t _pass)
+    : graph(_graph),
+    pass(_pass)
+{
+}
+
+void vgl::RenderGraph::PassBuilder::read(vgl::RenderGraphResource resource, vgl::RenderGraphAccess access) {
+    if (vgl::RenderGraphSolver::getAccessInfo(access).write) {
+        throw std::runtime_error("RENDER GRAPH READ DECLARED WITH A WRITE ACCESS");
+    }
+    this->graph->addUse(this->pass, resource, access);
+}
+
+void vgl::RenderGraph::PassBuilder::write(vgl::RenderGraphResource resource, vgl::RenderGraphAccess access) {
+    if (!vgl::RenderGraphSolver::getAccessInfo(access).write) {
+        throw std::runtime_error("RENDER GRAPH WRITE DECLARED WITH A READ ACCESS");
+    }
+    this->graph->addUse(this->pass, resource, access);
+}
+
+void vgl::RenderGraph::PassBuilder::setSideEffects() {
+    this->graph->passes[this->pass].pass.sideEffects = true;
+}
+
+VkImage vgl::RenderGraph::PassContext::getImage(vgl::RenderGraphResource resource) const {
+    return this->graph->resources.at(resource.index).vkImage;
+}
+
+VkImageView vgl::RenderGraph::PassContext::getImageView(vgl::RenderGraphResource resource) const {
+    return this->graph->resources.at(resource.index).view;
+}
+
+VkExtent2D vgl::RenderGraph::PassContext::getExtent(vgl::RenderGraphResource resource) const {
+    const auto& entry = this->graph->resources.at(resource.index);
+    return entry.imported ? entry.importedImage.extent : entry.texture.extent;
+}
+
+VkBuffer vgl::RenderGraph::PassContext::getBuffer(vgl::RenderGraphResource resource) const {
+    return this->graph->resources.at(resource.index).vkBuffer;
+}
+
+vgl::RenderGraph::RenderGraph(vgl::LogicalDevice* _logicalDevice, uint32_t _framesInFlight)
+    : logicalDevice(_logicalDevice),
+    framesInFlight(_framesInFlight)
+{
+}
+
+vgl::RenderGraph::~RenderGraph() {
+    for (auto& [frame, old] : this->retired) {
+        this->destroyPhysical(old);
+    }
+    this->destroyPhysical(this->physical);
+}
+
+void vgl::RenderGraph::beginFrame() {
+    this->frameNumber++;
+
+    //Anything replaced framesInFlight frames ago can no longer be in use by the GPU
+    auto it = this->retired.begin();
+    while (it != this->retired.end()) {
+        if (this->frameNumber - it->first >= this->framesInFlight) {
+            this->destroyPhysical(it->second);
+            it = this->retired.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void vgl::RenderGraph::reset() {
+    this->resources.clear();
+    this->passes.clear();
+    this->compiled = false;
+}
+
+vgl::RenderGraphResource vgl::RenderGraph::createTexture(const std::string& name, const TextureDesc& desc) {
+    ResourceEntry entry;
+    entry.name = name;
+    entry.image = true;
+    entry.texture = desc;
+    entry.aspect = aspectFor(desc.format);
+    entry.imageUsage = desc.extraUsage;
+    return this->addResource(std::move(entry));
+}
+
+vgl::RenderGraphResource vgl::RenderGraph::createBuffer(const std::string& name, const BufferDesc& desc) {
+    ResourceEntry entry;
+    entry.name = name;
+    entry.image = false;
+    entry.buffer = desc;
+    entry.bufferSize = desc.size;
+    entry.bufferUsage = desc.extraUsage;
+    return this->addResource(std::move(entry));
+}
+
+vgl::RenderGraphResource vgl::RenderGraph::importImage(const std::string& name, const ImportedImage& image) {
+    ResourceEntry entry;
+    entry.name = name;
+    entry.image = true;
+    entry.imported = true;
+    entry.importedImage = image;
+    entry.aspect = aspectFor(image.format);
+    entry.vkImage = image.image;
+    entry.view = image.view;
+    return this->addResource(std::move(entry));
+}
+
+vgl::RenderGraphResource vgl::RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size) {
+    ResourceEntry entry;
+    entry.name = name;
+    entry.image = false;
+    entry.imported = true;
+    entry.vkBuffer = buffer;
+    entry.bufferSize = size;
+    return this->addResource(std::move(entry));
+}
+
+vgl::RenderGraphResource vgl::RenderGraph::importFrame(const vgl::FrameContext& frame) {
+    //FrameRenderer hands the image out cleared in COLOR_ATTACHMENT_OPTIMAL and transitions it from there after recording
+    ImportedImage image;
+    image.image = frame.image;
+    image.view = frame.imageView;
+    image.format = frame.format;
+    image.extent = frame.extent;
+    image.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    image.initialStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    image.initialAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    image.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    image.finalStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    image.finalAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    vgl::RenderGraphResource resource = this->importImage("frame", image);
+    this->markOutput(resource);
+    return resource;
+}
+
+void vgl::RenderGraph::markOutput(vgl::RenderGraphResource resource) {
+    this->resources.at(resource.index).output = true;
+    this->compiled = false;
+}
+
+void vgl::RenderGraph::addPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute) {
+    PassEntry entry;
+    entry.name = name;
+    entry.execute = execute;
+    this->passes.push_back(std::move(entry));
+    this->compiled = false;
+
+    PassBuilder builder(this, static_cast<uint32_t>(this->passes.size() - 1));
+    setup(builder);
+}
+
+void vgl::RenderGraph::compile() {
+    std::vector<uint64_t> descKey = this->buildKey();
+
+    //Memory requirements only depend on the create info, so new resources are only needed to query them when the declarations change
+    Physical candidate;
+    std::vector<uint32_t> candidateSlots;
+    bool haveCandidate = false;
+    if (descKey != this->requirementsKey) {
+        this->requirements = this->createTransients(candidate, candidateSlots);
+        this->requirementsKey = descKey;
+        haveCandidate = true;
+    }
+
+    std::vector<vgl::RenderGraphSolver::Resource> solverResources(this->resources.size());
+    for (size_t r = 0; r < this->resources.size(); r++) {
+        const ResourceEntry& entry = this->resources[r];
+        auto& resource = solverResources[r];
+        resource.image = entry.image;
+        resource.imported = entry.imported;
+        resource.output = entry.output;
+        resource.requirements = this->requirements[r];
+
+        if (entry.imported && entry.image) {
+            resource.initialLayout = entry.importedImage.initialLayout;
+            resource.initialStages = entry.importedImage.initialStages;
+            resource.initialAccess = entry.importedImage.initialAccess;
+            resource.finalLayout = entry.importedImage.finalLayout;
+            resource.finalStages = entry.importedImage.finalStages;
+            resource.finalAccess = entry.importedImage.finalAccess;
+        }
+    }
+
+    std::vector<vgl::RenderGraphSolver::Pass> solverPasses;
+    solverPasses.reserve(this->passes.size());
+    for (const auto& pass : this->passes) {
+        solverPasses.push_back(pass.pass);
+    }
+
+    this->solution = vgl::RenderGraphSolver::solve(solverResources, solverPasses);
+
+    //Physical resources can be reused if the declarations and where they were placed are the same as last time
+    std::vector<uint64_t> key = descKey;
+    for (const auto& placement : this->solution.placements) {
+        key.push_back(placement.heap);
+        key.push_back(placement.offset);
+    }
+    for (const auto& heap : this->solution.heaps) {
+        key.push_back(heap.size);
+    }
+
+    if (key == this->physicalKey) {
+        if (haveCandidate) { this->destroyPhysical(candidate); }
+    }
+    else {
+        if (!haveCandidate) { this->createTransients(candidate, candidateSlots); }
+        this->bindTransients(candidate, candidateSlots);
+
+        this->retired.emplace_back(this->frameNumber, std::move(this->physical));
+        this->physical = std::move(candidate);
+        this->physicalSlots = std::move(candidateSlots);
+        this->physicalKey = std::move(key);
+        this->stats.reallocations++;
+    }
+
+    for (size_t r = 0; r < this->resources.size(); r++) {
+        ResourceEntry& entry = this->resources[r];
+        uint32_t slot = this->physicalSlots[r];
+        if (entry.imported || slot == vgl::RenderGraphSolver::invalidIndex) { continue; }
+
+        if (entry.image) {
+            entry.vkImage = this->physical.images[slot];
+            entry.view = this->physical.views[slot];
+        }
+        else {
+            entry.vkBuffer = this->physical.buffers[slot];
+        }
+    }
+
+    this->stats.passes = static_cast<uint32_t>(this->passes.size());
+    this->stats.culledPasses = this->solution.culledPasses;
+    this->stats.barriers = this->solution.barrierCount;
+    this->stats.transientBytes = this->solution.transientBytes;
+    this->stats.allocatedBytes = this->solution.heapBytes;
+    this->compiled = true;
+}
+
+void vgl::RenderGraph::execute(VkCommandBuffer commandBuffer) {
+    if (!this->compiled) {
+        this->compile();
+    }
+
+    PassContext context;
+    context.commandBuffer = commandBuffer;
+    context.graph = this;
+
+    for (size_t position = 0; position < this->solution.order.size(); position++) {
+        this->recordBarriers(commandBuffer, this->solution.barriers[position]);
+
+        const PassEntry& pass = this->passes[this->solution.order[position]];
+        if (pass.execute) {
+            pass.execute(context);
+        }
+    }
+
+    this->recordBarriers(commandBuffer, this->solution.finalBarriers);
+}
+
+const vgl::RenderGraphSolver::Result& vgl::RenderGraph::getSolution() const {
+    return this->solution;
+}
+
+const vgl::RenderGraph::Stats& vgl::RenderGraph::getStats() const {
+    return this->stats;
+}
+
+std::vector<std::string> vgl::RenderGraph::getExecutionOrder() const {
+    std::vector<std::string> names;
+    for (uint32_t pass : this->solution.order) {
+        names.push_back(this->passes[pass].name);
+    }
+    return names;
+}
+
+vgl::RenderGraphResource vgl::RenderGraph::addResource(ResourceEntry entry) {
+    this->resources.push_back(std::move(entry));
+    this->compiled = false;
+    return vgl::RenderGraphResource{ static_cast<uint32_t>(this->resources.size() - 1) };
+}
+
+void vgl::RenderGraph::addUse(uint32_t pass, vgl::RenderGraphResource resource, vgl::RenderGraphAccess access) {
+    if (!resource.isValid() || resource.index >= this->resources.size()) {
+        throw std::runtime_error("INVALID RENDER GRAPH RESOURCE");
+    }
+
+    ResourceEntry& entry = this->resources[resource.index];
+    if (entry.image) {
+        VkImageUsageFlags usage = imageUsageFor(access);
+        if (usage == 0) {
+            throw std::runtime_error("RENDER GRAPH ACCESS CAN NOT BE USED WITH AN IMAGE");
+        }
+        entry.imageUsage |= usage;
+    }
+    else {
+        VkBufferUsageFlags usage = bufferUsageFor(access);
+        if (usage == 0) {
+            throw std::runtime_error("RENDER GRAPH ACCESS CAN NOT BE USED WITH A BUFFER");
+        }
+        entry.bufferUsage |= usage;
+    }
+
+    this->passes[pass].pass.uses.push_back({ resource.index, access });
+}
+
+std::vector<VkMemoryRequirements> vgl::RenderGraph::createTransients(Physical& target, std::vector<uint32_t>& slots) {
+    VkDevice device = this->logicalDevice->device;
+    std::vector<VkMemoryRequirements> requirements(this->resources.size(), VkMemoryRequirements{});
+    slots.assign(this->resources.size(), vgl::RenderGraphSolver::invalidIndex);
+
+    for (size_t r = 0; r < this->resources.size(); r++) {
+        const ResourceEntry& entry = this->resources[r];
+        //Resources no pass uses have no usage to create them with
+        if (entry.imported || (entry.image ? entry.imageUsage : entry.bufferUsage) == 0) { continue; }
+
+        if (entry.image) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = entry.texture.format;
+            imageInfo.extent = { entry.texture.extent.width, entry.texture.extent.height, 1 };
+            imageInfo.mipLevels = entry.texture.mipLevels;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = entry.texture.samples;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = entry.imageUsage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            VkImage image = VK_NULL_HANDLE;
+            if (vkCreateImage(device, &imageInfo, vgl::HostAllocator::callbacks(), &image) != VK_SUCCESS) {
+                this->destroyPhysical(target);
+                throw std::runtime_error("FAILED TO CREATE RENDER GRAPH IMAGE " + entry.name);
+            }
+            vkGetImageMemoryRequirements(device, image, &requirements[r]);
+
+            slots[r] = static_cast<uint32_t>(target.images.size());
+            target.images.push_back(image);
+            target.views.push_back(VK_NULL_HANDLE);
+        }
+        else {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = entry.buffer.size;
+            bufferInfo.usage = entry.bufferUsage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VkBuffer buffer = VK_NULL_HANDLE;
+            if (vkCreateBuffer(device, &bufferInfo, vgl::HostAllocator::callbacks(), &buffer) != VK_SUCCESS) {
+                this->destroyPhysical(target);
+                throw std::runtime_error("FAILED TO CREATE RENDER GRAPH BUFFER " + entry.name);
+            }
+            vkGetBufferMemoryRequirements(device, buffer, &requirements[r]);
+
+            slots[r] = static_cast<uint32_t>(target.buffers.size());
+            target.buffers.push_back(buffer);
+        }
+    }
+
+    return requirements;
+}
+
+void vgl::RenderGraph::bindTransients(Physical& target, const std::vector<uint32_t>& slots) {
+    VkDevice device = this->logicalDevice->device;
+    vgl::MemoryAllocator* allocator = this->logicalDevice->getAllocator();
+
+    for (const auto& heap : this->solution.heaps) {
+        VkMemoryRequirements requirements{};
+        requirements.size = heap.size;
+        requirements.alignment = heap.alignment;
+        requirements.memoryTypeBits = heap.memoryTypeBits;
+
+        vgl::MemoryAllocation allocation = allocator->allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, !heap.image);
+        if (!allocation.isValid()) {
+            this->destroyPhysical(target);
+            throw std::runtime_error("FAILED TO ALLOCATE RENDER GRAPH MEMORY");
+        }
+        target.heaps.push_back(allocation);
+    }
+
+    for (size_t r = 0; r < this->resources.size(); r++) {
+        const ResourceEntry& entry = this->resources[r];
+        const auto& placement = this->solution.placements[r];
+        //Resources only used by culled passes are never bound
+        if (slots[r] == vgl::RenderGraphSolver::invalidIndex || placement.heap == vgl::RenderGraphSolver::invalidIndex) { continue; }
+
+        const vgl::MemoryAllocation& heap = target.heaps[placement.heap];
+        if (entry.image) {
+            VkImage image = target.images[slots[r]];
+            vkBindImageMemory(device, image, heap.memory, heap.offset + placement.offset);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = entry.texture.format;
+            viewInfo.subresourceRange.aspectMask = entry.aspect;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = entry.texture.mipLevels;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device, &viewInfo, vgl::HostAllocator::callbacks(), &target.views[slots[r]]) != VK_SUCCESS) {
+                this->destroyPhysical(target);
+                throw std::runtime_error("FAILED TO CREATE RENDER GRAPH IMAGE VIEW " + entry.name);
+            }
+        }
+        else {
+            vkBindBufferMemory(device, target.buffers[slots[r]], heap.memory, heap.offset + placement.offset);
+        }
+    }
+}
+
+void vgl::RenderGraph::destroyPhysical(Physical& target) {
+    VkDevice device = this->logicalDevice->device;
+
+    for (VkImageView view : target.views) {
+        if (view) { vkDestroyImageView(device, view, vgl::HostAllocator::callbacks()); }
+    }
+    for (VkImage image : target.images) {
+        vkDestroyImage(device, image, vgl::HostAllocator::callbacks());
+    }
+    for (VkBuffer buffer : target.buffers) {
+        vkDestroyBuffer(device, buffer, vgl::HostAllocator::callbacks());
+    }
+    for (auto& heap : target.heaps) {
+        this->logicalDevice->getAllocator()->free(heap);
+    }
+    target = Physical{};
+}
+
+std::vector<uint64_t> vgl::RenderGraph::buildKey() const {
+    std::vector<uint64_t> key;
+    key.reserve(this->resources.size() * 6);
+    for (const auto& entry : this->resources) {
+        if (entry.imported) {
+            key.push_back(0);
+        }
+        else if (entry.image) {
+            key.push_back(1);
+            key.push_back(entry.texture.format);
+            key.push_back((static_cast<uint64_t>(entry.texture.extent.width) << 32) | entry.texture.extent.height);
+            key.push_back((static_cast<uint64_t>(entry.texture.mipLevels) << 32) | entry.texture.samples);
+            key.push_back(entry.imageUsage);
+        }
+        else {
+            key.push_back(2);
+            key.push_back(entry.buffer.size);
+            key.push_back(entry.bufferUsage);
+        }
+    }
+    return key;
+}
+
+void vgl::RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<vgl::RenderGraphSolver::Barrier>& barriers) const {
+    if (barriers.empty()) { return; }
+
+    //Every barrier before a pass goes into a single vkCmdPipelineBarrier
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+    for (const auto& barrier : barriers) {
+        const ResourceEntry& entry = this->resources[barrier.resource];
+        srcStages |= barrier.srcStages;
+        dstStages |= barrier.dstStages;
+
+        if (entry.image) {
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = entry.vkImage;
+            imageBarrier.subresourceRange.aspectMask = entry.aspect;
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+            imageBarriers.push_back(imageBarrier);
+        }
+        else {
+            VkBufferMemoryBarrier bufferBarrier{};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.srcAccessMask = barrier.srcAccess;
+            bufferBarrier.dstAccessMask = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = entry.vkBuffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(bufferBarrier);
+        }
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+VkImageUsageFlags vgl::RenderGraph::imageUsageFor(vgl::RenderGraphAccess access) {
+    switch (access) {
+    case vgl::RenderGraphAccess::ColorAttachmentWrite:
+    case vgl::RenderGraphAccess::ColorAttachmentReadWrite:
+        return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case vgl::RenderGraphAccess::DepthAttachmentWrite:
+    case vgl::RenderGraphAccess::DepthAttachmentRead:
+        return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case vgl::RenderGraphAccess::FragmentSampled:
+    case vgl::RenderGraphAccess::ComputeSampled:
+        return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case vgl::RenderGraphAccess::ComputeStorageRead:
+    case vgl::RenderGraphAccess::ComputeStorageWrite:
+        return VK_IMAGE_USAGE_STORAGE_BIT;
+    case vgl::RenderGraphAccess::TransferSrc:
+        return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case vgl::RenderGraphAccess::TransferDst:
+        return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    default:
+        return 0;
+    }
+}
+
+VkBufferUsageFlags vgl::RenderGraph::bufferUsageFor(vgl::RenderGraphAccess access) {
+    switch (access) {
+    case vgl::RenderGraphAccess::ComputeStorageRead:
+    case vgl::RenderGraphAccess::ComputeStorageWrite:
+        return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    case vgl::RenderGraphAccess::TransferSrc:
+        return VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    case vgl::RenderGraphAccess::TransferDst:
+        return VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    case vgl::RenderGraphAccess::VertexBuffer:
+        return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    case vgl::RenderGraphAccess::IndexBuffer:
+        return VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    case vgl::RenderGraphAccess::IndirectBuffer:
+        return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    case vgl::RenderGraphAccess::UniformBuffer:
+        return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    default:
+        return 0;
+    }
+}
+
+VkImageAspectFlags vgl::RenderGraph::aspectFor(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
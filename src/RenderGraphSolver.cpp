@@ -0,0 +1,429 @@
+#include "vgl/RenderGraphSolver.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    //Every use of one resource by one pass, merged together
+    struct MergedUse {
+        uint32_t resource = vgl::RenderGraphSolver::invalidIndex;
+        vgl::RenderGraphSolver::AccessInfo info;
+        //Whether the pass depends on the contents left by earlier passes
+        bool readsContents = false;
+    };
+
+    std::vector<MergedUse> mergeUses(const vgl::RenderGraphSolver::Pass& pass) {
+        std::vector<MergedUse> merged;
+        for (const auto& use : pass.uses) {
+            vgl::RenderGraphSolver::AccessInfo info = vgl::RenderGraphSolver::getAccessInfo(use.access);
+            bool reads = !info.write || use.access == vgl::RenderGraphAccess::ColorAttachmentReadWrite
+                || use.access == vgl::RenderGraphAccess::DepthAttachmentWrite || use.access == vgl::RenderGraphAccess::ComputeStorageWrite;
+
+            auto it = std::find_if(merged.begin(), merged.end(), [&use](const MergedUse& m) { return m.resource == use.resource; });
+            if (it == merged.end()) {
+                merged.push_back({ use.resource, info, reads });
+                continue;
+            }
+
+            //A resource used two ways at once has to be in a layout both allow
+            if (it->info.layout != info.layout) {
+                it->info.layout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+            it->info.stages |= info.stages;
+            it->info.access |= info.access;
+            it->info.write = it->info.write || info.write;
+            it->readsContents = it->readsContents || reads;
+        }
+        return merged;
+    }
+
+}
+
+vgl::RenderGraphSolver::Result vgl::RenderGraphSolver::solve(const std::vector<Resource>& resources, const std::vector<Pass>& passes) {
+    Result result;
+
+    std::vector<bool> needed = cull(resources, passes);
+    result.order = schedule(resources, passes, needed);
+    result.culledPasses = static_cast<uint32_t>(passes.size() - result.order.size());
+
+    result.firstUse.assign(resources.size(), invalidIndex);
+    result.lastUse.assign(resources.size(), invalidIndex);
+    for (uint32_t position = 0; position < result.order.size(); position++) {
+        for (const auto& use : passes[result.order[position]].uses) {
+            if (result.firstUse[use.resource] == invalidIndex) {
+                result.firstUse[use.resource] = position;
+            }
+            result.lastUse[use.resource] = position;
+        }
+    }
+
+    placeTransients(resources, result);
+    placeBarriers(resources, passes, result);
+    return result;
+}
+
+vgl::RenderGraphSolver::AccessInfo vgl::RenderGraphSolver::getAccessInfo(RenderGraphAccess access) {
+    switch (access) {
+    case RenderGraphAccess::ColorAttachmentWrite:
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+    case RenderGraphAccess::ColorAttachmentReadWrite:
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+    case RenderGraphAccess::DepthAttachmentWrite:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+    case RenderGraphAccess::DepthAttachmentRead:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false };
+    case RenderGraphAccess::FragmentSampled:
+        return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+    case RenderGraphAccess::ComputeSampled:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+    case RenderGraphAccess::ComputeStorageRead:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+    case RenderGraphAccess::ComputeStorageWrite:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
+    case RenderGraphAccess::TransferSrc:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+    case RenderGraphAccess::TransferDst:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+    case RenderGraphAccess::VertexBuffer:
+        return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+    case RenderGraphAccess::IndexBuffer:
+        return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+    case RenderGraphAccess::IndirectBuffer:
+        return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+    case RenderGraphAccess::UniformBuffer:
+        return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+    }
+    return {};
+}
+
+std::vector<bool> vgl::RenderGraphSolver::cull(const std::vector<Resource>& resources, const std::vector<Pass>& passes) {
+    std::vector<bool> needed(passes.size(), false);
+
+    //Whether the current contents of a resource are read by something that is kept
+    std::vector<bool> live(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); i++) {
+        live[i] = resources[i].output;
+    }
+
+    for (size_t p = passes.size(); p-- > 0;) {
+        std::vector<MergedUse> uses = mergeUses(passes[p]);
+
+        bool keep = passes[p].sideEffects;
+        for (const auto& use : uses) {
+            keep = keep || (use.info.write && live[use.resource]);
+        }
+        if (!keep) { continue; }
+        needed[p] = true;
+
+        //A pass that replaces the contents makes earlier writes to them dead, unless it also reads them
+        for (const auto& use : uses) {
+            if (use.info.write && !use.readsContents) { live[use.resource] = false; }
+        }
+        for (const auto& use : uses) {
+            if (use.readsContents) { live[use.resource] = true; }
+        }
+    }
+
+    return needed;
+}
+
+std::vector<uint32_t> vgl::RenderGraphSolver::schedule(const std::vector<Resource>& resources, const std::vector<Pass>& passes, const std::vector<bool>& needed) {
+    uint32_t passCount = static_cast<uint32_t>(passes.size());
+
+    //Edges follow declaration order: reads depend on the last writer, writes on the last writer and every reader since
+    std::vector<std::vector<uint32_t>> dependencies(passCount);
+    std::vector<uint32_t> lastWriter(resources.size(), invalidIndex);
+    std::vector<std::vector<uint32_t>> readers(resources.size());
+    uint32_t lastSideEffect = invalidIndex;
+
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (!needed[p]) { continue; }
+        auto& deps = dependencies[p];
+
+        std::vector<MergedUse> uses = mergeUses(passes[p]);
+        for (const auto& use : uses) {
+            if (lastWriter[use.resource] != invalidIndex) { deps.push_back(lastWriter[use.resource]); }
+            if (use.info.write) {
+                deps.insert(deps.end(), readers[use.resource].begin(), readers[use.resource].end());
+            }
+        }
+        for (const auto& use : uses) {
+            if (use.info.write) {
+                lastWriter[use.resource] = p;
+                readers[use.resource].clear();
+            }
+            else {
+                readers[use.resource].push_back(p);
+            }
+        }
+
+        if (passes[p].sideEffects) {
+            if (lastSideEffect != invalidIndex) { deps.push_back(lastSideEffect); }
+            lastSideEffect = p;
+        }
+
+        std::sort(deps.begin(), deps.end());
+        deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+        deps.erase(std::remove(deps.begin(), deps.end(), p), deps.end());
+    }
+
+    std::vector<uint32_t> remaining(passCount, 0);
+    std::vector<std::vector<uint32_t>> dependents(passCount);
+    for (uint32_t p = 0; p < passCount; p++) {
+        remaining[p] = static_cast<uint32_t>(dependencies[p].size());
+        for (uint32_t dep : dependencies[p]) {
+            dependents[dep].push_back(p);
+        }
+    }
+
+    //Position in the order each pass was scheduled at
+    std::vector<uint32_t> position(passCount, invalidIndex);
+    std::vector<uint32_t> ready;
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (needed[p] && remaining[p] == 0) { ready.push_back(p); }
+    }
+
+    std::vector<uint32_t> order;
+    while (!ready.empty()) {
+        //Prefer the pass whose inputs were produced most recently, so transient results are consumed quickly and their memory freed
+        //Ties go to the pass declared first
+        auto best = ready.begin();
+        int64_t bestLatest = -1;
+        for (auto it = ready.begin(); it != ready.end(); ++it) {
+            int64_t latest = -1;
+            for (uint32_t dep : dependencies[*it]) {
+                latest = std::max<int64_t>(latest, position[dep]);
+            }
+            if (latest > bestLatest || (latest == bestLatest && *it < *best)) {
+                best = it;
+                bestLatest = latest;
+            }
+        }
+
+        uint32_t pass = *best;
+        ready.erase(best);
+        position[pass] = static_cast<uint32_t>(order.size());
+        order.push_back(pass);
+
+        for (uint32_t dependent : dependents[pass]) {
+            if (--remaining[dependent] == 0) { ready.push_back(dependent); }
+        }
+    }
+
+    //Edges only point at earlier passes so this can't happen, but a pass left unscheduled would silently be dropped
+    if (order.size() != static_cast<size_t>(std::count(needed.begin(), needed.end(), true))) {
+        throw std::runtime_error("RENDER GRAPH HAS A DEPENDENCY CYCLE");
+    }
+
+    return order;
+}
+
+void vgl::RenderGraphSolver::placeTransients(const std::vector<Resource>& resources, Result& result) {
+    result.placements.assign(resources.size(), Placement{});
+
+    std::vector<uint32_t> transients;
+    for (uint32_t r = 0; r < resources.size(); r++) {
+        if (!resources[r].imported && result.firstUse[r] != invalidIndex) {
+            transients.push_back(r);
+            result.transientBytes += resources[r].requirements.size;
+        }
+    }
+
+    //Biggest first so small resources fill the gaps left between big ones
+    std::stable_sort(transients.begin(), transients.end(), [&resources](uint32_t a, uint32_t b) {
+        return resources[a].requirements.size > resources[b].requirements.size;
+    });
+
+    std::vector<uint32_t> placed;
+    for (uint32_t r : transients) {
+        const VkMemoryRequirements& requirements = resources[r].requirements;
+
+        uint32_t heapIndex = invalidIndex;
+        for (uint32_t h = 0; h < result.heaps.size(); h++) {
+            if (result.heaps[h].image == resources[r].image && result.heaps[h].memoryTypeBits == requirements.memoryTypeBits) {
+                heapIndex = h;
+                break;
+            }
+        }
+        if (heapIndex == invalidIndex) {
+            heapIndex = static_cast<uint32_t>(result.heaps.size());
+            Heap heap;
+            heap.memoryTypeBits = requirements.memoryTypeBits;
+            heap.image = resources[r].image;
+            result.heaps.push_back(heap);
+        }
+
+        //Memory ranges of resources in the same heap that are alive at the same time
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> taken;
+        for (uint32_t other : placed) {
+            bool overlaps = result.firstUse[other] <= result.lastUse[r] && result.firstUse[r] <= result.lastUse[other];
+            if (result.placements[other].heap == heapIndex && overlaps) {
+                VkDeviceSize offset = result.placements[other].offset;
+                taken.emplace_back(offset, offset + resources[other].requirements.size);
+            }
+        }
+        std::sort(taken.begin(), taken.end());
+
+        //First gap big enough
+        VkDeviceSize offset = 0;
+        for (const auto& range : taken) {
+            if (offset + requirements.size <= range.first) { break; }
+            offset = std::max(offset, alignUp(range.second, requirements.alignment));
+        }
+
+        Heap& heap = result.heaps[heapIndex];
+        heap.size = std::max(heap.size, offset + requirements.size);
+        heap.alignment = std::max(heap.alignment, requirements.alignment);
+
+        result.placements[r] = { heapIndex, offset };
+        placed.push_back(r);
+    }
+
+    for (const auto& heap : result.heaps) {
+        result.heapBytes += heap.size;
+    }
+}
+
+void vgl::RenderGraphSolver::placeBarriers(const std::vector<Resource>& resources, const std::vector<Pass>& passes, Result& result) {
+    struct State {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        //Stages that read since the last write
+        VkPipelineStageFlags readStages = 0;
+        //Stages the last write has already been made visible to
+        VkPipelineStageFlags visibleStages = 0;
+        bool touched = false;
+        bool written = false;
+    };
+
+    std::vector<State> states(resources.size());
+    for (size_t r = 0; r < resources.size(); r++) {
+        if (resources[r].imported) {
+            states[r].layout = resources[r].initialLayout;
+            states[r].writeStages = resources[r].initialStages;
+            states[r].writeAccess = resources[r].initialAccess;
+            states[r].touched = true;
+        }
+    }
+
+    //Every stage and write a transient is used with, over the whole graph
+    std::vector<VkPipelineStageFlags> usedStages(resources.size(), 0);
+    std::vector<VkAccessFlags> usedWrites(resources.size(), 0);
+    for (uint32_t pass : result.order) {
+        for (const auto& use : mergeUses(passes[pass])) {
+            usedStages[use.resource] |= use.info.stages;
+            if (use.info.write) { usedWrites[use.resource] |= use.info.access; }
+        }
+    }
+
+    //The first use of a transient has to wait for everything else that used its memory, earlier this frame or in the previous frame
+    auto aliasSource = [&](uint32_t r, VkPipelineStageFlags& stages, VkAccessFlags& access) {
+        const Placement& placement = result.placements[r];
+        VkDeviceSize end = placement.offset + resources[r].requirements.size;
+        for (uint32_t other = 0; other < resources.size(); other++) {
+            const Placement& otherPlacement = result.placements[other];
+            if (otherPlacement.heap != placement.heap) { continue; }
+            VkDeviceSize otherEnd = otherPlacement.offset + resources[other].requirements.size;
+            if (otherPlacement.offset < end && placement.offset < otherEnd) {
+                stages |= usedStages[other];
+                access |= usedWrites[other];
+            }
+        }
+    };
+
+    result.barriers.resize(result.order.size());
+    for (uint32_t position = 0; position < result.order.size(); position++) {
+        auto& barriers = result.barriers[position];
+
+        for (const auto& use : mergeUses(passes[result.order[position]])) {
+            State& state = states[use.resource];
+            const AccessInfo& info = use.info;
+            VkImageLayout layout = resources[use.resource].image ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+            Barrier barrier;
+            barrier.resource = use.resource;
+            barrier.dstStages = info.stages;
+            barrier.dstAccess = info.access;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = layout;
+            bool needed = false;
+
+            if (!state.touched) {
+                //Contents of a transient are undefined when it is first used
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                aliasSource(use.resource, barrier.srcStages, barrier.srcAccess);
+                needed = true;
+            }
+            else if (state.layout != layout) {
+                barrier.srcStages = state.writeStages | state.readStages;
+                barrier.srcAccess = state.writeAccess;
+                needed = true;
+            }
+            else if (info.write) {
+                //Write after write and write after read
+                barrier.srcStages = state.writeStages | state.readStages;
+                barrier.srcAccess = state.writeAccess;
+                needed = barrier.srcStages != 0;
+            }
+            else if (state.writeStages != 0 && (info.stages & ~state.visibleStages) != 0) {
+                //Read after write, skipped when an earlier barrier already made the write visible to these stages
+                barrier.srcStages = state.writeStages;
+                barrier.srcAccess = state.writeAccess;
+                needed = true;
+            }
+
+            if (needed) {
+                if (barrier.srcStages == 0) { barrier.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; }
+                barriers.push_back(barrier);
+                result.barrierCount++;
+            }
+
+            state.touched = true;
+            state.layout = layout;
+            if (info.write) {
+                state.writeStages = info.stages;
+                state.writeAccess = info.access;
+                state.readStages = 0;
+                state.visibleStages = 0;
+                state.written = true;
+            }
+            else {
+                state.readStages |= info.stages;
+                if (needed) { state.visibleStages |= info.stages; }
+            }
+        }
+    }
+
+    for (uint32_t r = 0; r < resources.size(); r++) {
+        const Resource& resource = resources[r];
+        if (!resource.imported || result.firstUse[r] == invalidIndex) { continue; }
+
+        const State& state = states[r];
+        VkImageLayout finalLayout = resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || !resource.image ? state.layout : resource.finalLayout;
+        bool layoutChange = state.layout != finalLayout;
+        if (!layoutChange && !state.written) { continue; }
+
+        Barrier barrier;
+        barrier.resource = r;
+        barrier.srcStages = layoutChange ? state.writeStages | state.readStages : state.writeStages;
+        barrier.srcAccess = state.writeAccess;
+        barrier.dstStages = resource.finalStages;
+        barrier.dstAccess = resource.finalAccess;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = finalLayout;
+        if (barrier.srcStages == 0) { barrier.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; }
+
+        result.finalBarriers.push_back(barrier);
+        result.barrierCount++;
+    }
+}
+
+VkDeviceSize vgl::RenderGraphSolver::alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    if (alignment <= 1) { return value; }
+    return (value + alignment - 1) / alignment * alignment;
+}
@@ -0,0 +1,482 @@
+#include "vgl/ShaderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "vgl/FileUtils.h"
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+#include "vgl/MappedFile.h"
+
+namespace {
+
+    template <typename T>
+    void append(std::vector<char>& _data, const T& _value) {
+        const char* bytes = reinterpret_cast<const char*>(&_value);
+        _data.insert(_data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(const uint8_t* _data, size_t _size, size_t& _offset, T& _value) {
+        if (_size - _offset < sizeof(T)) { return false; }
+        memcpy(&_value, _data + _offset, sizeof(T));
+        _offset += sizeof(T);
+        return true;
+    }
+
+    //Key that is equal for equal binding lists
+    void appendBindings(std::string& _key, const std::vector<vgl::ShaderBinding>& _bindings) {
+        for (const vgl::ShaderBinding& binding : _bindings) {
+            uint32_t values[] = { binding.set, binding.binding, static_cast<uint32_t>(binding.type), binding.count, static_cast<uint32_t>(binding.stages) };
+            _key.append(reinterpret_cast<const char*>(values), sizeof(values));
+        }
+    }
+
+}
+
+VkShaderModule vgl::Shader::getModule() const {
+    return this->module;
+}
+
+const vgl::ShaderReflection& vgl::Shader::getReflection() const {
+    return this->reflection;
+}
+
+VkShaderStageFlagBits vgl::Shader::getStage() const {
+    return this->reflection.stage;
+}
+
+uint64_t vgl::Shader::getHash() const {
+    return this->hash;
+}
+
+const std::string& vgl::Shader::getName() const {
+    return this->name;
+}
+
+vgl::ShaderCache::ShaderCache(VkDevice _device, const std::string& _directory)
+    : device(_device)
+{
+    if (!_directory.empty()) {
+        this->path = (std::filesystem::path(_directory) / fileName).string();
+    }
+
+    auto loadStart = std::chrono::steady_clock::now();
+    this->load();
+    this->stats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+}
+
+vgl::ShaderCache::~ShaderCache() {
+    //Nothing new to write if every reflection came from the file
+    if (this->dirty) {
+        this->save();
+    }
+
+    for (auto& layout : this->layouts) {
+        vkDestroyPipelineLayout(this->device, layout.second->pipelineLayout, vgl::HostAllocator::callbacks());
+    }
+    for (auto& setLayout : this->setLayouts) {
+        vkDestroyDescriptorSetLayout(this->device, setLayout.second, vgl::HostAllocator::callbacks());
+    }
+    for (auto& shader : this->shaders) {
+        vkDestroyShaderModule(this->device, shader.second->module, vgl::HostAllocator::callbacks());
+    }
+}
+
+std::shared_ptr<const vgl::Shader> vgl::ShaderCache::load(const std::string& _path) {
+    //The code is hashed and handed to the driver straight from the mapping, it is never copied
+    vgl::MappedFile file(_path);
+    return this->create(file.data(), file.size(), _path);
+}
+
+std::shared_ptr<const vgl::Shader> vgl::ShaderCache::create(const void* _code, size_t _size, const std::string& _name) {
+    //SPIR-V is made of 32 bit words
+    if (!_code || _size == 0 || _size % 4 != 0 || reinterpret_cast<uintptr_t>(_code) % 4 != 0) {
+        throw std::runtime_error("INVALID SHADER CODE " + _name);
+    }
+
+    auto hashStart = std::chrono::steady_clock::now();
+    uint64_t codeHash = hash(_code, _size);
+    double hashMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hashStart).count();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.hashMs += hashMs;
+
+    //A 64 bit hash makes two different modules sharing an entry vanishingly unlikely, the size is checked as well
+    auto existing = this->shaders.find(codeHash);
+    if (existing != this->shaders.end() && existing->second->codeSize == _size) {
+        this->stats.deduplicated++;
+        return existing->second;
+    }
+    if (existing != this->shaders.end()) {
+        throw std::runtime_error("SHADER HASH COLLISION " + _name);
+    }
+
+    auto shader = std::make_shared<vgl::Shader>();
+    shader->hash = codeHash;
+    shader->codeSize = _size;
+    shader->name = _name;
+    shader->reflection = this->reflect(static_cast<const uint32_t*>(_code), _size, codeHash);
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = _size;
+    moduleInfo.pCode = static_cast<const uint32_t*>(_code);
+
+    if (vkCreateShaderModule(this->device, &moduleInfo, vgl::HostAllocator::callbacks(), &shader->module) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE SHADER MODULE " + _name);
+    }
+    this->stats.modulesCreated++;
+
+    this->shaders.emplace(codeHash, shader);
+    return shader;
+}
+
+const vgl::ShaderLayout& vgl::ShaderCache::getLayout(const std::vector<std::shared_ptr<const vgl::Shader>>& _shaders) {
+    //Merge the bindings and push constants of every stage
+    std::map<std::pair<uint32_t, uint32_t>, vgl::ShaderBinding> merged;
+    uint32_t pushBegin = UINT32_MAX;
+    uint32_t pushEnd = 0;
+    VkShaderStageFlags pushStages = 0;
+
+    for (const auto& shader : _shaders) {
+        if (!shader) { continue; }
+        const vgl::ShaderReflection& reflection = shader->getReflection();
+
+        for (const vgl::ShaderBinding& binding : reflection.bindings) {
+            if (binding.count == 0) {
+                throw std::runtime_error("RUNTIME DESCRIPTOR ARRAY IN " + shader->getName() + " NEEDS AN EXPLICIT SET LAYOUT");
+            }
+            auto result = merged.emplace(std::make_pair(binding.set, binding.binding), binding);
+            vgl::ShaderBinding& existing = result.first->second;
+            if (!result.second) {
+                if (existing.type != binding.type || existing.count != binding.count) {
+                    throw std::runtime_error("SHADER STAGES DISAGREE ON DESCRIPTOR " + std::to_string(binding.set) + "." + std::to_string(binding.binding));
+                }
+                existing.stages |= binding.stages;
+            }
+        }
+
+        if (reflection.pushConstantSize > 0) {
+            pushBegin = std::min(pushBegin, reflection.pushConstantOffset);
+            pushEnd = std::max(pushEnd, reflection.pushConstantOffset + reflection.pushConstantSize);
+            pushStages |= reflection.stage;
+        }
+    }
+
+    auto layout = std::make_unique<vgl::ShaderLayout>();
+    for (const auto& binding : merged) {
+        layout->bindings.push_back(binding.second);
+    }
+    //One range for every stage, so the same vkCmdPushConstants call works for all of them
+    if (pushStages != 0) {
+        layout->pushConstantRanges.push_back(VkPushConstantRange{ pushStages, pushBegin, pushEnd - pushBegin });
+    }
+
+    std::string key;
+    appendBindings(key, layout->bindings);
+    for (const VkPushConstantRange& range : layout->pushConstantRanges) {
+        uint32_t values[] = { static_cast<uint32_t>(range.stageFlags), range.offset, range.size };
+        key.append(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto existing = this->layouts.find(key);
+    if (existing != this->layouts.end()) {
+        return *existing->second;
+    }
+
+    //Bindings are sorted by set, so each set is a contiguous run
+    uint32_t setCount = layout->bindings.empty() ? 0 : layout->bindings.back().set + 1;
+    auto begin = layout->bindings.begin();
+    for (uint32_t set = 0; set < setCount; set++) {
+        auto end = std::find_if(begin, layout->bindings.end(), [set](const vgl::ShaderBinding& binding) { return binding.set != set; });
+        layout->setLayouts.push_back(this->getSetLayout(std::vector<vgl::ShaderBinding>(begin, end)));
+        begin = end;
+    }
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = static_cast<uint32_t>(layout->setLayouts.size());
+    layoutInfo.pSetLayouts = layout->setLayouts.data();
+    layoutInfo.pushConstantRangeCount = static_cast<uint32_t>(layout->pushConstantRanges.size());
+    layoutInfo.pPushConstantRanges = layout->pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(this->device, &layoutInfo, vgl::HostAllocator::callbacks(), &layout->pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE REFLECTED PIPELINE LAYOUT");
+    }
+    this->stats.pipelineLayoutsCreated++;
+
+    vgl::ShaderLayout& result = *layout;
+    this->layouts.emplace(std::move(key), std::move(layout));
+    return result;
+}
+
+uint32_t vgl::ShaderCache::trim() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    uint32_t destroyed = 0;
+    for (auto it = this->shaders.begin(); it != this->shaders.end();) {
+        if (it->second.use_count() == 1) {
+            vkDestroyShaderModule(this->device, it->second->module, vgl::HostAllocator::callbacks());
+            it = this->shaders.erase(it);
+            destroyed++;
+        }
+        else {
+            ++it;
+        }
+    }
+    return destroyed;
+}
+
+bool vgl::ShaderCache::save() {
+    if (this->path.empty()) { return false; }
+
+    std::vector<char> data;
+    uint32_t entryCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        //Most recently used first, so the oldest are the ones left out when there are too many
+        std::vector<std::pair<uint64_t, const CachedReflection*>> entries;
+        for (const auto& entry : this->reflections) {
+            entries.emplace_back(entry.first, &entry.second);
+        }
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.second->lastUsed > b.second->lastUsed; });
+        if (entries.size() > maxFileEntries) {
+            entries.resize(maxFileEntries);
+        }
+
+        for (const auto& entry : entries) {
+            std::vector<char> serialised = serialise(entry.first, *entry.second);
+            data.insert(data.end(), serialised.begin(), serialised.end());
+        }
+        entryCount = static_cast<uint32_t>(entries.size());
+        this->dirty = false;
+    }
+
+    FileHeader header;
+    header.magic = fileMagic;
+    header.version = fileVersion;
+    header.entryCount = entryCount;
+    header.dataSize = data.size();
+    header.checksum = vgl::fnv1a64(data.data(), data.size());
+
+    //Written to a temporary file then renamed over the old cache in one step
+    if (!vgl::writeFileAtomically(this->path, { { &header, sizeof(header) }, { data.data(), data.size() } })) {
+        return false;
+    }
+    return true;
+}
+
+vgl::ShaderCache::Stats vgl::ShaderCache::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+const std::string& vgl::ShaderCache::getPath() const {
+    return this->path;
+}
+
+void vgl::ShaderCache::printStats() const {
+    Stats current = this->getStats();
+
+    std::ostringstream line;
+    line << "Shader cache: " << (current.warm ? "warm" : "cold") << " start";
+    if (current.warm) {
+        line << " (" << current.loadedEntries << " reflections loaded in " << current.loadMs << "ms)";
+    }
+    else if (!current.rejectReason.empty()) {
+        line << " (" << current.rejectReason << ")";
+    }
+    line << ", " << current.modulesCreated << " modules created, " << current.deduplicated << " loads shared an existing module, "
+        << current.reflectionCacheHits << " reflections from the cache and " << current.reflectionsParsed << " parsed in " << current.reflectMs
+        << "ms, " << current.hashMs << "ms hashing, " << current.pipelineLayoutsCreated << " pipeline layouts";
+    vgl::Logger::get().log(vgl::LogLevel::Info, "ShaderCache", line.str());
+}
+
+uint64_t vgl::ShaderCache::hash(const void* data, size_t size) {
+    //FNV-1a over whole words rather than bytes, SPIR-V is always a multiple of 4 bytes so this is a quarter of the multiplies
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t value = vgl::fnv1aOffset;
+    size_t words = size / 4;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word;
+        memcpy(&word, bytes + i * 4, sizeof(word));
+        value ^= word;
+        value *= vgl::fnv1aPrime;
+    }
+    value = vgl::fnv1a64(bytes + words * 4, size - words * 4, value);
+    //Mix the high bits down so every bit depends on the whole input
+    value ^= value >> 32;
+    return value;
+}
+
+void vgl::ShaderCache::load() {
+    if (this->path.empty() || !std::filesystem::exists(this->path)) { return; }
+
+    vgl::MappedFile file;
+    try {
+        file = vgl::MappedFile(this->path);
+    }
+    catch (const std::exception&) {
+        this->stats.rejectReason = "failed to read file";
+        return;
+    }
+
+    if (file.size() < sizeof(FileHeader)) {
+        this->stats.rejectReason = "file is smaller than the header";
+        return;
+    }
+
+    FileHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != fileMagic || header.version != fileVersion) {
+        this->stats.rejectReason = "unknown file format";
+        return;
+    }
+    if (header.dataSize != file.size() - sizeof(FileHeader)) {
+        this->stats.rejectReason = "file is truncated or has trailing data";
+        return;
+    }
+
+    const uint8_t* data = file.data() + sizeof(FileHeader);
+    size_t size = static_cast<size_t>(header.dataSize);
+    if (vgl::fnv1a64(data, size) != header.checksum) {
+        this->stats.rejectReason = "checksum mismatch";
+        return;
+    }
+
+    std::unordered_map<uint64_t, CachedReflection> loaded;
+    size_t offset = 0;
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        uint64_t codeHash = 0;
+        CachedReflection cached;
+        if (!deserialise(data, size, offset, codeHash, cached)) {
+            this->stats.rejectReason = "entry runs past the end of the file";
+            return;
+        }
+        loaded[codeHash] = std::move(cached);
+    }
+
+    this->reflections = std::move(loaded);
+    this->stats.warm = true;
+    this->stats.loadedEntries = header.entryCount;
+}
+
+vgl::ShaderReflection vgl::ShaderCache::reflect(const uint32_t* code, size_t size, uint64_t codeHash) {
+    auto cached = this->reflections.find(codeHash);
+    if (cached != this->reflections.end() && cached->second.codeSize == size) {
+        cached->second.lastUsed = ++this->useCounter;
+        this->stats.reflectionCacheHits++;
+        return cached->second.reflection;
+    }
+
+    auto reflectStart = std::chrono::steady_clock::now();
+    CachedReflection entry;
+    entry.codeSize = size;
+    entry.reflection = vgl::ShaderReflection::reflect(code, size / 4);
+    entry.lastUsed = ++this->useCounter;
+    this->stats.reflectMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reflectStart).count();
+    this->stats.reflectionsParsed++;
+
+    this->reflections[codeHash] = entry;
+    this->dirty = true;
+    return entry.reflection;
+}
+
+VkDescriptorSetLayout vgl::ShaderCache::getSetLayout(const std::vector<vgl::ShaderBinding>& bindings) {
+    std::string key;
+    appendBindings(key, bindings);
+
+    auto existing = this->setLayouts.find(key);
+    if (existing != this->setLayouts.end()) {
+        return existing->second;
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    for (const vgl::ShaderBinding& binding : bindings) {
+        VkDescriptorSetLayoutBinding layoutBinding{};
+        layoutBinding.binding = binding.binding;
+        layoutBinding.descriptorType = binding.type;
+        layoutBinding.descriptorCount = binding.count;
+        layoutBinding.stageFlags = binding.stages;
+        layoutBindings.push_back(layoutBinding);
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutInfo.pBindings = layoutBindings.data();
+
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(this->device, &layoutInfo, vgl::HostAllocator::callbacks(), &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE REFLECTED DESCRIPTOR SET LAYOUT");
+    }
+    this->stats.setLayoutsCreated++;
+
+    this->setLayouts.emplace(std::move(key), setLayout);
+    return setLayout;
+}
+
+std::vector<char> vgl::ShaderCache::serialise(uint64_t codeHash, const CachedReflection& cached) {
+    const vgl::ShaderReflection& reflection = cached.reflection;
+
+    std::vector<char> data;
+    append(data, codeHash);
+    append(data, static_cast<uint64_t>(cached.codeSize));
+    append(data, static_cast<uint32_t>(reflection.stage));
+    append(data, reflection.localSize);
+    append(data, reflection.pushConstantOffset);
+    append(data, reflection.pushConstantSize);
+
+    append(data, static_cast<uint32_t>(reflection.entryPoint.size()));
+    data.insert(data.end(), reflection.entryPoint.begin(), reflection.entryPoint.end());
+
+    append(data, static_cast<uint32_t>(reflection.bindings.size()));
+    for (const vgl::ShaderBinding& binding : reflection.bindings) {
+        uint32_t values[] = { binding.set, binding.binding, static_cast<uint32_t>(binding.type), binding.count, static_cast<uint32_t>(binding.stages) };
+        append(data, values);
+    }
+    return data;
+}
+
+bool vgl::ShaderCache::deserialise(const uint8_t* data, size_t size, size_t& offset, uint64_t& codeHash, CachedReflection& cached) {
+    vgl::ShaderReflection& reflection = cached.reflection;
+
+    uint64_t codeSize = 0;
+    uint32_t stage = 0;
+    uint32_t entryPointLength = 0;
+    uint32_t bindingCount = 0;
+    if (!readValue(data, size, offset, codeHash) || !readValue(data, size, offset, codeSize) || !readValue(data, size, offset, stage) ||
+        !readValue(data, size, offset, reflection.localSize) || !readValue(data, size, offset, reflection.pushConstantOffset) ||
+        !readValue(data, size, offset, reflection.pushConstantSize) || !readValue(data, size, offset, entryPointLength)) {
+        return false;
+    }
+    cached.codeSize = static_cast<size_t>(codeSize);
+    reflection.stage = static_cast<VkShaderStageFlagBits>(stage);
+
+    if (size - offset < entryPointLength) { return false; }
+    reflection.entryPoint.assign(reinterpret_cast<const char*>(data + offset), entryPointLength);
+    offset += entryPointLength;
+
+    if (!readValue(data, size, offset, bindingCount)) { return false; }
+    //Checked before resizing so a corrupt count can't allocate gigabytes
+    if ((size - offset) / (sizeof(uint32_t) * 5) < bindingCount) { return false; }
+    reflection.bindings.resize(bindingCount);
+    for (vgl::ShaderBinding& binding : reflection.bindings) {
+        uint32_t values[5];
+        readValue(data, size, offset, values);
+        binding.set = values[0];
+        binding.binding = values[1];
+        binding.type = static_cast<VkDescriptorType>(values[2]);
+        binding.count = values[3];
+        binding.stages = static_cast<VkShaderStageFlags>(values[4]);
+    }
+    return true;
+}
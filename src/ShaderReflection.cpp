@@ -0,0 +1,418 @@
+#include "vgl/ShaderReflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    //The handful of SPIR-V opcodes, decorations and enums the reflection needs
+    constexpr uint32_t spirvMagic = 0x07230203;
+
+    enum Op : uint32_t {
+        OpEntryPoint = 15,
+        OpExecutionMode = 16,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpSpecConstant = 50,
+        OpFunction = 54,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpTypeAccelerationStructureKHR = 5341,
+    };
+
+    enum Decoration : uint32_t {
+        DecorationBlock = 2,
+        DecorationBufferBlock = 3,
+        DecorationArrayStride = 6,
+        DecorationMatrixStride = 7,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset = 35,
+    };
+
+    enum StorageClass : uint32_t {
+        StorageClassUniformConstant = 0,
+        StorageClassUniform = 2,
+        StorageClassPushConstant = 9,
+        StorageClassStorageBuffer = 12,
+    };
+
+    constexpr uint32_t ExecutionModeLocalSize = 17;
+    constexpr uint32_t DimBuffer = 5;
+    constexpr uint32_t DimSubpassData = 6;
+    //Sampled operand of OpTypeImage, 2 means the image is used without a sampler (storage)
+    constexpr uint32_t ImageStorage = 2;
+
+    //Everything recorded about one result id
+    struct Id {
+        uint32_t opcode = 0;
+        //Element, component, column, pointee or sampled image type depending on the opcode
+        uint32_t typeId = 0;
+        //Vector component / matrix column count, array length id, image dim or storage class
+        uint32_t count = 0;
+        uint32_t width = 0;
+        uint32_t imageSampled = 0;
+        uint32_t constant = 0;
+
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        bool hasSet = false;
+        bool hasBinding = false;
+        bool block = false;
+        bool bufferBlock = false;
+        uint32_t arrayStride = 0;
+
+        std::vector<uint32_t> members;
+        std::vector<uint32_t> memberOffsets;
+        std::vector<uint32_t> memberMatrixStrides;
+    };
+
+    VkShaderStageFlagBits toStage(uint32_t _executionModel) {
+        switch (_executionModel) {
+        case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+        default: throw std::runtime_error("UNSUPPORTED SHADER STAGE");
+        }
+    }
+
+    class Parser {
+
+    public:
+
+        Parser(const uint32_t* _code, size_t _wordCount)
+            : code(_code),
+            wordCount(_wordCount)
+        {
+        }
+
+        vgl::ShaderReflection parse() {
+            if (!this->code || this->wordCount < 5 || this->code[0] != spirvMagic) {
+                throw std::runtime_error("INVALID SPIR-V HEADER");
+            }
+            //Every id is below the bound, so ids can index a flat array
+            uint32_t bound = this->code[3];
+            if (bound > this->wordCount) {
+                throw std::runtime_error("INVALID SPIR-V ID BOUND");
+            }
+            this->ids.resize(bound);
+
+            bool foundEntryPoint = false;
+            uint32_t entryPointId = 0;
+
+            size_t offset = 5;
+            while (offset < this->wordCount) {
+                uint32_t opcode = this->code[offset] & 0xFFFF;
+                uint32_t length = this->code[offset] >> 16;
+                if (length == 0 || offset + length > this->wordCount) {
+                    throw std::runtime_error("INVALID SPIR-V INSTRUCTION");
+                }
+                const uint32_t* words = this->code + offset;
+                offset += length;
+
+                //Global declarations all come before the first function, nothing after it is needed
+                if (opcode == OpFunction) { break; }
+
+                switch (opcode) {
+                case OpEntryPoint:
+                    //Modules with several entry points are reflected for the first
+                    if (!foundEntryPoint && length >= 4) {
+                        this->reflection.stage = toStage(words[1]);
+                        entryPointId = words[2];
+                        this->reflection.entryPoint = readString(words + 3, length - 3);
+                        foundEntryPoint = true;
+                    }
+                    break;
+                case OpExecutionMode:
+                    if (length >= 6 && words[1] == entryPointId && words[2] == ExecutionModeLocalSize) {
+                        this->reflection.localSize[0] = words[3];
+                        this->reflection.localSize[1] = words[4];
+                        this->reflection.localSize[2] = words[5];
+                    }
+                    break;
+                case OpDecorate:
+                    if (length >= 3) { this->decorate(words, length); }
+                    break;
+                case OpMemberDecorate:
+                    if (length >= 5) { this->decorateMember(words); }
+                    break;
+                case OpTypeBool:
+                case OpTypeSampler:
+                case OpTypeAccelerationStructureKHR:
+                    this->at(words[1], length, 2).opcode = opcode;
+                    break;
+                case OpTypeInt:
+                case OpTypeFloat: {
+                    Id& id = this->at(words[1], length, 3);
+                    id.opcode = opcode;
+                    id.width = words[2];
+                    break;
+                }
+                case OpTypeVector:
+                case OpTypeMatrix:
+                case OpTypeArray: {
+                    Id& id = this->at(words[1], length, 4);
+                    id.opcode = opcode;
+                    id.typeId = words[2];
+                    id.count = words[3];
+                    break;
+                }
+                case OpTypeImage: {
+                    Id& id = this->at(words[1], length, 9);
+                    id.opcode = opcode;
+                    id.count = words[3];
+                    id.imageSampled = words[7];
+                    break;
+                }
+                case OpTypeSampledImage:
+                case OpTypeRuntimeArray: {
+                    Id& id = this->at(words[1], length, 3);
+                    id.opcode = opcode;
+                    id.typeId = words[2];
+                    break;
+                }
+                case OpTypeStruct: {
+                    Id& id = this->at(words[1], length, 2);
+                    id.opcode = opcode;
+                    id.members.assign(words + 2, words + length);
+                    break;
+                }
+                case OpTypePointer: {
+                    Id& id = this->at(words[1], length, 4);
+                    id.opcode = opcode;
+                    id.count = words[2];
+                    id.typeId = words[3];
+                    break;
+                }
+                case OpConstant:
+                case OpSpecConstant: {
+                    //Only used for array lengths, specialised lengths use their default value
+                    Id& id = this->at(words[2], length, 4);
+                    id.opcode = OpConstant;
+                    id.constant = words[3];
+                    break;
+                }
+                case OpVariable: {
+                    Id& id = this->at(words[2], length, 4);
+                    id.opcode = opcode;
+                    id.typeId = words[1];
+                    id.count = words[3];
+                    this->variables.push_back(words[2]);
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            if (!foundEntryPoint) {
+                throw std::runtime_error("SPIR-V MODULE HAS NO ENTRY POINT");
+            }
+
+            for (uint32_t variable : this->variables) {
+                this->reflectVariable(this->ids[variable]);
+            }
+
+            std::sort(this->reflection.bindings.begin(), this->reflection.bindings.end(), [](const vgl::ShaderBinding& a, const vgl::ShaderBinding& b) {
+                return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+            });
+            //Aliased variables share a binding, keep one of them
+            this->reflection.bindings.erase(std::unique(this->reflection.bindings.begin(), this->reflection.bindings.end(),
+                [](const vgl::ShaderBinding& a, const vgl::ShaderBinding& b) { return a.set == b.set && a.binding == b.binding; }),
+                this->reflection.bindings.end());
+
+            return this->reflection;
+        }
+
+    private:
+
+        const uint32_t* code = nullptr;
+        size_t wordCount = 0;
+
+        std::vector<Id> ids;
+        std::vector<uint32_t> variables;
+        vgl::ShaderReflection reflection;
+
+        //Bounds checked access for an instruction that needs at least _minimumLength words
+        Id& at(uint32_t _id, uint32_t _length, uint32_t _minimumLength) {
+            if (_id >= this->ids.size() || _length < _minimumLength) {
+                throw std::runtime_error("INVALID SPIR-V INSTRUCTION");
+            }
+            return this->ids[_id];
+        }
+
+        const Id& get(uint32_t _id) const {
+            if (_id >= this->ids.size()) {
+                throw std::runtime_error("INVALID SPIR-V ID");
+            }
+            return this->ids[_id];
+        }
+
+        static std::string readString(const uint32_t* _words, uint32_t _wordCount) {
+            //Literal strings are nul terminated and padded to a whole number of words
+            const char* characters = reinterpret_cast<const char*>(_words);
+            size_t maxLength = static_cast<size_t>(_wordCount) * 4;
+            size_t length = 0;
+            while (length < maxLength && characters[length] != '\0') {
+                length++;
+            }
+            return std::string(characters, length);
+        }
+
+        void decorate(const uint32_t* _words, uint32_t _length) {
+            Id& id = this->at(_words[1], _length, 3);
+            switch (_words[2]) {
+            case DecorationBlock: id.block = true; break;
+            case DecorationBufferBlock: id.bufferBlock = true; break;
+            case DecorationArrayStride: if (_length >= 4) { id.arrayStride = _words[3]; } break;
+            case DecorationDescriptorSet: if (_length >= 4) { id.set = _words[3]; id.hasSet = true; } break;
+            case DecorationBinding: if (_length >= 4) { id.binding = _words[3]; id.hasBinding = true; } break;
+            default: break;
+            }
+        }
+
+        void decorateMember(const uint32_t* _words) {
+            Id& id = this->at(_words[1], 5, 5);
+            uint32_t member = _words[2];
+            if (_words[3] == DecorationOffset) {
+                if (id.memberOffsets.size() <= member) { id.memberOffsets.resize(member + 1, 0); }
+                id.memberOffsets[member] = _words[4];
+            }
+            else if (_words[3] == DecorationMatrixStride) {
+                if (id.memberMatrixStrides.size() <= member) { id.memberMatrixStrides.resize(member + 1, 0); }
+                id.memberMatrixStrides[member] = _words[4];
+            }
+        }
+
+        //Bytes a type takes up in a block, _matrixStride comes from the member that uses the type
+        uint32_t typeSize(uint32_t _typeId, uint32_t _matrixStride, uint32_t _depth) const {
+            if (_depth > 32) {
+                throw std::runtime_error("SPIR-V TYPE NESTED TOO DEEPLY");
+            }
+            const Id& type = this->get(_typeId);
+            switch (type.opcode) {
+            case OpTypeBool:
+                return 4;
+            case OpTypeInt:
+            case OpTypeFloat:
+                return type.width / 8;
+            case OpTypeVector:
+                return type.count * this->typeSize(type.typeId, 0, _depth + 1);
+            case OpTypeMatrix:
+                return type.count * (_matrixStride ? _matrixStride : this->typeSize(type.typeId, 0, _depth + 1));
+            case OpTypeArray: {
+                uint32_t stride = type.arrayStride ? type.arrayStride : this->typeSize(type.typeId, _matrixStride, _depth + 1);
+                return this->get(type.count).constant * stride;
+            }
+            case OpTypeStruct: {
+                uint32_t size = 0;
+                for (size_t i = 0; i < type.members.size(); i++) {
+                    uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+                    uint32_t matrixStride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+                    size = std::max(size, offset + this->typeSize(type.members[i], matrixStride, _depth + 1));
+                }
+                return size;
+            }
+            default:
+                //Runtime arrays don't add to the size of a block
+                return 0;
+            }
+        }
+
+        void reflectPushConstants(const Id& _block) {
+            if (_block.opcode != OpTypeStruct || _block.members.empty()) { return; }
+
+            uint32_t begin = UINT32_MAX;
+            uint32_t end = 0;
+            for (size_t i = 0; i < _block.members.size(); i++) {
+                uint32_t offset = i < _block.memberOffsets.size() ? _block.memberOffsets[i] : 0;
+                uint32_t matrixStride = i < _block.memberMatrixStrides.size() ? _block.memberMatrixStrides[i] : 0;
+                begin = std::min(begin, offset);
+                end = std::max(end, offset + this->typeSize(_block.members[i], matrixStride, 0));
+            }
+            this->reflection.pushConstantOffset = begin;
+            this->reflection.pushConstantSize = end - begin;
+        }
+
+        void reflectVariable(const Id& _variable) {
+            uint32_t storageClass = _variable.count;
+            const Id& pointer = this->get(_variable.typeId);
+            if (pointer.opcode != OpTypePointer) { return; }
+
+            if (storageClass == StorageClassPushConstant) {
+                this->reflectPushConstants(this->get(pointer.typeId));
+                return;
+            }
+            if (storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform && storageClass != StorageClassStorageBuffer) {
+                return;
+            }
+            //Inputs, outputs and workgroup memory have no descriptors
+            if (!_variable.hasBinding) { return; }
+
+            vgl::ShaderBinding binding;
+            binding.set = _variable.hasSet ? _variable.set : 0;
+            binding.binding = _variable.binding;
+            binding.stages = this->reflection.stage;
+
+            //Arrays of descriptors take one binding with a descriptor count
+            const Id* type = &this->get(pointer.typeId);
+            while (type->opcode == OpTypeArray || type->opcode == OpTypeRuntimeArray) {
+                binding.count = type->opcode == OpTypeArray ? binding.count * this->get(type->count).constant : 0;
+                type = &this->get(type->typeId);
+            }
+
+            switch (type->opcode) {
+            case OpTypeSampler:
+                binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+                break;
+            case OpTypeSampledImage:
+                binding.type = this->get(type->typeId).count == DimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                break;
+            case OpTypeImage:
+                if (type->count == DimBuffer) {
+                    binding.type = type->imageSampled == ImageStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                }
+                else if (type->count == DimSubpassData) {
+                    binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                }
+                else {
+                    binding.type = type->imageSampled == ImageStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                break;
+            case OpTypeStruct:
+                //Older SPIR-V marks storage buffers as Uniform with the BufferBlock decoration
+                binding.type = storageClass == StorageClassStorageBuffer || type->bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                break;
+            case OpTypeAccelerationStructureKHR:
+                binding.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+                break;
+            default:
+                throw std::runtime_error("UNSUPPORTED DESCRIPTOR TYPE IN SHADER");
+            }
+
+            this->reflection.bindings.push_back(binding);
+        }
+
+    };
+
+}
+
+vgl::ShaderReflection vgl::ShaderReflection::reflect(const uint32_t* code, size_t wordCount) {
+    Parser parser(code, wordCount);
+    return parser.parse();
+}
@@ -0,0 +1,152 @@
+#include "vgl/SwapChain.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::SwapChain::SwapChain(vgl::PhysicalDevice* _physicalDevice, VkDevice _device, VkSurfaceKHR _surface, VkExtent2D _framebufferExtent, VkPresentModeKHR _preferredPresentMode)
+    : physicalDevice(_physicalDevice),
+    device(_device),
+    surface(_surface),
+    preferredPresentMode(_preferredPresentMode)
+{
+    this->create(_framebufferExtent, VK_NULL_HANDLE);
+}
+
+vgl::SwapChain::~SwapChain() {
+    this->destroyImageViews();
+    if (this->swapChain) {
+        vkDestroySwapchainKHR(this->device, this->swapChain, vgl::HostAllocator::callbacks());
+    }
+}
+
+void vgl::SwapChain::recreate(VkExtent2D _framebufferExtent) {
+    this->destroyImageViews();
+
+    //Passing the old swap chain lets the driver reuse resources and keep presenting while the new one is built
+    VkSwapchainKHR oldSwapChain = this->swapChain;
+    this->create(_framebufferExtent, oldSwapChain);
+    vkDestroySwapchainKHR(this->device, oldSwapChain, vgl::HostAllocator::callbacks());
+}
+
+void vgl::SwapChain::create(VkExtent2D _framebufferExtent, VkSwapchainKHR oldSwapChain) {
+    vgl::SwapChainSupportDetails swapChainSupport = this->physicalDevice->querySwapChainSupport();
+
+    VkSurfaceFormatKHR surfaceFormat = this->chooseSwapSurfaceFormat(swapChainSupport.formats);
+    this->presentMode = this->chooseSwapPresentMode(swapChainSupport.presentModes);
+    this->extent = this->chooseSwapExtent(swapChainSupport.capabilities, _framebufferExtent);
+    this->imageFormat = surfaceFormat.format;
+
+    //Request one more image than the minimum so the driver does not have to be waited on before another image can be acquired
+    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    //0 means there is no maximum
+    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
+        imageCount = swapChainSupport.capabilities.maxImageCount;
+    }
+
+    VkSwapchainCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface = this->surface;
+    createInfo.minImageCount = imageCount;
+    createInfo.imageFormat = surfaceFormat.format;
+    createInfo.imageColorSpace = surfaceFormat.colorSpace;
+    createInfo.imageExtent = this->extent;
+    //Always 1 unless developing a stereoscopic 3D application
+    createInfo.imageArrayLayers = 1;
+    //Images are rendered to directly and can be cleared with a transfer command
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    //If the graphics and present queues are different then the images need to be shared between the two families
+    const vgl::QueueFamilyIndices& indices = this->physicalDevice->queueFamilyIndices;
+    uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (indices.graphicsFamily != indices.presentFamily) {
+        createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        createInfo.queueFamilyIndexCount = 2;
+        createInfo.pQueueFamilyIndices = queueFamilyIndices;
+    }
+    else {
+        createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+    //Ignore the alpha channel when blending with other windows
+    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    createInfo.presentMode = this->presentMode;
+    //Don't care about the colour of pixels that are obscured
+    createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = oldSwapChain;
+
+    if (vkCreateSwapchainKHR(this->device, &createInfo, vgl::HostAllocator::callbacks(), &this->swapChain) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE SWAP CHAIN");
+    }
+
+    //The implementation is allowed to create more images than requested so query the actual count
+    vkGetSwapchainImagesKHR(this->device, this->swapChain, &imageCount, nullptr);
+    this->images.resize(imageCount);
+    vkGetSwapchainImagesKHR(this->device, this->swapChain, &imageCount, this->images.data());
+
+    this->createImageViews();
+}
+
+void vgl::SwapChain::createImageViews() {
+    this->imageViews.resize(this->images.size());
+
+    for (size_t i = 0; i < this->images.size(); i++) {
+        VkImageViewCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.image = this->images[i];
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        createInfo.format = this->imageFormat;
+        createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        createInfo.subresourceRange.baseMipLevel = 0;
+        createInfo.subresourceRange.levelCount = 1;
+        createInfo.subresourceRange.baseArrayLayer = 0;
+        createInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(this->device, &createInfo, vgl::HostAllocator::callbacks(), &this->imageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO CREATE SWAP CHAIN IMAGE VIEWS");
+        }
+    }
+}
+
+void vgl::SwapChain::destroyImageViews() {
+    for (auto imageView : this->imageViews) {
+        vkDestroyImageView(this->device, imageView, vgl::HostAllocator::callbacks());
+    }
+    this->imageViews.clear();
+}
+
+VkSurfaceFormatKHR vgl::SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
+    for (const auto& availableFormat : availableFormats) {
+        if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            return availableFormat;
+        }
+    }
+
+    return availableFormats[0];
+}
+
+VkPresentModeKHR vgl::SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    for (const auto& availablePresentMode : availablePresentModes) {
+        if (availablePresentMode == this->preferredPresentMode) {
+            return availablePresentMode;
+        }
+    }
+
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkExtent2D vgl::SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, VkExtent2D _framebufferExtent) {
+    //Max value of uint32_t means the surface lets the swap chain decide its size
+    if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
+        return capabilities.currentExtent;
+    }
+
+    VkExtent2D actualExtent = _framebufferExtent;
+    actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+    actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+
+    return actualExtent;
+}
@@ -0,0 +1,620 @@
+#include "vgl/TextureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+
+namespace {
+
+    //KTX2 file identifier, «KTX 20»\r\n\x1A\n
+    const uint8_t ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    //Fixed part of a KTX2 header, followed by one LevelIndex per level
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must match the file layout");
+
+    struct Ktx2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    //Fault in every page of a range so the upload copies from memory instead of waiting on the disk
+    void touchPages(const uint8_t* data, size_t size) {
+        const size_t pageSize = 4096;
+        volatile uint8_t sink = 0;
+        for (size_t offset = 0; offset < size; offset += pageSize) {
+            sink = sink + data[offset];
+        }
+        if (size > 0) {
+            sink = sink + data[size - 1];
+        }
+    }
+
+}
+
+vgl::TextureStreamer::TextureStreamer(vgl::LogicalDevice* _logicalDevice, vgl::UploadEngine* _uploadEngine, vgl::BindlessHeap* _bindlessHeap, uint32_t _framesInFlight,
+    const vgl::TextureStreamerSettings& _settings)
+    : logicalDevice(_logicalDevice),
+    allocator(_logicalDevice->getAllocator()),
+    uploadEngine(_uploadEngine),
+    bindlessHeap(_bindlessHeap),
+    framesInFlight(_framesInFlight),
+    settings(_settings)
+{
+}
+
+vgl::TextureStreamer::~TextureStreamer() {
+    //Uploads still queued reference the images, they have to finish before the images are destroyed
+    for (Texture& texture : this->textures) {
+        if (texture.hasPending) {
+            this->uploadEngine->wait(texture.pending.ticket);
+            this->destroy(texture.pending);
+        }
+        this->destroy(texture.current);
+    }
+    for (RetiredImage& image : this->retired) {
+        this->uploadEngine->wait(image.residency.ticket);
+        this->destroy(image.residency);
+    }
+}
+
+vgl::StreamedTexture vgl::TextureStreamer::load(const std::string& _path) {
+    VGL_PROFILE_SCOPE("TextureStreamer::load");
+
+    Texture texture;
+    texture.source = std::make_shared<Source>();
+    texture.source->file = vgl::MappedFile(_path);
+    const uint8_t* data = texture.source->file.data();
+    size_t size = texture.source->file.size();
+
+    Ktx2Header header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("INVALID KTX2 FILE " + _path);
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.identifier, ktx2Identifier, sizeof(ktx2Identifier)) != 0) {
+        throw std::runtime_error("INVALID KTX2 FILE " + _path);
+    }
+
+    //Basis and supercompressed files would have to be transcoded first, cube maps and arrays aren't streamed
+    if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 ||
+        header.faceCount != 1 || header.levelCount == 0 || header.pixelWidth == 0 || header.pixelHeight == 0) {
+        throw std::runtime_error("UNSUPPORTED KTX2 TEXTURE " + _path);
+    }
+
+    //A full mip chain ends at 1x1, more levels than that can't be given to vkCreateImage
+    uint32_t maxLevelCount = 1;
+    for (uint32_t extent = std::max(header.pixelWidth, header.pixelHeight); extent > 1; extent >>= 1) {
+        maxLevelCount++;
+    }
+    if (header.levelCount > maxLevelCount) {
+        throw std::runtime_error("INVALID KTX2 FILE " + _path);
+    }
+
+    texture.format = static_cast<VkFormat>(header.vkFormat);
+    uint32_t blockWidth = 1;
+    uint32_t blockHeight = 1;
+    if (!getBlockInfo(texture.format, texture.blockBytes, blockWidth, blockHeight)) {
+        throw std::runtime_error("UNSUPPORTED KTX2 FORMAT " + _path);
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(this->logicalDevice->getPhysicalDevice(), texture.format, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        throw std::runtime_error("TEXTURE FORMAT NOT SUPPORTED BY DEVICE " + _path);
+    }
+
+    if (size < sizeof(header) + header.levelCount * sizeof(Ktx2LevelIndex)) {
+        throw std::runtime_error("INVALID KTX2 FILE " + _path);
+    }
+
+    //Level data has to be tightly packed for the upload, so the sizes must match the format exactly
+    texture.levels.resize(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        Ktx2LevelIndex index;
+        memcpy(&index, data + sizeof(header) + i * sizeof(index), sizeof(index));
+
+        Level& level = texture.levels[i];
+        level.extent.width = std::max(header.pixelWidth >> i, 1u);
+        level.extent.height = std::max(header.pixelHeight >> i, 1u);
+        VkDeviceSize blocksWide = (level.extent.width + blockWidth - 1) / blockWidth;
+        VkDeviceSize blocksHigh = (level.extent.height + blockHeight - 1) / blockHeight;
+        level.offset = index.byteOffset;
+        level.size = blocksWide * blocksHigh * texture.blockBytes;
+
+        if (index.byteLength != level.size || index.byteOffset > size || size - index.byteOffset < index.byteLength) {
+            throw std::runtime_error("INVALID KTX2 FILE " + _path);
+        }
+    }
+
+    //The tail starts at the first level small enough, every level after it is smaller still
+    texture.tailLevel = header.levelCount - 1;
+    while (texture.tailLevel > 0 && texture.levels[texture.tailLevel - 1].size <= this->settings.mipTailBytes) {
+        texture.tailLevel--;
+    }
+
+    //Only the tail is read and made resident until markUsed asks for more
+    texture.wantedLevel = texture.tailLevel;
+    texture.live = true;
+    texture.current.baseLevel = header.levelCount;
+    texture.source->readLevel = header.levelCount;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    texture.lastUsed = this->frameNumber;
+
+    vgl::StreamedTexture handle;
+    if (!this->freeTextures.empty()) {
+        handle = this->freeTextures.back();
+        this->freeTextures.pop_back();
+        this->textures[handle] = std::move(texture);
+    }
+    else {
+        handle = static_cast<vgl::StreamedTexture>(this->textures.size());
+        this->textures.push_back(std::move(texture));
+    }
+
+    this->readAhead(this->textures[handle]);
+    return handle;
+}
+
+void vgl::TextureStreamer::release(vgl::StreamedTexture texture) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Texture& released = this->textures.at(texture);
+    if (!released.live) {
+        throw std::runtime_error("TEXTURE ALREADY RELEASED");
+    }
+
+    if (this->bindlessHeap && released.bindlessHandle != vgl::BindlessHeap::invalidHandle) {
+        this->bindlessHeap->removeTexture(released.bindlessHandle);
+    }
+    if (released.hasPending) {
+        this->retire(released.pending);
+    }
+    this->retire(released.current);
+
+    released = Texture();
+    this->freeTextures.push_back(texture);
+}
+
+void vgl::TextureStreamer::markUsed(vgl::StreamedTexture texture, uint32_t _finestLevel) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Texture& used = this->textures.at(texture);
+    used.lastUsed = this->frameNumber;
+    used.wantedLevel = std::min(_finestLevel, used.tailLevel);
+}
+
+void vgl::TextureStreamer::update() {
+    VGL_PROFILE_SCOPE("TextureStreamer::update");
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->frameNumber++;
+
+    //Destroy replaced images no frame in flight can still be reading
+    for (size_t i = 0; i < this->retired.size();) {
+        RetiredImage& image = this->retired[i];
+        if (image.readyFrame == 0 && this->uploadEngine->isReady(image.residency.ticket)) {
+            image.readyFrame = this->frameNumber;
+        }
+        if (image.readyFrame != 0 && image.readyFrame + this->framesInFlight < this->frameNumber) {
+            this->destroy(image.residency);
+            this->retired[i] = std::move(this->retired.back());
+            this->retired.pop_back();
+            continue;
+        }
+        i++;
+    }
+
+    std::vector<Texture*> candidates;
+    VkDeviceSize residentBytes = 0;
+    for (Texture& texture : this->textures) {
+        if (!texture.live) { continue; }
+        this->finishResidency(texture);
+        residentBytes += getTargetBytes(texture);
+        if (!texture.hasPending) {
+            candidates.push_back(&texture);
+        }
+    }
+    VkDeviceSize budget = this->computeBudget(residentBytes);
+
+    //Least recently used first
+    std::vector<Texture*> evictionOrder = candidates;
+    std::sort(evictionOrder.begin(), evictionOrder.end(), [](const Texture* a, const Texture* b) { return a->lastUsed < b->lastUsed; });
+
+    //Over budget, the least recently used textures lose their finest level
+    if (residentBytes > budget) {
+        this->evict(evictionOrder, UINT64_MAX, budget, residentBytes);
+    }
+    //Under budget, the most recently used textures gain a level, coarsest textures first so everything gets its tail before anything gets detail
+    //Levels of textures used less recently are evicted to make room
+    else {
+        std::sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) {
+            if (a->lastUsed != b->lastUsed) { return a->lastUsed > b->lastUsed; }
+            return a->current.baseLevel > b->current.baseLevel;
+        });
+
+        VkDeviceSize uploaded = 0;
+        for (Texture* texture : candidates) {
+            //Evicted this frame to make room for a texture used more recently
+            if (texture->hasPending || texture->current.baseLevel <= texture->wantedLevel) { continue; }
+
+            //The tail is uploaded in one go, after that one level at a time
+            uint32_t baseLevel = texture->current.image == VK_NULL_HANDLE ? texture->tailLevel : texture->current.baseLevel - 1;
+            VkDeviceSize bytes = getLevelBytes(*texture, baseLevel);
+            VkDeviceSize growth = bytes - std::min(bytes, getTargetBytes(*texture));
+
+            if (texture->source->readLevel.load() > baseLevel) {
+                this->readAhead(*texture);
+                this->stats.deferredForDisk++;
+                continue;
+            }
+            if (uploaded > 0 && uploaded + bytes > this->settings.uploadBytesPerFrame) {
+                this->stats.deferredForBandwidth++;
+                break;
+            }
+            if (growth > budget || !this->evict(evictionOrder, texture->lastUsed, budget - growth, residentBytes)) {
+                this->stats.deferredForBudget++;
+                continue;
+            }
+
+            this->beginResidency(*texture, baseLevel);
+            residentBytes += growth;
+            uploaded += bytes;
+            this->stats.levelsRaised++;
+        }
+    }
+
+    //Also picks up uploads left queued by an update that threw part way through
+    if (this->queuedUploads.empty()) {
+        return;
+    }
+
+    //Uploads can wait for staging space, so they are made without holding the mutex to not block markUsed and getView on other threads
+    //Images whose uploads aren't made yet have queuedTicket, so nothing swaps them in or destroys them in the meantime
+    std::vector<QueuedUpload> uploads = std::move(this->queuedUploads);
+    this->queuedUploads.clear();
+    lock.unlock();
+
+    std::vector<std::pair<VkImage, vgl::UploadTicket>> tickets;
+    for (const QueuedUpload& upload : uploads) {
+        vgl::UploadTicket ticket = this->uploadEngine->uploadImage(upload.image, upload.info, upload.source->file.data() + upload.offset, upload.size);
+        if (tickets.empty() || tickets.back().first != upload.image) {
+            tickets.emplace_back(upload.image, ticket);
+        }
+        tickets.back().second = ticket;
+    }
+    //Submit now rather than at the start of the next frame
+    this->uploadEngine->flush();
+
+    //The texture may have been released meanwhile, then its image is retired
+    lock.lock();
+    auto setTicket = [&tickets](Residency& residency) {
+        if (residency.ticket != queuedTicket) { return; }
+        for (const auto& entry : tickets) {
+            if (entry.first == residency.image) { residency.ticket = entry.second; }
+        }
+    };
+    for (Texture& texture : this->textures) {
+        if (texture.hasPending) { setTicket(texture.pending); }
+    }
+    for (RetiredImage& image : this->retired) {
+        setTicket(image.residency);
+    }
+}
+
+bool vgl::TextureStreamer::evict(const std::vector<Texture*>& evictionOrder, uint64_t usedBefore, VkDeviceSize targetBytes, VkDeviceSize& residentBytes) {
+    //Each texture drops at most one level per frame, the rest follow in the next frames if still needed
+    for (Texture* texture : evictionOrder) {
+        if (residentBytes <= targetBytes) { break; }
+        if (texture->lastUsed >= usedBefore) { break; }
+        if (texture->hasPending || texture->current.image == VK_NULL_HANDLE || texture->current.baseLevel >= texture->tailLevel) { continue; }
+
+        VkDeviceSize before = getTargetBytes(*texture);
+        this->beginResidency(*texture, texture->current.baseLevel + 1);
+        VkDeviceSize after = getTargetBytes(*texture);
+        residentBytes -= std::min(residentBytes, before - std::min(before, after));
+        this->stats.levelsEvicted++;
+    }
+    return residentBytes <= targetBytes;
+}
+
+VkImageView vgl::TextureStreamer::getView(vgl::StreamedTexture texture) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->getTexture(texture).current.view;
+}
+
+uint32_t vgl::TextureStreamer::getBindlessHandle(vgl::StreamedTexture texture) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->getTexture(texture).bindlessHandle;
+}
+
+uint32_t vgl::TextureStreamer::getResidentLevel(vgl::StreamedTexture texture) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->getTexture(texture).current.baseLevel;
+}
+
+uint32_t vgl::TextureStreamer::getLevelCount(vgl::StreamedTexture texture) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return static_cast<uint32_t>(this->getTexture(texture).levels.size());
+}
+
+void vgl::TextureStreamer::setSettings(const vgl::TextureStreamerSettings& _settings) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->settings = _settings;
+}
+
+vgl::TextureStreamerSettings vgl::TextureStreamer::getSettings() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->settings;
+}
+
+vgl::TextureStreamer::Stats vgl::TextureStreamer::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Stats current = this->stats;
+    current.residentBytes = 0;
+    for (const Texture& texture : this->textures) {
+        if (!texture.live) { continue; }
+        current.textureCount++;
+        current.residentBytes += texture.current.allocation.size + (texture.hasPending ? texture.pending.allocation.size : 0);
+        if (texture.current.baseLevel <= texture.wantedLevel) {
+            current.fullyResident++;
+        }
+    }
+    return current;
+}
+
+void vgl::TextureStreamer::printStats() const {
+    Stats current = this->getStats();
+
+    std::ostringstream line;
+    line << "Texture streamer: " << current.fullyResident << "/" << current.textureCount << " textures fully resident, "
+        << current.residentBytes / (1024 * 1024) << "MB of " << current.budgetBytes / (1024 * 1024) << "MB "
+        << (current.deviceBudget ? "device budget" : "estimated budget") << ", " << current.levelsRaised << " levels raised, "
+        << current.levelsEvicted << " evicted, " << current.bytesUploaded / (1024 * 1024) << "MB uploaded, deferred "
+        << current.deferredForBudget << " for budget, " << current.deferredForBandwidth << " for bandwidth, " << current.deferredForDisk << " for disk";
+    vgl::Logger::get().log(vgl::LogLevel::Info, "TextureStreamer", line.str());
+}
+
+const vgl::TextureStreamer::Texture& vgl::TextureStreamer::getTexture(vgl::StreamedTexture texture) const {
+    const Texture& found = this->textures.at(texture);
+    if (!found.live) {
+        throw std::runtime_error("TEXTURE ALREADY RELEASED");
+    }
+    return found;
+}
+
+VkDeviceSize vgl::TextureStreamer::computeBudget(VkDeviceSize residentBytes) {
+    VkDeviceSize budget = this->settings.memoryCap > 0 ? this->settings.memoryCap : UINT64_MAX;
+
+    //Only the part of the device budget that isn't used by something else is available, the textures' own usage is added back
+    vgl::MemoryBudget memoryBudget = this->allocator->queryBudget();
+    VkDeviceSize ownBytes = residentBytes;
+    for (const RetiredImage& image : this->retired) {
+        ownBytes += image.residency.allocation.size;
+    }
+    VkDeviceSize usage = memoryBudget.getDeviceLocalUsage();
+    VkDeviceSize otherBytes = usage - std::min(usage, ownBytes);
+    VkDeviceSize deviceBudget = memoryBudget.getDeviceLocalBudget();
+    VkDeviceSize available = deviceBudget - std::min(deviceBudget, otherBytes);
+    budget = std::min(budget, static_cast<VkDeviceSize>(static_cast<double>(available) * this->settings.budgetFraction));
+
+    this->stats.budgetBytes = budget;
+    this->stats.deviceBudget = memoryBudget.fromExtension;
+    return budget;
+}
+
+void vgl::TextureStreamer::beginResidency(Texture& texture, uint32_t baseLevel) {
+    Residency& residency = texture.pending;
+    residency.baseLevel = baseLevel;
+
+    const Level& base = texture.levels[baseLevel];
+    uint32_t levelCount = static_cast<uint32_t>(texture.levels.size()) - baseLevel;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = texture.format;
+    imageInfo.extent = base.extent;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    //Ownership is transferred from the transfer queue by the upload engine
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    this->allocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, residency.image, residency.allocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = residency.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = texture.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(this->logicalDevice->device, &viewInfo, vgl::HostAllocator::callbacks(), &residency.view) != VK_SUCCESS) {
+        //Nothing has been uploaded into the image yet so it can go straight away, pending must be empty again since hasPending is still false
+        residency.view = VK_NULL_HANDLE;
+        this->destroy(residency);
+        residency = Residency();
+        throw std::runtime_error("FAILED TO CREATE TEXTURE IMAGE VIEW");
+    }
+
+    //Every level is uploaded again from the mapped file, the levels the old image already had are the small ones
+    for (uint32_t level = static_cast<uint32_t>(texture.levels.size()); level-- > baseLevel;) {
+        QueuedUpload upload;
+        upload.image = residency.image;
+        upload.source = texture.source;
+        upload.info.extent = texture.levels[level].extent;
+        upload.info.mipLevel = level - baseLevel;
+        upload.info.texelBlockSize = texture.blockBytes;
+        upload.offset = texture.levels[level].offset;
+        upload.size = texture.levels[level].size;
+        this->queuedUploads.push_back(std::move(upload));
+        this->stats.bytesUploaded += texture.levels[level].size;
+    }
+    residency.ticket = queuedTicket;
+
+    texture.hasPending = true;
+}
+
+bool vgl::TextureStreamer::finishResidency(Texture& texture) {
+    if (!texture.hasPending || !this->uploadEngine->isReady(texture.pending.ticket)) {
+        return false;
+    }
+
+    this->retire(texture.current);
+    texture.current = texture.pending;
+    texture.pending = Residency();
+    texture.hasPending = false;
+
+    //The old handle is held back by the heap until frames in flight are done with it
+    if (this->bindlessHeap) {
+        if (texture.bindlessHandle != vgl::BindlessHeap::invalidHandle) {
+            this->bindlessHeap->removeTexture(texture.bindlessHandle);
+        }
+        texture.bindlessHandle = this->bindlessHeap->addTexture(texture.current.view);
+    }
+    return true;
+}
+
+void vgl::TextureStreamer::readAhead(Texture& texture) {
+    if (texture.source->readLevel.load() <= texture.wantedLevel || texture.source->reading.exchange(true)) {
+        return;
+    }
+
+    std::vector<std::pair<VkDeviceSize, VkDeviceSize>> ranges;
+    for (uint32_t level = texture.wantedLevel; level < texture.source->readLevel.load(); level++) {
+        ranges.emplace_back(texture.levels[level].offset, texture.levels[level].size);
+    }
+
+    //Coarsest first, so the tail can be uploaded while the finer levels are still being read
+    std::shared_ptr<Source> source = texture.source;
+    uint32_t firstLevel = texture.wantedLevel;
+    this->logicalDevice->getJobSystem()->submit([source, ranges, firstLevel]() {
+        VGL_PROFILE_SCOPE("TextureStreamer::read");
+        for (size_t i = ranges.size(); i-- > 0;) {
+            touchPages(source->file.data() + ranges[i].first, static_cast<size_t>(ranges[i].second));
+            source->readLevel = firstLevel + static_cast<uint32_t>(i);
+        }
+        source->reading = false;
+    });
+}
+
+void vgl::TextureStreamer::retire(Residency& residency) {
+    if (residency.image == VK_NULL_HANDLE) { return; }
+
+    RetiredImage image;
+    image.residency = residency;
+    this->retired.push_back(image);
+    residency = Residency();
+}
+
+void vgl::TextureStreamer::destroy(Residency& residency) {
+    if (residency.view != VK_NULL_HANDLE) {
+        vkDestroyImageView(this->logicalDevice->device, residency.view, vgl::HostAllocator::callbacks());
+        residency.view = VK_NULL_HANDLE;
+    }
+    if (residency.image != VK_NULL_HANDLE) {
+        this->allocator->destroyImage(residency.image, residency.allocation);
+    }
+}
+
+VkDeviceSize vgl::TextureStreamer::getTargetBytes(const Texture& texture) {
+    if (texture.hasPending) {
+        return texture.pending.allocation.size;
+    }
+    return texture.current.allocation.size;
+}
+
+VkDeviceSize vgl::TextureStreamer::getLevelBytes(const Texture& texture, uint32_t baseLevel) {
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = baseLevel; level < texture.levels.size(); level++) {
+        bytes += texture.levels[level].size;
+    }
+    return bytes;
+}
+
+bool vgl::TextureStreamer::getBlockInfo(VkFormat format, uint32_t& bytes, uint32_t& width, uint32_t& height) {
+    width = 1;
+    height = 1;
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        bytes = 1;
+        return true;
+    case VK_FORMAT_R8G8_UNORM:
+        bytes = 2;
+        return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        bytes = 4;
+        return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        bytes = 8;
+        return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        bytes = 16;
+        return true;
+    default:
+        break;
+    }
+
+    //Block compressed formats cover 4x4 texels
+    width = 4;
+    height = 4;
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        bytes = 8;
+        return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        bytes = 16;
+        return true;
+    default:
+        return false;
+    }
+}
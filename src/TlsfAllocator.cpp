@@ -0,0 +1,300 @@
+#include "vgl/TlsfAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+    //Index of the highest set bit, value must not be 0
+    uint32_t findLastSet(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+    }
+
+    //Index of the lowest set bit, value must not be 0
+    uint32_t findFirstSet(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+}
+
+vgl::TlsfAllocator::TlsfAllocator(uint64_t _size)
+    : size(_size)
+{
+    for (auto& firstLevel : this->freeLists) {
+        for (auto& head : firstLevel) {
+            head = invalidIndex;
+        }
+    }
+
+    //Start with a single free block covering the whole range
+    if (this->size > 0) {
+        uint32_t index = this->createBlock();
+        this->blocks[index].offset = 0;
+        this->blocks[index].size = this->size;
+        this->insertFreeBlock(index);
+    }
+}
+
+vgl::TlsfAllocator::Allocation vgl::TlsfAllocator::allocate(uint64_t _size, uint64_t _alignment) {
+    if (_size == 0) { _size = 1; }
+    if (_alignment == 0) { _alignment = 1; }
+
+    //Over-allocate so the offset can always be aligned inside the block that is found
+    uint64_t searchSize = _size + _alignment - 1;
+
+    uint32_t fl, sl;
+    mappingSearch(searchSize, fl, sl);
+    if (fl >= flCount) { return Allocation{}; }
+
+    uint32_t index = this->findFreeBlock(fl, sl);
+    if (index == invalidIndex) { return Allocation{}; }
+
+    this->removeFreeBlock(index);
+
+    //Padding in front of the aligned offset becomes its own free block
+    //The previous physical block can't be free (it would have been merged) so it doesn't need merging
+    uint64_t alignedOffset = alignUp(this->blocks[index].offset, _alignment);
+    uint64_t padding = alignedOffset - this->blocks[index].offset;
+    if (padding > 0) {
+        uint32_t front = this->createBlock();
+        Block& block = this->blocks[index];
+        Block& frontBlock = this->blocks[front];
+
+        frontBlock.offset = block.offset;
+        frontBlock.size = padding;
+        frontBlock.prevPhysical = block.prevPhysical;
+        frontBlock.nextPhysical = index;
+        if (block.prevPhysical != invalidIndex) {
+            this->blocks[block.prevPhysical].nextPhysical = front;
+        }
+
+        block.prevPhysical = front;
+        block.offset += padding;
+        block.size -= padding;
+
+        this->insertFreeBlock(front);
+    }
+
+    //Return whatever is left after the allocation to the free lists
+    if (this->blocks[index].size > _size) {
+        this->splitBlock(index, _size);
+    }
+
+    this->blocks[index].free = false;
+    this->usedSize += this->blocks[index].size;
+    this->allocationCount++;
+
+    Allocation allocation;
+    allocation.offset = this->blocks[index].offset;
+    allocation.size = this->blocks[index].size;
+    allocation.blockIndex = index;
+    return allocation;
+}
+
+void vgl::TlsfAllocator::free(uint32_t _blockIndex) {
+    if (_blockIndex >= this->blocks.size() || this->blocks[_blockIndex].free) {
+        throw std::runtime_error("INVALID TLSF BLOCK FREED");
+    }
+
+    this->usedSize -= this->blocks[_blockIndex].size;
+    this->allocationCount--;
+
+    uint32_t index = _blockIndex;
+
+    //Merge with free neighbours so free space stays in as few blocks as possible
+    uint32_t next = this->blocks[index].nextPhysical;
+    if (next != invalidIndex && this->blocks[next].free) {
+        this->removeFreeBlock(next);
+        this->mergeWithNext(index);
+    }
+
+    uint32_t prev = this->blocks[index].prevPhysical;
+    if (prev != invalidIndex && this->blocks[prev].free) {
+        this->removeFreeBlock(prev);
+        this->mergeWithNext(prev);
+        index = prev;
+    }
+
+    this->insertFreeBlock(index);
+}
+
+vgl::TlsfAllocator::Stats vgl::TlsfAllocator::getStats() const {
+    Stats stats;
+    stats.totalSize = this->size;
+    stats.usedSize = this->usedSize;
+    stats.allocationCount = this->allocationCount;
+    stats.freeBlockCount = this->freeBlockCount;
+
+    //The largest free block is in the highest non empty bucket
+    if (this->flBitmap != 0) {
+        uint32_t fl = findLastSet(this->flBitmap);
+        uint32_t sl = findLastSet(this->slBitmap[fl]);
+        for (uint32_t i = this->freeLists[fl][sl]; i != invalidIndex; i = this->blocks[i].nextFree) {
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, this->blocks[i].size);
+        }
+    }
+
+    return stats;
+}
+
+uint64_t vgl::TlsfAllocator::getSize() const {
+    return this->size;
+}
+
+bool vgl::TlsfAllocator::isEmpty() const {
+    return this->allocationCount == 0;
+}
+
+void vgl::TlsfAllocator::mapping(uint64_t _size, uint32_t& fl, uint32_t& sl) {
+    //Small sizes are bucketed linearly in the first level
+    if (_size < slCount) {
+        fl = 0;
+        sl = static_cast<uint32_t>(_size);
+        return;
+    }
+
+    uint32_t log2 = findLastSet(_size);
+    //Take the slLog2 bits below the highest set bit as the second level index
+    sl = static_cast<uint32_t>(_size >> (log2 - slLog2)) ^ slCount;
+    fl = log2 - slLog2 + 1;
+}
+
+void vgl::TlsfAllocator::mappingSearch(uint64_t _size, uint32_t& fl, uint32_t& sl) {
+    //Round up to the next bucket boundary so any block in the bucket is large enough
+    if (_size >= slCount) {
+        uint64_t round = (1ull << (findLastSet(_size) - slLog2)) - 1;
+        _size += round;
+    }
+    mapping(_size, fl, sl);
+}
+
+uint32_t vgl::TlsfAllocator::findFreeBlock(uint32_t fl, uint32_t sl) const {
+    //Look for a non empty bucket in the same first level at or above sl
+    uint32_t slMap = this->slBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        //Otherwise take the smallest non empty bucket in a higher first level
+        uint64_t flMap = (fl + 1 < 64) ? this->flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) { return invalidIndex; }
+
+        fl = findFirstSet(flMap);
+        slMap = this->slBitmap[fl];
+    }
+
+    sl = findFirstSet(slMap);
+    return this->freeLists[fl][sl];
+}
+
+uint32_t vgl::TlsfAllocator::createBlock() {
+    if (!this->unusedBlocks.empty()) {
+        uint32_t index = this->unusedBlocks.back();
+        this->unusedBlocks.pop_back();
+        this->blocks[index] = Block{};
+        return index;
+    }
+
+    this->blocks.emplace_back();
+    return static_cast<uint32_t>(this->blocks.size() - 1);
+}
+
+void vgl::TlsfAllocator::releaseBlock(uint32_t index) {
+    this->blocks[index] = Block{};
+    this->unusedBlocks.push_back(index);
+}
+
+void vgl::TlsfAllocator::insertFreeBlock(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(this->blocks[index].size, fl, sl);
+
+    uint32_t head = this->freeLists[fl][sl];
+    Block& block = this->blocks[index];
+    block.free = true;
+    block.prevFree = invalidIndex;
+    block.nextFree = head;
+    if (head != invalidIndex) {
+        this->blocks[head].prevFree = index;
+    }
+    this->freeLists[fl][sl] = index;
+
+    this->flBitmap |= 1ull << fl;
+    this->slBitmap[fl] |= 1u << sl;
+    this->freeBlockCount++;
+}
+
+void vgl::TlsfAllocator::removeFreeBlock(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(this->blocks[index].size, fl, sl);
+
+    Block& block = this->blocks[index];
+    if (block.prevFree != invalidIndex) {
+        this->blocks[block.prevFree].nextFree = block.nextFree;
+    }
+    else {
+        this->freeLists[fl][sl] = block.nextFree;
+    }
+    if (block.nextFree != invalidIndex) {
+        this->blocks[block.nextFree].prevFree = block.prevFree;
+    }
+
+    //Clear the bitmap bits if the bucket is now empty
+    if (this->freeLists[fl][sl] == invalidIndex) {
+        this->slBitmap[fl] &= ~(1u << sl);
+        if (this->slBitmap[fl] == 0) {
+            this->flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    block.free = false;
+    block.prevFree = invalidIndex;
+    block.nextFree = invalidIndex;
+    this->freeBlockCount--;
+}
+
+void vgl::TlsfAllocator::splitBlock(uint32_t index, uint64_t _size) {
+    uint32_t remainder = this->createBlock();
+    Block& block = this->blocks[index];
+    Block& remainderBlock = this->blocks[remainder];
+
+    remainderBlock.offset = block.offset + _size;
+    remainderBlock.size = block.size - _size;
+    remainderBlock.prevPhysical = index;
+    remainderBlock.nextPhysical = block.nextPhysical;
+    if (block.nextPhysical != invalidIndex) {
+        this->blocks[block.nextPhysical].prevPhysical = remainder;
+    }
+
+    block.nextPhysical = remainder;
+    block.size = _size;
+
+    this->insertFreeBlock(remainder);
+}
+
+void vgl::TlsfAllocator::mergeWithNext(uint32_t index) {
+    uint32_t next = this->blocks[index].nextPhysical;
+    Block& block = this->blocks[index];
+    Block& nextBlock = this->blocks[next];
+
+    block.size += nextBlock.size;
+    block.nextPhysical = nextBlock.nextPhysical;
+    if (nextBlock.nextPhysical != invalidIndex) {
+        this->blocks[nextBlock.nextPhysical].prevPhysical = index;
+    }
+
+    this->releaseBlock(next);
+}
@@ -0,0 +1,411 @@
+#include "vgl/UploadEngine.h"
+
+#include "vgl/HostAllocator.h"
+
+vgl::UploadEngine::UploadEngine(vgl::LogicalDevice* _logicalDevice, VkDeviceSize _stagingSize, VkDeviceSize _batchSize)
+    : logicalDevice(_logicalDevice),
+    allocator(_logicalDevice->getAllocator()),
+    ringSize(_stagingSize),
+    batchSize(_batchSize)
+{
+    VkDevice device = this->logicalDevice->device;
+    const vgl::QueueFamilyIndices& indices = this->logicalDevice->queueFamilyIndices;
+
+    this->queue = this->logicalDevice->transferQueue;
+    this->dedicatedQueue = indices.hasDedicatedTransfer();
+    this->graphicsFamily = indices.graphicsFamily.value();
+    this->transferFamily = this->dedicatedQueue ? indices.transferFamily.value() : this->graphicsFamily;
+
+    //Staging offsets also have to respect the flush granularity when the memory isn't coherent
+    const VkPhysicalDeviceLimits& limits = this->allocator->getLimits();
+    this->copyAlignment = std::max<VkDeviceSize>({ 16, limits.optimalBufferCopyOffsetAlignment, limits.nonCoherentAtomSize });
+
+    //Command buffers are recycled individually as their batches finish
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = this->transferFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, vgl::HostAllocator::callbacks(), &this->commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE UPLOAD COMMAND POOL");
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, vgl::HostAllocator::callbacks(), &this->timeline) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE UPLOAD TIMELINE SEMAPHORE");
+    }
+
+    //Written once by the CPU and read once by the copy, so host visible memory is fine
+    this->allocator->createBuffer(this->ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        this->ringBuffer, this->ringAllocation, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+vgl::UploadEngine::~UploadEngine() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    //Let every queued copy finish so nothing references the staging memory
+    this->submitBatch();
+    this->retireBatches(this->nextValue - 1);
+
+    VkDevice device = this->logicalDevice->device;
+    this->allocator->destroyBuffer(this->ringBuffer, this->ringAllocation);
+    vkDestroySemaphore(device, this->timeline, vgl::HostAllocator::callbacks());
+    //Destroying the pool frees its command buffers
+    vkDestroyCommandPool(device, this->commandPool, vgl::HostAllocator::callbacks());
+}
+
+vgl::UploadTicket vgl::UploadEngine::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+    if (size == 0) { return 0; }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    StagingRegion region = this->reserveStaging(size, this->copyAlignment);
+    memcpy(region.mapped, data, static_cast<size_t>(size));
+    if (region.buffer == this->ringBuffer) {
+        this->allocator->flush(this->ringAllocation, region.offset, size);
+    }
+    else {
+        this->allocator->flush(this->recording.temporaryBuffers.back().allocation);
+    }
+
+    this->beginBatch();
+    VkCommandBuffer commandBuffer = this->recording.commandBuffer;
+
+    VkBufferCopy copy{};
+    copy.srcOffset = region.offset;
+    copy.dstOffset = dstOffset;
+    copy.size = size;
+    vkCmdCopyBuffer(commandBuffer, region.buffer, dst, 1, &copy);
+
+    //Hand the range over to the graphics queue, the matching acquire is recorded by recordAcquireBarriers
+    if (this->dedicatedQueue) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = this->transferFamily;
+        barrier.dstQueueFamilyIndex = this->graphicsFamily;
+        barrier.buffer = dst;
+        barrier.offset = dstOffset;
+        barrier.size = size;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        this->recording.bufferAcquires.push_back(barrier);
+    }
+
+    return this->finishUpload(size);
+}
+
+vgl::UploadTicket vgl::UploadEngine::uploadImage(VkImage dst, const vgl::ImageUploadInfo& info, const void* data, VkDeviceSize size) {
+    if (size == 0) { return 0; }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    //Buffer offsets for image copies have to be a multiple of the texel block size as well
+    VkDeviceSize alignment = this->copyAlignment;
+    if (info.texelBlockSize > 0 && alignment % info.texelBlockSize != 0) {
+        alignment *= info.texelBlockSize;
+    }
+
+    StagingRegion region = this->reserveStaging(size, alignment);
+    memcpy(region.mapped, data, static_cast<size_t>(size));
+    if (region.buffer == this->ringBuffer) {
+        this->allocator->flush(this->ringAllocation, region.offset, size);
+    }
+    else {
+        this->allocator->flush(this->recording.temporaryBuffers.back().allocation);
+    }
+
+    this->beginBatch();
+    VkCommandBuffer commandBuffer = this->recording.commandBuffer;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dst;
+    barrier.subresourceRange.aspectMask = info.aspectMask;
+    barrier.subresourceRange.baseMipLevel = info.mipLevel;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = info.baseArrayLayer;
+    barrier.subresourceRange.layerCount = info.layerCount;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy copy{};
+    copy.bufferOffset = region.offset;
+    copy.bufferRowLength = 0;
+    copy.bufferImageHeight = 0;
+    copy.imageSubresource.aspectMask = info.aspectMask;
+    copy.imageSubresource.mipLevel = info.mipLevel;
+    copy.imageSubresource.baseArrayLayer = info.baseArrayLayer;
+    copy.imageSubresource.layerCount = info.layerCount;
+    copy.imageOffset = { 0, 0, 0 };
+    copy.imageExtent = info.extent;
+    vkCmdCopyBufferToImage(commandBuffer, region.buffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+    //Transition to the final layout, with a dedicated queue this is part of the ownership transfer and happens once across the release and acquire
+    //Visibility to the graphics queue comes from the frame waiting on the timeline semaphore
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = info.finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    if (this->dedicatedQueue) {
+        barrier.srcQueueFamilyIndex = this->transferFamily;
+        barrier.dstQueueFamilyIndex = this->graphicsFamily;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    if (this->dedicatedQueue) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        this->recording.imageAcquires.push_back(barrier);
+    }
+
+    return this->finishUpload(size);
+}
+
+vgl::UploadTicket vgl::UploadEngine::flush() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->submitBatch();
+    return this->nextValue - 1;
+}
+
+bool vgl::UploadEngine::isComplete(UploadTicket ticket) {
+    return ticket <= this->getCompletedValue();
+}
+
+bool vgl::UploadEngine::isReady(UploadTicket ticket) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return ticket <= this->acquiredValue;
+}
+
+void vgl::UploadEngine::wait(UploadTicket ticket) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    //The ticket may belong to the batch still being recorded
+    if (this->recordingStarted && ticket >= this->recording.value) {
+        this->submitBatch();
+    }
+    this->retireBatches(std::min(ticket, this->nextValue - 1));
+}
+
+uint64_t vgl::UploadEngine::recordAcquireBarriers(VkCommandBuffer graphicsCommandBuffer) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->retireBatches(0);
+    if (this->pendingAcquireValue == 0) { return 0; }
+
+    //Only finished batches are acquired, so waiting on the semaphore never stalls the graphics queue
+    if (!this->pendingBufferAcquires.empty() || !this->pendingImageAcquires.empty()) {
+        vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+            static_cast<uint32_t>(this->pendingBufferAcquires.size()), this->pendingBufferAcquires.data(),
+            static_cast<uint32_t>(this->pendingImageAcquires.size()), this->pendingImageAcquires.data());
+    }
+    this->pendingBufferAcquires.clear();
+    this->pendingImageAcquires.clear();
+
+    uint64_t value = this->pendingAcquireValue;
+    this->acquiredValue = value;
+    this->pendingAcquireValue = 0;
+    return value;
+}
+
+VkSemaphore vgl::UploadEngine::getSemaphore() const {
+    return this->timeline;
+}
+
+vgl::UploadEngine::Stats vgl::UploadEngine::getStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void vgl::UploadEngine::beginBatch() {
+    if (this->recordingStarted) { return; }
+
+    if (this->freeCommandBuffers.empty()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = this->commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(this->logicalDevice->device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("FAILED TO ALLOCATE UPLOAD COMMAND BUFFER");
+        }
+        this->freeCommandBuffers.push_back(commandBuffer);
+    }
+
+    this->recording.commandBuffer = this->freeCommandBuffers.back();
+    this->freeCommandBuffers.pop_back();
+    this->recording.value = this->nextValue;
+
+    //Beginning implicitly resets the command buffer since the pool allows individual resets
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(this->recording.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO BEGIN RECORDING UPLOAD COMMAND BUFFER");
+    }
+
+    this->recordingStarted = true;
+}
+
+void vgl::UploadEngine::submitBatch() {
+    if (!this->recordingStarted) { return; }
+
+    if (vkEndCommandBuffer(this->recording.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO RECORD UPLOAD COMMAND BUFFER");
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &this->recording.value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &this->recording.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &this->timeline;
+
+    //Tickets are handed out before the batch is submitted so uploads keep their own timeline rather than the scheduler's
+    //The transfer queue can be the graphics queue, so the submit is still serialised with the scheduler's
+    VkResult result = VK_SUCCESS;
+    {
+        std::lock_guard<std::mutex> queueLock(this->logicalDevice->getQueueScheduler()->getQueueMutex(this->queue));
+        result = vkQueueSubmit(this->queue, 1, &submitInfo, VK_NULL_HANDLE);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO SUBMIT UPLOAD BATCH");
+    }
+
+    this->recording.ringEnd = this->ringHead;
+    this->inFlight.push_back(std::move(this->recording));
+    this->recording = Batch{};
+    this->recordingStarted = false;
+    this->nextValue++;
+    this->stats.batchesSubmitted++;
+}
+
+void vgl::UploadEngine::retireBatches(uint64_t waitValue) {
+    if (waitValue > 0) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &this->timeline;
+        waitInfo.pValues = &waitValue;
+        vkWaitSemaphores(this->logicalDevice->device, &waitInfo, UINT64_MAX);
+    }
+
+    uint64_t completed = this->getCompletedValue();
+    while (!this->inFlight.empty() && this->inFlight.front().value <= completed) {
+        Batch& batch = this->inFlight.front();
+
+        this->ringTail = batch.ringEnd;
+        for (auto& temporary : batch.temporaryBuffers) {
+            this->allocator->destroyBuffer(temporary.buffer, temporary.allocation);
+        }
+        this->freeCommandBuffers.push_back(batch.commandBuffer);
+
+        this->pendingBufferAcquires.insert(this->pendingBufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+        this->pendingImageAcquires.insert(this->pendingImageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+        this->pendingAcquireValue = batch.value;
+
+        this->inFlight.pop_front();
+    }
+}
+
+vgl::UploadEngine::StagingRegion vgl::UploadEngine::reserveStaging(VkDeviceSize size, VkDeviceSize alignment) {
+    StagingRegion region;
+
+    //Large uploads would hold most of the ring and force everything else to wait, give them their own buffer instead
+    if (size > this->ringSize / 2) {
+        TemporaryBuffer temporary;
+        this->allocator->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            temporary.buffer, temporary.allocation, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        this->recording.temporaryBuffers.push_back(temporary);
+
+        region.buffer = temporary.buffer;
+        region.offset = 0;
+        region.mapped = temporary.allocation.mapped;
+        return region;
+    }
+
+    while (!this->tryReserveRing(size, alignment, region)) {
+        //The batch being recorded holds ring space that can only be reclaimed once it has been submitted
+        this->submitBatch();
+
+        //Nothing is using the ring, start again from the beginning so the upload can't be blocked by wasted space at the end
+        if (this->inFlight.empty()) {
+            this->ringHead = this->ringTail;
+            this->ringOffset = 0;
+            continue;
+        }
+
+        this->stats.stagingStalls++;
+        this->retireBatches(this->inFlight.front().value);
+    }
+
+    return region;
+}
+
+bool vgl::UploadEngine::tryReserveRing(VkDeviceSize size, VkDeviceSize alignment, StagingRegion& region) {
+    VkDeviceSize offset = ((this->ringOffset + alignment - 1) / alignment) * alignment;
+    VkDeviceSize padding = offset - this->ringOffset;
+
+    //Not enough room before the end of the buffer, skip the rest and wrap around to the start
+    if (offset + size > this->ringSize) {
+        padding = this->ringSize - this->ringOffset;
+        offset = 0;
+    }
+
+    if (this->ringHead + padding + size - this->ringTail > this->ringSize) {
+        return false;
+    }
+
+    this->ringHead += padding + size;
+    this->ringOffset = offset + size;
+
+    region.buffer = this->ringBuffer;
+    region.offset = offset;
+    region.mapped = static_cast<char*>(this->ringAllocation.mapped) + offset;
+    return true;
+}
+
+vgl::UploadTicket vgl::UploadEngine::finishUpload(VkDeviceSize size) {
+    this->stats.bytesUploaded += size;
+    this->stats.uploadCount++;
+    this->recording.bytes += size;
+
+    UploadTicket ticket = this->recording.value;
+    if (this->recording.bytes >= this->batchSize) {
+        this->submitBatch();
+    }
+    return ticket;
+}
+
+uint64_t vgl::UploadEngine::getCompletedValue() const {
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(this->logicalDevice->device, this->timeline, &value);
+    return value;
+}
@@ -1,9 +1,19 @@
 #include "vgl/VulkanCore.h"
 
-vgl::VulkanCore::VulkanCore(vgl::Window *_window){
+#include "vgl/CpuProfiler.h"
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+
+vgl::VulkanCore::VulkanCore(vgl::Window *_window, const vgl::DeviceFilter& _deviceFilter)
+    : deviceFilter(_deviceFilter)
+{
+    VGL_PROFILE_SCOPE("VulkanCore::VulkanCore");
 
     //Set window
     this->window = std::make_unique<vgl::Window>(*_window);
+    this->applicationName = this->window->windowName;
+    //GLFW callbacks (e.g. framebuffer resize) need to reach the core's copy of the window
+    glfwSetWindowUserPointer(this->window->window, this->window.get());
     
     //Create a vulkan instance
     this->createInstance();
@@ -13,30 +23,335 @@ vgl::VulkanCore::VulkanCore(vgl::Window *_window){
 
     //Create vulkan surface inside window
     this->window->createVulkanSurface(this->instance);
+    this->surface = this->window->surface;
+
+    //Set the physical device and create the logical device
+    this->createDevices();
+
+    //Create the swap chain and per-frame resources
+    this->renderer = std::make_unique<vgl::FrameRenderer>(this->physicalDevice.get(), this->logicalDevice.get(), this->surface, this->window.get(),
+        this->window->getFramebufferSize());
+    this->createFrameArena();
+    this->createUploadEngine();
+    this->createCommandRecorder();
+    this->createRenderGraph();
+    this->createBindlessHeap();
+    this->createDescriptorAllocator();
+    this->createGpuProfiler();
+    this->createTextureStreamer();
+    this->createDrawBatcher();
+    this->connectCpuProfiler();
+    this->asyncCompute = std::make_unique<vgl::AsyncCompute>(this->logicalDevice.get());
+
+    VGL_LOG_INFO("Core", "CORE CREATED");
+}
+
+vgl::VulkanCore::VulkanCore(const vgl::HeadlessSettings& _settings)
+    : headless(true),
+    headlessSettings(_settings),
+    applicationName(_settings.applicationName),
+    pipelineCacheDirectory(_settings.pipelineCacheDirectory),
+    deviceFilter(_settings.deviceFilter)
+{
+    VGL_PROFILE_SCOPE("VulkanCore::VulkanCore");
+
+    //No window is created so GLFW is never initialised
+
+    //Create a vulkan instance
+    this->createInstance();
+
+    //Setup a debug messenger
+    this->setupDebugMessenger();
 
-    //Set the physical device
-    this->physicalDevice = vgl::PhysicalDevice(std::make_shared<const VkInstance>(this->instance), this->deviceExtensions, std::make_shared<VkSurfaceKHR>(this->window->surface));
+    //Optionally create a headless surface so swap chain code paths can still be used
+    if (this->headlessSettings.useHeadlessSurface) {
+        this->createHeadlessSurface();
+    }
 
-    this->logicalDevice = vgl::LogicalDevice(std::make_shared<const VkInstance>(this->instance), this->deviceExtensions, std::make_shared<VkSurfaceKHR>(this->window->surface));
+    //Set the physical device and create the logical device
+    this->createDevices();
 
+    //Render into an offscreen image instead of a swap chain
+    this->offscreenTarget = std::make_unique<vgl::OffscreenTarget>(this->logicalDevice.get(),
+        VkExtent2D{ this->headlessSettings.width, this->headlessSettings.height }, this->headlessSettings.format);
 
-    std::cout << "CORE CREATED\n";
+    //With a headless surface the swap chain path is used so it can be exercised without a display
+    if (this->surface) {
+        this->renderer = std::make_unique<vgl::FrameRenderer>(this->physicalDevice.get(), this->logicalDevice.get(), this->surface, nullptr,
+            VkExtent2D{ this->headlessSettings.width, this->headlessSettings.height });
+    }
+    else {
+        this->renderer = std::make_unique<vgl::FrameRenderer>(this->logicalDevice.get(), this->offscreenTarget.get());
+    }
+    this->createFrameArena();
+    this->createUploadEngine();
+    this->createCommandRecorder();
+    this->createRenderGraph();
+    this->createBindlessHeap();
+    this->createDescriptorAllocator();
+    this->createGpuProfiler();
+    this->createTextureStreamer();
+    this->createDrawBatcher();
+    this->connectCpuProfiler();
+    this->asyncCompute = std::make_unique<vgl::AsyncCompute>(this->logicalDevice.get());
+
+    VGL_LOG_INFO("Core", "HEADLESS CORE CREATED");
 }
 
 vgl::VulkanCore::~VulkanCore() {
-    std::cout << "Destroying Vulkan Core\n";
+    VGL_LOG_INFO("Core", "Destroying Vulkan Core");
+
+    //Device objects have to be destroyed before the device and the device before the instance
+    this->waitIdle();
+    this->renderer.reset();
+    this->textureStreamer.reset();
+    this->drawBatcher.reset();
+    this->commandRecorder.reset();
+    this->renderGraph.reset();
+    this->bindlessHeap.reset();
+    this->descriptorAllocator.reset();
+    this->gpuProfiler.reset();
+    this->asyncCompute.reset();
+    this->uploadEngine.reset();
+    this->frameArena.reset();
+    this->offscreenTarget.reset();
+    this->logicalDevice.reset();
 
     if (this->enableValidationLayers) {
-        this->DestroyDebugUtilsMessengerEXT(this->instance, this->debugMessenger, nullptr);
+        this->DestroyDebugUtilsMessengerEXT(this->instance, this->debugMessenger, vgl::HostAllocator::callbacks());
     }
 
     //this->window->~Window();
 
-    if (this->window->window) { this->window->~Window(); this->window.release(); }
+    if (this->window && this->window->window) { this->window->~Window(); this->window.release(); }
+
+    //Headless surface is owned by the core rather than a window
+    if (this->headless && this->surface) {
+        vkDestroySurfaceKHR(this->instance, this->surface, vgl::HostAllocator::callbacks());
+    }
+
+    vkDestroyInstance(this->instance, vgl::HostAllocator::callbacks());
+
+    VGL_LOG_INFO("Core", "Destroyed Vulkan Core");
+}
+
+bool vgl::VulkanCore::isHeadless() const {
+    return this->headless;
+}
+
+vgl::OffscreenTarget* vgl::VulkanCore::getOffscreenTarget() const {
+    return this->offscreenTarget.get();
+}
+
+vgl::PhysicalDevice* vgl::VulkanCore::getPhysicalDevice() const {
+    return this->physicalDevice.get();
+}
+
+vgl::LogicalDevice* vgl::VulkanCore::getLogicalDevice() const {
+    return this->logicalDevice.get();
+}
+
+vgl::FrameRenderer* vgl::VulkanCore::getRenderer() const {
+    return this->renderer.get();
+}
+
+bool vgl::VulkanCore::drawFrame(const vgl::FrameRenderer::RecordFunction& record) {
+    return this->renderer->drawFrame(record);
+}
+
+const vgl::FrameStats& vgl::VulkanCore::getFrameStats() const {
+    return this->renderer->getStats();
+}
+
+vgl::LinearArena* vgl::VulkanCore::getFrameArena() const {
+    return this->frameArena.get();
+}
+
+void vgl::VulkanCore::createFrameArena() {
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+        | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    this->frameArena = std::make_unique<vgl::LinearArena>(this->logicalDevice->getAllocator(), frameArenaSize, this->renderer->getFramesInFlight(), usage);
+
+    vgl::LinearArena* arena = this->frameArena.get();
+    this->renderer->addFrameBeginCallback([arena](uint32_t frameIndex) { arena->beginFrame(frameIndex); });
+}
+
+vgl::CommandRecorder* vgl::VulkanCore::getCommandRecorder() const {
+    return this->commandRecorder.get();
+}
+
+void vgl::VulkanCore::createCommandRecorder() {
+    this->commandRecorder = std::make_unique<vgl::CommandRecorder>(this->logicalDevice.get(), this->logicalDevice->getJobSystem(),
+        this->logicalDevice->queueFamilyIndices.graphicsFamily.value(), this->renderer->getFramesInFlight());
+
+    vgl::CommandRecorder* recorder = this->commandRecorder.get();
+    this->renderer->addFrameBeginCallback([recorder](uint32_t frameIndex) { recorder->beginFrame(frameIndex); });
+}
+
+vgl::RenderGraph* vgl::VulkanCore::getRenderGraph() const {
+    return this->renderGraph.get();
+}
+
+void vgl::VulkanCore::createRenderGraph() {
+    this->renderGraph = std::make_unique<vgl::RenderGraph>(this->logicalDevice.get(), this->renderer->getFramesInFlight());
 
-    vkDestroyInstance(this->instance, nullptr);
+    vgl::RenderGraph* graph = this->renderGraph.get();
+    this->renderer->addFrameBeginCallback([graph](uint32_t) { graph->beginFrame(); });
+}
+
+vgl::BindlessHeap* vgl::VulkanCore::getBindlessHeap() const {
+    return this->bindlessHeap.get();
+}
+
+void vgl::VulkanCore::createBindlessHeap() {
+    if (!this->logicalDevice->isBindlessEnabled()) {
+        VGL_LOG_WARNING("Core", "DESCRIPTOR INDEXING NOT SUPPORTED, CONTINUING WITHOUT A BINDLESS HEAP");
+        return;
+    }
+
+    this->bindlessHeap = std::make_unique<vgl::BindlessHeap>(this->logicalDevice.get(), this->renderer->getFramesInFlight());
+
+    vgl::BindlessHeap* heap = this->bindlessHeap.get();
+    this->renderer->addFrameBeginCallback([heap](uint32_t) { heap->beginFrame(); });
+}
 
-    std::cout << "Destroyed Vulkan Core\n";
+vgl::DescriptorAllocator* vgl::VulkanCore::getDescriptorAllocator() const {
+    return this->descriptorAllocator.get();
+}
+
+void vgl::VulkanCore::createDescriptorAllocator() {
+    this->descriptorAllocator = std::make_unique<vgl::DescriptorAllocator>(this->logicalDevice.get(), this->logicalDevice->getJobSystem(),
+        this->renderer->getFramesInFlight());
+
+    vgl::DescriptorAllocator* allocator = this->descriptorAllocator.get();
+    this->renderer->addFrameBeginCallback([allocator](uint32_t frameIndex) { allocator->beginFrame(frameIndex); });
+}
+
+vgl::GpuProfiler* vgl::VulkanCore::getGpuProfiler() const {
+    return this->gpuProfiler.get();
+}
+
+void vgl::VulkanCore::createGpuProfiler() {
+    if (!vgl::GpuProfiler::isSupported(this->logicalDevice.get())) {
+        VGL_LOG_WARNING("Core", "TIMESTAMP QUERIES NOT SUPPORTED, CONTINUING WITHOUT A GPU PROFILER");
+        return;
+    }
+
+    this->gpuProfiler = std::make_unique<vgl::GpuProfiler>(this->logicalDevice.get(), this->renderer->getFramesInFlight());
+
+    vgl::GpuProfiler* profiler = this->gpuProfiler.get();
+    //Read back the results of the frame that last used this index, its fence has just signalled
+    this->renderer->addFrameBeginCallback([profiler](uint32_t frameIndex) { profiler->beginFrame(frameIndex); });
+    //Reset the frame's queries before anything can write to them
+    this->renderer->addRecordCallback([profiler](const vgl::FrameContext& frame) { profiler->beginCommandBuffer(frame.commandBuffer, frame.frameIndex); });
+    //The device is idle while the swap chain is recreated, the one time a submitted calibration isn't delayed by frames in flight
+    if (!this->logicalDevice->isCalibratedTimestampsEnabled()) {
+        this->renderer->addResizeCallback([profiler](VkExtent2D) { profiler->calibrate(); });
+    }
+}
+
+vgl::TextureStreamer* vgl::VulkanCore::getTextureStreamer() const {
+    return this->textureStreamer.get();
+}
+
+void vgl::VulkanCore::createTextureStreamer() {
+    this->textureStreamer = std::make_unique<vgl::TextureStreamer>(this->logicalDevice.get(), this->uploadEngine.get(), this->bindlessHeap.get(),
+        this->renderer->getFramesInFlight());
+
+    vgl::TextureStreamer* streamer = this->textureStreamer.get();
+    //Runs after the upload engine's flush, so residency changes are submitted by the streamer itself
+    this->renderer->addFrameBeginCallback([streamer](uint32_t) { streamer->update(); });
+}
+
+vgl::DrawBatcher* vgl::VulkanCore::getDrawBatcher() const {
+    return this->drawBatcher.get();
+}
+
+void vgl::VulkanCore::createDrawBatcher() {
+    this->drawBatcher = std::make_unique<vgl::DrawBatcher>(this->logicalDevice.get(), this->logicalDevice->getJobSystem(), this->renderer->getFramesInFlight());
+
+    vgl::DrawBatcher* batcher = this->drawBatcher.get();
+    this->renderer->addFrameBeginCallback([batcher](uint32_t frameIndex) { batcher->beginFrame(frameIndex); });
+}
+
+void vgl::VulkanCore::connectCpuProfiler() {
+#ifdef VGL_PROFILING
+    //Drain every thread's samples once a frame so the rings never fill up
+    this->renderer->addFrameBeginCallback([](uint32_t) { vgl::CpuProfiler::get().collect(); });
+#endif
+}
+
+vgl::UploadEngine* vgl::VulkanCore::getUploadEngine() const {
+    return this->uploadEngine.get();
+}
+
+vgl::AsyncCompute* vgl::VulkanCore::getAsyncCompute() const {
+    return this->asyncCompute.get();
+}
+
+void vgl::VulkanCore::createUploadEngine() {
+    this->uploadEngine = std::make_unique<vgl::UploadEngine>(this->logicalDevice.get());
+
+    vgl::UploadEngine* engine = this->uploadEngine.get();
+    vgl::FrameRenderer* frameRenderer = this->renderer.get();
+
+    //Submit whatever was queued during the last frame
+    this->renderer->addFrameBeginCallback([engine](uint32_t) { engine->flush(); });
+
+    //Acquire finished uploads before anything in the frame can use them
+    this->renderer->addRecordCallback([engine, frameRenderer](const vgl::FrameContext& frame) {
+        uint64_t value = engine->recordAcquireBarriers(frame.commandBuffer);
+        if (value != 0) {
+            frameRenderer->addWaitSemaphore(engine->getSemaphore(), value, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+    });
+}
+
+void vgl::VulkanCore::waitIdle() {
+    if (this->logicalDevice) {
+        //Work still queued in the scheduler isn't on a queue yet, so it has to be flushed for the device to finish it
+        this->logicalDevice->getQueueScheduler()->deviceWaitIdle();
+    }
+}
+
+void vgl::VulkanCore::createDevices() {
+    VGL_PROFILE_SCOPE("VulkanCore::createDevices");
+
+    //Swap chains can only be created when there is a surface
+    if (this->surface) {
+        this->deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    auto instancePtr = std::make_shared<const VkInstance>(this->instance);
+    auto surfacePtr = std::make_shared<VkSurfaceKHR>(this->surface);
+
+    //Device capabilities are persisted next to the pipeline cache so later runs skip querying them
+    this->physicalDevice = std::make_unique<vgl::PhysicalDevice>(instancePtr, this->deviceExtensions, surfacePtr, this->deviceFilter, this->pipelineCacheDirectory);
+
+    const std::vector<const char*> deviceLayers = this->enableValidationLayers ? this->validationLayers : std::vector<const char*>{};
+    this->logicalDevice = std::make_unique<vgl::LogicalDevice>(instancePtr, this->deviceExtensions, deviceLayers, surfacePtr, this->physicalDevice->getCapabilities(),
+        this->pipelineCacheDirectory);
+}
+
+//Create a surface that is not backed by a window
+//Presenting to it is a no-op but it allows swap chains to be created on machines without a display
+void vgl::VulkanCore::createHeadlessSurface() {
+    if (!this->checkInstanceExtensionSupport(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME)) {
+        VGL_LOG_WARNING("Core", "VK_EXT_headless_surface NOT AVAILABLE, CONTINUING WITHOUT A SURFACE");
+        return;
+    }
+
+    auto func = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(this->instance, "vkCreateHeadlessSurfaceEXT");
+    if (func == nullptr) {
+        throw std::runtime_error("FAILED TO LOAD vkCreateHeadlessSurfaceEXT");
+    }
+
+    VkHeadlessSurfaceCreateInfoEXT createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+    if (func(this->instance, &createInfo, vgl::HostAllocator::callbacks(), &this->surface) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE HEADLESS SURFACE");
+    }
 }
 
 
@@ -49,6 +364,7 @@ vgl::VulkanCore::~VulkanCore() {
 //Creating it  involves specifying details about the application to the driver
 void vgl::VulkanCore::createInstance() {
     if (this->instance) { return; }
+    VGL_PROFILE_SCOPE("VulkanCore::createInstance");
     //Check if validation layers have been requested and if so are available
     if (this->enableValidationLayers && !this->checkValidationLayerSupport()) {
         throw std::runtime_error("VALIDATION LAYERS REQUESTED, BUT NOT AVAILABLE");
@@ -58,7 +374,7 @@ void vgl::VulkanCore::createInstance() {
     //Technically optional but may provide useful information to the driver in order to optimise the application
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = this->window->windowName.c_str();
+    appInfo.pApplicationName = this->applicationName.c_str();
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
@@ -70,17 +386,10 @@ void vgl::VulkanCore::createInstance() {
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
-    //Vulkan is a platform agnostic API, meaning that you need an extension to interface with the window system
-    //GLFW has a built-in function that returns the extension(s) it needs
     /*
     If Encountered VK_ERROR_INCOMPATIBLE_DRIVER
     https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Instance#:~:text=is%20created%20successfully.-,Encountered%20VK_ERROR_INCOMPATIBLE_DRIVER%3A,-If%20using%20MacOS
     */
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    createInfo.enabledExtensionCount = glfwExtensionCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
 
     //Include validation layer names if they are enabled
     if (this->enableValidationLayers) {
@@ -118,7 +427,7 @@ void vgl::VulkanCore::createInstance() {
         - Pointer to the variable that stores the handle to the new object
     */
     //Nearly all Vulkan functions return a value of the type VkResult that is either VK_SUCCESS or an error code
-    if (vkCreateInstance(&createInfo, nullptr, &this->instance) != VK_SUCCESS) {
+    if (vkCreateInstance(&createInfo, vgl::HostAllocator::callbacks(), &this->instance) != VK_SUCCESS) {
         throw std::runtime_error("FAILED TO CREATE INSTANCE");
     }
 }
@@ -155,14 +464,46 @@ bool vgl::VulkanCore::checkValidationLayerSupport() {
 
 
 
+//Checks if an instance extension is available
+bool vgl::VulkanCore::checkInstanceExtensionSupport(const char* extensionName) {
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extensionName, extension.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+
+
 //Returns the required list of extensions based on whether validation layers are enabled or not
-//The extensions specified by GLFW are always required, but the debug messenger extension is conditionally added
+//Vulkan is a platform agnostic API, meaning that you need an extension to interface with the window system
+//When there is a window the extensions specified by GLFW are required, when headless GLFW is never touched
+//The debug messenger extension is conditionally added
 std::vector<const char*> vgl::VulkanCore::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    if (this->window) {
+        //GLFW has a built-in function that returns the extension(s) it needs
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
+    else if (this->headlessSettings.useHeadlessSurface && this->checkInstanceExtensionSupport(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME)) {
+        extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+    }
 
     if (this->enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -187,9 +528,12 @@ void vgl::VulkanCore::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCrea
 
     Using top 3 will mean receiving notifications about possible problems while leaving out verbose general debug info
     */
-    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
-        | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
+    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
         | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    //Verbose and info messages are only requested if they would be logged, the layers are much slower when they have to produce them
+    if (vgl::Logger::get().isEnabled(vgl::LogLevel::Verbose)) {
+        createInfo.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+    }
 
     //Allows specification about the types of messages which the callback function is notified about
     createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
@@ -240,7 +584,24 @@ VKAPI_ATTR VkBool32 VKAPI_CALL vgl::VulkanCore::debugCallback(VkDebugUtilsMessag
     const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
     void* pUserData)
 {
-    std::cerr << "Validation Layer: " << pCallbackData->pMessage << std::endl;
+    vgl::LogLevel level = vgl::LogLevel::Verbose;
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        level = vgl::LogLevel::Error;
+    }
+    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        level = vgl::LogLevel::Warning;
+    }
+    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+        level = vgl::LogLevel::Info;
+    }
+
+    //Queued rather than written here, the layers call this from whichever thread made the Vulkan call
+    //The same message ID is usually reported every frame, so it is rate limited on its ID
+    vgl::Logger& logger = vgl::Logger::get();
+    if (logger.isEnabled(level)) {
+        uint64_t repeatKey = (1ull << 32) | static_cast<uint32_t>(pCallbackData->messageIdNumber);
+        logger.log(level, "Validation", pCallbackData->pMessage ? pCallbackData->pMessage : "", repeatKey);
+    }
     return VK_FALSE;
 }
 
@@ -281,8 +642,8 @@ void vgl::VulkanCore::setupDebugMessenger() {
     VkDebugUtilsMessengerCreateInfoEXT createInfo{};
     populateDebugMessengerCreateInfo(createInfo);
 
-    //Second to last parameter is again the optional allocator callbas that gets set to nullptr often
-    if (this->CreateDebugUtilsMessengerEXT(this->instance, &createInfo, nullptr, &this->debugMessenger) != VK_SUCCESS) {
+    //Second to last parameter is again the optional allocator callbacks, the messenger is destroyed with the same ones
+    if (this->CreateDebugUtilsMessengerEXT(this->instance, &createInfo, vgl::HostAllocator::callbacks(), &this->debugMessenger) != VK_SUCCESS) {
         throw std::runtime_error("FAILED TO SET UP DEBUG MESSENGER");
     }
 }
\ No newline at end of file
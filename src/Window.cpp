@@ -1,5 +1,8 @@
 #include "vgl/Window.h"
 
+#include "vgl/HostAllocator.h"
+#include "vgl/Logger.h"
+
 //Constructors
 vgl::Window::Window(){
 	this->initGLFWWindow();
@@ -22,7 +25,7 @@ vgl::Window::~Window() {
 	//Window destructor can be called twice, when the core is destroyed/goes out of scope and when the window goes out of scope
 	//Have to check if inctance and surface have not been destroyed to avoid errors
 	if (this->instance && this->surface) {
-		vkDestroySurfaceKHR(*this->instance, this->surface, nullptr);
+		vkDestroySurfaceKHR(*this->instance, this->surface, vgl::HostAllocator::callbacks());
 	}
 	if (this->window) {
 		glfwDestroyWindow(this->window);
@@ -32,7 +35,7 @@ vgl::Window::~Window() {
 }
 
 void vgl::Window::testPrint(){
-	std::cout << "IN WINDOW\n";
+	VGL_LOG_INFO("Window", "IN WINDOW");
 }
 
 
@@ -44,11 +47,21 @@ void vgl::Window::pollEvents() {
 	glfwPollEvents();
 }
 
+void vgl::Window::waitEvents() {
+	glfwWaitEvents();
+}
+
+VkExtent2D vgl::Window::getFramebufferSize() {
+	int fbWidth = 0, fbHeight = 0;
+	glfwGetFramebufferSize(this->window, &fbWidth, &fbHeight);
+	return VkExtent2D{ static_cast<uint32_t>(fbWidth), static_cast<uint32_t>(fbHeight) };
+}
+
 
 //Create Vulkan surface
 void vgl::Window::createVulkanSurface(VkInstance& instance) {
 	this->instance = std::make_shared<VkInstance>(instance);
-	if (glfwCreateWindowSurface(instance, this->window, nullptr, &this->surface) != VK_SUCCESS) {
+	if (glfwCreateWindowSurface(instance, this->window, vgl::HostAllocator::callbacks(), &this->surface) != VK_SUCCESS) {
 		throw std::runtime_error("FAILED TO CREATE WINDOW SURFACE");
 	}
 }
@@ -75,8 +88,12 @@ void vgl::Window::initGLFWWindow() {
 
 	glfwSetWindowUserPointer(this->window, this);
 
-	//TODO TODO TODO
-	//Sort this out later
-	//glfwSetFramebufferSizeCallback(this->window, this->framebufferResizeCallback);
+	//Not all drivers return VK_ERROR_OUT_OF_DATE_KHR on resize so track it explicitly
+	glfwSetFramebufferSizeCallback(this->window, vgl::Window::framebufferResizeCallback);
+
+}
 
+void vgl::Window::framebufferResizeCallback(GLFWwindow* window, int, int) {
+	auto app = reinterpret_cast<vgl::Window*>(glfwGetWindowUserPointer(window));
+	app->framebufferResized = true;
 }
\ No newline at end of file
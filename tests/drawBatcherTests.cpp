@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "vgl/DrawBatcher.h"
+#include "vgl/JobSystem.h"
+
+/*
+CPU only tests for DrawBatcher::radixSort, no device is needed since the sort only works on the keys and values it is given.
+Returns non zero if any check fails so CTest reports it.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK FAILED: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (false)
+
+//Keys with few distinct values so there are plenty of ties, the values are the submission order
+static void makeInput(size_t count, uint64_t distinct, uint32_t seed, std::vector<uint64_t>& keys, std::vector<uint32_t>& values) {
+	std::mt19937_64 random(seed);
+	keys.resize(count);
+	values.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		//Spread the keys over the whole 64 bits so every pass has work to do
+		keys[i] = (random() % distinct) * 0x0101010101010101ull;
+		values[i] = static_cast<uint32_t>(i);
+	}
+}
+
+static bool isStablySorted(const std::vector<uint64_t>& keys, const std::vector<uint32_t>& values) {
+	for (size_t i = 1; i < keys.size(); i++) {
+		if (keys[i - 1] > keys[i]) { return false; }
+		if (keys[i - 1] == keys[i] && values[i - 1] > values[i]) { return false; }
+	}
+	return true;
+}
+
+static void testSerial() {
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> values;
+	std::vector<uint64_t> keyScratch;
+	std::vector<uint32_t> valueScratch;
+
+	makeInput(10000, 37, 1, keys, values);
+	std::vector<uint64_t> expected = keys;
+	std::sort(expected.begin(), expected.end());
+
+	vgl::DrawBatcher::radixSort(keys, values, keyScratch, valueScratch, nullptr);
+	CHECK(keys == expected);
+	CHECK(isStablySorted(keys, values));
+
+	//Every key the same, every pass is skipped and nothing moves
+	keys.assign(100, 42);
+	values.resize(100);
+	for (uint32_t i = 0; i < 100; i++) { values[i] = i; }
+	vgl::DrawBatcher::radixSort(keys, values, keyScratch, valueScratch, nullptr);
+	CHECK(isStablySorted(keys, values));
+	CHECK(values.front() == 0 && values.back() == 99);
+
+	//Nothing to sort
+	keys.clear();
+	values.clear();
+	vgl::DrawBatcher::radixSort(keys, values, keyScratch, valueScratch, nullptr);
+	CHECK(keys.empty());
+}
+
+static void testParallelMatchesSerial() {
+	vgl::JobSystem jobSystem(4);
+
+	//Large enough to be split into several chunks, plus a size that doesn't divide evenly between them
+	for (size_t count : { size_t(100), size_t(65536), size_t(100003) }) {
+		std::vector<uint64_t> serialKeys;
+		std::vector<uint32_t> serialValues;
+		makeInput(count, 1000, static_cast<uint32_t>(count), serialKeys, serialValues);
+		std::vector<uint64_t> parallelKeys = serialKeys;
+		std::vector<uint32_t> parallelValues = serialValues;
+
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint32_t> valueScratch;
+		vgl::DrawBatcher::radixSort(serialKeys, serialValues, keyScratch, valueScratch, nullptr);
+		vgl::DrawBatcher::radixSort(parallelKeys, parallelValues, keyScratch, valueScratch, &jobSystem);
+
+		CHECK(isStablySorted(serialKeys, serialValues));
+		CHECK(parallelKeys == serialKeys);
+		CHECK(parallelValues == serialValues);
+	}
+}
+
+int main() {
+	testSerial();
+	testParallelMatchesSerial();
+
+	if (failures != 0) {
+		std::fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("All draw batcher tests passed\n");
+	return 0;
+}
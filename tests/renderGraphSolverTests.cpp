@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "vgl/RenderGraphSolver.h"
+
+/*
+CPU only tests for RenderGraphSolver, no device is needed since the solver only works on the declared resources and passes.
+Returns non zero if any check fails so CTest reports it.
+*/
+
+using Solver = vgl::RenderGraphSolver;
+using Access = vgl::RenderGraphAccess;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK FAILED: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (false)
+
+static Solver::Resource transientImage(VkDeviceSize size) {
+	Solver::Resource resource;
+	resource.requirements.size = size;
+	resource.requirements.alignment = 256;
+	resource.requirements.memoryTypeBits = 1;
+	return resource;
+}
+
+static Solver::Resource outputImage() {
+	Solver::Resource resource;
+	resource.imported = true;
+	resource.output = true;
+	resource.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resource.initialStages = 0;
+	resource.initialAccess = 0;
+	resource.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	resource.finalStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	resource.finalAccess = VK_ACCESS_TRANSFER_READ_BIT;
+	return resource;
+}
+
+static Solver::Pass pass(std::vector<Solver::Use> uses, bool sideEffects = false) {
+	Solver::Pass result;
+	result.uses = std::move(uses);
+	result.sideEffects = sideEffects;
+	return result;
+}
+
+static const Solver::Barrier* findBarrier(const std::vector<Solver::Barrier>& barriers, uint32_t resource) {
+	for (const auto& barrier : barriers) {
+		if (barrier.resource == resource) { return &barrier; }
+	}
+	return nullptr;
+}
+
+static void testCulling() {
+	//0 feeds the output, 1 writes something nothing reads, 2 has side effects, 3 writes the output
+	std::vector<Solver::Resource> resources = { transientImage(1024), transientImage(1024), transientImage(1024), outputImage() };
+	std::vector<Solver::Pass> passes = {
+		pass({ { 0, Access::ColorAttachmentWrite } }),
+		pass({ { 1, Access::ColorAttachmentWrite } }),
+		pass({ { 2, Access::ComputeStorageWrite } }, true),
+		pass({ { 0, Access::FragmentSampled }, { 3, Access::ColorAttachmentWrite } }),
+	};
+
+	Solver::Result result = Solver::solve(resources, passes);
+	CHECK(result.culledPasses == 1);
+	CHECK(result.order.size() == 3);
+	CHECK(std::find(result.order.begin(), result.order.end(), 1) == result.order.end());
+	//The side effect pass shares nothing with the others so can go anywhere, 3 has to come after 0
+	CHECK(std::find(result.order.begin(), result.order.end(), 0) < std::find(result.order.begin(), result.order.end(), 3));
+	CHECK(result.firstUse[1] == Solver::invalidIndex);
+	CHECK(result.placements[1].heap == Solver::invalidIndex);
+
+	//A write that is overwritten before anything reads it is dead too
+	passes = {
+		pass({ { 3, Access::ColorAttachmentWrite } }),
+		pass({ { 3, Access::ColorAttachmentWrite } }),
+	};
+	result = Solver::solve(resources, passes);
+	CHECK(result.order == std::vector<uint32_t>{ 1 });
+	CHECK(result.culledPasses == 1);
+}
+
+static void testBarriers() {
+	std::vector<Solver::Resource> resources = { transientImage(1024), outputImage() };
+	std::vector<Solver::Pass> passes = {
+		pass({ { 0, Access::ColorAttachmentWrite } }),
+		pass({ { 0, Access::FragmentSampled }, { 1, Access::ColorAttachmentWrite } }),
+		pass({ { 0, Access::FragmentSampled }, { 1, Access::ColorAttachmentReadWrite } }),
+	};
+
+	Solver::Result result = Solver::solve(resources, passes);
+	CHECK((result.order == std::vector<uint32_t>{ 0, 1, 2 }));
+	CHECK(result.barriers.size() == 3);
+
+	//Read after write with a layout change
+	const Solver::Barrier* sampled = findBarrier(result.barriers[1], 0);
+	CHECK(sampled != nullptr);
+	if (sampled != nullptr) {
+		CHECK(sampled->oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		CHECK(sampled->newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		CHECK(sampled->srcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		CHECK(sampled->srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		CHECK(sampled->dstStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+
+	//The write is already visible to the fragment shader, so reading it again needs no barrier
+	CHECK(findBarrier(result.barriers[2], 0) == nullptr);
+
+	//Write after write on the output in the same layout
+	const Solver::Barrier* blend = findBarrier(result.barriers[2], 1);
+	CHECK(blend != nullptr);
+	if (blend != nullptr) {
+		CHECK(blend->oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		CHECK(blend->newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		CHECK(blend->srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	}
+
+	//The output is left in its final layout after the graph
+	CHECK(result.finalBarriers.size() == 1);
+	if (!result.finalBarriers.empty()) {
+		CHECK(result.finalBarriers[0].resource == 1);
+		CHECK(result.finalBarriers[0].newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		CHECK(result.finalBarriers[0].dstStages == VK_PIPELINE_STAGE_TRANSFER_BIT);
+	}
+
+	//Buffers never get layouts
+	resources = { transientImage(1024), outputImage() };
+	resources[0].image = false;
+	passes = {
+		pass({ { 0, Access::ComputeStorageWrite } }),
+		pass({ { 0, Access::VertexBuffer }, { 1, Access::ColorAttachmentWrite } }),
+	};
+	result = Solver::solve(resources, passes);
+	const Solver::Barrier* vertices = findBarrier(result.barriers[1], 0);
+	CHECK(vertices != nullptr);
+	if (vertices != nullptr) {
+		CHECK(vertices->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(vertices->newLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(vertices->srcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		CHECK(vertices->dstStages == VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	}
+}
+
+static void testAliasing() {
+	//A chain of transients, 0 is dead by the time 2 is written so they can share memory, 1 overlaps both
+	std::vector<Solver::Resource> resources = { transientImage(1024), transientImage(1024), transientImage(1024), outputImage() };
+	std::vector<Solver::Pass> passes = {
+		pass({ { 0, Access::ColorAttachmentWrite } }),
+		pass({ { 0, Access::FragmentSampled }, { 1, Access::ColorAttachmentWrite } }),
+		pass({ { 1, Access::FragmentSampled }, { 2, Access::ColorAttachmentWrite } }),
+		pass({ { 2, Access::FragmentSampled }, { 3, Access::ColorAttachmentWrite } }),
+	};
+
+	Solver::Result result = Solver::solve(resources, passes);
+	CHECK(result.transientBytes == 3072);
+	CHECK(result.heapBytes == 2048);
+	CHECK(result.heaps.size() == 1);
+	CHECK(result.placements[0].heap == result.placements[2].heap);
+	CHECK(result.placements[0].offset == result.placements[2].offset);
+	CHECK(result.placements[0].offset != result.placements[1].offset);
+	CHECK(result.placements[3].heap == Solver::invalidIndex);
+
+	//The first use of 2 has to wait for everything that used 0's memory
+	const Solver::Barrier* reuse = findBarrier(result.barriers[2], 2);
+	CHECK(reuse != nullptr);
+	if (reuse != nullptr) {
+		CHECK(reuse->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK((reuse->srcStages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0);
+		CHECK((reuse->srcStages & VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) != 0);
+	}
+
+	//Images and buffers never share a heap
+	resources[2].image = false;
+	passes[2] = pass({ { 1, Access::FragmentSampled }, { 2, Access::ComputeStorageWrite } });
+	passes[3] = pass({ { 2, Access::ComputeStorageRead }, { 3, Access::ColorAttachmentWrite } });
+	result = Solver::solve(resources, passes);
+	CHECK(result.heaps.size() == 2);
+	CHECK(result.placements[0].heap != result.placements[2].heap);
+}
+
+static void testCycles() {
+	//Dependencies are taken from declaration order, so the only cycles that can be declared are a pass depending on itself
+	//through a read and write of the same resource, those have to be scheduled rather than rejected or dropped
+	std::vector<Solver::Resource> resources = { transientImage(1024), outputImage() };
+	std::vector<Solver::Pass> passes = {
+		pass({ { 0, Access::ColorAttachmentWrite } }),
+		pass({ { 0, Access::ColorAttachmentReadWrite } }),
+		pass({ { 0, Access::FragmentSampled }, { 0, Access::ComputeStorageWrite }, { 1, Access::ColorAttachmentWrite } }),
+	};
+
+	bool threw = false;
+	Solver::Result result;
+	try {
+		result = Solver::solve(resources, passes);
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+	CHECK(!threw);
+	CHECK((result.order == std::vector<uint32_t>{ 0, 1, 2 }));
+
+	//Used two ways at once, the resource has to be in a layout both allow
+	if (result.barriers.size() == 3) {
+		const Solver::Barrier* merged = findBarrier(result.barriers[2], 0);
+		CHECK(merged != nullptr);
+		if (merged != nullptr) { CHECK(merged->newLayout == VK_IMAGE_LAYOUT_GENERAL); }
+	}
+
+	//Side effects keep their declaration order even without a shared resource
+	resources = { transientImage(1024), transientImage(1024) };
+	passes = {
+		pass({ { 0, Access::ComputeStorageWrite } }, true),
+		pass({ { 1, Access::ComputeStorageWrite } }, true),
+	};
+	result = Solver::solve(resources, passes);
+	CHECK((result.order == std::vector<uint32_t>{ 0, 1 }));
+}
+
+int main() {
+	testCulling();
+	testBarriers();
+	testAliasing();
+	testCycles();
+
+	if (failures != 0) {
+		std::fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("All render graph solver tests passed\n");
+	return 0;
+}